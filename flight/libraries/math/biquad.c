@@ -0,0 +1,103 @@
+/**
+ ******************************************************************************
+ * @addtogroup OpenPilot Math Utilities
+ * @{
+ * @addtogroup Biquad filter
+ * @{
+ *
+ * @file       biquad.c
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      Second order IIR filter sections (low pass and notch)
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <math.h>
+#include <pios_math.h>
+#include "biquad.h"
+
+// Coefficients follow the "Cookbook formulae for audio EQ biquad filter coefficients" by R. Bristow-Johnson
+
+static void biquad_init_passthrough(biquad_t *filter)
+{
+    filter->b0 = 1.0f;
+    filter->b1 = 0.0f;
+    filter->b2 = 0.0f;
+    filter->a1 = 0.0f;
+    filter->a2 = 0.0f;
+    filter->z1 = 0.0f;
+    filter->z2 = 0.0f;
+}
+
+bool biquad_init_lowpass(biquad_t *filter, float cutoff, float sample_rate)
+{
+    if (!(cutoff > 0.0f) || !(cutoff < 0.5f * sample_rate)) {
+        biquad_init_passthrough(filter);
+        return false;
+    }
+
+    const float w0    = M_2PI_F * cutoff / sample_rate;
+    const float sh    = sinf(0.5f * w0);
+    const float omc   = 2.0f * sh * sh; // 1 - cos(w0), without cancellation for low cut-off ratios
+    const float alpha = sinf(w0) * M_SQRT1_2_F; // sin(w0) / (2 * Q) with Q = 1 / sqrt(2)
+    const float a0inv = 1.0f / (1.0f + alpha);
+
+    filter->b0 = 0.5f * omc * a0inv;
+    filter->b1 = omc * a0inv;
+    filter->b2 = filter->b0;
+    filter->a1 = -2.0f * (1.0f - omc) * a0inv;
+    filter->a2 = (1.0f - alpha) * a0inv;
+    filter->z1 = 0.0f;
+    filter->z2 = 0.0f;
+    return true;
+}
+
+bool biquad_init_notch(biquad_t *filter, float center, float q, float sample_rate)
+{
+    if (!(center > 0.0f) || !(center < 0.5f * sample_rate) || !(q > 0.0f)) {
+        biquad_init_passthrough(filter);
+        return false;
+    }
+
+    const float w0    = M_2PI_F * center / sample_rate;
+    const float cs    = cosf(w0);
+    const float alpha = sinf(w0) / (2.0f * q);
+    const float a0inv = 1.0f / (1.0f + alpha);
+
+    filter->b0 = a0inv;
+    filter->b1 = -2.0f * cs * a0inv;
+    filter->b2 = a0inv;
+    filter->a1 = filter->b1;
+    filter->a2 = (1.0f - alpha) * a0inv;
+    filter->z1 = 0.0f;
+    filter->z2 = 0.0f;
+    return true;
+}
+
+void biquad_reset(biquad_t *filter, float value)
+{
+    // All the sections built here have unity gain at DC
+    filter->z2 = (filter->b2 - filter->a2) * value;
+    filter->z1 = (filter->b1 - filter->a1) * value + filter->z2;
+}
+
+/**
+ * @}
+ * @}
+ */
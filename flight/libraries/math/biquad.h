@@ -0,0 +1,96 @@
+/**
+ ******************************************************************************
+ * @addtogroup OpenPilot Math Utilities
+ * @{
+ * @addtogroup Biquad filter
+ * @{
+ *
+ * @file       biquad.h
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      Second order IIR filter sections (low pass and notch)
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef BIQUAD_H
+#define BIQUAD_H
+
+#include <stdbool.h>
+
+/***
+ * Second order section in transposed direct form 2.
+ * Coefficients are normalised so that a0 = 1.
+ */
+typedef struct {
+    float b0;
+    float b1;
+    float b2;
+    float a1;
+    float a2;
+    float z1;
+    float z2;
+} biquad_t;
+
+/***
+ * Configure a Butterworth low pass section
+ * @param filter the instance to be initialized
+ * @param cutoff cut-off frequency in Hz
+ * @param sample_rate rate in Hz at which samples are filtered
+ * @return false if the cut-off is not below the Nyquist frequency, the section then passes samples through
+ */
+bool biquad_init_lowpass(biquad_t *filter, float cutoff, float sample_rate);
+
+/***
+ * Configure a notch section
+ * @param filter the instance to be initialized
+ * @param center rejected frequency in Hz
+ * @param q quality factor, center frequency divided by the -3dB bandwidth
+ * @param sample_rate rate in Hz at which samples are filtered
+ * @return false if the center is not below the Nyquist frequency, the section then passes samples through
+ */
+bool biquad_init_notch(biquad_t *filter, float center, float q, float sample_rate);
+
+/***
+ * Set the filter state as if a constant input had been applied for ever
+ * @param filter the working instance
+ * @param value the constant input
+ */
+void biquad_reset(biquad_t *filter, float value);
+
+/***
+ * Filter a new sample
+ * @param filter the working instance
+ * @param sample the new sample
+ * @return filtered value
+ */
+static inline float biquad_apply(biquad_t *filter, float sample)
+{
+    const float out = filter->b0 * sample + filter->z1;
+
+    filter->z1 = filter->b1 * sample - filter->a1 * out + filter->z2;
+    filter->z2 = filter->b2 * sample - filter->a2 * out;
+    return out;
+}
+
+#endif /* BIQUAD_H */
+
+/**
+ * @}
+ * @}
+ */
@@ -140,6 +140,7 @@ SRC += $(FLIGHTLIB)/fifo_buffer.c
 
 SRC += $(MATHLIB)/mathmisc.c
 SRC += $(MATHLIB)/butterworth.c
+SRC += $(MATHLIB)/biquad.c
 SRC += $(FLIGHTLIB)/printf-stdarg.c
 SRC += $(FLIGHTLIB)/optypes.c
 
@@ -66,6 +66,7 @@
 #include <UBX.h>
 
 #include <mathmisc.h>
+#include <biquad.h>
 #include <taskinfo.h>
 #include <pios_math.h>
 #include <pios_constants.h>
@@ -106,6 +107,10 @@ static const float temp_alpha_baro = TEMP_DT_BARO / (TEMP_DT_BARO + 1.0f / (2.0f
 
 #define ZERO_ROT_ANGLE           0.00001f
 
+// Accel/gyro samples passed through each stage of the filter chain at once
+#define FILTER_BATCH_SIZE        32
+#define GYRO_NOTCH_COUNT         REVOSETTINGS_GYRONOTCHFREQUENCY_NUMELEM
+
 // Private types
 typedef struct {
     // used to accumulate all samples in a task iteration
@@ -113,9 +118,30 @@ typedef struct {
     Vector3i32 accum[2]; // summed 16 bit sensor values in this averaged set
     int32_t    temperature;    // sum of 16 bit temperatures in this averaged set
     uint32_t   prev_timestamp; // to detect timer wrap around
+    uint32_t   last_timestamp; // PIOS_DELAY_GetRaw() time of the newest sensor read
     uint16_t   count;          // number of sensor reads in this averaged set
 } sensor_fetch_context;
 
+typedef struct {
+    // samples waiting to go through the filter chain, [0] accel [1] gyro
+    float    sample[MAX_SENSORS_PER_INSTANCE][FILTER_BATCH_SIZE][3];
+    uint16_t count;
+} sensor_filter_batch;
+
+typedef struct sensor_state {
+    // filter chain of one accel/gyro sensor
+    const PIOS_SENSORS_Instance *sensor;
+    struct sensor_state *next;
+    float    filter_rate;      // sample rate the filters are configured for, 0 if not configured
+    uint8_t  filter_settings;  // filter_settings_id the filters are configured for
+    uint8_t  filter_primed;    // sensor types whose filter state was set from a sample
+    uint8_t  gyro_notch_count; // enabled notches, at the start of gyro_notch
+    biquad_t accel_lowpass[3];
+    biquad_t gyro_lowpass[3];
+    biquad_t gyro_notch[GYRO_NOTCH_COUNT][3];
+    float    filter_output[MAX_SENSORS_PER_INSTANCE][3];
+} sensor_state;
+
 #define MAX_SENSOR_DATA_SIZE (sizeof(PIOS_SENSORS_3Axis_SensorsWithTemp) + MAX_SENSORS_PER_INSTANCE * sizeof(Vector3i16))
 typedef union {
     PIOS_SENSORS_3Axis_SensorsWithTemp sensorSample3Axis;
@@ -131,6 +157,9 @@ PERF_DEFINE_COUNTER(counterMagPeriod);
 PERF_DEFINE_COUNTER(counterBaroPeriod);
 PERF_DEFINE_COUNTER(counterSensorPeriod);
 PERF_DEFINE_COUNTER(counterSensorResets);
+PERF_DEFINE_COUNTER(counterNotchFilter);
+PERF_DEFINE_COUNTER(counterLowPassFilter);
+PERF_DEFINE_COUNTER(counterFilteredPublish);
 
 #if defined(PIOS_INCLUDE_HMC5X83)
 void aux_hmc5x83_load_settings();
@@ -144,6 +173,12 @@ static void accumulateSamples(sensor_fetch_context *sensor_context, sensor_data
 static void processSamples3d(sensor_fetch_context *sensor_context, const PIOS_SENSORS_Instance *sensor);
 static void processSamples1d(PIOS_SENSORS_1Axis_SensorsWithTemp *sample, const PIOS_SENSORS_Instance *sensor);
 
+static sensor_state *getSensorState(const PIOS_SENSORS_Instance *sensor);
+static bool setupFilters(sensor_state *state);
+static void addFilterSample(sensor_data *sample, const PIOS_SENSORS_Instance *sensor);
+static void filterSamples(sensor_state *state);
+static void processFilteredSamples(sensor_fetch_context *sensor_context, const sensor_state *state);
+
 static void clearContext(sensor_fetch_context *sensor_context);
 
 static void handleAccel(float *samples, float temperature);
@@ -194,6 +229,13 @@ static float baro_temp_bias   = 0;
 static float baro_temperature = NAN;
 static uint8_t baro_temp_calibration_count = 0;
 
+// Accel/gyro filter chain, used instead of averaging when SensorDecimation is Filter
+// Both are allocated on first use, boards that do not filter do without
+static sensor_filter_batch *filter_batch;
+static sensor_state *sensor_states;
+static volatile bool filter_enabled = false;
+static volatile uint8_t filter_settings_id = 0; // changed on each settings update
+
 #if defined(PIOS_INCLUDE_HMC5X83)
 // Allow AuxMag to be disabled without reboot
 // because the other mags are that way
@@ -274,6 +316,9 @@ static void SensorsTask(__attribute__((unused)) void *parameters)
     PERF_INIT_COUNTER(counterBaroPeriod, 0x53000004);
     PERF_INIT_COUNTER(counterSensorPeriod, 0x53000005);
     PERF_INIT_COUNTER(counterSensorResets, 0x53000006);
+    PERF_INIT_COUNTER(counterNotchFilter, 0x53000007);
+    PERF_INIT_COUNTER(counterLowPassFilter, 0x53000008);
+    PERF_INIT_COUNTER(counterFilteredPublish, 0x53000009);
 
     // Test sensors
     bool sensors_test = true;
@@ -318,13 +363,26 @@ static void SensorsTask(__attribute__((unused)) void *parameters)
 
             if (!sensor->driver->is_polled) {
                 const QueueHandle_t queue = PIOS_SENSORS_GetQueue(sensor);
+                sensor_state *state = getSensorState(sensor);
+                const bool filter = state && setupFilters(state);
                 while (xQueueReceive(queue,
                                      (void *)source_data,
                                      (is_primary && !sensor_context.count) ? sensor_period_ticks : 0) == pdTRUE) {
                     accumulateSamples(&sensor_context, source_data);
+                    if (filter) {
+                        addFilterSample(source_data, sensor);
+                        if (filter_batch->count == FILTER_BATCH_SIZE) {
+                            filterSamples(state);
+                        }
+                    }
                 }
                 if (sensor_context.count) {
-                    processSamples3d(&sensor_context, sensor);
+                    if (filter) {
+                        filterSamples(state);
+                        processFilteredSamples(&sensor_context, state);
+                    } else {
+                        processSamples3d(&sensor_context, sensor);
+                    }
                     clearContext(&sensor_context);
                 } else if (is_primary) {
                     PIOS_SENSOR_Reset(sensor);
@@ -361,6 +419,7 @@ static void clearContext(sensor_fetch_context *sensor_context)
     }
     sensor_context->temperature    = 0;
     sensor_context->prev_timestamp = 0;
+    sensor_context->last_timestamp = 0;
     sensor_context->timestamp = 0LL;
     sensor_context->count     = 0;
 }
@@ -381,6 +440,7 @@ static void accumulateSamples(sensor_fetch_context *sensor_context, sensor_data
     } else {
         sensor_context->prev_timestamp = sample->sensorSample3Axis.timestamp;
     }
+    sensor_context->last_timestamp = sample->sensorSample3Axis.timestamp;
     sensor_context->count++;
 }
 
@@ -441,6 +501,207 @@ static void processSamples3d(sensor_fetch_context *sensor_context, const PIOS_SE
     }
 }
 
+/**
+ * Find the filter chain state of an accel/gyro sensor,
+ * created the first time the sensor is filtered
+ * @return the state, NULL if the sensor does not need one
+ */
+static sensor_state *getSensorState(const PIOS_SENSORS_Instance *sensor)
+{
+    sensor_state *state;
+
+    LL_FOREACH(sensor_states, state) {
+        if (state->sensor == sensor) {
+            return state;
+        }
+    }
+
+    if (!(sensor->type & PIOS_SENSORS_TYPE_3AXIS_GYRO_ACCEL) || !filter_enabled) {
+        return NULL;
+    }
+
+    state = (sensor_state *)pios_malloc(sizeof(sensor_state));
+    PIOS_Assert(state);
+    memset(state, 0, sizeof(sensor_state));
+    state->sensor = sensor;
+    LL_APPEND(sensor_states, state);
+    return state;
+}
+
+/**
+ * Configure the filter chain for the sample rate of the sensor
+ * @return true if the samples of the sensor have to be filtered, false to average them
+ */
+static bool setupFilters(sensor_state *state)
+{
+    if (!filter_enabled) {
+        return false;
+    }
+
+    if (!filter_batch) {
+        filter_batch = (sensor_filter_batch *)pios_malloc(sizeof(sensor_filter_batch));
+        PIOS_Assert(filter_batch);
+        filter_batch->count = 0;
+    }
+
+    const float rate = PIOS_SENSORS_GetSampleRate(state->sensor);
+    if (!(rate > 0.0f)) {
+        // cannot design the filters without knowing the sample rate
+        return false;
+    }
+
+    const uint8_t settings = filter_settings_id;
+    if (settings != state->filter_settings || rate != state->filter_rate) {
+        // Read the settings here rather than from copies written by settingsUpdatedCb,
+        // RevoSettings is only accessed under its own lock. An update racing with this
+        // changes filter_settings_id again, so the filters are set up again next time.
+        RevoSettingsSensorLowPassCutoffData filter_cutoff;
+        float filter_notch_frequency[GYRO_NOTCH_COUNT];
+        float filter_notch_q;
+        RevoSettingsSensorLowPassCutoffGet(&filter_cutoff);
+        RevoSettingsGyroNotchFrequencyArrayGet(filter_notch_frequency);
+        RevoSettingsGyroNotchQGet(&filter_notch_q);
+
+        state->filter_settings  = settings;
+        state->filter_rate      = rate;
+        state->gyro_notch_count = 0;
+        for (uint8_t i = 0; i < GYRO_NOTCH_COUNT; i++) {
+            biquad_t *notch = state->gyro_notch[state->gyro_notch_count];
+            if (biquad_init_notch(&notch[0], filter_notch_frequency[i], filter_notch_q, rate)) {
+                notch[1] = notch[0];
+                notch[2] = notch[0];
+                state->gyro_notch_count++;
+            }
+        }
+        for (uint8_t axis = 0; axis < 3; axis++) {
+            biquad_init_lowpass(&state->accel_lowpass[axis], filter_cutoff.Accel, rate);
+            biquad_init_lowpass(&state->gyro_lowpass[axis], filter_cutoff.Gyro, rate);
+        }
+        state->filter_primed = 0;
+    }
+
+    return true;
+}
+
+static void addFilterSample(sensor_data *sample, const PIOS_SENSORS_Instance *sensor)
+{
+    const Vector3i16 *raw = sample->sensorSample3Axis.sample;
+    const uint16_t n = filter_batch->count;
+    uint8_t index    = 0;
+
+    if (sensor->type & PIOS_SENSORS_TYPE_3AXIS_ACCEL) {
+        filter_batch->sample[0][n][0] = raw[0].x;
+        filter_batch->sample[0][n][1] = raw[0].y;
+        filter_batch->sample[0][n][2] = raw[0].z;
+        index = 1;
+    }
+    if (sensor->type & PIOS_SENSORS_TYPE_3AXIS_GYRO) {
+        filter_batch->sample[1][n][0] = raw[index].x;
+        filter_batch->sample[1][n][1] = raw[index].y;
+        filter_batch->sample[1][n][2] = raw[index].z;
+    }
+    filter_batch->count++;
+}
+
+/**
+ * Run the batched samples through the filter chain, one stage at a time.
+ * Only the newest output is kept for publishing, the filters run at the
+ * sensor rate and the task period decimates their output.
+ */
+static void filterSamples(sensor_state *state)
+{
+    const PIOS_SENSORS_Instance *sensor = state->sensor;
+    const uint16_t count = filter_batch->count;
+    float(*accel)[3] = filter_batch->sample[0];
+    float(*gyro)[3]  = filter_batch->sample[1];
+    const bool has_accel = sensor->type & PIOS_SENSORS_TYPE_3AXIS_ACCEL;
+    const bool has_gyro  = sensor->type & PIOS_SENSORS_TYPE_3AXIS_GYRO;
+
+    if (!count) {
+        return;
+    }
+
+    // start from the first sample rather than from zero to avoid a long settling transient
+    if (has_accel && !(state->filter_primed & PIOS_SENSORS_TYPE_3AXIS_ACCEL)) {
+        for (uint8_t axis = 0; axis < 3; axis++) {
+            biquad_reset(&state->accel_lowpass[axis], accel[0][axis]);
+        }
+    }
+    if (has_gyro && !(state->filter_primed & PIOS_SENSORS_TYPE_3AXIS_GYRO)) {
+        for (uint8_t axis = 0; axis < 3; axis++) {
+            for (uint8_t i = 0; i < state->gyro_notch_count; i++) {
+                biquad_reset(&state->gyro_notch[i][axis], gyro[0][axis]);
+            }
+            biquad_reset(&state->gyro_lowpass[axis], gyro[0][axis]);
+        }
+    }
+    state->filter_primed |= sensor->type & PIOS_SENSORS_TYPE_3AXIS_GYRO_ACCEL;
+
+    if (has_gyro && state->gyro_notch_count) {
+        PERF_TIMED_SECTION_START(counterNotchFilter);
+        for (uint8_t i = 0; i < state->gyro_notch_count; i++) {
+            for (uint8_t axis = 0; axis < 3; axis++) {
+                biquad_t *notch = &state->gyro_notch[i][axis];
+                for (uint16_t n = 0; n < count; n++) {
+                    gyro[n][axis] = biquad_apply(notch, gyro[n][axis]);
+                }
+            }
+        }
+        PERF_TIMED_SECTION_END(counterNotchFilter);
+    }
+
+    PERF_TIMED_SECTION_START(counterLowPassFilter);
+    for (uint8_t axis = 0; axis < 3; axis++) {
+        if (has_accel) {
+            biquad_t *lowpass = &state->accel_lowpass[axis];
+            for (uint16_t n = 0; n < count; n++) {
+                accel[n][axis] = biquad_apply(lowpass, accel[n][axis]);
+            }
+            state->filter_output[0][axis] = accel[count - 1][axis];
+        }
+        if (has_gyro) {
+            biquad_t *lowpass = &state->gyro_lowpass[axis];
+            for (uint16_t n = 0; n < count; n++) {
+                gyro[n][axis] = biquad_apply(lowpass, gyro[n][axis]);
+            }
+            state->filter_output[1][axis] = gyro[count - 1][axis];
+        }
+    }
+    PERF_TIMED_SECTION_END(counterLowPassFilter);
+
+    filter_batch->count = 0;
+}
+
+static void processFilteredSamples(sensor_fetch_context *sensor_context, const sensor_state *state)
+{
+    const PIOS_SENSORS_Instance *sensor = state->sensor;
+    float samples[3];
+    float scales[MAX_SENSORS_PER_INSTANCE];
+    uint8_t index = 0;
+
+    PIOS_SENSORS_GetScales(sensor, scales, MAX_SENSORS_PER_INSTANCE);
+    const float temperature = (float)sensor_context->temperature / (float)sensor_context->count * 0.01f;
+
+    PERF_TIMED_SECTION_START(counterFilteredPublish);
+    if (sensor->type & PIOS_SENSORS_TYPE_3AXIS_ACCEL) {
+        samples[0] = state->filter_output[0][0] * scales[0];
+        samples[1] = state->filter_output[0][1] * scales[0];
+        samples[2] = state->filter_output[0][2] * scales[0];
+        PERF_TRACK_VALUE(counterAccelSamples, sensor_context->count);
+        PERF_MEASURE_PERIOD(counterAccelPeriod);
+        handleAccel(samples, temperature);
+        index = 1;
+    }
+
+    if (sensor->type & PIOS_SENSORS_TYPE_3AXIS_GYRO) {
+        samples[0] = state->filter_output[1][0] * scales[index];
+        samples[1] = state->filter_output[1][1] * scales[index];
+        samples[2] = state->filter_output[1][2] * scales[index];
+        handleGyro(samples, temperature, sensor_context->last_timestamp);
+    }
+    PERF_TIMED_SECTION_END(counterFilteredPublish);
+}
+
 static void processSamples1d(PIOS_SENSORS_1Axis_SensorsWithTemp *sample, const PIOS_SENSORS_Instance *sensor)
 {
     switch (sensor->type) {
@@ -637,6 +898,11 @@ static void settingsUpdatedCb(__attribute__((unused)) UAVObjEvent *objEv)
     // so add the scaling, and store the result in mag_transform for run time use
     matrix_mult_3x3f((float(*)[3])RevoCalibrationmag_transformToArray(cal.mag_transform), R, mag_transform);
 
+    RevoSettingsSensorDecimationOptions decimation;
+    RevoSettingsSensorDecimationGet(&decimation);
+    filter_enabled = (decimation == REVOSETTINGS_SENSORDECIMATION_FILTER);
+    filter_settings_id++;
+
     RevoSettingsBaroTempCorrectionPolynomialGet(&baroCorrection);
     RevoSettingsBaroTempCorrectionExtentGet(&baroCorrectionExtent);
     baro_temp_correction_enabled =
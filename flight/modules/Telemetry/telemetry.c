@@ -51,13 +51,22 @@
  *
  * Data is passed on the telemetry channels using queues. If
  * PIOS_TELEM_PRIORITY_QUEUE is defined then two queues are created, one normal
- * priority and the other high priority.
+ * priority and the other high priority. If PIOS_TELEM_COALESCE_EVENTS is
+ * defined an object update waiting in a queue is not queued again.
  *
  * The "Tx" tasks read events first from the priority queue and then from
  * the normal queue, passing each event to processObjEvent() which ultimately
  * passes each event to the UAVTalk library which results in the appropriate
  * transmit routine being called to send the data back to the recipient on
  * the "local" or "radio" link.
+ *
+ * Unacknowledged updates sent by the "Tx" tasks are not written to the port
+ * one frame at a time, they are collected in a per channel transmit batch
+ * and written with a single call once the queues run empty, the batch is
+ * full or TELEM_TX_BATCH_LATENCY_MS has passed since its first frame.
+ * UAVTalk builds these frames right in the batch, see reserveData().
+ * Everything else (acked updates, object requests and all frames sent from
+ * the "Rx" tasks) flushes the batch first and is written immediately.
  */
 
 #include <openpilot.h>
@@ -65,6 +74,7 @@
 #include "telemetry.h"
 
 #include "flighttelemetrystats.h"
+#include "flighttelemetrybatchstats.h"
 #include "gcstelemetrystats.h"
 #include "hwsettings.h"
 #include "taskinfo.h"
@@ -97,6 +107,14 @@
 #define STATS_UPDATE_PERIOD_MS    4000
 #define CONNECTION_TIMEOUT_MS     8000
 
+// Transmit batching, see header comment
+#ifndef TELEM_TX_BATCH_SIZE
+#define TELEM_TX_BATCH_SIZE       128
+#endif
+#ifndef TELEM_TX_BATCH_LATENCY_MS
+#define TELEM_TX_BATCH_LATENCY_MS 10
+#endif
+
 #ifdef PIOS_INCLUDE_RFM22B
 #define HAS_RADIO
 #endif
@@ -118,12 +136,28 @@ typedef struct {
     xTaskHandle rxTaskHandle;
     // Telemetry stream
     UAVTalkConnection uavTalkCon;
+
+    // Transmit batch, protected by txBatchLock
+    xSemaphoreHandle  txBatchLock;
+    uint8_t  txBatch[TELEM_TX_BATCH_SIZE];
+    uint16_t txBatchLength;
+    uint16_t txBatchFrames;
+    uint32_t txBatchStart;
+    // Set by the Tx task while it sends frames that may be batched
+    bool     txBatching;
+
+    // Port write stats, reset on each stats update, protected by txBatchLock
+    uint32_t txWrites;
+    uint32_t txWriteFrames;
+    uint32_t txWriteBytes;
+    uint32_t txWriteErrors;
 } channelContext;
 
 #ifdef HAS_RADIO
 // Main telemetry channel
 static channelContext localChannel;
 static int32_t transmitLocalData(uint8_t *data, int32_t length);
+static uint8_t *reserveLocalData(int32_t length);
 static void registerLocalObject(UAVObjHandle obj);
 static uint32_t localPort();
 #endif /* ifdef HAS_RADIO */
@@ -133,6 +167,7 @@ static void updateSettings(channelContext *channel);
 // OPLink telemetry channel
 static channelContext radioChannel;
 static int32_t transmitRadioData(uint8_t *data, int32_t length);
+static uint8_t *reserveRadioData(int32_t length);
 static void registerRadioObject(UAVObjHandle obj);
 static uint32_t radioPort();
 static uint32_t radio_port;
@@ -149,6 +184,7 @@ static void updateObject(
     channelContext *channel,
     UAVObjHandle obj,
     int32_t eventType);
+static void connectObjectQueue(UAVObjHandle obj, xQueueHandle queue, uint8_t eventMask);
 static void processObjEvent(
     channelContext *channel,
     UAVObjEvent *ev);
@@ -160,6 +196,17 @@ static int32_t setLoggingPeriod(
     channelContext *channel,
     UAVObjHandle obj,
     int32_t updatePeriodMs);
+static int32_t transmitData(
+    channelContext *channel,
+    uint8_t *data,
+    int32_t length);
+static uint8_t *reserveData(
+    channelContext *channel,
+    int32_t length);
+static void flushTxBatch(channelContext *channel);
+static void flushLateTxBatch(channelContext *channel);
+static void flushTxBatchLocked(channelContext *channel, uint32_t outputPort);
+static void takeTxWriteStats(channelContext *channel, uint32_t *writes, uint32_t *frames, uint32_t *bytes, uint32_t *errors);
 static void updateTelemetryStats();
 static void gcsTelemetryStatsUpdated();
 
@@ -243,6 +290,8 @@ void TelemetryInitializeChannel(channelContext *channel)
                                           sizeof(UAVObjEvent));
 #endif /* PIOS_TELEM_PRIORITY_QUEUE */
 
+    channel->txBatchLock = xSemaphoreCreateRecursiveMutex();
+
     // Create periodic event that will be used to update the telemetry stats
     UAVObjEvent ev;
     memset(&ev, 0, sizeof(UAVObjEvent));
@@ -283,6 +332,7 @@ int32_t TelemetryInitialize(void)
 #endif /* PIOS_INCLUDE_RFM22B */
 
     FlightTelemetryStatsInitialize();
+    FlightTelemetryBatchStatsInitialize();
     GCSTelemetryStatsInitialize();
 
     // Initialize vars
@@ -305,6 +355,7 @@ int32_t TelemetryInitialize(void)
         TelemetryInitializeChannel(&localChannel);
         // Initialise UAVTalk
         localChannel.uavTalkCon = UAVTalkInitialize(&transmitLocalData);
+        UAVTalkSetOutputReserve(localChannel.uavTalkCon, &reserveLocalData);
     }
 #endif /* ifdef HAS_RADIO */
 
@@ -318,6 +369,7 @@ int32_t TelemetryInitialize(void)
     TelemetryInitializeChannel(&radioChannel);
     // Initialise UAVTalk
     radioChannel.uavTalkCon = UAVTalkInitialize(&transmitRadioData);
+    UAVTalkSetOutputReserve(radioChannel.uavTalkCon, &reserveRadioData);
 
     return 0;
 }
@@ -471,11 +523,25 @@ static void updateObject(
     // note that all setting objects have implicitly IsPriority=true
 #ifdef PIOS_TELEM_PRIORITY_QUEUE
     if (UAVObjIsPriority(obj)) {
-        UAVObjConnectQueue(obj, channel->priorityQueue, eventMask);
+        connectObjectQueue(obj, channel->priorityQueue, eventMask);
     } else
 #endif /* PIOS_TELEM_PRIORITY_QUEUE */
 
-    UAVObjConnectQueue(obj, channel->queue, eventMask);
+    connectObjectQueue(obj, channel->queue, eventMask);
+}
+
+/**
+ * Connect an object to a telemetry queue. With PIOS_TELEM_COALESCE_EVENTS an object updated
+ * faster than the link can send it is queued only once, the latest data is packed when the
+ * event is processed. Each connection then costs a few bytes of heap per object instance.
+ */
+static void connectObjectQueue(UAVObjHandle obj, xQueueHandle queue, uint8_t eventMask)
+{
+#ifdef PIOS_TELEM_COALESCE_EVENTS
+    UAVObjConnectQueueCoalesced(obj, queue, eventMask);
+#else
+    UAVObjConnectQueue(obj, queue, eventMask);
+#endif
 }
 
 
@@ -506,6 +572,9 @@ static void processObjEvent(
         if ((ev->event == EV_UPDATED && (updateMode == UPDATEMODE_ONCHANGE || updateMode == UPDATEMODE_THROTTLED))
             || ev->event == EV_UPDATED_MANUAL
             || (ev->event == EV_UPDATED_PERIODIC && updateMode != UPDATEMODE_THROTTLED)) {
+            // Unacked updates can wait in the transmit batch, acked ones
+            // must go out before we start waiting for the ack
+            channel->txBatching = !UAVObjGetTelemetryAcked(&metadata);
             // Send update to GCS (with retries)
             while (retries < MAX_RETRIES && success == -1) {
                 // call blocks until ack is received or timeout
@@ -517,6 +586,7 @@ static void processObjEvent(
                     ++retries;
                 }
             }
+            channel->txBatching = false;
             // Update stats
             txRetries += retries;
             if (success == -1) {
@@ -603,26 +673,41 @@ static void telemetryTxTask(void *parameters)
 
 #ifdef PIOS_TELEM_PRIORITY_QUEUE
         // empty priority queue, non-blocking
-        while (xQueueReceive(channel->priorityQueue, &ev, 0) == pdTRUE) {
+        while (UAVObjQueueReceive(channel->priorityQueue, &ev, 0) == pdTRUE) {
             // Process event
             processObjEvent(channel, &ev);
         }
         // check regular queue and process update - non-blocking
-        if (xQueueReceive(channel->queue, &ev, 0) == pdTRUE) {
-            // Process event
-            processObjEvent(channel, &ev);
-            // if both queues are empty, wait on priority queue for updates (1 tick) then repeat cycle
-        } else if (xQueueReceive(channel->priorityQueue, &ev, 1) == pdTRUE) {
+        if (UAVObjQueueReceive(channel->queue, &ev, 0) == pdTRUE) {
             // Process event
             processObjEvent(channel, &ev);
+        } else {
+            // both queues are empty, send what was batched so far and
+            // wait on priority queue for updates (1 tick) then repeat cycle
+            flushTxBatch(channel);
+            if (UAVObjQueueReceive(channel->priorityQueue, &ev, 1) == pdTRUE) {
+                // Process event
+                processObjEvent(channel, &ev);
+            }
         }
 #else
-        // wait on queue for updates (1 tick) then repeat cycle
-        if (xQueueReceive(channel->queue, &ev, 1) == pdTRUE) {
+        // check queue and process update - non-blocking
+        if (UAVObjQueueReceive(channel->queue, &ev, 0) == pdTRUE) {
             // Process event
             processObjEvent(channel, &ev);
+        } else {
+            // queue is empty, send what was batched so far and
+            // wait on queue for updates (1 tick) then repeat cycle
+            flushTxBatch(channel);
+            if (UAVObjQueueReceive(channel->queue, &ev, 1) == pdTRUE) {
+                // Process event
+                processObjEvent(channel, &ev);
+            }
         }
 #endif /* PIOS_TELEM_PRIORITY_QUEUE */
+
+        // Do not hold back batched frames for too long under sustained load
+        flushLateTxBatch(channel);
     }
 }
 
@@ -698,13 +783,17 @@ static uint32_t radioPort()
  */
 static int32_t transmitLocalData(uint8_t *data, int32_t length)
 {
-    uint32_t outputPort = localChannel.getPort();
-
-    if (outputPort) {
-        return PIOS_COM_SendBuffer(outputPort, data, length);
-    }
+    return transmitData(&localChannel, data, length);
+}
 
-    return -1;
+/**
+ * Room for the next frame sent to the modem or USB port.
+ * \param[in] length Largest length of the frame
+ * \return where to build the frame, NULL if it is not batched
+ */
+static uint8_t *reserveLocalData(int32_t length)
+{
+    return reserveData(&localChannel, length);
 }
 #endif /* ifdef HAS_RADIO */
 
@@ -717,13 +806,191 @@ static int32_t transmitLocalData(uint8_t *data, int32_t length)
  */
 static int32_t transmitRadioData(uint8_t *data, int32_t length)
 {
-    uint32_t outputPort = radioChannel.getPort();
+    return transmitData(&radioChannel, data, length);
+}
+
+/**
+ * Room for the next frame sent to the radio port.
+ * \param[in] length Largest length of the frame
+ * \return where to build the frame, NULL if it is not batched
+ */
+static uint8_t *reserveRadioData(int32_t length)
+{
+    return reserveData(&radioChannel, length);
+}
+
+/**
+ * Room at the end of the channel transmit batch for the next frame, so that
+ * UAVTalk builds the frames that are going to be batched in place.
+ * Flushes the batch first if the frame may not fit.
+ * \param[in] channel telemetry channel context
+ * \param[in] length Largest length of the frame
+ * \return where to build the frame, NULL if it is not batched
+ */
+static uint8_t *reserveData(
+    channelContext *channel,
+    int32_t length)
+{
+    uint32_t outputPort = channel->getPort();
+    uint8_t *data = NULL;
+
+    if (!outputPort) {
+        return NULL;
+    }
+
+    xSemaphoreTakeRecursive(channel->txBatchLock, portMAX_DELAY);
+
+    if (channel->txBatching && length <= TELEM_TX_BATCH_SIZE
+        && xTaskGetCurrentTaskHandle() == channel->txTaskHandle) {
+        if (channel->txBatchLength + length > TELEM_TX_BATCH_SIZE) {
+            flushTxBatchLocked(channel, outputPort);
+        }
+        data = &channel->txBatch[channel->txBatchLength];
+    }
+
+    xSemaphoreGiveRecursive(channel->txBatchLock);
+
+    return data;
+}
+
+/**
+ * Transmit data buffer on a telemetry channel. Frames sent by the Tx task
+ * while batching is enabled are appended to the channel transmit batch,
+ * anything else flushes the batch and is written to the port directly.
+ * \param[in] channel telemetry channel context
+ * \param[in] data Data buffer to send, usually where reserveData() put it
+ * \param[in] length Length of buffer
+ * \return -1 on failure
+ * \return number of bytes transmitted (or batched) on success
+ */
+static int32_t transmitData(
+    channelContext *channel,
+    uint8_t *data,
+    int32_t length)
+{
+    uint32_t outputPort = channel->getPort();
+    int32_t rc;
+
+    if (!outputPort) {
+        return -1;
+    }
+
+    xSemaphoreTakeRecursive(channel->txBatchLock, portMAX_DELAY);
+
+    if (channel->txBatching && length <= TELEM_TX_BATCH_SIZE
+        && xTaskGetCurrentTaskHandle() == channel->txTaskHandle) {
+        if (channel->txBatchLength + length > TELEM_TX_BATCH_SIZE) {
+            flushTxBatchLocked(channel, outputPort);
+        }
+        if (channel->txBatchLength == 0) {
+            channel->txBatchStart = xTaskGetTickCount();
+        }
+        // Already in place unless the batch was flushed since it was reserved
+        if (data != &channel->txBatch[channel->txBatchLength]) {
+            memmove(&channel->txBatch[channel->txBatchLength], data, length);
+        }
+        channel->txBatchLength += length;
+        channel->txBatchFrames++;
+        rc = length;
+    } else {
+        // Keep frames in order, whatever is batched goes out first
+        flushTxBatchLocked(channel, outputPort);
+        rc = PIOS_COM_SendBuffer(outputPort, data, length);
+        if (rc > 0) {
+            channel->txWrites++;
+            channel->txWriteFrames++;
+            channel->txWriteBytes += rc;
+        }
+    }
+
+    xSemaphoreGiveRecursive(channel->txBatchLock);
+
+    return rc;
+}
+
+/**
+ * Write the transmit batch of a telemetry channel to its port
+ * \param[in] channel telemetry channel context
+ */
+static void flushTxBatch(channelContext *channel)
+{
+    uint32_t outputPort = channel->getPort();
 
+    xSemaphoreTakeRecursive(channel->txBatchLock, portMAX_DELAY);
     if (outputPort) {
-        return PIOS_COM_SendBuffer(outputPort, data, length);
+        flushTxBatchLocked(channel, outputPort);
+    } else {
+        // Port went away, nobody is listening
+        channel->txBatchLength = 0;
+        channel->txBatchFrames = 0;
     }
+    xSemaphoreGiveRecursive(channel->txBatchLock);
+}
 
-    return -1;
+/**
+ * Write the transmit batch of a telemetry channel to its port if its oldest
+ * frame has waited for TELEM_TX_BATCH_LATENCY_MS
+ * \param[in] channel telemetry channel context
+ */
+static void flushLateTxBatch(channelContext *channel)
+{
+    // Only the Tx task appends, and it calls this between its own appends. But
+    // frames other tasks send (such as the Rx task's acks) flush the batch, so
+    // read txBatchLength and txBatchStart under the lock
+    xSemaphoreTakeRecursive(channel->txBatchLock, portMAX_DELAY);
+    if (channel->txBatchLength > 0
+        && (xTaskGetTickCount() - channel->txBatchStart) * portTICK_RATE_MS >= TELEM_TX_BATCH_LATENCY_MS) {
+        flushTxBatch(channel);
+    }
+    xSemaphoreGiveRecursive(channel->txBatchLock);
+}
+
+/**
+ * Write the transmit batch of a telemetry channel, txBatchLock must be held
+ * \param[in] channel telemetry channel context
+ * \param[in] outputPort port to write to
+ */
+static void flushTxBatchLocked(channelContext *channel, uint32_t outputPort)
+{
+    if (channel->txBatchLength == 0) {
+        return;
+    }
+
+    int32_t rc = PIOS_COM_SendBuffer(outputPort, channel->txBatch, channel->txBatchLength);
+    if (rc == channel->txBatchLength) {
+        channel->txWrites++;
+        channel->txWriteFrames += channel->txBatchFrames;
+        channel->txWriteBytes  += rc;
+    } else {
+        // The frames were already accounted as sent by UAVTalk
+        channel->txWriteErrors += channel->txBatchFrames;
+    }
+
+    channel->txBatchLength = 0;
+    channel->txBatchFrames = 0;
+}
+
+/**
+ * Add up and reset the port write stats of a telemetry channel
+ * \param[in] channel telemetry channel context
+ */
+static void takeTxWriteStats(channelContext *channel, uint32_t *writes, uint32_t *frames, uint32_t *bytes, uint32_t *errors)
+{
+    // Channel not initialised, its port is disabled
+    if (!channel->txBatchLock) {
+        return;
+    }
+
+    xSemaphoreTakeRecursive(channel->txBatchLock, portMAX_DELAY);
+    *writes += channel->txWrites;
+    *frames += channel->txWriteFrames;
+    *bytes  += channel->txWriteBytes;
+    *errors += channel->txWriteErrors;
+    channel->txWrites      = 0;
+    channel->txWriteFrames = 0;
+    channel->txWriteBytes  = 0;
+    channel->txWriteErrors = 0;
+    xSemaphoreGiveRecursive(channel->txBatchLock);
 }
 
 /**
@@ -747,6 +1014,7 @@ static int32_t setUpdatePeriod(
     ev.instId = UAVOBJ_ALL_INSTANCES;
     ev.event  = EV_UPDATED_PERIODIC;
     ev.lowPriority = true;
+    ev.coalesced   = false;
 
 #ifdef PIOS_TELEM_PRIORITY_QUEUE
     xQueueHandle targetQueue = UAVObjIsPriority(obj) ? channel->priorityQueue :
@@ -783,6 +1051,7 @@ static int32_t setLoggingPeriod(
     ev.instId = UAVOBJ_ALL_INSTANCES;
     ev.event  = EV_LOGGING_PERIODIC;
     ev.lowPriority = true;
+    ev.coalesced   = false;
 
 #ifdef PIOS_TELEM_PRIORITY_QUEUE
     xQueueHandle targetQueue = UAVObjIsPriority(obj) ? channel->priorityQueue :
@@ -806,6 +1075,7 @@ static int32_t setLoggingPeriod(
 static void gcsTelemetryStatsUpdated()
 {
     FlightTelemetryStatsData flightStats;
+    FlightTelemetryBatchStatsData batchStats;
     GCSTelemetryStatsData gcsStats;
 
     FlightTelemetryStatsGet(&flightStats);
@@ -825,13 +1095,20 @@ static void updateTelemetryStats()
     GCSTelemetryStatsData gcsStats;
     uint8_t forceUpdate;
     uint8_t connectionTimeout;
+    uint8_t oldStatus;
     uint32_t timeNow;
+    uint32_t txWrites      = 0;
+    uint32_t txWriteFrames = 0;
+    uint32_t txWriteBytes  = 0;
+    uint32_t txWriteErrors = 0;
 
     // Get stats
     UAVTalkGetStats(radioChannel.uavTalkCon, &utalkStats, true);
+    takeTxWriteStats(&radioChannel, &txWrites, &txWriteFrames, &txWriteBytes, &txWriteErrors);
 
 #ifdef HAS_RADIO
     UAVTalkAddStats(localChannel.uavTalkCon, &utalkStats, true);
+    takeTxWriteStats(&localChannel, &txWrites, &txWriteFrames, &txWriteBytes, &txWriteErrors);
 #endif
 
     // Get object data
@@ -842,8 +1119,10 @@ static void updateTelemetryStats()
     if (flightStats.Status == FLIGHTTELEMETRYSTATS_STATUS_CONNECTED) {
         flightStats.TxDataRate    = (float)utalkStats.txBytes / ((float)STATS_UPDATE_PERIOD_MS / 1000.0f);
         flightStats.TxBytes      += utalkStats.txBytes;
-        flightStats.TxFailures   += txErrors;
+        flightStats.TxFailures   += txErrors + txWriteErrors;
         flightStats.TxRetries    += txRetries;
+        batchStats.TxFramesPerWrite = txWrites ? (float)txWriteFrames / (float)txWrites : 0.0f;
+        batchStats.TxBytesPerWrite  = txWrites ? (float)txWriteBytes / (float)txWrites : 0.0f;
 
         flightStats.RxDataRate    = (float)utalkStats.rxBytes / ((float)STATS_UPDATE_PERIOD_MS / 1000.0f);
         flightStats.RxBytes      += utalkStats.rxBytes;
@@ -855,6 +1134,8 @@ static void updateTelemetryStats()
         flightStats.TxBytes      = 0;
         flightStats.TxFailures   = 0;
         flightStats.TxRetries    = 0;
+        batchStats.TxFramesPerWrite = 0;
+        batchStats.TxBytesPerWrite  = 0;
 
         flightStats.RxDataRate   = 0;
         flightStats.RxBytes      = 0;
@@ -877,6 +1158,7 @@ static void updateTelemetryStats()
     }
 
     // Update connection state
+    oldStatus   = flightStats.Status;
     forceUpdate = 1;
     if (flightStats.Status == FLIGHTTELEMETRYSTATS_STATUS_DISCONNECTED) {
         // Wait for connection request
@@ -900,14 +1182,23 @@ static void updateTelemetryStats()
         flightStats.Status = FLIGHTTELEMETRYSTATS_STATUS_DISCONNECTED;
     }
 
+    // The link was lost or a new handshake started, the next peer negotiates its features again
+    if (flightStats.Status != oldStatus && flightStats.Status != FLIGHTTELEMETRYSTATS_STATUS_CONNECTED) {
+        UAVTalkResetCapabilities(radioChannel.uavTalkCon);
+#ifdef HAS_RADIO
+        UAVTalkResetCapabilities(localChannel.uavTalkCon);
+#endif
+    }
+
     // TODO: check whether is there any error condition worth raising an alarm
     // Disconnection is actually a normal (non)working status so it is not raising alarms anymore.
     if (flightStats.Status == FLIGHTTELEMETRYSTATS_STATUS_CONNECTED) {
         AlarmsClear(SYSTEMALARMS_ALARM_TELEMETRY);
     }
 
-    // Update object
+    // Update objects
     FlightTelemetryStatsSet(&flightStats);
+    FlightTelemetryBatchStatsSet(&batchStats);
 
     // Force telemetry update if not connected
     if (forceUpdate) {
@@ -274,20 +274,18 @@ static void msp_send(struct msp_bridge *m, uint8_t cmd, const uint8_t *data, siz
     buf[3] = (uint8_t)(len);
     buf[4] = cmd;
 
-    PIOS_COM_SendBuffer(m->com, buf, sizeof(buf));
-
-    if (len > 0) {
-        PIOS_COM_SendBuffer(m->com, data, len);
-
-        for (unsigned i = 0; i < len; i++) {
-            cs ^= data[i];
-        }
+    for (unsigned i = 0; i < len; i++) {
+        cs ^= data[i];
     }
 
-    cs    ^= 0;
+    // Header, payload and checksum go out as a single package
+    struct pios_com_iovec iov[] = {
+        { .base = buf,  .len = sizeof(buf) },
+        { .base = data, .len = (uint16_t)len },
+        { .base = &cs,  .len = 1           },
+    };
 
-    buf[0] = cs;
-    PIOS_COM_SendBuffer(m->com, buf, 1);
+    PIOS_COM_SendBufferV(m->com, iov, NELEMENTS(iov));
 }
 
 static msp_state msp_state_size(struct msp_bridge *m, uint8_t b)
@@ -610,6 +610,100 @@ int32_t PIOS_COM_SendBuffer(uint32_t com_id, const uint8_t *buffer, uint16_t len
     return len;
 }
 
+/**
+ * Sends a package made of several buffers over given port
+ * (blocking function)
+ * The buffers are copied into the tx fifo one after the other, so a header,
+ * payload and trailer kept in separate buffers go out as one package with a
+ * single send lock and tx start instead of one per buffer. Each byte is still
+ * copied once into the fifo, as with PIOS_COM_SendBuffer().
+ * As with PIOS_COM_SendBuffer(), each buffer is queued in fragments of at
+ * most the fifo size, and a fragment only once it fits in whole.
+ * \param[in] port COM port
+ * \param[in] iov array of buffers to send
+ * \param[in] iovcnt number of buffers in iov
+ * \return -1 if port not available
+ * \return -2 if mutex can't be taken;
+ * \return -3 if data cannot be sent in the max allotted time of 5000msec
+ * \return number of bytes transmitted on success
+ */
+int32_t PIOS_COM_SendBufferV(uint32_t com_id, const struct pios_com_iovec *iov, uint8_t iovcnt)
+{
+    struct pios_com_dev *com_dev = (struct pios_com_dev *)com_id;
+
+    if (!PIOS_COM_validate(com_dev)) {
+        /* Undefined COM port for this board (see pios_board.c) */
+        return -1;
+    }
+    PIOS_Assert(com_dev->has_tx);
+#if defined(PIOS_INCLUDE_FREERTOS)
+    if (xSemaphoreTake(com_dev->sendbuffer_sem, 5) != pdTRUE) {
+        return -2;
+    }
+#endif /* PIOS_INCLUDE_FREERTOS */
+    uint16_t max_frag_len = fifoBuf_getSize(&com_dev->tx);
+    int32_t len = 0;
+    for (uint8_t i = 0; i < iovcnt; i++) {
+        len += iov[i].len;
+    }
+
+    for (uint8_t i = 0; i < iovcnt; i++) {
+        const uint8_t *buffer = iov[i].base;
+        uint16_t bytes_to_send = iov[i].len;
+
+        while (bytes_to_send) {
+            if (com_dev->driver->available && !(com_dev->driver->available(com_dev->lower_id) & COM_AVAILABLE_TX)) {
+                /*
+                 * Underlying device is down/unconnected.
+                 * Dump our fifo contents and act like an infinite data sink.
+                 * (see PIOS_COM_SendBufferNonBlockingInternal)
+                 */
+                fifoBuf_clearData(&com_dev->tx);
+#if defined(PIOS_INCLUDE_FREERTOS)
+                xSemaphoreGive(com_dev->sendbuffer_sem);
+#endif /* PIOS_INCLUDE_FREERTOS */
+                return len;
+            }
+
+            uint16_t frag_size = bytes_to_send;
+            if (frag_size > max_frag_len) {
+                frag_size = max_frag_len;
+            }
+
+            if (frag_size <= fifoBuf_getFree(&com_dev->tx)) {
+                /* The whole fragment fits, tx is started once the package is queued */
+                fifoBuf_putData(&com_dev->tx, buffer, frag_size);
+                bytes_to_send -= frag_size;
+                buffer += frag_size;
+                continue;
+            }
+
+            /* Device is busy, wait for the underlying device to free some space and retry */
+            /* Make sure the transmitter is running while we wait */
+            if (com_dev->driver->tx_start) {
+                (com_dev->driver->tx_start)(com_dev->lower_id,
+                                            fifoBuf_getUsed(&com_dev->tx));
+            }
+#if defined(PIOS_INCLUDE_FREERTOS)
+            if (xSemaphoreTake(com_dev->tx_sem, 5000) != pdTRUE) {
+                xSemaphoreGive(com_dev->sendbuffer_sem);
+                return -3;
+            }
+#endif
+        }
+    }
+
+    /* More data has been put in the tx buffer, make sure the tx is started */
+    if (len > 0 && com_dev->driver->tx_start) {
+        com_dev->driver->tx_start(com_dev->lower_id,
+                                  fifoBuf_getUsed(&com_dev->tx));
+    }
+#if defined(PIOS_INCLUDE_FREERTOS)
+    xSemaphoreGive(com_dev->sendbuffer_sem);
+#endif /* PIOS_INCLUDE_FREERTOS */
+    return len;
+}
+
 /**
  * Sends a single character over given port
  * \param[in] port COM port
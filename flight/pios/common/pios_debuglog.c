@@ -40,30 +40,53 @@
 // Global variables
 extern uintptr_t pios_user_fs_id; // flash filesystem for logging
 
+// The mutex only serializes flash access (write task, format, init).
+// Producers never take it, see claim_record()
 static xSemaphoreHandle mutex = 0;
 #define mutexlock()   xSemaphoreTakeRecursive(mutex, portMAX_DELAY)
 #define mutexunlock() xSemaphoreGiveRecursive(mutex)
 
+// The ring state is only touched from tasks, for a few instructions at a
+// time. Holding off the scheduler is enough and leaves interrupts running.
+#define ringlock()    vTaskSuspendAll()
+#define ringunlock()  xTaskResumeAll()
+
 static bool logging_enabled = false;
 #define MAX_CONSECUTIVE_FAILS_COUNT 10
 static bool log_is_full     = false;
 static uint8_t fails_count  = 0;
 static uint16_t flightnum   = 0;
 static uint16_t lognum = 0;
-
-#define BUFFERS_COUNT 2
-static DebugLogEntryData *current_buffer = 0;
-static DebugLogEntryData *buffers[BUFFERS_COUNT] = { 0, 0 };
-static uint8_t current_write_buffer_index;
-static uint8_t next_read_buffer_index;
+// flight the write task is currently saving entries for
+static uint16_t log_flightnum = 0;
+
+// Records are packed into blocks of one DebugLogEntry each, that are
+// saved to flash as a whole by the write task. Blocks form a ring, the one
+// at write_block is being filled by the producers, the ones from read_block
+// up to it are waiting for flash.
+#ifndef PIOS_DEBUGLOG_BUFFERS_COUNT
+#define PIOS_DEBUGLOG_BUFFERS_COUNT 4
+#endif
+typedef struct {
+    DebugLogEntryData entry;
+    uint16_t used; // bytes of entry.Data in use
+    uint8_t  records; // records in this block, 0 if free
+    uint8_t  writers; // producers still copying their record into this block
+    bool     sealed; // no more records go into this block
+} DebugLogBlock;
+
+static DebugLogBlock *blocks = 0;
+static volatile uint8_t write_block;
+static volatile uint8_t read_block;
+
+static volatile uint32_t dropped_records;
+static volatile uint32_t failed_writes;
 
 #define LOG_ENTRY_MAX_DATA_SIZE (sizeof(((DebugLogEntryData *)0)->Data))
 #define LOG_ENTRY_HEADER_SIZE   (sizeof(DebugLogEntryData) - LOG_ENTRY_MAX_DATA_SIZE)
 // build the obj_id as a DEBUGLOGENTRY ID with least significant byte zeroed and filled with flight number
 #define LOG_GET_FLIGHT_OBJID(x) ((DEBUGLOGENTRY_OBJID & ~0xFF) | (x & 0xFF))
 
-static uint32_t used_buffer_space = 0;
-
 #define CBTASK_PRIORITY   CALLBACK_TASK_AUXILIARY
 #define CALLBACK_PRIORITY CALLBACK_PRIORITY_LOW
 #define CB_TIMEOUT        100
@@ -71,37 +94,44 @@ static uint32_t used_buffer_space = 0;
 static DelayedCallbackInfo *callbackHandle;
 
 /* Private Function Prototypes */
-static void enqueue_data(uint32_t objid, uint16_t instid, size_t size, uint8_t *data);
-static bool write_current_buffer();
+static DebugLogEntryData *claim_record(size_t size, bool alone, DebugLogBlock * *claimed);
+static void release_record(DebugLogBlock *block);
+static bool seal_current_block();
+static void free_block(DebugLogBlock *block);
 static void writeTask();
-static uint8_t get_blocks_free();
 /**
  * @brief Initialize the log facility
  */
 void PIOS_DEBUGLOG_Initialize()
 {
     if (!mutex) {
-        mutex = xSemaphoreCreateRecursiveMutex();
-        for (uint32_t i = 0; i < BUFFERS_COUNT; i++) {
-            buffers[i] = pios_malloc(sizeof(DebugLogEntryData));
+        mutex  = xSemaphoreCreateRecursiveMutex();
+        blocks = pios_malloc(sizeof(DebugLogBlock) * PIOS_DEBUGLOG_BUFFERS_COUNT);
+        if (blocks) {
+            memset(blocks, 0, sizeof(DebugLogBlock) * PIOS_DEBUGLOG_BUFFERS_COUNT);
         }
-        current_write_buffer_index = 0;
-        next_read_buffer_index     = 0;
-        current_buffer = buffers[current_write_buffer_index];
+        write_block = 0;
+        read_block  = 0;
     }
 
-    if (!current_buffer) {
+    if (!blocks) {
         return;
     }
     mutexlock();
     lognum      = 0;
     flightnum   = 0;
     fails_count = 0;
-    used_buffer_space = 0;
     log_is_full = false;
-    while (PIOS_FLASHFS_ObjLoad(pios_user_fs_id, LOG_GET_FLIGHT_OBJID(flightnum), lognum, (uint8_t *)current_buffer, sizeof(DebugLogEntryData)) == 0) {
+    dropped_records = 0;
+    failed_writes   = 0;
+    // the block at write_block is not in use yet, borrow it to scan the log
+    while (PIOS_FLASHFS_ObjLoad(pios_user_fs_id, LOG_GET_FLIGHT_OBJID(flightnum), lognum, (uint8_t *)&blocks[write_block].entry, sizeof(DebugLogEntryData)) == 0) {
         flightnum++;
     }
+    log_flightnum = flightnum;
+    for (uint32_t i = 0; i < PIOS_DEBUGLOG_BUFFERS_COUNT; i++) {
+        memset(blocks[i].entry.Data, 0xff, sizeof(blocks[i].entry.Data));
+    }
     mutexunlock();
     callbackHandle = PIOS_CALLBACKSCHEDULER_Create(&writeTask, CALLBACK_PRIORITY, CBTASK_PRIORITY, CALLBACKINFO_RUNNING_DEBUGLOG, STACK_SIZE_BYTES);
     PIOS_CALLBACKSCHEDULER_Schedule(callbackHandle, CB_TIMEOUT, CALLBACK_UPDATEMODE_LATER);
@@ -116,8 +146,11 @@ void PIOS_DEBUGLOG_Enable(uint8_t enabled)
 {
     // increase the flight num as soon as logging is disabled
     if (logging_enabled && !enabled) {
+        // whatever is buffered belongs to the flight that just ended
+        if (blocks && seal_current_block()) {
+            PIOS_CALLBACKSCHEDULER_Dispatch(callbackHandle);
+        }
         flightnum++;
-        lognum = 0;
     }
     logging_enabled = enabled;
 }
@@ -132,14 +165,31 @@ void PIOS_DEBUGLOG_Enable(uint8_t enabled)
  */
 void PIOS_DEBUGLOG_UAVObject(uint32_t objid, uint16_t instid, size_t size, uint8_t *data)
 {
-    if (!logging_enabled || !current_buffer || log_is_full) {
+    if (!logging_enabled || !blocks || log_is_full) {
         return;
     }
-    mutexlock();
 
-    enqueue_data(objid, instid, size, data);
+    if (size > LOG_ENTRY_MAX_DATA_SIZE) {
+        size = LOG_ENTRY_MAX_DATA_SIZE;
+    }
 
-    mutexunlock();
+    DebugLogBlock *block;
+    DebugLogEntryData *entry = claim_record(size, false, &block);
+    if (!entry) {
+        return;
+    }
+
+    entry->Flight     = flightnum;
+    entry->FlightTime = PIOS_DELAY_GetuS();
+    entry->Entry      = 0; // assigned by the write task
+    entry->Type       = DEBUGLOGENTRY_TYPE_UAVOBJECT;
+    entry->ObjectID   = objid;
+    entry->InstanceID = instid;
+    entry->Size = size;
+
+    memcpy(entry->Data, data, size);
+
+    release_record(block);
 }
 /**
  * @brief Write a debug log entry with text
@@ -149,33 +199,36 @@ void PIOS_DEBUGLOG_UAVObject(uint32_t objid, uint16_t instid, size_t size, uint8
  */
 void PIOS_DEBUGLOG_Printf(char *format, ...)
 {
-    if (!logging_enabled || !current_buffer || log_is_full) {
+    if (!logging_enabled || !blocks || log_is_full) {
         return;
     }
 
+    // format first, so the ring lock is not held while formatting
+    char text[LOG_ENTRY_MAX_DATA_SIZE];
     va_list args;
     va_start(args, format);
-    mutexlock();
-    // flush any pending buffer before writing debug text
-    if (used_buffer_space) {
-        write_current_buffer();
+    vsnprintf(text, sizeof(text), (char *)format, args);
+    va_end(args);
+
+    // text is saved in an entry of its own, with its terminating zero
+    size_t size = strlen(text);
+    DebugLogBlock *block;
+    DebugLogEntryData *entry = claim_record(size + 1, true, &block);
+    if (!entry) {
+        return;
     }
-    memset(current_buffer->Data, 0xff, sizeof(current_buffer->Data));
-    vsnprintf((char *)current_buffer->Data, sizeof(current_buffer->Data), (char *)format, args);
-    current_buffer->Flight     = flightnum;
 
-    current_buffer->FlightTime = PIOS_DELAY_GetuS();
+    entry->Flight     = flightnum;
+    entry->FlightTime = PIOS_DELAY_GetuS();
+    entry->Entry      = 0; // assigned by the write task
+    entry->Type       = DEBUGLOGENTRY_TYPE_TEXT;
+    entry->ObjectID   = 0;
+    entry->InstanceID = 0;
+    entry->Size = size;
 
-    current_buffer->Entry      = lognum;
-    current_buffer->Type       = DEBUGLOGENTRY_TYPE_TEXT;
-    current_buffer->ObjectID   = 0;
-    current_buffer->InstanceID = 0;
-    current_buffer->Size       = strlen((const char *)current_buffer->Data);
+    memcpy(entry->Data, text, size + 1);
 
-    if (PIOS_FLASHFS_ObjSave(pios_user_fs_id, LOG_GET_FLIGHT_OBJID(flightnum), lognum, (uint8_t *)current_buffer, sizeof(DebugLogEntryData)) == 0) {
-        lognum++;
-    }
-    mutexunlock();
+    release_record(block);
 }
 
 
@@ -222,6 +275,21 @@ void PIOS_DEBUGLOG_Info(uint16_t *flight, uint16_t *entry, uint16_t *free, uint1
     }
 }
 
+/**
+ * @brief Retrieve the number of records that did not make it to flash
+ * @param[out] records dropped because all buffers were waiting for flash
+ * @param[out] entries that failed to be saved to flash
+ */
+void PIOS_DEBUGLOG_Stats(uint32_t *dropped, uint32_t *failed)
+{
+    if (dropped) {
+        *dropped = dropped_records;
+    }
+    if (failed) {
+        *failed = failed_writes;
+    }
+}
+
 /**
  * @brief Format entire flash memory!!!
  */
@@ -231,93 +299,190 @@ void PIOS_DEBUGLOG_Format(void)
     PIOS_FLASHFS_Format(pios_user_fs_id);
     lognum      = 0;
     flightnum   = 0;
+    log_flightnum = 0;
     log_is_full = false;
     fails_count = 0;
-    used_buffer_space = 0;
+    dropped_records = 0;
+    failed_writes   = 0;
+    // drop whatever was waiting for the old log
+    if (blocks) {
+        seal_current_block();
+        while (read_block != write_block || blocks[read_block].sealed) {
+            DebugLogBlock *block = &blocks[read_block];
+            if (block->writers) {
+                break;
+            }
+            free_block(block);
+        }
+    }
     mutexunlock();
 }
 
-void enqueue_data(uint32_t objid, uint16_t instid, size_t size, uint8_t *data)
+/**
+ * Claim space for a record in the block being filled, moving on to the next
+ * block if it does not fit. This is the only part of the producer path that
+ * touches shared state, it runs under the ring lock for a few instructions
+ * instead of taking the mutex so a producer never waits for the flash. The
+ * record is then filled in without any lock and handed back with
+ * release_record().
+ * \param[in] size of the record data
+ * \param[in] alone the record gets a block of its own
+ * \param[out] claimed block the record belongs to
+ * \return the record header to fill in, NULL if all blocks are in use
+ */
+static DebugLogEntryData *claim_record(size_t size, bool alone, DebugLogBlock * *claimed)
 {
-    DebugLogEntryData *entry;
-
-    // start a new block
-    if (!used_buffer_space) {
-        entry = current_buffer;
-        memset(current_buffer->Data, 0xff, sizeof(current_buffer->Data));
-        used_buffer_space += size;
-    } else {
-        // if an instance is being filled and there is enough space, does enqueues new data.
-        if (used_buffer_space + size + LOG_ENTRY_HEADER_SIZE > LOG_ENTRY_MAX_DATA_SIZE) {
-            current_buffer->Type = DEBUGLOGENTRY_TYPE_MULTIPLEUAVOBJECTS;
-            if (!write_current_buffer()) {
-                return;
-            }
-            entry = current_buffer;
-            memset(current_buffer->Data, 0xff, sizeof(current_buffer->Data));
-            used_buffer_space += size;
+    DebugLogEntryData *entry = NULL;
+    bool dispatch = false;
+
+    ringlock();
+
+    DebugLogBlock *block = &blocks[write_block];
+
+    if (block->records > 0
+        && (alone || block->sealed || block->used + LOG_ENTRY_HEADER_SIZE + size > LOG_ENTRY_MAX_DATA_SIZE)) {
+        // not enough space, seal the block and start a new one
+        block->sealed = true;
+        dispatch = true;
+        uint8_t next = (write_block + 1) % PIOS_DEBUGLOG_BUFFERS_COUNT;
+        if (next == read_block) {
+            // all blocks are waiting for flash
+            dropped_records++;
+            block = NULL;
         } else {
-            entry = (DebugLogEntryData *)&current_buffer->Data[used_buffer_space];
-            used_buffer_space += size + LOG_ENTRY_HEADER_SIZE;
+            write_block = next;
+            block = &blocks[next];
         }
     }
 
-    entry->Flight     = flightnum;
-    entry->FlightTime = PIOS_DELAY_GetuS();
-    entry->Entry = lognum;
-    entry->Type = DEBUGLOGENTRY_TYPE_UAVOBJECT;
-    entry->ObjectID   = objid;
-    entry->InstanceID = instid;
-    if (size > sizeof(current_buffer->Data)) {
-        size = sizeof(current_buffer->Data);
+    if (block) {
+        if (block->records == 0) {
+            // the first record uses the block header itself
+            entry = &block->entry;
+            block->used = size;
+        } else {
+            entry = (DebugLogEntryData *)&block->entry.Data[block->used];
+            block->used += LOG_ENTRY_HEADER_SIZE + size;
+        }
+        block->records++;
+        block->writers++;
+        // nothing else goes into it, it is saved once the record is released
+        block->sealed = alone;
     }
-    entry->Size = size;
 
-    memcpy(entry->Data, data, size);
+    ringunlock();
+
+    if (dispatch) {
+        PIOS_CALLBACKSCHEDULER_Dispatch(callbackHandle);
+    }
+
+    *claimed = block;
+    return entry;
 }
 
-bool write_current_buffer()
+/**
+ * Hand a record filled in after claim_record() over to the write task
+ * \param[in] block the record belongs to
+ */
+static void release_record(DebugLogBlock *block)
 {
-    PIOS_CALLBACKSCHEDULER_Dispatch(callbackHandle);
-    // Check if queue is full
-
-    if (get_blocks_free() > 0) {
-        current_write_buffer_index = (current_write_buffer_index + 1) % BUFFERS_COUNT;
-        current_buffer    = buffers[current_write_buffer_index];
-        used_buffer_space = 0;
-        return true;
-    } else {
-        return false;
+    ringlock();
+    block->writers--;
+    bool ready = block->sealed && !block->writers;
+    ringunlock();
+
+    if (ready) {
+        PIOS_CALLBACKSCHEDULER_Dispatch(callbackHandle);
     }
 }
 
-static uint8_t get_blocks_free()
+/**
+ * Seal the block being filled, if it holds any record
+ * \return true if a block was sealed
+ */
+static bool seal_current_block()
 {
-    uint8_t used_blocks = current_write_buffer_index - next_read_buffer_index;
+    bool sealed = false;
 
-    if (current_write_buffer_index < next_read_buffer_index) {
-        used_blocks = (BUFFERS_COUNT - next_read_buffer_index) + current_write_buffer_index;
+    ringlock();
+    DebugLogBlock *block = &blocks[write_block];
+    if (block->records > 0 && !block->sealed) {
+        block->sealed = true;
+        sealed = true;
+    }
+    ringunlock();
+
+    return sealed;
+}
+
+/**
+ * Return the block at read_block to the ring
+ * \param[in] block at read_block
+ */
+static void free_block(DebugLogBlock *block)
+{
+    // empty data blocks are set as 0xFF to minimize flash wearing,
+    // the GCS also relies on it to find the end of a multiple objects entry
+    memset(block->entry.Data, 0xff, sizeof(block->entry.Data));
+
+    ringlock();
+    block->used    = 0;
+    block->records = 0;
+    block->sealed  = false;
+    if (read_block != write_block) {
+        read_block = (read_block + 1) % PIOS_DEBUGLOG_BUFFERS_COUNT;
     }
-    return (BUFFERS_COUNT - used_blocks) - 1;
+    ringunlock();
 }
 
 static void writeTask()
 {
-    if (current_write_buffer_index != next_read_buffer_index) {
-        // not enough space, write the block and start a new one
+    mutexlock();
+    // save all blocks that are complete
+    while (true) {
+        DebugLogBlock *block = &blocks[read_block];
+
+        ringlock();
+        bool ready = block->sealed && !block->writers;
+        ringunlock();
+        if (!ready) {
+            break;
+        }
+
+        // entries are numbered from 0 in each flight
+        if (block->entry.Flight != log_flightnum) {
+            log_flightnum = block->entry.Flight;
+            lognum = 0;
+        }
+        // each record carries the number of the entry it is saved in
+        block->entry.Entry = lognum;
+        uint16_t offset = block->entry.Size;
+        for (uint8_t i = 1; i < block->records; i++) {
+            DebugLogEntryData *record = (DebugLogEntryData *)&block->entry.Data[offset];
+            record->Entry = lognum;
+            offset += LOG_ENTRY_HEADER_SIZE + record->Size;
+        }
+        // text has a block of its own, so packed records are always objects
+        if (block->records > 1) {
+            block->entry.Type = DEBUGLOGENTRY_TYPE_MULTIPLEUAVOBJECTS;
+        }
+
         if (PIOS_FLASHFS_ObjSave(pios_user_fs_id,
-                                 LOG_GET_FLIGHT_OBJID(flightnum), lognum,
-                                 (uint8_t *)buffers[next_read_buffer_index],
+                                 LOG_GET_FLIGHT_OBJID(log_flightnum), lognum,
+                                 (uint8_t *)&block->entry,
                                  sizeof(DebugLogEntryData)) == 0) {
-            next_read_buffer_index = (next_read_buffer_index + 1) % BUFFERS_COUNT;
+            free_block(block);
             lognum++;
             fails_count = 0;
         } else {
+            failed_writes++;
             if (fails_count++ > MAX_CONSECUTIVE_FAILS_COUNT) {
                 log_is_full = true;
             }
+            break;
         }
     }
+    mutexunlock();
 }
 #endif /* ifdef PIOS_INCLUDE_DEBUGLOG */
 /**
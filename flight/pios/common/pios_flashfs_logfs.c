@@ -30,15 +30,77 @@
 #ifdef PIOS_INCLUDE_FLASH
 
 #include <stdbool.h>
+#include <string.h> /* memmove */
 #include <openpilot.h>
 #include <pios_math.h>
 #include <pios_wdg.h>
 #include "pios_flashfs_logfs_priv.h"
+#if defined(PIOS_INCLUDE_CALLBACKSCHEDULER)
+#include "callbackinfo.h"
+#endif
 
 /*
  * Filesystem state data tracked in RAM
  */
 
+/* Maximum number of active slots tracked by the RAM index of each filesystem,
+ * 0 leaves the index out and every lookup scans the log in flash */
+#ifndef PIOS_FLASHFS_LOGFS_INDEX_SIZE
+#define PIOS_FLASHFS_LOGFS_INDEX_SIZE 128
+#endif
+
+/*
+ * The index maps an object id and instance to the active slot holding it,
+ * so lookups don't have to walk the slot headers in flash. Entries are kept
+ * sorted by object id and instance id.
+ */
+struct logfs_index_entry {
+    uint32_t obj_id;
+    uint16_t obj_inst_id;
+    uint16_t slot_id;
+    uint16_t gc_slot_id; /* where garbage collection moved the slot to, 0 if not moved yet */
+};
+
+/* Number of slots moved to the next arena by one garbage collection step */
+#ifndef PIOS_FLASHFS_LOGFS_GC_SLOTS_PER_STEP
+#define PIOS_FLASHFS_LOGFS_GC_SLOTS_PER_STEP 8
+#endif
+#if PIOS_FLASHFS_LOGFS_GC_SLOTS_PER_STEP < 2
+#error PIOS_FLASHFS_LOGFS_GC_SLOTS_PER_STEP must be at least 2 for garbage collection to outpace saves
+#endif
+
+/* Delay between garbage collection steps run in the background */
+#ifndef PIOS_FLASHFS_LOGFS_GC_PERIOD_MS
+#define PIOS_FLASHFS_LOGFS_GC_PERIOD_MS 20
+#endif
+#define LOGFS_GC_STACK_SIZE_BYTES 512
+
+/*
+ * Garbage collection moves the active slots to the next arena a few at a
+ * time, along with every save and, when the filesystem config asks for it,
+ * in the background, so that no single save has to wait for a whole arena
+ * to be erased and copied. Background steps are meant for external flash:
+ * erasing internal flash stalls the cpu, which must not happen at random
+ * times in flight.
+ *
+ * A flash sector erase cannot be split up, so the bound is one sector erase.
+ * Without background steps the erases are left to the saves, and a save that
+ * starts one still waits for it: up to several hundred milliseconds with 4K
+ * sectors and longer with 64K ones. Such boards can avoid it by calling
+ * PIOS_FLASHFS_Logfs_GarbageCollectStep() when a stall does not matter.
+ */
+enum logfs_gc_state {
+    LOGFS_GC_ERASING, /* next arena is being erased one sector per step */
+    LOGFS_GC_ERASED, /* next arena is erased, waiting for the log to fill up */
+    LOGFS_GC_COPYING, /* active slots are being moved to the next arena */
+};
+
+enum logfs_gc_mode {
+    LOGFS_GC_BACKGROUND, /* step run from the background callback */
+    LOGFS_GC_SAVE, /* step run along with a save */
+    LOGFS_GC_FORCE, /* step run because the log is full */
+};
+
 enum pios_flashfs_logfs_dev_magic {
     PIOS_FLASHFS_LOGFS_DEV_MAGIC = 0x94938201,
 };
@@ -56,6 +118,28 @@ struct logfs_state {
     uint16_t num_free_slots; /* slots in free state */
     uint16_t num_active_slots; /* slots in active state */
 
+    /* RAM index of the active slots in the mounted arena */
+    struct logfs_index_entry *index;
+    uint16_t index_size; /* max number of entries */
+    uint16_t index_count; /* entries in use */
+
+    /* NOTE: When the index overflows or finds the same object twice in the
+     *       log it is no longer complete. Lookups that miss in the index
+     *       then fall back to scanning the log in flash.
+     */
+    bool index_complete;
+
+    /* Incremental garbage collection */
+    enum logfs_gc_state gc_state;
+    uint8_t  gc_arena_id; /* arena the next collection moves the log to */
+    uint16_t gc_sector_id; /* next sector of that arena to erase */
+    uint16_t gc_src_slot_id; /* next slot of the active arena to move */
+    uint16_t gc_dst_slot_id; /* next free slot in the arena being filled */
+    uint16_t gc_threshold; /* free slots left when moving the slots starts */
+#if defined(PIOS_INCLUDE_CALLBACKSCHEDULER)
+    struct logfs_state *gc_next; /* list of filesystems visited by the background callback */
+#endif
+
     /* Underlying flash driver glue */
     const struct pios_flash_driver *driver;
     uintptr_t flash_id;
@@ -111,25 +195,25 @@ struct arena_header {
 ****************************************/
 
 /**
- * @brief Erases all sectors within the given arena and sets arena to erased state.
- * @return 0 if success, < 0 on failure
+ * @brief Erases one sector of the given arena and sets arena to erased state after the last one.
+ * @return 1 if the arena is now fully erased, 0 if more sectors are left, < 0 on failure
  * @note Must be called while holding the flash transaction lock
  */
-static int32_t logfs_erase_arena(const struct logfs_state *logfs, uint8_t arena_id)
+static int32_t logfs_erase_arena_sector(const struct logfs_state *logfs, uint8_t arena_id, uint16_t sector_id)
 {
     uintptr_t arena_addr = logfs_get_addr(logfs, arena_id, 0);
 
-    /* Erase all of the sectors in the arena */
-    for (uint8_t sector_id = 0;
-         sector_id < (logfs->cfg->arena_size / logfs->cfg->sector_size);
-         sector_id++) {
 #ifdef PIOS_INCLUDE_WDG
-        PIOS_WDG_Clear();
+    PIOS_WDG_Clear();
 #endif
-        if (logfs->driver->erase_sector(logfs->flash_id,
-                                        arena_addr + (sector_id * logfs->cfg->sector_size))) {
-            return -1;
-        }
+    if (logfs->driver->erase_sector(logfs->flash_id,
+                                    arena_addr + (sector_id * logfs->cfg->sector_size))) {
+        return -1;
+    }
+
+    if ((uint32_t)sector_id + 1 < logfs->cfg->arena_size / logfs->cfg->sector_size) {
+        /* More sectors to go */
+        return 0;
     }
 
     /* Mark this arena as fully erased */
@@ -146,6 +230,28 @@ static int32_t logfs_erase_arena(const struct logfs_state *logfs, uint8_t arena_
     }
 
     /* Arena is ready to be activated */
+    return 1;
+}
+
+/**
+ * @brief Erases all sectors within the given arena and sets arena to erased state.
+ * @return 0 if success, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_erase_arena(const struct logfs_state *logfs, uint8_t arena_id)
+{
+    int32_t rc;
+
+    /* Erase all of the sectors in the arena */
+    for (uint16_t sector_id = 0;
+         sector_id < (logfs->cfg->arena_size / logfs->cfg->sector_size);
+         sector_id++) {
+        rc = logfs_erase_arena_sector(logfs, arena_id, sector_id);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+
     return 0;
 }
 
@@ -416,12 +522,105 @@ static bool logfs_log_is_full(const struct logfs_state *logfs)
     return logfs->num_free_slots == 0;
 }
 
+/****************************************
+* Slot index functions
+****************************************/
+
+static int32_t logfs_index_compare(const struct logfs_index_entry *entry, uint32_t obj_id, uint16_t obj_inst_id)
+{
+    if (entry->obj_id != obj_id) {
+        return (entry->obj_id < obj_id) ? -1 : 1;
+    }
+    return (int32_t)entry->obj_inst_id - (int32_t)obj_inst_id;
+}
+
+/**
+ * @brief Binary search of the index for an object instance
+ * @return position of the entry if found, else the position it would be inserted at
+ */
+static uint16_t logfs_index_search(const struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id, bool *found)
+{
+    uint16_t lo = 0;
+    uint16_t hi = logfs->index_count;
+
+    while (lo < hi) {
+        uint16_t mid = lo + (hi - lo) / 2;
+        int32_t cmp  = logfs_index_compare(&logfs->index[mid], obj_id, obj_inst_id);
+        if (cmp == 0) {
+            *found = true;
+            return mid;
+        } else if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    *found = false;
+    return lo;
+}
+
+static void logfs_index_insert(struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id, uint16_t slot_id)
+{
+    bool found;
+    uint16_t pos = logfs_index_search(logfs, obj_id, obj_inst_id, &found);
+
+    if (found || logfs->index_count >= logfs->index_size) {
+        /* Object is active more than once or no room left, keep the first one only */
+        logfs->index_complete = false;
+        return;
+    }
+
+    memmove(&logfs->index[pos + 1],
+            &logfs->index[pos],
+            (logfs->index_count - pos) * sizeof(logfs->index[0]));
+    logfs->index[pos].obj_id      = obj_id;
+    logfs->index[pos].obj_inst_id = obj_inst_id;
+    logfs->index[pos].slot_id     = slot_id;
+    logfs->index[pos].gc_slot_id  = 0;
+    logfs->index_count++;
+}
+
+/**
+ * @brief Look up the index entry of a slot
+ * @return the entry, NULL if the slot is not indexed
+ */
+static struct logfs_index_entry *logfs_index_get(struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id, uint16_t slot_id)
+{
+    bool found;
+    uint16_t pos = logfs_index_search(logfs, obj_id, obj_inst_id, &found);
+
+    if (!found || logfs->index[pos].slot_id != slot_id) {
+        return NULL;
+    }
+
+    return &logfs->index[pos];
+}
+
+static void logfs_index_remove(struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id, uint16_t slot_id)
+{
+    struct logfs_index_entry *entry = logfs_index_get(logfs, obj_id, obj_inst_id, slot_id);
+
+    if (!entry) {
+        /* This slot was not indexed */
+        return;
+    }
+
+    uint16_t pos = entry - logfs->index;
+    logfs->index_count--;
+    memmove(&logfs->index[pos],
+            &logfs->index[pos + 1],
+            (logfs->index_count - pos) * sizeof(logfs->index[0]));
+}
+
 static int32_t logfs_unmount_log(struct logfs_state *logfs)
 {
     PIOS_Assert(logfs->mounted);
 
     logfs->num_active_slots = 0;
     logfs->num_free_slots   = 0;
+    logfs->index_count      = 0;
+    logfs->index_complete   = false;
     logfs->mounted = false;
 
     return 0;
@@ -434,8 +633,10 @@ static int32_t logfs_mount_log(struct logfs_state *logfs, uint8_t arena_id)
     logfs->num_active_slots = 0;
     logfs->num_free_slots   = 0;
     logfs->active_arena_id  = arena_id;
+    logfs->index_count      = 0;
+    logfs->index_complete   = true;
 
-    /* Scan the log to find out how full it is */
+    /* Scan the log to find out how full it is and index the active slots */
     for (uint16_t slot_id = 1;
          slot_id < (logfs->cfg->arena_size / logfs->cfg->slot_size);
          slot_id++) {
@@ -467,6 +668,7 @@ static int32_t logfs_mount_log(struct logfs_state *logfs, uint8_t arena_id)
             break;
         case SLOT_STATE_ACTIVE:
             logfs->num_active_slots++;
+            logfs_index_insert(logfs, slot_hdr.obj_id, slot_hdr.obj_inst_id, slot_id);
             break;
         case SLOT_STATE_RESERVED:
         case SLOT_STATE_OBSOLETE:
@@ -484,6 +686,20 @@ static int32_t logfs_mount_log(struct logfs_state *logfs, uint8_t arena_id)
     logfs->active_arena_id = arena_id;
     logfs->mounted = true;
 
+    /* Find out whether the arena the next collection moves the log to still needs erasing */
+    struct arena_header arena_hdr;
+    logfs->gc_arena_id  = (arena_id + 1) % (logfs->cfg->total_fs_size / logfs->cfg->arena_size);
+    logfs->gc_sector_id = 0;
+    logfs->gc_state     = LOGFS_GC_ERASING;
+    if (logfs->driver->read_data(logfs->flash_id,
+                                 logfs_get_addr(logfs, logfs->gc_arena_id, 0),
+                                 (uint8_t *)&arena_hdr,
+                                 sizeof(arena_hdr)) == 0 &&
+        arena_hdr.state == ARENA_STATE_ERASED &&
+        arena_hdr.magic == logfs->cfg->fs_magic) {
+        logfs->gc_state = LOGFS_GC_ERASED;
+    }
+
     return 0;
 }
 
@@ -492,17 +708,33 @@ static bool PIOS_FLASHFS_Logfs_validate(const struct logfs_state *logfs)
     return logfs && (logfs->magic == PIOS_FLASHFS_LOGFS_DEV_MAGIC);
 }
 
+#if defined(PIOS_INCLUDE_CALLBACKSCHEDULER)
+/* All mounted filesystems, visited by the garbage collection callback */
+static struct logfs_state *logfs_gc_list;
+static DelayedCallbackInfo *logfs_gc_callback;
+#endif
+
+/* The slot index never needs more entries than there are slots for objects in an arena */
+static uint16_t PIOS_FLASHFS_Logfs_index_size(const struct flashfs_logfs_cfg *cfg)
+{
+    return MIN(cfg->arena_size / cfg->slot_size - 1, PIOS_FLASHFS_LOGFS_INDEX_SIZE);
+}
+
 #if defined(PIOS_INCLUDE_FREERTOS)
-static struct logfs_state *PIOS_FLASHFS_Logfs_alloc(void)
+static struct logfs_state *PIOS_FLASHFS_Logfs_alloc(const struct flashfs_logfs_cfg *cfg)
 {
     struct logfs_state *logfs;
+    uint16_t index_size = PIOS_FLASHFS_Logfs_index_size(cfg);
 
-    logfs = (struct logfs_state *)pios_malloc(sizeof(*logfs));
+    /* The index is allocated along with the state */
+    logfs = (struct logfs_state *)pios_malloc(sizeof(*logfs) + index_size * sizeof(struct logfs_index_entry));
     if (!logfs) {
         return NULL;
     }
 
-    logfs->magic = PIOS_FLASHFS_LOGFS_DEV_MAGIC;
+    logfs->magic      = PIOS_FLASHFS_LOGFS_DEV_MAGIC;
+    logfs->index      = (struct logfs_index_entry *)(logfs + 1);
+    logfs->index_size = index_size;
     return logfs;
 }
 static void PIOS_FLASHFS_Logfs_free(struct logfs_state *logfs)
@@ -513,8 +745,11 @@ static void PIOS_FLASHFS_Logfs_free(struct logfs_state *logfs)
 }
 #else
 static struct logfs_state pios_flashfs_logfs_devs[PIOS_FLASHFS_LOGFS_MAX_DEVS];
+#if PIOS_FLASHFS_LOGFS_INDEX_SIZE > 0
+static struct logfs_index_entry pios_flashfs_logfs_index[PIOS_FLASHFS_LOGFS_MAX_DEVS][PIOS_FLASHFS_LOGFS_INDEX_SIZE];
+#endif
 static uint8_t pios_flashfs_logfs_num_devs;
-static struct logfs_state *PIOS_FLASHFS_Logfs_alloc(void)
+static struct logfs_state *PIOS_FLASHFS_Logfs_alloc(const struct flashfs_logfs_cfg *cfg)
 {
     struct logfs_state *logfs;
 
@@ -522,8 +757,15 @@ static struct logfs_state *PIOS_FLASHFS_Logfs_alloc(void)
         return NULL;
     }
 
-    logfs = &pios_flashfs_logfs_devs[pios_flashfs_logfs_num_devs++];
-    logfs->magic = PIOS_FLASHFS_LOGFS_DEV_MAGIC;
+    logfs = &pios_flashfs_logfs_devs[pios_flashfs_logfs_num_devs];
+    logfs->magic      = PIOS_FLASHFS_LOGFS_DEV_MAGIC;
+#if PIOS_FLASHFS_LOGFS_INDEX_SIZE > 0
+    logfs->index      = pios_flashfs_logfs_index[pios_flashfs_logfs_num_devs];
+#else
+    logfs->index      = NULL;
+#endif
+    logfs->index_size = PIOS_FLASHFS_Logfs_index_size(cfg);
+    pios_flashfs_logfs_num_devs++;
 
     return logfs;
 }
@@ -565,7 +807,7 @@ int32_t PIOS_FLASHFS_Logfs_Init(uintptr_t *fs_id, const struct flashfs_logfs_cfg
 
     struct logfs_state *logfs;
 
-    logfs = (struct logfs_state *)PIOS_FLASHFS_Logfs_alloc();
+    logfs = (struct logfs_state *)PIOS_FLASHFS_Logfs_alloc(cfg);
     if (logfs) {
         while (rc && count++ < 2) {
             /* Bind configuration parameters to this filesystem instance */
@@ -574,6 +816,15 @@ int32_t PIOS_FLASHFS_Logfs_Init(uintptr_t *fs_id, const struct flashfs_logfs_cfg
             logfs->flash_id = flash_id; /* lower-level flash device id */
             logfs->mounted  = false;
 
+            /*
+             * Leave enough free slots when garbage collection starts for
+             * one step per save to erase the next arena and move every slot.
+             */
+            uint16_t num_slots = cfg->arena_size / cfg->slot_size;
+            logfs->gc_threshold = MIN((cfg->arena_size / cfg->sector_size) +
+                                      num_slots / (PIOS_FLASHFS_LOGFS_GC_SLOTS_PER_STEP - 1) + 2,
+                                      num_slots / 2);
+
             if (logfs->driver->start_transaction(logfs->flash_id) == 0) {
                 bool found = false;
                 int32_t arena_id;
@@ -616,6 +867,12 @@ out_end_trans:
                 logfs->driver->end_transaction(logfs->flash_id);
             }
         }
+#if defined(PIOS_INCLUDE_CALLBACKSCHEDULER)
+        if (rc == 0 && cfg->background_gc) {
+            logfs->gc_next = logfs_gc_list;
+            logfs_gc_list  = logfs;
+        }
+#endif
     }
 
     return rc;
@@ -632,6 +889,15 @@ int32_t PIOS_FLASHFS_Logfs_Destroy(uintptr_t fs_id)
         goto out_exit;
     }
 
+#if defined(PIOS_INCLUDE_CALLBACKSCHEDULER)
+    for (struct logfs_state * *prev = &logfs_gc_list; *prev; prev = &(*prev)->gc_next) {
+        if (*prev == logfs) {
+            *prev = logfs->gc_next;
+            break;
+        }
+    }
+#endif
+
     PIOS_FLASHFS_Logfs_free(logfs);
     rc = 0;
 
@@ -639,58 +905,141 @@ out_exit:
     return rc;
 }
 
-/* NOTE: Must be called while holding the flash transaction lock */
-static int32_t logfs_garbage_collect(struct logfs_state *logfs)
+/****************************************
+* Garbage collection functions
+****************************************/
+
+/*
+ * Should the active slots start moving to the next arena?
+ * Moving starts early enough for one step per save to finish the collection
+ * before the log is full, but only once it frees a worthwhile number of
+ * obsolete slots. Otherwise the log is left to fill up and collected at once.
+ */
+static bool logfs_gc_should_start(const struct logfs_state *logfs)
 {
-    PIOS_Assert(logfs->mounted);
+    uint16_t num_obsolete_slots = (logfs->cfg->arena_size / logfs->cfg->slot_size) - 1 -
+                                  logfs->num_active_slots - logfs->num_free_slots;
 
-    /* Source arena is the active arena */
-    uint8_t src_arena_id = logfs->active_arena_id;
+    return logfs->num_free_slots <= logfs->gc_threshold &&
+           num_obsolete_slots >= logfs->gc_threshold;
+}
 
-    /* Compute destination arena */
-    uint8_t dst_arena_id = (logfs->active_arena_id + 1) % (logfs->cfg->total_fs_size / logfs->cfg->arena_size);
+/* Is there garbage collection work left for the background callback? */
+static bool logfs_gc_pending(const struct logfs_state *logfs)
+{
+    if (!logfs->mounted) {
+        return false;
+    }
 
-    /* Erase destination arena */
-    if (logfs_erase_arena(logfs, dst_arena_id) != 0) {
-        return -1;
+    switch (logfs->gc_state) {
+    case LOGFS_GC_ERASING:
+    case LOGFS_GC_COPYING:
+        return true;
+    case LOGFS_GC_ERASED:
+        return logfs_gc_should_start(logfs);
     }
 
-    /* Reserve the destination arena so we can start filling it */
-    if (logfs_reserve_arena(logfs, dst_arena_id) != 0) {
-        /* Unable to reserve the arena */
+    return false;
+}
+
+/**
+ * @brief Obsolete the copy of a slot already moved to the arena being filled
+ * @param[in] slot_hdr header of the obsoleted slot in the active arena
+ * @param[in] gc_slot_id slot the copy was moved to, 0 if unknown
+ * @return 0 if success, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_gc_obsolete_copy(struct logfs_state *logfs, struct slot_header *slot_hdr, uint16_t gc_slot_id)
+{
+    if (gc_slot_id == 0) {
+        /* Slot was not indexed, look for the copy among the slots moved so far */
+        for (uint16_t slot_id = 1; slot_id < logfs->gc_dst_slot_id; slot_id++) {
+            struct slot_header copy_hdr;
+            if (logfs->driver->read_data(logfs->flash_id,
+                                         logfs_get_addr(logfs, logfs->gc_arena_id, slot_id),
+                                         (uint8_t *)&copy_hdr,
+                                         sizeof(copy_hdr)) != 0) {
+                return -1;
+            }
+            if (copy_hdr.state == SLOT_STATE_ACTIVE &&
+                copy_hdr.obj_id == slot_hdr->obj_id &&
+                copy_hdr.obj_inst_id == slot_hdr->obj_inst_id) {
+                gc_slot_id = slot_id;
+                break;
+            }
+        }
+        if (gc_slot_id == 0) {
+            /* No copy, the slot was not active when it was moved */
+            return 0;
+        }
+    }
+
+    if (logfs->driver->write_data(logfs->flash_id,
+                                  logfs_get_addr(logfs, logfs->gc_arena_id, gc_slot_id),
+                                  (uint8_t *)slot_hdr,
+                                  sizeof(*slot_hdr)) != 0) {
         return -2;
     }
 
-    /* Copy active slots from active arena to destination arena */
-    uint16_t dst_slot_id = 1;
-    for (uint16_t src_slot_id = 1;
-         src_slot_id < (logfs->cfg->arena_size / logfs->cfg->slot_size);
-         src_slot_id++) {
+    return 0;
+}
+
+/**
+ * @brief Move the next active slots of the log to the arena being filled
+ * @return 0 if success, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_gc_copy_slots(struct logfs_state *logfs, uint16_t max_slots)
+{
+    /* The log ends at the first free slot */
+    uint16_t end_slot_id = (logfs->cfg->arena_size / logfs->cfg->slot_size) - logfs->num_free_slots;
+
+    for (uint16_t i = 0; i < max_slots && logfs->gc_src_slot_id < end_slot_id; i++) {
         struct slot_header slot_hdr;
-        uintptr_t src_addr = logfs_get_addr(logfs, src_arena_id, src_slot_id);
+        uintptr_t src_addr = logfs_get_addr(logfs, logfs->active_arena_id, logfs->gc_src_slot_id);
         if (logfs->driver->read_data(logfs->flash_id,
                                      src_addr,
                                      (uint8_t *)&slot_hdr,
                                      sizeof(slot_hdr)) != 0) {
-            return -3;
+            return -1;
         }
 
         if (slot_hdr.state == SLOT_STATE_ACTIVE) {
-            uintptr_t dst_addr = logfs_get_addr(logfs, dst_arena_id, dst_slot_id);
+            uintptr_t dst_addr = logfs_get_addr(logfs, logfs->gc_arena_id, logfs->gc_dst_slot_id);
             if (logfs_raw_copy_bytes(logfs,
                                      src_addr,
                                      sizeof(slot_hdr) + slot_hdr.obj_size,
                                      dst_addr) != 0) {
                 /* Failed to copy all bytes */
-                return -4;
+                return -2;
             }
-            dst_slot_id++;
+
+            /* Remember where the slot went in case it is deleted before the collection ends */
+            struct logfs_index_entry *entry = logfs_index_get(logfs, slot_hdr.obj_id, slot_hdr.obj_inst_id, logfs->gc_src_slot_id);
+            if (entry) {
+                entry->gc_slot_id = logfs->gc_dst_slot_id;
+            }
+            logfs->gc_dst_slot_id++;
         }
+        logfs->gc_src_slot_id++;
 #ifdef PIOS_INCLUDE_WDG
         PIOS_WDG_Clear();
 #endif
     }
 
+    return 0;
+}
+
+/**
+ * @brief Switch over to the arena the active slots were moved to
+ * @return 0 if success, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_gc_finish(struct logfs_state *logfs)
+{
+    uint8_t src_arena_id = logfs->active_arena_id;
+    uint8_t dst_arena_id = logfs->gc_arena_id;
+
     /* Activate the destination arena */
     if (logfs_activate_arena(logfs, dst_arena_id) != 0) {
         return -5;
@@ -706,7 +1055,7 @@ static int32_t logfs_garbage_collect(struct logfs_state *logfs)
         return -7;
     }
 
-    /* Mount the new arena */
+    /* Mount the new arena, this rebuilds the slot index and picks the next arena to erase */
     if (logfs_mount_log(logfs, dst_arena_id) != 0) {
         return -8;
     }
@@ -714,6 +1063,161 @@ static int32_t logfs_garbage_collect(struct logfs_state *logfs)
     return 0;
 }
 
+/**
+ * @brief Run one bounded step of garbage collection
+ * A step erases at most one sector or moves at most PIOS_FLASHFS_LOGFS_GC_SLOTS_PER_STEP slots.
+ * Erasing is left to the background callback until the log is getting full.
+ * @return 0 if success, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_gc_step(struct logfs_state *logfs, enum logfs_gc_mode mode)
+{
+    int32_t rc;
+
+    PIOS_Assert(logfs->mounted);
+
+    switch (logfs->gc_state) {
+    case LOGFS_GC_ERASING:
+        if (mode == LOGFS_GC_SAVE && logfs->num_free_slots > logfs->gc_threshold) {
+            /* Not urgent yet */
+            return 0;
+        }
+        rc = logfs_erase_arena_sector(logfs, logfs->gc_arena_id, logfs->gc_sector_id);
+        if (rc < 0) {
+            return -1;
+        }
+        logfs->gc_sector_id++;
+        if (rc > 0) {
+            logfs->gc_state = LOGFS_GC_ERASED;
+        }
+        break;
+    case LOGFS_GC_ERASED:
+        if (mode != LOGFS_GC_FORCE && !logfs_gc_should_start(logfs)) {
+            break;
+        }
+        /* Reserve the destination arena so we can start filling it */
+        if (logfs_reserve_arena(logfs, logfs->gc_arena_id) != 0) {
+            /* Unable to reserve the arena, erase it again */
+            logfs->gc_state     = LOGFS_GC_ERASING;
+            logfs->gc_sector_id = 0;
+            return -2;
+        }
+        logfs->gc_src_slot_id = 1;
+        logfs->gc_dst_slot_id = 1;
+        logfs->gc_state = LOGFS_GC_COPYING;
+        break;
+    case LOGFS_GC_COPYING:
+        if (logfs_gc_copy_slots(logfs, PIOS_FLASHFS_LOGFS_GC_SLOTS_PER_STEP) != 0) {
+            /* The destination arena is in an unknown state, start over */
+            logfs->gc_state     = LOGFS_GC_ERASING;
+            logfs->gc_sector_id = 0;
+            return -3;
+        }
+        if (logfs->gc_src_slot_id == (logfs->cfg->arena_size / logfs->cfg->slot_size) - logfs->num_free_slots) {
+            /* Every slot of the log has been moved */
+            return logfs_gc_finish(logfs);
+        }
+        break;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Run all remaining steps of a garbage collection
+ * @return 0 if success, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_garbage_collect(struct logfs_state *logfs)
+{
+    PIOS_Assert(logfs->mounted);
+
+    /* Source arena is the active arena */
+    uint8_t src_arena_id = logfs->active_arena_id;
+
+    while (logfs->mounted && logfs->active_arena_id == src_arena_id) {
+        int32_t rc = logfs_gc_step(logfs, LOGFS_GC_FORCE);
+        if (rc != 0) {
+            return rc;
+        }
+    }
+
+    return 0;
+}
+
+#if defined(PIOS_INCLUDE_CALLBACKSCHEDULER)
+/* Background callback, runs one garbage collection step on every filesystem with work left */
+static void logfs_gc_task(void)
+{
+    bool more = false;
+
+    for (struct logfs_state *logfs = logfs_gc_list; logfs; logfs = logfs->gc_next) {
+        if (PIOS_FLASHFS_Logfs_GarbageCollectStep((uintptr_t)logfs) > 0) {
+            more = true;
+        }
+    }
+
+    if (more) {
+        PIOS_CALLBACKSCHEDULER_Schedule(logfs_gc_callback, PIOS_FLASHFS_LOGFS_GC_PERIOD_MS, CALLBACK_UPDATEMODE_SOONER);
+    }
+}
+
+/* Make sure the background callback runs. Not done from init since the scheduler starts later. */
+static void logfs_gc_kick(void)
+{
+    if (!logfs_gc_callback) {
+        logfs_gc_callback = PIOS_CALLBACKSCHEDULER_Create(&logfs_gc_task, CALLBACK_PRIORITY_LOW, CALLBACK_TASK_AUXILIARY, CALLBACKINFO_RUNNING_FLASHFS, LOGFS_GC_STACK_SIZE_BYTES);
+        if (!logfs_gc_callback) {
+            return;
+        }
+    }
+    PIOS_CALLBACKSCHEDULER_Schedule(logfs_gc_callback, PIOS_FLASHFS_LOGFS_GC_PERIOD_MS, CALLBACK_UPDATEMODE_SOONER);
+}
+#endif /* PIOS_INCLUDE_CALLBACKSCHEDULER */
+
+/**
+ * @brief Run one step of background garbage collection
+ * @param[in] fs_id The filesystem to use for this action
+ * @return 1 if more steps are needed, 0 if there is nothing left to do, < 0 on failure
+ * @retval -1 if fs_id is not a valid filesystem instance
+ * @retval -2 if failed to start transaction
+ * @retval -3 if the step failed
+ */
+int32_t PIOS_FLASHFS_Logfs_GarbageCollectStep(uintptr_t fs_id)
+{
+    int32_t rc;
+
+    struct logfs_state *logfs = (struct logfs_state *)fs_id;
+
+    if (!PIOS_FLASHFS_Logfs_validate(logfs)) {
+        rc = -1;
+        goto out_exit;
+    }
+
+    if (logfs->driver->start_transaction(logfs->flash_id) != 0) {
+        rc = -2;
+        goto out_exit;
+    }
+
+    if (!logfs_gc_pending(logfs)) {
+        rc = 0;
+        goto out_end_trans;
+    }
+
+    if (logfs_gc_step(logfs, LOGFS_GC_BACKGROUND) != 0) {
+        rc = -3;
+        goto out_end_trans;
+    }
+
+    rc = logfs_gc_pending(logfs) ? 1 : 0;
+
+out_end_trans:
+    logfs->driver->end_transaction(logfs->flash_id);
+
+out_exit:
+    return rc;
+}
+
 /* NOTE: Must be called while holding the flash transaction lock */
 static int16_t logfs_object_find_next(const struct logfs_state *logfs, struct slot_header *slot_hdr, uint16_t *curr_slot, uint32_t obj_id, uint16_t obj_inst_id)
 {
@@ -756,8 +1260,51 @@ static int16_t logfs_object_find_next(const struct logfs_state *logfs, struct sl
     return -1;
 }
 
+/**
+ * @brief Find the first active slot of an object, using the slot index where possible
+ * @note Must be called while holding the flash transaction lock
+ * @return 0 if found, -1 if not found, -2 on flash read error
+ */
+static int16_t logfs_object_find(struct logfs_state *logfs, struct slot_header *slot_hdr, uint16_t *slot_id, uint32_t obj_id, uint16_t obj_inst_id)
+{
+    PIOS_Assert(slot_hdr);
+    PIOS_Assert(slot_id);
+
+    bool found;
+    uint16_t pos = logfs_index_search(logfs, obj_id, obj_inst_id, &found);
+
+    if (found) {
+        uint16_t indexed_slot_id = logfs->index[pos].slot_id;
+        uintptr_t slot_addr = logfs_get_addr(logfs, logfs->active_arena_id, indexed_slot_id);
+
+        if (logfs->driver->read_data(logfs->flash_id,
+                                     slot_addr,
+                                     (uint8_t *)slot_hdr,
+                                     sizeof(*slot_hdr)) != 0) {
+            return -2;
+        }
+        if (slot_hdr->state == SLOT_STATE_ACTIVE &&
+            slot_hdr->obj_id == obj_id &&
+            slot_hdr->obj_inst_id == obj_inst_id) {
+            *slot_id = indexed_slot_id;
+            return 0;
+        }
+
+        /* Index is out of step with the log, stop trusting it */
+        PIOS_DEBUG_Assert(0);
+        logfs_index_remove(logfs, obj_id, obj_inst_id, indexed_slot_id);
+        logfs->index_complete = false;
+    } else if (logfs->index_complete) {
+        /* Every active slot is indexed, the object is not in the log */
+        return -1;
+    }
+
+    /* Fall back to scanning the log */
+    *slot_id = 0;
+    return logfs_object_find_next(logfs, slot_hdr, slot_id, obj_id, obj_inst_id);
+}
+
 /* NOTE: Must be called while holding the flash transaction lock */
-/* OPTIMIZE: could trust that there is at most one active version of every object and terminate the search when we find one */
 static int8_t logfs_delete_object(struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id)
 {
     int8_t rc;
@@ -767,7 +1314,14 @@ static int8_t logfs_delete_object(struct logfs_state *logfs, uint32_t obj_id, ui
 
     do {
         struct slot_header slot_hdr;
-        switch (logfs_object_find_next(logfs, &slot_hdr, &curr_slot_id, obj_id, obj_inst_id)) {
+        int16_t found;
+        if (logfs->index_complete) {
+            /* There is at most one active version of the object and the index knows where */
+            found = logfs_object_find(logfs, &slot_hdr, &curr_slot_id, obj_id, obj_inst_id);
+        } else {
+            found = logfs_object_find_next(logfs, &slot_hdr, &curr_slot_id, obj_id, obj_inst_id);
+        }
+        switch (found) {
         case 0:
             /* Found a matching slot.  Obsolete it. */
             slot_hdr.state = SLOT_STATE_OBSOLETE;
@@ -782,6 +1336,18 @@ static int8_t logfs_delete_object(struct logfs_state *logfs, uint32_t obj_id, ui
             }
             /* Object has been successfully obsoleted and is no longer active */
             logfs->num_active_slots--;
+
+            if (logfs->gc_state == LOGFS_GC_COPYING && curr_slot_id < logfs->gc_src_slot_id) {
+                /* Garbage collection already moved this slot, obsolete the copy too */
+                struct logfs_index_entry *entry = logfs_index_get(logfs, obj_id, obj_inst_id, curr_slot_id);
+                if (logfs_gc_obsolete_copy(logfs, &slot_hdr, entry ? entry->gc_slot_id : 0) != 0) {
+                    /* The copy would come back to life, start the collection over */
+                    logfs->gc_state     = LOGFS_GC_ERASING;
+                    logfs->gc_sector_id = 0;
+                }
+            }
+
+            logfs_index_remove(logfs, obj_id, obj_inst_id, curr_slot_id);
             break;
         case -1:
             /* Search completed, object not found */
@@ -902,6 +1468,7 @@ static int8_t logfs_append_to_log(struct logfs_state *logfs, uint32_t obj_id, ui
 
     /* Object has been successfully written to the slot */
     logfs->num_active_slots++;
+    logfs_index_insert(logfs, obj_id, obj_inst_id, free_slot_id);
     return 0;
 }
 
@@ -928,6 +1495,8 @@ static int8_t logfs_append_to_log(struct logfs_state *logfs, uint32_t obj_id, ui
  * @retval -5 if garbage collection failed
  * @retval -6 if filesystem is full even after garbage collection should have freed space
  * @retval -7 if writing the new object to the filesystem failed
+ * @note Without background garbage collection a save may erase a whole flash
+ *       sector before returning, see logfs_gc_step()
  */
 int32_t PIOS_FLASHFS_ObjSave(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst_id, uint8_t *obj_data, uint16_t obj_size)
 {
@@ -994,9 +1563,22 @@ int32_t PIOS_FLASHFS_ObjSave(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst
     /* Object successfully written to the log */
     rc = 0;
 
+    /*
+     * Move any garbage collection in progress along by one bounded step.
+     * The object is saved already, a failed step only means the
+     * collection starts over.
+     */
+    logfs_gc_step(logfs, LOGFS_GC_SAVE);
+
 out_end_trans:
     logfs->driver->end_transaction(logfs->flash_id);
 
+#if defined(PIOS_INCLUDE_CALLBACKSCHEDULER)
+    if (rc == 0 && logfs->cfg->background_gc && logfs_gc_pending(logfs)) {
+        logfs_gc_kick();
+    }
+#endif
+
 out_exit:
     return rc;
 }
@@ -1036,7 +1618,7 @@ int32_t PIOS_FLASHFS_ObjLoad(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst
     /* Find the object in the log */
     uint16_t slot_id = 0;
     struct slot_header slot_hdr;
-    if (logfs_object_find_next(logfs, &slot_hdr, &slot_id, obj_id, obj_inst_id) != 0) {
+    if (logfs_object_find(logfs, &slot_hdr, &slot_id, obj_id, obj_inst_id) != 0) {
         /* Object does not exist in fs */
         rc = -3;
         goto out_end_trans;
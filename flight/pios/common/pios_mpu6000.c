@@ -47,6 +47,7 @@ bool PIOS_MPU6000_driver_Test(uintptr_t context);
 void PIOS_MPU6000_driver_Reset(uintptr_t context);
 void PIOS_MPU6000_driver_get_scale(float *scales, uint8_t size, uintptr_t context);
 QueueHandle_t PIOS_MPU6000_driver_get_queue(uintptr_t context);
+float PIOS_MPU6000_driver_get_sample_rate(uintptr_t context);
 
 const PIOS_SENSORS_Driver PIOS_MPU6000_Driver = {
     .test      = PIOS_MPU6000_driver_Test,
@@ -55,6 +56,7 @@ const PIOS_SENSORS_Driver PIOS_MPU6000_Driver = {
     .reset     = PIOS_MPU6000_driver_Reset,
     .get_queue = PIOS_MPU6000_driver_get_queue,
     .get_scale = PIOS_MPU6000_driver_get_scale,
+    .get_sample_rate = PIOS_MPU6000_driver_get_sample_rate,
     .is_polled = false,
 };
 //
@@ -642,6 +644,15 @@ QueueHandle_t PIOS_MPU6000_driver_get_queue(__attribute__((unused)) uintptr_t co
 {
     return dev->queue;
 }
+
+float PIOS_MPU6000_driver_get_sample_rate(__attribute__((unused)) uintptr_t context)
+{
+    // Gyro output rate is 8kHz without digital low pass filter, 1kHz with it
+    if (dev->filter == PIOS_MPU6000_LOWPASS_256_HZ) {
+        return 8000.0f / (1 + dev->cfg->Smpl_rate_div_no_dlp);
+    }
+    return 1000.0f / (1 + dev->cfg->Smpl_rate_div_dlp);
+}
 #endif /* PIOS_INCLUDE_MPU6000 */
 
 /**
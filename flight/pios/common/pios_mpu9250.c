@@ -151,6 +151,7 @@ bool PIOS_MPU9250_Main_driver_Test(uintptr_t context);
 void PIOS_MPU9250_Main_driver_Reset(uintptr_t context);
 void PIOS_MPU9250_Main_driver_get_scale(float *scales, uint8_t size, uintptr_t context);
 QueueHandle_t PIOS_MPU9250_Main_driver_get_queue(uintptr_t context);
+float PIOS_MPU9250_Main_driver_get_sample_rate(uintptr_t context);
 
 const PIOS_SENSORS_Driver PIOS_MPU9250_Main_Driver = {
     .test      = PIOS_MPU9250_Main_driver_Test,
@@ -159,6 +160,7 @@ const PIOS_SENSORS_Driver PIOS_MPU9250_Main_Driver = {
     .reset     = PIOS_MPU9250_Main_driver_Reset,
     .get_queue = PIOS_MPU9250_Main_driver_get_queue,
     .get_scale = PIOS_MPU9250_Main_driver_get_scale,
+    .get_sample_rate = PIOS_MPU9250_Main_driver_get_sample_rate,
     .is_polled = false,
 };
 
@@ -961,6 +963,15 @@ QueueHandle_t PIOS_MPU9250_Main_driver_get_queue(__attribute__((unused)) uintptr
     return dev->queue;
 }
 
+float PIOS_MPU9250_Main_driver_get_sample_rate(__attribute__((unused)) uintptr_t context)
+{
+    // Gyro output rate is 8kHz without digital low pass filter, 1kHz with it
+    if (dev->filter == PIOS_MPU9250_LOWPASS_256_HZ) {
+        return 8000.0f / (1 + dev->cfg->Smpl_rate_div_no_dlp);
+    }
+    return 1000.0f / (1 + dev->cfg->Smpl_rate_div_dlp);
+}
+
 
 /* PIOS sensor driver implementation */
 bool PIOS_MPU9250_Mag_driver_Test(__attribute__((unused)) uintptr_t context)
@@ -84,6 +84,13 @@ int32_t PIOS_DEBUGLOG_Read(void *buffer, uint16_t flight, uint16_t inst);
  */
 void PIOS_DEBUGLOG_Info(uint16_t *flight, uint16_t *entry, uint16_t *free, uint16_t *used);
 
+/**
+ * @brief Retrieve the number of records that did not make it to flash
+ * @param[out] records dropped because all buffers were waiting for flash
+ * @param[out] entries that failed to be saved to flash
+ */
+void PIOS_DEBUGLOG_Stats(uint32_t *dropped, uint32_t *failed);
+
 /**
  * @brief Format entire flash memory!!!
  */
@@ -28,6 +28,7 @@
 #define PIOS_FLASHFS_LOGFS_PRIV_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "pios_flash.h" /* struct pios_flash_driver */
 
 struct flashfs_logfs_cfg {
@@ -39,10 +40,18 @@ struct flashfs_logfs_cfg {
     uint32_t start_offset; /* Offset into flash where this filesystem starts */
     uint32_t sector_size; /* Size of a flash erase block */
     uint32_t page_size; /* Maximum flash burst write size */
+
+    /* NOTE: Without background_gc the saves erase the sectors of the next arena,
+     *       and a save that erases one waits for the whole sector erase.
+     */
+    bool     background_gc; /* Collect garbage from a background callback, not for flash that stalls the cpu while erasing */
 };
 
 int32_t PIOS_FLASHFS_Logfs_Init(uintptr_t *fs_id, const struct flashfs_logfs_cfg *cfg, const struct pios_flash_driver *driver, uintptr_t flash_id);
 
 int32_t PIOS_FLASHFS_Logfs_Destroy(uintptr_t fs_id);
 
+/* Runs one bounded garbage collection step, lets boards without background_gc erase ahead of the saves */
+int32_t PIOS_FLASHFS_Logfs_GarbageCollectStep(uintptr_t fs_id);
+
 #endif /* PIOS_FLASHFS_LOGFS_PRIV_H */
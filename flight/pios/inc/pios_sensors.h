@@ -42,6 +42,10 @@ typedef void (*PIOS_SENSORS_fetch_function)(void *samples, uint8_t size, uintptr
  */
 typedef void (*PIOS_SENSORS_get_scale_function)(float *, uint8_t size, uintptr_t context);
 typedef QueueHandle_t (*PIOS_SENSORS_get_queue_function)(uintptr_t context);
+/**
+ * return the rate in Hz at which samples are added to the sensor queue
+ */
+typedef float (*PIOS_SENSORS_get_sample_rate_function)(uintptr_t context);
 
 typedef struct PIOS_SENSORS_Driver {
     PIOS_SENSORS_test_function      test; // called at startup to test the sensor
@@ -50,6 +54,7 @@ typedef struct PIOS_SENSORS_Driver {
     PIOS_SENSORS_reset_function     reset; // reset sensor. for example if data are not received in the allotted time
     PIOS_SENSORS_get_queue_function get_queue; // get the queue reference
     PIOS_SENSORS_get_scale_function get_scale; // return scales for the sensors
+    PIOS_SENSORS_get_sample_rate_function get_sample_rate; // return the rate of queued samples. NULL if unknown
     bool is_polled;
 } PIOS_SENSORS_Driver;
 
@@ -164,6 +169,19 @@ static inline QueueHandle_t PIOS_SENSORS_GetQueue(const PIOS_SENSORS_Instance *s
     }
     return sensor->driver->get_queue(sensor->context);
 }
+/**
+ * retrieve the rate of the samples in the sensor queue
+ * @param sensor
+ * @return sample rate in Hz or 0 if not known
+ */
+static inline float PIOS_SENSORS_GetSampleRate(const PIOS_SENSORS_Instance *sensor)
+{
+    PIOS_Assert(sensor);
+    if (!sensor->driver->get_sample_rate) {
+        return 0.0f;
+    }
+    return sensor->driver->get_sample_rate(sensor->context);
+}
 /**
  * Get the sensor scales.
  * @param sensor sensor instance
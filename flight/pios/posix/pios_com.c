@@ -362,6 +362,30 @@ int32_t PIOS_COM_SendBuffer(uint32_t com_id, const uint8_t *buffer, uint16_t len
     return rc;
 }
 
+/**
+ * Sends a package made of several buffers over given port
+ * (blocking function)
+ * \param[in] port COM port
+ * \param[in] iov array of buffers to send
+ * \param[in] iovcnt number of buffers in iov
+ * \return -1 if port not available
+ * \return number of bytes transmitted on success
+ */
+int32_t PIOS_COM_SendBufferV(uint32_t com_id, const struct pios_com_iovec *iov, uint8_t iovcnt)
+{
+    int32_t len = 0;
+
+    for (uint8_t i = 0; i < iovcnt; i++) {
+        int32_t rc = PIOS_COM_SendBuffer(com_id, iov[i].base, iov[i].len);
+        if (rc < 0) {
+            return rc;
+        }
+        len += iov[i].len;
+    }
+
+    return len;
+}
+
 /**
  * Sends a single character over given port
  * \param[in] port COM port
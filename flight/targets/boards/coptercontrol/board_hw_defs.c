@@ -424,6 +424,7 @@ static const struct flashfs_logfs_cfg flashfs_w25x_cfg = {
     .start_offset  = 0,          /* start at the beginning of the chip */
     .sector_size   = 0x00001000, /* 4K bytes */
     .page_size     = 0x00000100, /* 256 bytes */
+    .background_gc = false,      /* no heap for the 512 bytes collector stack, collect while saving */
 };
 
 
@@ -436,6 +437,7 @@ static const struct flashfs_logfs_cfg flashfs_m25p_cfg = {
     .start_offset  = 0,          /* start at the beginning of the chip */
     .sector_size   = 0x00010000, /* 64K bytes */
     .page_size     = 0x00000100, /* 256 bytes */
+    .background_gc = false,      /* no heap for the 512 bytes collector stack, collect while saving */
 };
 
 #include "pios_flash.h"
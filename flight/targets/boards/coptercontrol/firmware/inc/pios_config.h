@@ -124,6 +124,7 @@
 /* #define LOG_FILENAME "startup.log" */
 #define PIOS_INCLUDE_FLASH
 #define PIOS_INCLUDE_FLASH_LOGFS_SETTINGS
+#define PIOS_FLASHFS_LOGFS_INDEX_SIZE   0 /* no RAM to spare for the settings index, lookups scan the flash */
 /* #define FLASH_FREERTOS */
 /* #define PIOS_INCLUDE_FLASH_EEPROM */
 /* #define PIOS_INCLUDE_FLASH_INTERNAL */
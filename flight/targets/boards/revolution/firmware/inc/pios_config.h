@@ -153,6 +153,7 @@
 #define PIOS_INCLUDE_COM_FLEXI
 /* #define PIOS_INCLUDE_COM_AUX */
 #define PIOS_TELEM_PRIORITY_QUEUE
+#define PIOS_TELEM_COALESCE_EVENTS /* Queue object updates only once while they wait to be sent */
 #define PIOS_INCLUDE_GPS
 /* #define PIOS_GPS_MINIMAL */
 #define PIOS_INCLUDE_GPS_NMEA_PARSER
@@ -163,6 +164,13 @@
 /* Stabilization options */
 #define PIOS_QUATERNION_STABILIZATION
 
+/* UAVObject manager options */
+#define PIOS_UAVOBJECT_LOCK_STRIPES     8
+#define PIOS_UAVOBJECT_SEQLOCK_MAX_SIZE 64
+
+/* UAVTalk options */
+#define UAVTALK_DELTA_SLOTS            4
+
 /* Performance counters */
 #define IDLE_COUNTS_PER_SEC_AT_NO_LOAD 8379692
 
@@ -468,6 +468,7 @@ static const struct flashfs_logfs_cfg flashfs_external_cfg = {
     .start_offset  = 0,      /* start at the beginning of the chip */
     .sector_size   = 0x00010000, /* 64K bytes */
     .page_size     = 0x00000100, /* 256 bytes */
+    .background_gc = true,       /* external flash, erasing does not stall the cpu */
 };
 
 
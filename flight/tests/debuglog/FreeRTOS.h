@@ -0,0 +1,23 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+/* Single threaded stand-ins for the few FreeRTOS primitives used by the debug log */
+typedef void *xSemaphoreHandle;
+typedef uint32_t portTickType;
+
+#define portMAX_DELAY    0xffffffff
+#define pdTRUE           1
+#define pdFALSE          0
+#define tskIDLE_PRIORITY 0
+
+/* Implemented by the test */
+xSemaphoreHandle xSemaphoreCreateRecursiveMutex(void);
+int xSemaphoreTakeRecursive(xSemaphoreHandle sem, portTickType ticks);
+int xSemaphoreGiveRecursive(xSemaphoreHandle sem);
+void vTaskSuspendAll(void);
+int xTaskResumeAll(void);
+
+#endif /* FREERTOS_H */
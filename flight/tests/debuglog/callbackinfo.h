@@ -0,0 +1,6 @@
+#ifndef CALLBACKINFO_H
+#define CALLBACKINFO_H
+
+#define CALLBACKINFO_RUNNING_DEBUGLOG 0
+
+#endif /* CALLBACKINFO_H */
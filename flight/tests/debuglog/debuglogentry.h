@@ -0,0 +1,27 @@
+#ifndef DEBUGLOGENTRY_H
+#define DEBUGLOGENTRY_H
+
+#include <stdint.h>
+
+/* Same layout as the generated DebugLogEntry, fields ordered by size. Any object id does for the test */
+#define DEBUGLOGENTRY_OBJID 0x12345600
+
+typedef enum __attribute__((__packed__)) {
+    DEBUGLOGENTRY_TYPE_EMPTY = 0,
+    DEBUGLOGENTRY_TYPE_TEXT  = 1,
+    DEBUGLOGENTRY_TYPE_UAVOBJECT = 2,
+    DEBUGLOGENTRY_TYPE_MULTIPLEUAVOBJECTS = 3
+} DebugLogEntryTypeOptions;
+
+typedef struct __attribute__((__packed__)) {
+    uint32_t FlightTime;
+    uint32_t ObjectID;
+    uint16_t Flight;
+    uint16_t Entry;
+    uint16_t InstanceID;
+    uint16_t Size;
+    DebugLogEntryTypeOptions Type;
+    uint8_t  Data[200];
+} DebugLogEntryData;
+
+#endif /* DEBUGLOGENTRY_H */
@@ -0,0 +1,29 @@
+#ifndef PIOS_H
+#define PIOS_H
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/* PIOS Feature Selection */
+#include "pios_config.h"
+
+#ifdef PIOS_INCLUDE_FREERTOS
+/* FreeRTOS Includes */
+#include "FreeRTOS.h"
+#endif
+#include "pios_mem.h"
+#include <pios_flashfs.h>
+#include <pios_callbackscheduler.h>
+#include <pios_debuglog.h>
+
+#define PIOS_Assert(x) \
+    if (!(x)) { abort(); \
+    }
+
+/* Implemented by the test */
+uint32_t PIOS_DELAY_GetuS(void);
+
+#endif /* PIOS_H */
@@ -0,0 +1,7 @@
+#ifndef PIOS_MEM_H
+#define PIOS_MEM_H
+
+#define pios_malloc(size) (malloc(size))
+#define pios_free(p)      (free(p))
+
+#endif /* PIOS_MEM_H */
@@ -0,0 +1,6 @@
+#ifndef UAVOBJECTMANAGER_H
+#define UAVOBJECTMANAGER_H
+
+/* The debug log only needs the DebugLogEntry layout, see debuglogentry.h */
+
+#endif /* UAVOBJECTMANAGER_H */
@@ -0,0 +1,328 @@
+#include "gtest/gtest.h"
+
+#include <string.h> /* memset */
+#include <vector>
+
+extern "C" {
+#include "pios.h"
+#include "debuglogentry.h"
+}
+
+#define ENTRY_HEADER_SIZE (sizeof(DebugLogEntryData) - sizeof(((DebugLogEntryData *)0)->Data))
+#define RECORD_SIZE       20
+// The first record of a block uses the block header, the others bring their own
+#define RECORDS_PER_BLOCK (1 + (sizeof(((DebugLogEntryData *)0)->Data) - RECORD_SIZE) / (ENTRY_HEADER_SIZE + RECORD_SIZE))
+#define BLOCKS_COUNT      4
+
+/*
+ * Stand ins for the flash filesystem and the callback scheduler. Saved
+ * entries are kept in order, the write task only runs when a test calls it.
+ */
+uintptr_t pios_user_fs_id;
+
+static std::vector<DebugLogEntryData> flash;
+static bool flash_fails;
+static DelayedCallback write_task;
+static uint32_t dispatches;
+
+extern "C" int32_t PIOS_FLASHFS_Format(__attribute__((unused)) uintptr_t fs_id)
+{
+    flash.clear();
+    return 0;
+}
+
+extern "C" int32_t PIOS_FLASHFS_ObjSave(__attribute__((unused)) uintptr_t fs_id, __attribute__((unused)) uint32_t obj_id,
+                                        __attribute__((unused)) uint16_t obj_inst_id, uint8_t *obj_data, uint16_t obj_size)
+{
+    if (flash_fails || obj_size != sizeof(DebugLogEntryData)) {
+        return -1;
+    }
+    DebugLogEntryData entry;
+    memcpy(&entry, obj_data, sizeof(entry));
+    flash.push_back(entry);
+    return 0;
+}
+
+extern "C" int32_t PIOS_FLASHFS_ObjLoad(__attribute__((unused)) uintptr_t fs_id, __attribute__((unused)) uint32_t obj_id,
+                                        __attribute__((unused)) uint16_t obj_inst_id, __attribute__((unused)) uint8_t *obj_data,
+                                        __attribute__((unused)) uint16_t obj_size)
+{
+    // Only used to find the first free flight, start from an empty log
+    return -3;
+}
+
+extern "C" int32_t PIOS_FLASHFS_GetStats(__attribute__((unused)) uintptr_t fs_id, struct PIOS_FLASHFS_Stats *stats)
+{
+    stats->num_free_slots   = 0;
+    stats->num_active_slots = flash.size();
+    return 0;
+}
+
+extern "C" DelayedCallbackInfo *PIOS_CALLBACKSCHEDULER_Create(DelayedCallback cb,
+                                                                __attribute__((unused)) DelayedCallbackPriority priority,
+                                                                __attribute__((unused)) DelayedCallbackPriorityTask priorityTask,
+                                                                __attribute__((unused)) int16_t callbackID,
+                                                                __attribute__((unused)) uint32_t stacksize)
+{
+    write_task = cb;
+    return (DelayedCallbackInfo *)&write_task;
+}
+
+extern "C" int32_t PIOS_CALLBACKSCHEDULER_Schedule(__attribute__((unused)) DelayedCallbackInfo *cbinfo,
+                                                   __attribute__((unused)) int32_t milliseconds,
+                                                   __attribute__((unused)) DelayedCallbackUpdateMode updatemode)
+{
+    return 0;
+}
+
+extern "C" int32_t PIOS_CALLBACKSCHEDULER_Dispatch(__attribute__((unused)) DelayedCallbackInfo *cbinfo)
+{
+    dispatches++;
+    return 0;
+}
+
+// Nesting depth of the mutex and of the ring lock, both are released on return
+static int mutex_depth;
+static int suspend_depth;
+
+extern "C" xSemaphoreHandle xSemaphoreCreateRecursiveMutex(void)
+{
+    return (xSemaphoreHandle)&mutex_depth;
+}
+
+extern "C" int xSemaphoreTakeRecursive(__attribute__((unused)) xSemaphoreHandle sem, __attribute__((unused)) portTickType ticks)
+{
+    mutex_depth++;
+    return pdTRUE;
+}
+
+extern "C" int xSemaphoreGiveRecursive(__attribute__((unused)) xSemaphoreHandle sem)
+{
+    mutex_depth--;
+    return pdTRUE;
+}
+
+extern "C" void vTaskSuspendAll(void)
+{
+    // The ring lock is only held for a few instructions and never nested
+    EXPECT_EQ(0, suspend_depth);
+    suspend_depth++;
+}
+
+extern "C" int xTaskResumeAll(void)
+{
+    suspend_depth--;
+    return pdFALSE;
+}
+
+extern "C" uint32_t PIOS_DELAY_GetuS(void)
+{
+    return 0;
+}
+
+/* Records of a saved entry, split up the way the GCS does it */
+static std::vector<DebugLogEntryData> records(const DebugLogEntryData &entry)
+{
+    std::vector<DebugLogEntryData> result;
+    const uint32_t data_len = sizeof(entry.Data);
+
+    result.push_back(entry);
+    if (entry.Type != DEBUGLOGENTRY_TYPE_MULTIPLEUAVOBJECTS) {
+        return result;
+    }
+    uint32_t start = entry.Size;
+    while (start + ENTRY_HEADER_SIZE + 1 < data_len) {
+        DebugLogEntryData fields;
+        memset(&fields, 0xff, sizeof(fields));
+        memcpy(&fields, &entry.Data[start], ENTRY_HEADER_SIZE);
+        uint32_t toread = ENTRY_HEADER_SIZE + fields.Size;
+        if (!(toread + start > data_len)) {
+            memcpy(&fields, &entry.Data[start], toread);
+            result.push_back(fields);
+        }
+        start += toread;
+    }
+    return result;
+}
+
+class DebugLogTest : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        if (!write_task) {
+            PIOS_DEBUGLOG_Initialize();
+        }
+        ASSERT_TRUE(write_task);
+        // Drops whatever an earlier test left buffered and clears the counters
+        PIOS_DEBUGLOG_Format();
+        flash_fails = false;
+        dispatches  = 0;
+        PIOS_DEBUGLOG_Enable(1);
+    }
+
+    virtual void TearDown()
+    {
+        PIOS_DEBUGLOG_Enable(0);
+        EXPECT_EQ(0, mutex_depth);
+        EXPECT_EQ(0, suspend_depth);
+    }
+
+    void logRecord(uint16_t n)
+    {
+        uint8_t data[RECORD_SIZE];
+
+        memset(data, n & 0xff, sizeof(data));
+        PIOS_DEBUGLOG_UAVObject(0x1000, n, sizeof(data), data);
+    }
+
+    // All saved records, in the order they were logged
+    std::vector<DebugLogEntryData> savedRecords()
+    {
+        std::vector<DebugLogEntryData> result;
+
+        for (size_t i = 0; i < flash.size(); i++) {
+            std::vector<DebugLogEntryData> r = records(flash[i]);
+            result.insert(result.end(), r.begin(), r.end());
+        }
+        return result;
+    }
+
+    void expectRecords(uint16_t first, uint16_t count)
+    {
+        std::vector<DebugLogEntryData> saved = savedRecords();
+
+        ASSERT_EQ(count, saved.size());
+        for (uint16_t i = 0; i < count; i++) {
+            EXPECT_EQ(first + i, saved[i].InstanceID);
+            EXPECT_EQ(RECORD_SIZE, saved[i].Size);
+            EXPECT_EQ((first + i) & 0xff, saved[i].Data[RECORD_SIZE - 1]);
+        }
+    }
+};
+
+TEST_F(DebugLogTest, PacksRecordsIntoBlocks) {
+    for (uint16_t i = 0; i <= RECORDS_PER_BLOCK; i++) {
+        logRecord(i);
+    }
+    // Disabling the log hands over the block being filled
+    PIOS_DEBUGLOG_Enable(0);
+    write_task();
+
+    ASSERT_EQ(2U, flash.size());
+    EXPECT_EQ(DEBUGLOGENTRY_TYPE_MULTIPLEUAVOBJECTS, flash[0].Type);
+    EXPECT_EQ(DEBUGLOGENTRY_TYPE_UAVOBJECT, flash[1].Type);
+    EXPECT_EQ(0, flash[0].Entry);
+    EXPECT_EQ(1, flash[1].Entry);
+    EXPECT_EQ(RECORDS_PER_BLOCK, records(flash[0]).size());
+    expectRecords(0, RECORDS_PER_BLOCK + 1);
+
+    // every packed record carries the number of its entry
+    std::vector<DebugLogEntryData> saved = records(flash[0]);
+    for (size_t i = 0; i < saved.size(); i++) {
+        EXPECT_EQ(0, saved[i].Entry);
+    }
+    EXPECT_EQ(1, records(flash[1])[0].Entry);
+}
+
+TEST_F(DebugLogTest, RingWrapsAround) {
+    const uint16_t count = 5 * BLOCKS_COUNT * RECORDS_PER_BLOCK;
+
+    for (uint16_t i = 0; i < count; i++) {
+        logRecord(i);
+        if (i % RECORDS_PER_BLOCK == 0) {
+            write_task();
+        }
+    }
+    PIOS_DEBUGLOG_Enable(0);
+    write_task();
+
+    uint32_t dropped, failed;
+    PIOS_DEBUGLOG_Stats(&dropped, &failed);
+    EXPECT_EQ(0U, dropped);
+    EXPECT_EQ(0U, failed);
+    EXPECT_EQ(count / RECORDS_PER_BLOCK, flash.size());
+    expectRecords(0, count);
+}
+
+TEST_F(DebugLogTest, OverflowDropsRecords) {
+    const uint16_t buffered = BLOCKS_COUNT * RECORDS_PER_BLOCK;
+
+    // The write task does not run, as with a stalled flash
+    for (uint16_t i = 0; i < 2 * buffered; i++) {
+        logRecord(i);
+    }
+    EXPECT_LT(0U, dispatches);
+
+    uint32_t dropped;
+    PIOS_DEBUGLOG_Stats(&dropped, NULL);
+    EXPECT_EQ(buffered, dropped);
+
+    // What was buffered is saved, and logging goes on once there is room
+    write_task();
+    expectRecords(0, buffered);
+    flash.clear();
+
+    logRecord(2 * buffered);
+    PIOS_DEBUGLOG_Enable(0);
+    write_task();
+    expectRecords(2 * buffered, 1);
+    PIOS_DEBUGLOG_Stats(&dropped, NULL);
+    EXPECT_EQ(buffered, dropped);
+}
+
+TEST_F(DebugLogTest, FailedWriteIsRetried) {
+    for (uint16_t i = 0; i < RECORDS_PER_BLOCK; i++) {
+        logRecord(i);
+    }
+    PIOS_DEBUGLOG_Enable(0);
+
+    flash_fails = true;
+    write_task();
+    EXPECT_EQ(0U, flash.size());
+
+    flash_fails = false;
+    write_task();
+    expectRecords(0, RECORDS_PER_BLOCK);
+
+    uint32_t dropped, failed;
+    PIOS_DEBUGLOG_Stats(&dropped, &failed);
+    EXPECT_EQ(0U, dropped);
+    EXPECT_EQ(1U, failed);
+}
+
+TEST_F(DebugLogTest, TextHasItsOwnEntry) {
+    logRecord(0);
+    logRecord(1);
+    PIOS_DEBUGLOG_Printf((char *)"text %d", 42);
+    logRecord(2);
+    PIOS_DEBUGLOG_Enable(0);
+    write_task();
+
+    ASSERT_EQ(3U, flash.size());
+    EXPECT_EQ(DEBUGLOGENTRY_TYPE_MULTIPLEUAVOBJECTS, flash[0].Type);
+    EXPECT_EQ(DEBUGLOGENTRY_TYPE_TEXT, flash[1].Type);
+    EXPECT_EQ(DEBUGLOGENTRY_TYPE_UAVOBJECT, flash[2].Type);
+    for (uint16_t i = 0; i < flash.size(); i++) {
+        EXPECT_EQ(i, flash[i].Entry);
+    }
+
+    // text entries are saved as before, with the rest of the data unused
+    EXPECT_EQ(strlen("text 42"), flash[1].Size);
+    EXPECT_STREQ("text 42", (const char *)flash[1].Data);
+    EXPECT_EQ(0xff, flash[1].Data[sizeof(flash[1].Data) - 1]);
+    EXPECT_EQ(2, flash[2].InstanceID);
+}
+
+TEST_F(DebugLogTest, TextStartsTheLog) {
+    PIOS_DEBUGLOG_Printf((char *)"first");
+    logRecord(0);
+    PIOS_DEBUGLOG_Enable(0);
+    write_task();
+
+    ASSERT_EQ(2U, flash.size());
+    EXPECT_EQ(DEBUGLOGENTRY_TYPE_TEXT, flash[0].Type);
+    EXPECT_STREQ("first", (const char *)flash[0].Data);
+    EXPECT_EQ(DEBUGLOGENTRY_TYPE_UAVOBJECT, flash[1].Type);
+    EXPECT_EQ(0, flash[1].InstanceID);
+    EXPECT_EQ(1, flash[1].Entry);
+}
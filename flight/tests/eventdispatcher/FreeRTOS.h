@@ -0,0 +1,29 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+/* Single threaded stand-ins for the few FreeRTOS primitives used by the event dispatcher */
+typedef void *xSemaphoreHandle;
+typedef void *xQueueHandle;
+typedef uint32_t portTickType;
+
+#define portMAX_DELAY            0xffffffff
+#define portTICK_RATE_MS         1
+#define pdTRUE                   1
+#define pdFALSE                  0
+#define tskIDLE_PRIORITY         0
+#define configMINIMAL_STACK_SIZE 128
+
+/* Implemented by the test, the tick count only moves when a test sets it */
+xSemaphoreHandle xSemaphoreCreateRecursiveMutex(void);
+int xSemaphoreTakeRecursive(xSemaphoreHandle sem, portTickType ticks);
+int xSemaphoreGiveRecursive(xSemaphoreHandle sem);
+portTickType xTaskGetTickCount(void);
+
+xQueueHandle xQueueCreate(uint32_t length, uint32_t itemSize);
+int xQueueSend(xQueueHandle queue, const void *item, portTickType ticks);
+int xQueueReceive(xQueueHandle queue, void *item, portTickType ticks);
+
+#endif /* FREERTOS_H */
@@ -0,0 +1,10 @@
+#ifndef PIOS_MEM_H
+#define PIOS_MEM_H
+
+/* Implemented by the test, to count the allocations and make them fail */
+void *test_malloc(size_t size);
+
+#define pios_malloc(size) (test_malloc(size))
+#define pios_free(p)      (free(p))
+
+#endif /* PIOS_MEM_H */
@@ -0,0 +1,432 @@
+#include "gtest/gtest.h"
+
+#include <string.h> /* memset */
+#include <map>
+#include <vector>
+
+extern "C" {
+#include "openpilot.h"
+}
+
+#define PERIOD_MS         1000
+#define HEAP_BLOCK_SIZE   16u
+#define MAX_UPDATE_PERIOD 1000
+
+/*
+ * Stand ins for the callback scheduler, the queues and the tick count. The
+ * event task only runs when a test calls it, at the tick the test sets.
+ */
+static DelayedCallback event_task;
+static int32_t scheduled_ms;
+static portTickType tick;
+static uint32_t allocations;
+static bool malloc_fails;
+static bool queue_full;
+static uint32_t queue_sends;
+
+// Periodic callbacks in the order they ran, the instance ID tells them apart
+struct Update {
+    uint32_t time;
+    uint16_t id;
+};
+static std::vector<Update> updates;
+
+static UAVObjHandle test_obj = (UAVObjHandle)&test_obj;
+
+extern "C" void *test_malloc(size_t size)
+{
+    if (malloc_fails) {
+        return NULL;
+    }
+    allocations++;
+    return malloc(size);
+}
+
+extern "C" DelayedCallbackInfo *PIOS_CALLBACKSCHEDULER_Create(DelayedCallback cb,
+                                                                __attribute__((unused)) DelayedCallbackPriority priority,
+                                                                __attribute__((unused)) DelayedCallbackPriorityTask priorityTask,
+                                                                __attribute__((unused)) int16_t callbackID,
+                                                                __attribute__((unused)) uint32_t stacksize)
+{
+    event_task = cb;
+    return (DelayedCallbackInfo *)&event_task;
+}
+
+extern "C" int32_t PIOS_CALLBACKSCHEDULER_Schedule(__attribute__((unused)) DelayedCallbackInfo *cbinfo,
+                                                   int32_t milliseconds,
+                                                   __attribute__((unused)) DelayedCallbackUpdateMode updatemode)
+{
+    scheduled_ms = milliseconds;
+    return 0;
+}
+
+extern "C" int32_t PIOS_CALLBACKSCHEDULER_Dispatch(__attribute__((unused)) DelayedCallbackInfo *cbinfo)
+{
+    return 0;
+}
+
+// Nesting depth of the dispatcher mutex, released on return
+static int mutex_depth;
+
+extern "C" xSemaphoreHandle xSemaphoreCreateRecursiveMutex(void)
+{
+    return (xSemaphoreHandle)&mutex_depth;
+}
+
+extern "C" int xSemaphoreTakeRecursive(__attribute__((unused)) xSemaphoreHandle sem, __attribute__((unused)) portTickType ticks)
+{
+    mutex_depth++;
+    return pdTRUE;
+}
+
+extern "C" int xSemaphoreGiveRecursive(__attribute__((unused)) xSemaphoreHandle sem)
+{
+    mutex_depth--;
+    return pdTRUE;
+}
+
+extern "C" portTickType xTaskGetTickCount(void)
+{
+    return tick;
+}
+
+extern "C" xQueueHandle xQueueCreate(__attribute__((unused)) uint32_t length, __attribute__((unused)) uint32_t itemSize)
+{
+    return (xQueueHandle)&queue_sends;
+}
+
+extern "C" int xQueueSend(__attribute__((unused)) xQueueHandle queue, __attribute__((unused)) const void *item,
+                          __attribute__((unused)) portTickType ticks)
+{
+    if (queue_full) {
+        return pdFALSE;
+    }
+    queue_sends++;
+    return pdTRUE;
+}
+
+extern "C" int xQueueReceive(__attribute__((unused)) xQueueHandle queue, __attribute__((unused)) void *item,
+                             __attribute__((unused)) portTickType ticks)
+{
+    // Nothing is dispatched through the event queue by these tests
+    return pdFALSE;
+}
+
+extern "C" uint32_t UAVObjGetID(__attribute__((unused)) UAVObjHandle obj)
+{
+    return 0x1234;
+}
+
+static void periodicCallback(UAVObjEvent *ev)
+{
+    Update update = { tick, ev->instId };
+
+    updates.push_back(update);
+}
+
+class EventDispatcherTest : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        // The heap of an earlier test is dropped, and the tick moves on so the
+        // event task does not wait for a wake up scheduled by that test
+        tick = (tick / 100000 + 1) * 100000;
+        ASSERT_EQ(0, EventDispatcherInitialize());
+        ASSERT_TRUE(event_task);
+        updates.clear();
+        allocations  = 0;
+        malloc_fails = false;
+        queue_full   = false;
+        queue_sends  = 0;
+    }
+
+    virtual void TearDown()
+    {
+        EXPECT_EQ(0, mutex_depth);
+    }
+
+    int32_t create(uint16_t id, uint16_t periodMs)
+    {
+        UAVObjEvent ev;
+
+        memset(&ev, 0, sizeof(ev));
+        ev.instId = id;
+        ev.event  = EV_UPDATED_PERIODIC;
+        return EventPeriodicCallbackCreate(&ev, periodicCallback, periodMs);
+    }
+
+    int32_t update(uint16_t id, uint16_t periodMs)
+    {
+        UAVObjEvent ev;
+
+        memset(&ev, 0, sizeof(ev));
+        ev.instId = id;
+        ev.event  = EV_UPDATED_PERIODIC;
+        return EventPeriodicCallbackUpdate(&ev, periodicCallback, periodMs);
+    }
+
+    // Run the event task at a given time, returns the delay it asks to be run again after
+    int32_t runAt(uint32_t time)
+    {
+        tick = time;
+        event_task();
+        return scheduled_ms;
+    }
+
+    // Run the event task whenever it asks to, until the given time
+    void runUntil(uint32_t time)
+    {
+        while (tick + scheduled_ms <= time) {
+            EXPECT_GT(scheduled_ms, 0);
+            EXPECT_LE(scheduled_ms, MAX_UPDATE_PERIOD);
+            runAt(tick + scheduled_ms);
+        }
+    }
+
+    // Times of the updates of each entry
+    std::map<uint16_t, std::vector<uint32_t> > updateTimes()
+    {
+        std::map<uint16_t, std::vector<uint32_t> > times;
+
+        for (size_t i = 0; i < updates.size(); i++) {
+            times[updates[i].id].push_back(updates[i].time);
+        }
+        return times;
+    }
+};
+
+TEST_F(EventDispatcherTest, DueEntriesRunInOrder) {
+    const uint16_t count = 100;
+
+    for (uint16_t id = 0; id < count; id++) {
+        ASSERT_EQ(0, create(id, PERIOD_MS));
+    }
+
+    // The entries start at random times within a period, all of them are late
+    // now. Rescheduled this way, each keeps its place within the period.
+    const uint32_t start = tick + PERIOD_MS - 1;
+    runAt(start);
+    ASSERT_EQ(count, updates.size());
+    std::vector<Update> first = updates;
+
+    // Run exactly when the earliest entry is due, until each ran once more
+    updates.clear();
+    EventClearStats();
+    runUntil(start + PERIOD_MS);
+    ASSERT_EQ(count, updates.size());
+
+    std::map<uint16_t, std::vector<uint32_t> > times = updateTimes();
+    uint32_t previous = start;
+    for (uint16_t i = 0; i < count; i++) {
+        ASSERT_EQ(1u, times[first[i].id].size());
+        uint32_t time = times[first[i].id][0];
+        // Popped from the heap in the order they were due
+        EXPECT_LE(previous, time);
+        EXPECT_LE(time, start + PERIOD_MS);
+        previous = time;
+    }
+
+    // None was found late once the task ran when asked to
+    EventStats stats;
+    EventGetStats(&stats);
+    EXPECT_EQ(count, stats.periodicUpdates);
+    EXPECT_EQ(0u, stats.totalLatencyMs);
+    EXPECT_EQ(0u, stats.maxLatencyMs);
+}
+
+TEST_F(EventDispatcherTest, PeriodicEntriesAreRescheduled) {
+    const uint16_t periods[] = { 10, 25, 40, 333, 1000, 2500 };
+    const uint16_t count     = sizeof(periods) / sizeof(periods[0]);
+
+    for (uint16_t id = 0; id < count; id++) {
+        ASSERT_EQ(0, create(id, periods[id]));
+    }
+
+    const uint32_t start = tick;
+    runAt(start);
+    runUntil(start + 10000);
+
+    std::map<uint16_t, std::vector<uint32_t> > times = updateTimes();
+    for (uint16_t id = 0; id < count; id++) {
+        const std::vector<uint32_t> &t = times[id];
+        // The first update runs late, the next ones exactly a period apart,
+        // even the ones longer than the task wakes up at the latest
+        ASSERT_EQ(2u + (10000 - (t[1] - start)) / periods[id], t.size()) << "period " << periods[id];
+        EXPECT_EQ(start, t[0]);
+        EXPECT_LE(t[1] - start, periods[id]);
+        for (size_t i = 2; i < t.size(); i++) {
+            EXPECT_EQ(periods[id], t[i] - t[i - 1]) << "period " << periods[id];
+        }
+    }
+
+    // A new period restarts the entry, at the next time the task runs
+    updates.clear();
+    ASSERT_EQ(0, update(0, 100));
+    const uint32_t restart = tick + scheduled_ms;
+    runUntil(restart + 1000);
+    times = updateTimes();
+    const std::vector<uint32_t> &t = times[0];
+    ASSERT_LE(10u, t.size());
+    EXPECT_EQ(restart, t[0]);
+    EXPECT_LE(t[1] - t[0], 100u);
+    for (size_t i = 2; i < t.size(); i++) {
+        EXPECT_EQ(100u, t[i] - t[i - 1]);
+    }
+}
+
+TEST_F(EventDispatcherTest, RemovedEntriesStop) {
+    const uint16_t count = 40;
+
+    for (uint16_t id = 0; id < count; id++) {
+        ASSERT_EQ(0, create(id, 100));
+    }
+    // Registered once only, unknown entries can not be updated
+    EXPECT_EQ(-1, create(0, 100));
+    EXPECT_EQ(-1, update(count, 100));
+
+    runAt(tick);
+    // A zero period unschedules the entry, from anywhere in the heap
+    for (uint16_t id = 0; id < count; id += 2) {
+        ASSERT_EQ(0, update(id, 0));
+    }
+    updates.clear();
+    const uint32_t start = tick;
+    runUntil(start + 1000);
+
+    std::map<uint16_t, std::vector<uint32_t> > times = updateTimes();
+    for (uint16_t id = 0; id < count; id++) {
+        if (id % 2 == 0) {
+            EXPECT_EQ(0u, times.count(id)) << "removed " << id;
+            continue;
+        }
+        const std::vector<uint32_t> &t = times[id];
+        ASSERT_EQ(10u, t.size()) << "kept " << id;
+        for (size_t i = 1; i < t.size(); i++) {
+            EXPECT_EQ(100u, t[i] - t[i - 1]);
+        }
+    }
+
+    // Removing twice does nothing, a removed entry can be scheduled again
+    ASSERT_EQ(0, update(2, 0));
+    ASSERT_EQ(0, update(0, 50));
+    updates.clear();
+    runUntil(start + 2000);
+    times = updateTimes();
+    EXPECT_EQ(0u, times.count(2));
+    EXPECT_LE(19u, times[0].size());
+    EXPECT_EQ(10u, times[1].size());
+
+    // Removing them all leaves the task waking up at its longest period
+    for (uint16_t id = 0; id < count; id++) {
+        ASSERT_EQ(0, update(id, 0));
+    }
+    updates.clear();
+    EXPECT_EQ(MAX_UPDATE_PERIOD, runAt(tick + scheduled_ms));
+    EXPECT_EQ(0u, updates.size());
+}
+
+TEST_F(EventDispatcherTest, HeapGrowsInBlocks) {
+    uint16_t id = 0;
+
+    // One allocation for each entry, plus one for each block: the first block
+    // holds HEAP_BLOCK_SIZE entries, each next one twice as many as the previous
+    for (; id < HEAP_BLOCK_SIZE; id++) {
+        ASSERT_EQ(0, create(id, PERIOD_MS));
+    }
+    EXPECT_EQ(HEAP_BLOCK_SIZE + 1u, allocations);
+
+    // A full heap that can not grow leaves the entry out
+    malloc_fails = true;
+    EXPECT_EQ(-1, create(id, PERIOD_MS));
+    malloc_fails = false;
+
+    for (; id < 3 * HEAP_BLOCK_SIZE; id++) {
+        ASSERT_EQ(0, create(id, PERIOD_MS));
+    }
+    EXPECT_EQ(3u * HEAP_BLOCK_SIZE + 2u, allocations);
+
+    ASSERT_EQ(0, create(id++, PERIOD_MS));
+    EXPECT_EQ(3u * HEAP_BLOCK_SIZE + 1u + 3u, allocations);
+
+    // Entries without a period are not scheduled, and do not need room in the heap
+    for (uint16_t i = 0; i < 2 * HEAP_BLOCK_SIZE; i++) {
+        ASSERT_EQ(0, create(1000 + i, 0));
+    }
+    EXPECT_EQ(5u * HEAP_BLOCK_SIZE + 1u + 3u, allocations);
+
+    // Every entry of every block runs once a period
+    const uint32_t start = tick;
+    runAt(start);
+    runUntil(start + PERIOD_MS);
+    std::map<uint16_t, std::vector<uint32_t> > times = updateTimes();
+    EXPECT_EQ(id, times.size());
+    for (uint16_t i = 0; i < id; i++) {
+        EXPECT_EQ(2u, times[i].size()) << "entry " << i;
+    }
+}
+
+TEST_F(EventDispatcherTest, LatencyAndJitterStats) {
+    EventStats stats;
+
+    ASSERT_EQ(0, create(0, 100));
+
+    // The first update has no previous one to measure against
+    const uint32_t start = tick + runAt(tick);
+    EventGetStats(&stats);
+    EXPECT_EQ(0u, stats.periodicUpdates);
+
+    runAt(start);
+    EventClearStats();
+
+    // On time
+    EXPECT_EQ(100, runAt(start + 100));
+    EventGetStats(&stats);
+    EXPECT_EQ(1u, stats.periodicUpdates);
+    EXPECT_EQ(0u, stats.totalLatencyMs);
+    EXPECT_EQ(0u, stats.totalJitterMs);
+
+    // 30ms late, the next update stays on the period
+    EXPECT_EQ(70, runAt(start + 230));
+    // On time again, 30ms early compared to the previous update
+    EXPECT_EQ(100, runAt(start + 300));
+    // More than a period late, the missed update is skipped
+    EXPECT_EQ(50, runAt(start + 550));
+
+    EventGetStats(&stats);
+    EXPECT_EQ(4u, stats.periodicUpdates);
+    EXPECT_EQ(30u + 150u, stats.totalLatencyMs);
+    EXPECT_EQ(150u, stats.maxLatencyMs);
+    EXPECT_EQ(30u + 30u + 150u, stats.totalJitterMs);
+    EXPECT_EQ(150u, stats.maxJitterMs);
+    EXPECT_EQ(0u, stats.eventErrors);
+
+    EventClearStats();
+    EventGetStats(&stats);
+    EXPECT_EQ(0u, stats.periodicUpdates);
+    EXPECT_EQ(0u, stats.maxLatencyMs);
+    EXPECT_EQ(0u, stats.maxJitterMs);
+}
+
+TEST_F(EventDispatcherTest, QueueErrorsAreCounted) {
+    UAVObjEvent ev;
+    EventStats stats;
+    xQueueHandle queue = (xQueueHandle)&queue_sends;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.obj   = test_obj;
+    ev.event = EV_UPDATED_PERIODIC;
+    ASSERT_EQ(0, EventPeriodicQueueCreate(&ev, queue, 100));
+    ev.instId      = 1;
+    ev.lowPriority = true;
+    ASSERT_EQ(0, EventPeriodicQueueCreate(&ev, queue, 100));
+
+    runAt(tick);
+    EXPECT_EQ(2u, queue_sends);
+
+    // A full queue is an error, unless the event is low priority
+    queue_full = true;
+    runUntil(tick + 100);
+    EventGetStats(&stats);
+    EXPECT_EQ(1u, stats.eventErrors);
+    EXPECT_EQ(0x1234u, stats.lastErrorID);
+}
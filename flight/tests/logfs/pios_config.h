@@ -6,4 +6,7 @@
 // #define PIOS_FLASHFS_LOGFS_MAX_DEVS 5
 #define PIOS_INCLUDE_FREERTOS
 
+/* Slots moved per garbage collection step, the latency tests check against it */
+#define PIOS_FLASHFS_LOGFS_GC_SLOTS_PER_STEP 8
+
 #endif /* PIOS_CONFIG_H */
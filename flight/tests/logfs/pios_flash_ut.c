@@ -15,6 +15,9 @@ struct flash_ut_dev {
     const struct pios_flash_ut_cfg *cfg;
     bool transaction_in_progress;
     FILE *flash_file;
+    uint32_t num_reads;
+    uint32_t num_writes;
+    uint32_t num_erases;
 };
 
 static struct flash_ut_dev *PIOS_Flash_UT_Alloc(void)
@@ -40,6 +43,9 @@ int32_t PIOS_Flash_UT_Init(uintptr_t *flash_id, const struct pios_flash_ut_cfg *
 
     flash_dev->cfg = cfg;
     flash_dev->transaction_in_progress = false;
+    flash_dev->num_reads  = 0;
+    flash_dev->num_writes = 0;
+    flash_dev->num_erases = 0;
 
     flash_dev->flash_file = fopen(FLASH_IMAGE_FILE, "rb+");
     if (flash_dev->flash_file == NULL) {
@@ -74,6 +80,44 @@ int32_t PIOS_Flash_UT_Destroy(uintptr_t flash_id)
     return 0;
 }
 
+uint32_t PIOS_Flash_UT_GetReadCount(uintptr_t flash_id)
+{
+    /* Check inputs */
+    assert(flash_id);
+    struct flash_ut_dev *flash_dev = (void *)flash_id;
+
+    return flash_dev->num_reads;
+}
+
+uint32_t PIOS_Flash_UT_GetWriteCount(uintptr_t flash_id)
+{
+    /* Check inputs */
+    assert(flash_id);
+    struct flash_ut_dev *flash_dev = (void *)flash_id;
+
+    return flash_dev->num_writes;
+}
+
+uint32_t PIOS_Flash_UT_GetEraseCount(uintptr_t flash_id)
+{
+    /* Check inputs */
+    assert(flash_id);
+    struct flash_ut_dev *flash_dev = (void *)flash_id;
+
+    return flash_dev->num_erases;
+}
+
+void PIOS_Flash_UT_ResetCounts(uintptr_t flash_id)
+{
+    /* Check inputs */
+    assert(flash_id);
+    struct flash_ut_dev *flash_dev = (void *)flash_id;
+
+    flash_dev->num_reads  = 0;
+    flash_dev->num_writes = 0;
+    flash_dev->num_erases = 0;
+}
+
 
 /**********************************
  *
@@ -123,6 +167,8 @@ static int32_t PIOS_Flash_UT_EraseSector(uintptr_t flash_id, uint32_t addr)
 
     assert(s == flash_dev->cfg->size_of_sector);
 
+    flash_dev->num_erases++;
+
     return 0;
 }
 
@@ -144,6 +190,8 @@ static int32_t PIOS_Flash_UT_WriteData(uintptr_t flash_id, uint32_t addr, uint8_
 
     assert(s == len);
 
+    flash_dev->num_writes++;
+
     return 0;
 }
 
@@ -165,6 +213,8 @@ static int32_t PIOS_Flash_UT_ReadData(uintptr_t flash_id, uint32_t addr, uint8_t
 
     assert(s == len);
 
+    flash_dev->num_reads++;
+
     return 0;
 }
 
@@ -5,6 +5,7 @@
 #include <string.h> /* memset */
 
 extern "C" {
+#include "pios_config.h" /* PIOS_FLASHFS_LOGFS_GC_SLOTS_PER_STEP */
 #include "pios_flash.h" /* PIOS_FLASH_* API */
 #include "pios_flash_ut_priv.h"
 
@@ -297,6 +298,254 @@ TEST_F(LogfsTestCooked, WriteManyVerify) {
     EXPECT_EQ(0, memcmp(obj3, obj3_check, sizeof(obj3)));
 }
 
+/*
+ * Flash reads per load, the slot index built at mount time lets a load
+ * read just the slot header and the object data instead of walking the
+ * headers of all the slots before it.
+ */
+#define INDEXED_INSTANCES 100
+
+TEST_F(LogfsTestCooked, LoadReadCountIndexed) {
+    for (uint16_t i = 0; i < INDEXED_INSTANCES; i++) {
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, i, obj1, sizeof(obj1)));
+    }
+
+    /* Remount so that the index is rebuilt from flash */
+    PIOS_FLASHFS_Logfs_Destroy(fs_id);
+    EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, &flashfs_config_partition_a, &pios_ut_flash_driver, flash_id));
+
+    unsigned char obj1_check[OBJ1_SIZE];
+    PIOS_Flash_UT_ResetCounts(flash_id);
+    for (uint16_t i = 0; i < INDEXED_INSTANCES; i++) {
+        memset(obj1_check, 0, sizeof(obj1_check));
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, i, obj1_check, sizeof(obj1_check)));
+        EXPECT_EQ(0, memcmp(obj1, obj1_check, sizeof(obj1)));
+    }
+    uint32_t reads = PIOS_Flash_UT_GetReadCount(flash_id);
+    printf("indexed: %.1f flash reads per load\n", (double)reads / INDEXED_INSTANCES);
+
+    /* One read for the slot header and one for the data */
+    EXPECT_EQ(2u * INDEXED_INSTANCES, reads);
+
+    /* Missing objects are known to be missing without touching flash */
+    PIOS_Flash_UT_ResetCounts(flash_id);
+    EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ2_ID, 0, obj2, sizeof(obj2)));
+    EXPECT_EQ(0u, PIOS_Flash_UT_GetReadCount(flash_id));
+}
+
+TEST_F(LogfsTestCooked, LoadReadCountIndexUpdated) {
+    unsigned char obj1_check[OBJ1_SIZE];
+
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 0, obj1, sizeof(obj1)));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ2_ID, 0, obj2, sizeof(obj2)));
+
+    /* A new version of the object moves to another slot */
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 0, obj1_alt, sizeof(obj1_alt)));
+    PIOS_Flash_UT_ResetCounts(flash_id);
+    memset(obj1_check, 0, sizeof(obj1_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 0, obj1_check, sizeof(obj1_check)));
+    EXPECT_EQ(0, memcmp(obj1_alt, obj1_check, sizeof(obj1_alt)));
+    EXPECT_EQ(2u, PIOS_Flash_UT_GetReadCount(flash_id));
+
+    /* A deleted object is gone from the index */
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjDelete(fs_id, OBJ1_ID, 0));
+    PIOS_Flash_UT_ResetCounts(flash_id);
+    EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 0, obj1_check, sizeof(obj1_check)));
+    EXPECT_EQ(0u, PIOS_Flash_UT_GetReadCount(flash_id));
+
+    /* Objects that survive garbage collection are found in their new slots */
+    for (uint32_t i = 0; i < flashfs_config_partition_a.arena_size / flashfs_config_partition_a.slot_size; i++) {
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 1, obj1, sizeof(obj1)));
+    }
+    unsigned char obj2_check[OBJ2_SIZE];
+    PIOS_Flash_UT_ResetCounts(flash_id);
+    memset(obj2_check, 0, sizeof(obj2_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ2_ID, 0, obj2_check, sizeof(obj2_check)));
+    EXPECT_EQ(0, memcmp(obj2, obj2_check, sizeof(obj2)));
+    EXPECT_EQ(2u, PIOS_Flash_UT_GetReadCount(flash_id));
+}
+
+TEST_F(LogfsTestCooked, LoadIndexOverflow) {
+    uint16_t num_slots = flashfs_config_partition_a.arena_size / flashfs_config_partition_a.slot_size - 1;
+
+    /* More active objects than the index can hold */
+    for (uint16_t i = 0; i < num_slots; i++) {
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, i, obj1, sizeof(obj1)));
+    }
+
+    /* Objects left out of the index are still found by scanning the log */
+    unsigned char obj1_check[OBJ1_SIZE];
+    PIOS_Flash_UT_ResetCounts(flash_id);
+    for (uint16_t i = 0; i < num_slots; i++) {
+        memset(obj1_check, 0, sizeof(obj1_check));
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, i, obj1_check, sizeof(obj1_check)));
+        EXPECT_EQ(0, memcmp(obj1, obj1_check, sizeof(obj1)));
+    }
+    printf("overflowed: %.1f flash reads per load\n", (double)PIOS_Flash_UT_GetReadCount(flash_id) / num_slots);
+
+    /* Deleting an object not in the index */
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjDelete(fs_id, OBJ1_ID, num_slots - 1));
+    EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, num_slots - 1, obj1_check, sizeof(obj1_check)));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 0, obj1_check, sizeof(obj1_check)));
+}
+
+/*
+ * Save latency while the log is garbage collected. The time of a save is
+ * modelled from the flash operations it needed, with typical timings of the
+ * external SPI flash: 64KB sector erase, page program and a short read.
+ */
+#define MODEL_ERASE_US     500000
+#define MODEL_WRITE_US     500
+#define MODEL_READ_US      20
+
+#define LATENCY_INSTANCES  20
+#define LATENCY_SAVES      5000
+#define LATENCY_NUM_BUCKETS 10
+
+/* Writes one save may need: the slots moved by a collection step and the save itself */
+#define LATENCY_MAX_WRITES ((uint32_t)(PIOS_FLASHFS_LOGFS_GC_SLOTS_PER_STEP * ((OBJ1_SIZE + 12) / 16 + 1) + 10))
+
+class LogfsTestLatency : public LogfsTestCooked {
+protected:
+    virtual void SetUp()
+    {
+        LogfsTestCooked::SetUp();
+
+        memset(histogram, 0, sizeof(histogram));
+        max_us     = 0;
+        max_erases = 0;
+        max_writes = 0;
+    }
+
+    void save(uint16_t obj_inst_id, unsigned char *data)
+    {
+        PIOS_Flash_UT_ResetCounts(flash_id);
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, obj_inst_id, data, OBJ1_SIZE));
+
+        uint32_t erases = PIOS_Flash_UT_GetEraseCount(flash_id);
+        uint32_t writes = PIOS_Flash_UT_GetWriteCount(flash_id);
+        uint32_t us     = erases * MODEL_ERASE_US +
+                          writes * MODEL_WRITE_US +
+                          PIOS_Flash_UT_GetReadCount(flash_id) * MODEL_READ_US;
+
+        uint8_t bucket = 0;
+        while (bucket < LATENCY_NUM_BUCKETS - 1 && us >= bucket_limits_ms[bucket] * 1000) {
+            bucket++;
+        }
+        histogram[bucket]++;
+
+        max_us     = (us > max_us) ? us : max_us;
+        max_erases = (erases > max_erases) ? erases : max_erases;
+        max_writes = (writes > max_writes) ? writes : max_writes;
+    }
+
+    void printHistogram(const char *name)
+    {
+        printf("%s save latency (modelled):\n", name);
+        for (uint8_t i = 0; i < LATENCY_NUM_BUCKETS; i++) {
+            if (i < LATENCY_NUM_BUCKETS - 1) {
+                printf("  < %4u ms: %u\n", bucket_limits_ms[i], histogram[i]);
+            } else {
+                printf("  >=%4u ms: %u\n", bucket_limits_ms[i - 1], histogram[i]);
+            }
+        }
+        printf("  max %.1f ms, %u erases, %u writes\n", max_us / 1000.0, max_erases, max_writes);
+    }
+
+    /* Every instance holds the number of the save that last wrote it */
+    void verifyAll()
+    {
+        unsigned char obj1_check[OBJ1_SIZE];
+
+        for (uint16_t i = 0; i < LATENCY_INSTANCES; i++) {
+            memset(obj1_check, 0, sizeof(obj1_check));
+            EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, i, obj1_check, sizeof(obj1_check)));
+            EXPECT_EQ((LATENCY_SAVES - LATENCY_INSTANCES + i) & 0xff, obj1_check[0]);
+        }
+    }
+
+    static const uint32_t bucket_limits_ms[LATENCY_NUM_BUCKETS - 1];
+    uint32_t histogram[LATENCY_NUM_BUCKETS];
+    uint32_t max_us;
+    uint32_t max_erases;
+    uint32_t max_writes;
+};
+
+const uint32_t LogfsTestLatency::bucket_limits_ms[LATENCY_NUM_BUCKETS - 1] = { 1, 2, 5, 10, 20, 50, 100, 200, 500 };
+
+TEST_F(LogfsTestLatency, SaveWithBackgroundCollection) {
+    uint32_t background_erases = 0;
+
+    for (uint32_t i = 0; i < LATENCY_SAVES; i++) {
+        memset(obj1, i & 0xff, sizeof(obj1));
+        save(i % LATENCY_INSTANCES, obj1);
+
+        /* The background callback gets to run between two saves */
+        PIOS_Flash_UT_ResetCounts(flash_id);
+        EXPECT_LE(0, PIOS_FLASHFS_Logfs_GarbageCollectStep(fs_id));
+        background_erases += PIOS_Flash_UT_GetEraseCount(flash_id);
+    }
+    printHistogram("background");
+
+    /* The log was collected many times, always erasing in the background */
+    EXPECT_LT(0u, background_erases);
+    EXPECT_EQ(0u, max_erases);
+    EXPECT_GE(LATENCY_MAX_WRITES, max_writes);
+
+    verifyAll();
+}
+
+TEST_F(LogfsTestLatency, SaveWithoutBackgroundCollection) {
+    for (uint32_t i = 0; i < LATENCY_SAVES; i++) {
+        memset(obj1, i & 0xff, sizeof(obj1));
+        save(i % LATENCY_INSTANCES, obj1);
+    }
+    printHistogram("save only");
+
+    /* Saves do all the work, one sector erase or a few slots at a time */
+    EXPECT_GE(1u, max_erases);
+    EXPECT_GE(LATENCY_MAX_WRITES, max_writes);
+
+    verifyAll();
+}
+
+TEST_F(LogfsTestLatency, DeleteDuringCollection) {
+    unsigned char obj1_check[OBJ1_SIZE];
+    uint8_t versions[LATENCY_INSTANCES];
+    bool deleted[LATENCY_INSTANCES];
+
+    memset(deleted, 0, sizeof(deleted));
+    for (uint32_t i = 0; i < LATENCY_SAVES; i++) {
+        uint16_t inst = (i * 7) % LATENCY_INSTANCES;
+        if (i % 5 == 0) {
+            EXPECT_EQ(0, PIOS_FLASHFS_ObjDelete(fs_id, OBJ1_ID, inst));
+            deleted[inst] = true;
+        } else {
+            memset(obj1, i & 0xff, sizeof(obj1));
+            save(inst, obj1);
+            versions[inst] = i & 0xff;
+            deleted[inst]  = false;
+        }
+        if (i % 2) {
+            EXPECT_LE(0, PIOS_FLASHFS_Logfs_GarbageCollectStep(fs_id));
+        }
+    }
+
+    /* Remount, copies of deleted slots must not have come back */
+    PIOS_FLASHFS_Logfs_Destroy(fs_id);
+    EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, &flashfs_config_partition_a, &pios_ut_flash_driver, flash_id));
+
+    for (uint16_t inst = 0; inst < LATENCY_INSTANCES; inst++) {
+        memset(obj1_check, 0, sizeof(obj1_check));
+        if (deleted[inst]) {
+            EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, inst, obj1_check, sizeof(obj1_check)));
+        } else {
+            EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, inst, obj1_check, sizeof(obj1_check)));
+            EXPECT_EQ(versions[inst], obj1_check[0]);
+        }
+    }
+}
+
 class LogfsTestCookedMultiPart : public LogfsTestRaw {
 protected:
     virtual void SetUp()
@@ -0,0 +1,81 @@
+#include "gtest/gtest.h"
+
+#include <math.h> /* sinf */
+
+extern "C" {
+#include "biquad.h"
+}
+
+#define SAMPLE_RATE 8000.0f
+
+// To use a test fixture, derive a class from testing::Test.
+class BiquadTest : public testing::Test {
+protected:
+    // Peak output for a sine input, once the filter has settled
+    float amplitude(biquad_t *filter, float frequency)
+    {
+        float peak = 0.0f;
+
+        for (int i = 0; i < 16000; i++) {
+            float out = biquad_apply(filter, sinf(2.0f * (float)M_PI * frequency * i / SAMPLE_RATE));
+            if (i >= 8000 && fabsf(out) > peak) {
+                peak = fabsf(out);
+            }
+        }
+        return peak;
+    }
+};
+
+TEST_F(BiquadTest, LowPassResponse) {
+    biquad_t filter;
+
+    EXPECT_TRUE(biquad_init_lowpass(&filter, 100.0f, SAMPLE_RATE));
+    EXPECT_NEAR(1.0f, amplitude(&filter, 10.0f), 0.01f);
+
+    EXPECT_TRUE(biquad_init_lowpass(&filter, 100.0f, SAMPLE_RATE));
+    EXPECT_NEAR(sqrtf(0.5f), amplitude(&filter, 100.0f), 0.01f);
+
+    // Second order, -40dB per decade
+    EXPECT_TRUE(biquad_init_lowpass(&filter, 100.0f, SAMPLE_RATE));
+    EXPECT_NEAR(0.01f, amplitude(&filter, 1000.0f), 0.002f);
+}
+
+TEST_F(BiquadTest, NotchResponse) {
+    biquad_t filter;
+
+    EXPECT_TRUE(biquad_init_notch(&filter, 200.0f, 3.0f, SAMPLE_RATE));
+    EXPECT_LT(amplitude(&filter, 200.0f), 0.01f);
+
+    EXPECT_TRUE(biquad_init_notch(&filter, 200.0f, 3.0f, SAMPLE_RATE));
+    EXPECT_NEAR(1.0f, amplitude(&filter, 20.0f), 0.01f);
+
+    EXPECT_TRUE(biquad_init_notch(&filter, 200.0f, 3.0f, SAMPLE_RATE));
+    EXPECT_NEAR(1.0f, amplitude(&filter, 2000.0f), 0.01f);
+}
+
+TEST_F(BiquadTest, PassThroughAboveNyquist) {
+    biquad_t filter;
+
+    EXPECT_FALSE(biquad_init_lowpass(&filter, SAMPLE_RATE / 2, SAMPLE_RATE));
+    EXPECT_EQ(0.25f, biquad_apply(&filter, 0.25f));
+    EXPECT_EQ(-3.0f, biquad_apply(&filter, -3.0f));
+
+    EXPECT_FALSE(biquad_init_notch(&filter, 0.0f, 3.0f, SAMPLE_RATE));
+    EXPECT_EQ(0.25f, biquad_apply(&filter, 0.25f));
+}
+
+TEST_F(BiquadTest, Reset) {
+    biquad_t lowpass;
+    biquad_t notch;
+
+    biquad_init_lowpass(&lowpass, 50.0f, SAMPLE_RATE);
+    biquad_init_notch(&notch, 150.0f, 5.0f, SAMPLE_RATE);
+    biquad_reset(&lowpass, 9.81f);
+    biquad_reset(&notch, 9.81f);
+
+    // No step response once the state matches the input
+    for (int i = 0; i < 100; i++) {
+        EXPECT_NEAR(9.81f, biquad_apply(&lowpass, 9.81f), 0.01f);
+        EXPECT_NEAR(9.81f, biquad_apply(&notch, 9.81f), 0.01f);
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef PIOS_H
+#define PIOS_H
+
+/* PIOS Feature Selection */
+#include "pios_config.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PIOS_Assert(x) \
+    if (!(x)) { abort(); \
+    }
+
+#include <pios_com.h>
+
+#endif /* PIOS_H */
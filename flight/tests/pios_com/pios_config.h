@@ -0,0 +1,9 @@
+#ifndef PIOS_CONFIG_H
+#define PIOS_CONFIG_H
+
+/* Enable/Disable PiOS modules */
+#define PIOS_INCLUDE_COM
+// FreeRTOS is left out, PIOS_COM then allocates from a static array
+#define PIOS_COM_MAX_DEVS 2
+
+#endif /* PIOS_CONFIG_H */
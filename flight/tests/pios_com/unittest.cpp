@@ -0,0 +1,263 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h> /* printf */
+#include <string.h> /* memset */
+#include <time.h> /* clock_gettime */
+
+extern "C" {
+#include "pios.h"
+}
+
+#define TX_FIFO_SIZE 256
+
+/*
+ * Stand in for a serial driver. The COM layer hands it the tx callback at
+ * init time, tx_start() either leaves the data in the fifo or drains all of
+ * it as an interrupt driven driver would.
+ */
+static pios_com_callback tx_out_cb;
+static uint32_t tx_out_context;
+static uint32_t tx_start_calls;
+static bool tx_drain;
+static bool tx_available;
+static uint8_t tx_out[4096];
+static uint32_t tx_out_len;
+static uint32_t tx_sink;
+
+static void fake_bind_tx_cb(__attribute__((unused)) uint32_t id, pios_com_callback cb, uint32_t context)
+{
+    tx_out_cb = cb;
+    tx_out_context = context;
+}
+
+static uint16_t fake_drain(void)
+{
+    uint8_t buf[64];
+    uint16_t headroom;
+    bool need_yield;
+    uint16_t len;
+    uint16_t total = 0;
+
+    while ((len = tx_out_cb(tx_out_context, buf, sizeof(buf), &headroom, &need_yield)) > 0) {
+        if (tx_out_len + len <= sizeof(tx_out)) {
+            memcpy(&tx_out[tx_out_len], buf, len);
+            tx_out_len += len;
+        }
+        tx_sink += len;
+        total   += len;
+    }
+    return total;
+}
+
+static void fake_tx_start(__attribute__((unused)) uint32_t id, __attribute__((unused)) uint16_t tx_bytes_avail)
+{
+    tx_start_calls++;
+    if (tx_drain) {
+        fake_drain();
+    }
+}
+
+static uint32_t fake_available(__attribute__((unused)) uint32_t id)
+{
+    return tx_available ? COM_AVAILABLE_TX : COM_AVAILABLE_NONE;
+}
+
+// Only used by PIOS_COM_ReceiveBuffer() when waiting for data
+extern "C" int32_t PIOS_DELAY_WaitmS(__attribute__((unused)) uint32_t mS)
+{
+    return 0;
+}
+
+static const struct pios_com_driver fake_driver = {
+    .init = NULL,
+    .set_baud          = NULL,
+    .set_halfduplex    = NULL,
+    .set_config        = NULL,
+    .set_ctrl_line     = NULL,
+    .tx_start          = fake_tx_start,
+    .rx_start          = NULL,
+    .bind_rx_cb        = NULL,
+    .bind_tx_cb        = fake_bind_tx_cb,
+    .bind_ctrl_line_cb = NULL,
+    .bind_baud_rate_cb = NULL,
+    .available         = fake_available,
+    .bind_available_cb = NULL,
+};
+
+// The COM layer has no way to free a device, the one set up first is reused
+static uint32_t com_id;
+static uint8_t tx_buffer[TX_FIFO_SIZE];
+
+class PiosComTest : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        if (!com_id) {
+            ASSERT_EQ(0, PIOS_COM_Init(&com_id, &fake_driver, 0, NULL, 0, tx_buffer, sizeof(tx_buffer)));
+        }
+        ASSERT_NE(0U, com_id);
+
+        tx_drain       = false;
+        tx_available   = true;
+        tx_start_calls = 0;
+        // Empty whatever an earlier test left in the fifo
+        fake_drain();
+        tx_out_len     = 0;
+        tx_sink = 0;
+
+        for (uint16_t i = 0; i < sizeof(header); i++) {
+            header[i] = i;
+        }
+        for (uint16_t i = 0; i < sizeof(payload); i++) {
+            payload[i] = i * 7;
+        }
+        checksum = 0x5a;
+
+        iov[0].base = header;
+        iov[0].len  = sizeof(header);
+        iov[1].base = payload;
+        iov[1].len  = sizeof(payload);
+        iov[2].base = &checksum;
+        iov[2].len  = 1;
+    }
+
+    void expectPackage(const uint8_t *data)
+    {
+        EXPECT_EQ(0, memcmp(data, header, sizeof(header)));
+        EXPECT_EQ(0, memcmp(data + sizeof(header), payload, sizeof(payload)));
+        EXPECT_EQ(checksum, data[sizeof(header) + sizeof(payload)]);
+    }
+
+    uint8_t header[10];
+    uint8_t payload[180];
+    uint8_t checksum;
+    struct pios_com_iovec iov[3];
+};
+
+TEST_F(PiosComTest, SendBufferVInvalidPort) {
+    EXPECT_EQ(-1, PIOS_COM_SendBufferV(0, iov, 3));
+}
+
+TEST_F(PiosComTest, SendBufferVQueuesPackage) {
+    const int32_t len = sizeof(header) + sizeof(payload) + 1;
+
+    EXPECT_EQ(len, PIOS_COM_SendBufferV(com_id, iov, 3));
+
+    // The whole package is queued with a single tx start
+    EXPECT_EQ(1U, tx_start_calls);
+    EXPECT_EQ(len, fake_drain());
+    expectPackage(tx_out);
+}
+
+TEST_F(PiosComTest, SendBufferVWrapsAroundFifoEnd) {
+    uint8_t filler[200];
+
+    // Move the fifo positions close to its end
+    memset(filler, 0xee, sizeof(filler));
+    EXPECT_EQ((int32_t)sizeof(filler), PIOS_COM_SendBuffer(com_id, filler, sizeof(filler)));
+    fake_drain();
+    tx_out_len = 0;
+
+    EXPECT_EQ((int32_t)(sizeof(header) + sizeof(payload) + 1), PIOS_COM_SendBufferV(com_id, iov, 3));
+    fake_drain();
+    expectPackage(tx_out);
+}
+
+TEST_F(PiosComTest, SendBufferVLargerThanFifo) {
+    uint8_t big[3 * TX_FIFO_SIZE + 17];
+    struct pios_com_iovec big_iov[2] = {
+        { header, sizeof(header) },
+        { big,    sizeof(big)    },
+    };
+
+    for (uint16_t i = 0; i < sizeof(big); i++) {
+        big[i] = i ^ (i >> 8);
+    }
+
+    // The driver has to drain the fifo for the rest to be queued
+    tx_drain = true;
+    EXPECT_EQ((int32_t)(sizeof(header) + sizeof(big)), PIOS_COM_SendBufferV(com_id, big_iov, 2));
+    fake_drain();
+
+    ASSERT_EQ(sizeof(header) + sizeof(big), tx_out_len);
+    EXPECT_EQ(0, memcmp(tx_out, header, sizeof(header)));
+    EXPECT_EQ(0, memcmp(tx_out + sizeof(header), big, sizeof(big)));
+}
+
+TEST_F(PiosComTest, SendBufferVDeviceDown) {
+    tx_available = false;
+
+    // A device that is down acts as a sink and nothing is queued
+    EXPECT_EQ((int32_t)(sizeof(header) + sizeof(payload) + 1), PIOS_COM_SendBufferV(com_id, iov, 3));
+    EXPECT_EQ(0, fake_drain());
+}
+
+/*
+ * Transmit throughput through PIOS_COM, a package made of a header, a payload
+ * and a checksum is sent and the driver drains the fifo on each tx start.
+ * "Separate" sends the three parts with one PIOS_COM_SendBuffer() each, as
+ * the MSP bridge used to. "Staged" assembles the package in a temporary
+ * buffer first. "Vectored" sends it with one PIOS_COM_SendBufferV().
+ */
+#define THROUGHPUT_PACKAGES 200000
+
+static double elapsed(const struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+TEST_F(PiosComTest, Throughput) {
+    const uint16_t len  = sizeof(header) + sizeof(payload) + 1;
+    const double bytes  = (double)THROUGHPUT_PACKAGES * len;
+    uint8_t staging[sizeof(header) + sizeof(payload) + 1];
+    struct timespec start;
+
+    tx_drain = true;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t i = 0; i < THROUGHPUT_PACKAGES; i++) {
+        for (uint8_t j = 0; j < 3; j++) {
+            PIOS_COM_SendBuffer(com_id, iov[j].base, iov[j].len);
+        }
+    }
+    double separate_time  = elapsed(&start);
+    uint32_t separate_starts = tx_start_calls;
+    EXPECT_EQ(bytes, (double)tx_sink);
+
+    tx_sink = 0;
+    tx_start_calls = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t i = 0; i < THROUGHPUT_PACKAGES; i++) {
+        uint16_t pos = 0;
+        for (uint8_t j = 0; j < 3; j++) {
+            memcpy(&staging[pos], iov[j].base, iov[j].len);
+            pos += iov[j].len;
+        }
+        PIOS_COM_SendBuffer(com_id, staging, pos);
+    }
+    double staged_time = elapsed(&start);
+    uint32_t staged_starts = tx_start_calls;
+    EXPECT_EQ(bytes, (double)tx_sink);
+
+    tx_sink = 0;
+    tx_start_calls = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t i = 0; i < THROUGHPUT_PACKAGES; i++) {
+        PIOS_COM_SendBufferV(com_id, iov, 3);
+    }
+    double vectored_time = elapsed(&start);
+    uint32_t vectored_starts = tx_start_calls;
+    EXPECT_EQ(bytes, (double)tx_sink);
+
+    // One tx start, and on target one send lock, per package instead of per part
+    EXPECT_EQ(3U * THROUGHPUT_PACKAGES, separate_starts);
+    EXPECT_EQ((uint32_t)THROUGHPUT_PACKAGES, staged_starts);
+    EXPECT_EQ((uint32_t)THROUGHPUT_PACKAGES, vectored_starts);
+
+    printf("separate: %.1f MB/s\n", bytes / separate_time / 1e6);
+    printf("staged:   %.1f MB/s\n", bytes / staged_time / 1e6);
+    printf("vectored: %.1f MB/s\n", bytes / vectored_time / 1e6);
+}
@@ -0,0 +1,26 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+/* Single threaded stand-ins for the few FreeRTOS primitives used by the object manager */
+typedef void *xSemaphoreHandle;
+typedef void *xQueueHandle;
+typedef uint32_t portTickType;
+
+#define portMAX_DELAY 0xffffffff
+#define pdTRUE        1
+#define pdFALSE       0
+
+#define vPortFree(pv) (free(pv))
+
+/* Implemented by the test, to simulate lock contention and check the lock order */
+xSemaphoreHandle xSemaphoreCreateRecursiveMutex(void);
+int xSemaphoreTakeRecursive(xSemaphoreHandle sem, portTickType ticks);
+int xSemaphoreGiveRecursive(xSemaphoreHandle sem);
+
+int xQueueSend(xQueueHandle queue, const void *item, portTickType ticks);
+int xQueueReceive(xQueueHandle queue, void *item, portTickType ticks);
+
+#endif /* FREERTOS_H */
@@ -0,0 +1,10 @@
+#ifndef OPENPILOT_H
+#define OPENPILOT_H
+
+#include <pios.h>
+
+#include <utlist.h>
+#include <uavobjectmanager.h>
+#include <eventdispatcher.h>
+
+#endif /* OPENPILOT_H */
@@ -0,0 +1,27 @@
+#ifndef PIOS_H
+#define PIOS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/* PIOS Feature Selection */
+#include "pios_config.h"
+
+#ifdef PIOS_INCLUDE_FREERTOS
+/* FreeRTOS Includes */
+#include "FreeRTOS.h"
+#endif
+#include "pios_mem.h"
+#include <pios_helpers.h>
+
+#define PIOS_Assert(x) \
+    if (!(x)) { while (1) {; } \
+    }
+#define PIOS_DEBUG_Assert(x) PIOS_Assert(x)
+#define PIOS_STATIC_ASSERT(test) ((void)sizeof(int[1 - 2 * !(test)]))
+
+uint8_t PIOS_CRC_updateCRC(uint8_t crc, const uint8_t *data, int32_t length);
+
+#endif /* PIOS_H */
@@ -0,0 +1,10 @@
+#ifndef PIOS_CONFIG_H
+#define PIOS_CONFIG_H
+
+#define PIOS_INCLUDE_FREERTOS
+
+/* Object manager options */
+#define PIOS_UAVOBJECT_LOCK_STRIPES     4
+#define PIOS_UAVOBJECT_SEQLOCK_MAX_SIZE 64
+
+#endif /* PIOS_CONFIG_H */
@@ -0,0 +1,109 @@
+#!/usr/bin/env python
+#
+# Writes the object IDs of shared/uavobjectdefinition as a C table, hashed the
+# same way as UAVObjectParser::calculateID() in ground/uavobjgenerator, so the
+# object manager tests run against the IDs the firmware really registers.
+#
+# Usage: uavobjectids.py <uavobjectdefinition dir> <output header>
+#
+
+import os
+import sys
+import xml.etree.ElementTree as ET
+
+FIELD_TYPES = ["int8", "int16", "int32", "uint8", "uint16", "uint32", "float", "enum"]
+FIELD_TYPE_NUM_BYTES = [1, 2, 4, 1, 2, 4, 4, 1]
+FIELDTYPE_ENUM = 7
+
+
+def update_hash(value, hash):
+    return (hash ^ (((hash << 5) & 0xFFFFFFFF) + (hash >> 2) + value)) & 0xFFFFFFFF
+
+
+def update_hash_string(value, hash):
+    for c in value.encode("latin-1"):
+        c = ord(c) if isinstance(c, str) else c
+        # QByteArray holds signed chars
+        hash = update_hash((c - 256) & 0xFFFFFFFF if c > 127 else c, hash)
+    return hash
+
+
+def split_list(value):
+    # QString::split(",", QString::SkipEmptyParts) followed by trimmed()
+    return [part.strip() for part in value.split(",") if part != ""]
+
+
+def child_texts(node, list_name, item_name):
+    list_node = node.find(list_name)
+    if list_node is None:
+        return []
+    return [item.text for item in list_node.findall(item_name) if item.text]
+
+
+def parse_field(node, fields):
+    name = node.get("name")
+    parent_name = node.get("cloneof")
+    if parent_name:
+        parent = [field for field in fields if field["name"] == parent_name][0]
+        field = dict(parent)
+        field["name"] = name
+        return field
+
+    type = FIELD_TYPES.index(node.get("type"))
+    if node.get("elementnames") is not None:
+        num_elements = len(split_list(node.get("elementnames")))
+    else:
+        num_elements = len(child_texts(node, "elementnames", "elementname"))
+    if num_elements == 0:
+        num_elements = int(node.get("elements"))
+
+    options = []
+    if type == FIELDTYPE_ENUM:
+        if node.get("options") is not None:
+            options = split_list(node.get("options"))
+        else:
+            options = child_texts(node, "options", "option")
+
+    return {"name": name, "type": type, "numBytes": FIELD_TYPE_NUM_BYTES[type],
+            "numElements": num_elements, "options": options}
+
+
+def object_id(node):
+    fields = []
+    for child in node.findall("field"):
+        fields.append(parse_field(child, fields))
+    # Stable sort by size, as the generator does
+    fields.sort(key=lambda field: -field["numBytes"])
+
+    hash = update_hash_string(node.get("name"), 0)
+    hash = update_hash(1 if node.get("settings") == "true" else 0, hash)
+    hash = update_hash(1 if node.get("singleinstance") == "true" else 0, hash)
+    for field in fields:
+        hash = update_hash_string(field["name"], hash)
+        hash = update_hash(field["numElements"], hash)
+        hash = update_hash(field["type"], hash)
+        for option in field["options"]:
+            hash = update_hash_string(option, hash)
+    return hash & 0xFFFFFFFE
+
+
+def main():
+    definitions = sys.argv[1]
+    objects = []
+    for filename in sorted(os.listdir(definitions)):
+        if filename.endswith(".xml"):
+            root = ET.parse(os.path.join(definitions, filename)).getroot()
+            for node in root.findall("object"):
+                objects.append((node.get("name"), object_id(node)))
+
+    with open(sys.argv[2], "w") as out:
+        out.write("/* Generated by uavobjectids.py from shared/uavobjectdefinition, do not edit */\n")
+        out.write("#define NUM_OBJECTS %d\n" % len(objects))
+        out.write("static const uint32_t objIds[NUM_OBJECTS] = {\n")
+        for name, id in objects:
+            out.write("    0x%08X, /* %s */\n" % (id, name))
+        out.write("};\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,454 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* abort */
+#include <string.h> /* memset */
+#include <time.h> /* clock */
+
+extern "C" {
+#include "openpilot.h"
+#include "pios_struct_helper.h"
+#include "uavobjectprivate.h"
+
+static bool lockContended;
+
+/* Locks are numbered from 1 in creation order, with the depth each one is held at */
+#define MAX_LOCKS 8
+static uint32_t numLocks;
+static uint32_t lockDepth[MAX_LOCKS + 1];
+static uint32_t maxLocksHeld;
+static uint32_t lockTakes;
+
+static uint32_t locksHeld()
+{
+    uint32_t held = 0;
+
+    for (uint32_t i = 1; i <= numLocks; i++) {
+        held += (lockDepth[i] > 0);
+    }
+    return held;
+}
+
+xSemaphoreHandle xSemaphoreCreateRecursiveMutex(void)
+{
+    if (numLocks == MAX_LOCKS) {
+        abort();
+    }
+    return (xSemaphoreHandle)(uintptr_t)++numLocks;
+}
+
+int xSemaphoreTakeRecursive(xSemaphoreHandle sem, portTickType ticks)
+{
+    if (ticks == 0 && lockContended) {
+        return pdFALSE;
+    }
+    lockTakes++;
+    if (lockDepth[(uintptr_t)sem]++ == 0 && locksHeld() > maxLocksHeld) {
+        maxLocksHeld = locksHeld();
+    }
+    return pdTRUE;
+}
+
+int xSemaphoreGiveRecursive(xSemaphoreHandle sem)
+{
+    lockDepth[(uintptr_t)sem]--;
+    return pdTRUE;
+}
+
+/* Event queue of depth EVENT_QUEUE_LEN, only one queue is in use at a time */
+#define EVENT_QUEUE_LEN 4
+static UAVObjEvent eventQueue[EVENT_QUEUE_LEN];
+static uint32_t eventQueueHead, eventQueueTail;
+
+int xQueueSend(__attribute__((unused)) xQueueHandle queue, const void *item, __attribute__((unused)) portTickType ticks)
+{
+    if (eventQueueHead - eventQueueTail >= EVENT_QUEUE_LEN) {
+        return pdFALSE;
+    }
+    memcpy(&eventQueue[eventQueueHead++ % EVENT_QUEUE_LEN], item, sizeof(UAVObjEvent));
+    return pdTRUE;
+}
+
+int xQueueReceive(__attribute__((unused)) xQueueHandle queue, void *item, __attribute__((unused)) portTickType ticks)
+{
+    if (eventQueueHead == eventQueueTail) {
+        return pdFALSE;
+    }
+    memcpy(item, &eventQueue[eventQueueTail++ % EVENT_QUEUE_LEN], sizeof(UAVObjEvent));
+    return pdTRUE;
+}
+
+int32_t EventCallbackDispatch(__attribute__((unused)) UAVObjEvent *ev, __attribute__((unused)) UAVObjEventCallback cb)
+{
+    return pdTRUE;
+}
+
+uint8_t PIOS_CRC_updateCRC(uint8_t crc, __attribute__((unused)) const uint8_t *data, __attribute__((unused)) int32_t length)
+{
+    return crc;
+}
+}
+
+/* Object IDs of shared/uavobjectdefinition, see uavobjectids.py */
+#include "uavobjectids.h"
+
+#define OBJ_SIZE           32
+#define BENCH_LOOKUPS      2000000
+
+#define MULTI_OBJ_ID       0x1A2B3C40
+#define MULTI_OBJ_SIZE     22
+#define MULTI_INSTANCES    500
+#define BENCH_INST_PASSES  2000
+
+/* Handle table, filled the same way the generated $(NAME)Initialize() does it */
+static UAVObjHandle handles[NUM_OBJECTS] __attribute__((used, section("_uavo_handles")));
+static UAVObjHandle multiHandle __attribute__((used, section("_uavo_handles")));
+
+typedef struct {
+    uint32_t instance;
+    uint8_t  pattern[MULTI_OBJ_SIZE - 4];
+} __attribute__((packed)) MultiData;
+
+static void MultiSetDefaults(UAVObjHandle obj, uint16_t instId)
+{
+    MultiData data;
+
+    memset(&data, 0, sizeof(data));
+    data.instance = instId;
+    UAVObjSetInstanceData(obj, instId, &data);
+}
+
+class UAVObjectManagerTest : public testing::Test {
+protected:
+    static void SetUpTestCase()
+    {
+        ASSERT_EQ(0, UAVObjInitialize());
+
+        for (uint32_t i = 0; i < NUM_OBJECTS; i++) {
+            handles[i] = UAVObjRegister(objIds[i], true, false, false, OBJ_SIZE, NULL);
+            ASSERT_TRUE(handles[i] != NULL);
+        }
+
+        multiHandle = UAVObjRegister(MULTI_OBJ_ID, false, false, false, MULTI_OBJ_SIZE, &MultiSetDefaults);
+        ASSERT_TRUE(multiHandle != NULL);
+    }
+};
+
+TEST_F(UAVObjectManagerTest, GetByIDFindsDataObjects) {
+    for (uint32_t i = 0; i < NUM_OBJECTS; i++) {
+        EXPECT_EQ(handles[i], UAVObjGetByID(objIds[i]));
+        EXPECT_EQ(objIds[i], UAVObjGetID(UAVObjGetByID(objIds[i])));
+    }
+}
+
+TEST_F(UAVObjectManagerTest, GetByIDFindsMetaObjects) {
+    for (uint32_t i = 0; i < NUM_OBJECTS; i++) {
+        UAVObjHandle meta = UAVObjGetByID(MetaObjectId(objIds[i]));
+        ASSERT_TRUE(meta != NULL);
+        EXPECT_TRUE(UAVObjIsMetaobject(meta));
+        EXPECT_EQ(UAVObjGetLinkedObj(handles[i]), meta);
+    }
+}
+
+TEST_F(UAVObjectManagerTest, GetByIDUnknown) {
+    EXPECT_TRUE(UAVObjGetByID(0x0) == NULL);
+    EXPECT_TRUE(UAVObjGetByID(0xFFFFFFF0) == NULL);
+    EXPECT_TRUE(UAVObjGetByID(objIds[0] + 2) == NULL);
+}
+
+TEST_F(UAVObjectManagerTest, RegisterDuplicate) {
+    EXPECT_TRUE(UAVObjRegister(objIds[3], true, false, false, OBJ_SIZE, NULL) == NULL);
+    EXPECT_EQ(handles[3], UAVObjGetByID(objIds[3]));
+}
+
+TEST_F(UAVObjectManagerTest, GetByIDBenchmark) {
+    uint32_t found = 0;
+    clock_t start  = clock();
+
+    for (uint32_t i = 0; i < BENCH_LOOKUPS; i++) {
+        /* Mix data and metaobject lookups as seen by UAVTalk */
+        uint32_t id = objIds[i % NUM_OBJECTS] + (i & 1);
+        if (UAVObjGetByID(id)) {
+            found++;
+        }
+    }
+
+    double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+    EXPECT_EQ((uint32_t)BENCH_LOOKUPS, found);
+    printf("UAVObjGetByID: %u objects, %.0f lookups/sec\n", NUM_OBJECTS, BENCH_LOOKUPS / (elapsed > 0 ? elapsed : 1e-9));
+}
+
+TEST_F(UAVObjectManagerTest, MultiInstance500) {
+    MultiData data;
+
+    /* Grow one instance at a time, as e.g. WaypointCreateInstance() does */
+    for (uint16_t i = 1; i < MULTI_INSTANCES / 2; i++) {
+        EXPECT_EQ(i, UAVObjCreateInstance(multiHandle, &MultiSetDefaults));
+    }
+    EXPECT_EQ(MULTI_INSTANCES / 2, UAVObjGetNumInstances(multiHandle));
+
+    /* Unpacking the last instance creates all missing ones at once */
+    memset(&data, 0xA5, sizeof(data));
+    data.instance = MULTI_INSTANCES - 1;
+    EXPECT_EQ(0, UAVObjUnpack(multiHandle, MULTI_INSTANCES - 1, (const uint8_t *)&data));
+    EXPECT_EQ(MULTI_INSTANCES, UAVObjGetNumInstances(multiHandle));
+
+    /* Only instances up to the limit can be created */
+    EXPECT_EQ(-1, UAVObjSetInstanceData(multiHandle, MULTI_INSTANCES, &data));
+    EXPECT_EQ(-1, UAVObjUnpack(multiHandle, UAVOBJ_MAX_INSTANCES, (const uint8_t *)&data));
+
+    /* Every instance is independently addressable */
+    for (uint16_t i = 0; i < MULTI_INSTANCES; i++) {
+        memset(&data, i & 0xFF, sizeof(data));
+        data.instance = i;
+        ASSERT_EQ(0, UAVObjSetInstanceData(multiHandle, i, &data));
+    }
+
+    uint32_t checked = 0;
+    clock_t start    = clock();
+    for (uint32_t pass = 0; pass < BENCH_INST_PASSES; pass++) {
+        for (uint16_t i = 0; i < MULTI_INSTANCES; i++) {
+            ASSERT_EQ(0, UAVObjGetInstanceData(multiHandle, i, &data));
+            if (data.instance == i && data.pattern[MULTI_OBJ_SIZE - 5] == (i & 0xFF)) {
+                checked++;
+            }
+        }
+    }
+    double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    EXPECT_EQ((uint32_t)MULTI_INSTANCES * BENCH_INST_PASSES, checked);
+    printf("UAVObjGetInstanceData: %u instances, %.0f reads/sec\n", MULTI_INSTANCES,
+           MULTI_INSTANCES * BENCH_INST_PASSES / (elapsed > 0 ? elapsed : 1e-9));
+}
+
+TEST_F(UAVObjectManagerTest, SeqlockRead) {
+    uint8_t in[OBJ_SIZE], out[OBJ_SIZE];
+    UAVObjStats objStats;
+
+    UAVObjClearStats();
+    memset(in, 0x5A, sizeof(in));
+    ASSERT_EQ(0, UAVObjSetData(handles[7], in));
+    ASSERT_EQ(0, UAVObjGetData(handles[7], out));
+    EXPECT_EQ(0, memcmp(in, out, sizeof(in)));
+    ASSERT_EQ(0, UAVObjGetDataField(handles[7], out, 4, 8));
+    EXPECT_EQ(0, memcmp(in + 4, out, 8));
+
+    /* A write in progress makes readers retry, then fall back to the lock */
+    struct UAVOSingle *uavo_single = (struct UAVOSingle *)handles[7];
+    uint32_t seq = uavo_single->seq;
+    EXPECT_EQ(0u, seq & 1);
+    uavo_single->seq = seq + 1;
+    memset(out, 0, sizeof(out));
+    ASSERT_EQ(0, UAVObjGetData(handles[7], out));
+    EXPECT_EQ(0, memcmp(in, out, sizeof(in)));
+    uavo_single->seq = seq;
+
+    UAVObjGetStats(&objStats);
+    EXPECT_LT(0u, objStats.seqlockRetries);
+    EXPECT_EQ(0u, objStats.lockContentions);
+}
+
+TEST_F(UAVObjectManagerTest, LockContentionStats) {
+    uint8_t data[OBJ_SIZE];
+    UAVObjStats objStats;
+
+    memset(data, 0, sizeof(data));
+    UAVObjClearStats();
+    lockContended = true;
+    EXPECT_EQ(0, UAVObjSetData(handles[9], data));
+    EXPECT_EQ(0, UAVObjGetInstanceData(multiHandle, 0, data));
+    lockContended = false;
+
+    UAVObjGetStats(&objStats);
+    EXPECT_EQ(2u, objStats.lockContentions);
+}
+
+TEST_F(UAVObjectManagerTest, CoalescedEvents) {
+    uint8_t data[OBJ_SIZE];
+    UAVObjStats objStats;
+    UAVObjEvent ev;
+    xQueueHandle queue = (xQueueHandle)&eventQueue;
+
+    memset(data, 0, sizeof(data));
+    UAVObjClearStats();
+
+    /* A plain queue overflows when the producer is faster than the consumer */
+    ASSERT_EQ(0, UAVObjConnectQueue(handles[11], queue, EV_UPDATED));
+    for (uint32_t i = 0; i < 10; i++) {
+        UAVObjSetData(handles[11], data);
+    }
+    UAVObjGetStats(&objStats);
+    EXPECT_EQ((uint32_t)EVENT_QUEUE_LEN, objStats.eventsDelivered);
+    EXPECT_EQ(10u - EVENT_QUEUE_LEN, objStats.eventQueueErrors);
+
+    /* Receiving from a plain queue does not touch the object */
+    uint32_t takes = lockTakes;
+    ASSERT_EQ(pdTRUE, UAVObjQueueReceive(queue, &ev, 0));
+    EXPECT_FALSE(ev.coalesced);
+    EXPECT_EQ(takes, lockTakes);
+    while (UAVObjQueueReceive(queue, &ev, 0) == pdTRUE) {}
+
+    /* A coalesced queue holds one pending event per object, instance and event type */
+    UAVObjClearStats();
+    ASSERT_EQ(0, UAVObjConnectQueueCoalesced(handles[11], queue, EV_UPDATED | EV_UPDATE_REQ));
+    for (uint32_t i = 0; i < 10; i++) {
+        UAVObjSetData(handles[11], data);
+    }
+    UAVObjRequestUpdate(handles[11]);
+    UAVObjGetStats(&objStats);
+    EXPECT_EQ(2u, objStats.eventsDelivered);
+    EXPECT_EQ(9u, objStats.eventsCoalesced);
+    EXPECT_EQ(0u, objStats.eventQueueErrors);
+
+    ASSERT_EQ(pdTRUE, UAVObjQueueReceive(queue, &ev, 0));
+    EXPECT_EQ(handles[11], ev.obj);
+    EXPECT_EQ(EV_UPDATED, ev.event);
+    EXPECT_TRUE(ev.coalesced);
+
+    /* Once received, the next update is queued again */
+    UAVObjSetData(handles[11], data);
+    UAVObjGetStats(&objStats);
+    EXPECT_EQ(3u, objStats.eventsDelivered);
+
+    while (UAVObjQueueReceive(queue, &ev, 0) == pdTRUE) {}
+    EXPECT_EQ(0, UAVObjDisconnectQueue(handles[11], queue));
+}
+
+TEST_F(UAVObjectManagerTest, CoalescedEventsPerInstance) {
+    UAVObjStats objStats;
+    UAVObjEvent ev;
+    xQueueHandle queue = (xQueueHandle)&eventQueue;
+
+    while (UAVObjGetNumInstances(multiHandle) < 2) {
+        UAVObjCreateInstance(multiHandle, &MultiSetDefaults);
+    }
+    uint16_t last = UAVObjGetNumInstances(multiHandle) - 1;
+
+    UAVObjClearStats();
+    ASSERT_EQ(0, UAVObjConnectQueueCoalesced(multiHandle, queue, EV_UPDATED_MANUAL));
+
+    /* Each instance has its own pending event, the whole object counts as one more */
+    for (uint32_t i = 0; i < 5; i++) {
+        UAVObjInstanceUpdated(multiHandle, 0);
+        UAVObjInstanceUpdated(multiHandle, last);
+        UAVObjUpdated(multiHandle);
+    }
+    UAVObjGetStats(&objStats);
+    EXPECT_EQ(3u, objStats.eventsDelivered);
+    EXPECT_EQ(12u, objStats.eventsCoalesced);
+    EXPECT_EQ(0u, objStats.eventQueueErrors);
+
+    /* Receiving the event of one instance leaves the others pending */
+    ASSERT_EQ(pdTRUE, UAVObjQueueReceive(queue, &ev, 0));
+    EXPECT_EQ(0, ev.instId);
+    EXPECT_TRUE(ev.coalesced);
+    UAVObjInstanceUpdated(multiHandle, last);
+    UAVObjUpdated(multiHandle);
+    UAVObjInstanceUpdated(multiHandle, 0);
+    UAVObjGetStats(&objStats);
+    EXPECT_EQ(4u, objStats.eventsDelivered);
+    EXPECT_EQ(14u, objStats.eventsCoalesced);
+
+    ASSERT_EQ(pdTRUE, UAVObjQueueReceive(queue, &ev, 0));
+    EXPECT_EQ(last, ev.instId);
+    ASSERT_EQ(pdTRUE, UAVObjQueueReceive(queue, &ev, 0));
+    EXPECT_EQ(UAVOBJ_ALL_INSTANCES, ev.instId);
+    ASSERT_EQ(pdTRUE, UAVObjQueueReceive(queue, &ev, 0));
+    EXPECT_EQ(0, ev.instId);
+    EXPECT_EQ(pdFALSE, UAVObjQueueReceive(queue, &ev, 0));
+
+    /* Instances without a pending entry are queued as on a plain queue */
+    UAVObjClearStats();
+    UAVObjInstanceUpdated(multiHandle, UAVOBJ_ALL_INSTANCES - 1);
+    UAVObjInstanceUpdated(multiHandle, UAVOBJ_ALL_INSTANCES - 1);
+    UAVObjGetStats(&objStats);
+    EXPECT_EQ(2u, objStats.eventsDelivered);
+    EXPECT_EQ(0u, objStats.eventsCoalesced);
+    ASSERT_EQ(pdTRUE, UAVObjQueueReceive(queue, &ev, 0));
+    EXPECT_FALSE(ev.coalesced);
+    while (UAVObjQueueReceive(queue, &ev, 0) == pdTRUE) {}
+
+    /* Creating instances past the pending entries adds a block for them */
+    struct ObjectEventEntry *entry = ((struct UAVOBase *)multiHandle)->next_event;
+    ASSERT_TRUE(entry != NULL);
+    uint16_t slots = entry->pendingSlots;
+    uint16_t added;
+    do {
+        added = UAVObjCreateInstance(multiHandle, &MultiSetDefaults);
+    } while (added + 1 < slots && added < UAVOBJ_MAX_INSTANCES);
+    ASSERT_LT(added, UAVOBJ_MAX_INSTANCES);
+    EXPECT_LT(slots, entry->pendingSlots);
+    UAVObjClearStats();
+    UAVObjInstanceUpdated(multiHandle, added);
+    UAVObjInstanceUpdated(multiHandle, added);
+    UAVObjGetStats(&objStats);
+    EXPECT_EQ(1u, objStats.eventsDelivered);
+    EXPECT_EQ(1u, objStats.eventsCoalesced);
+    ASSERT_EQ(pdTRUE, UAVObjQueueReceive(queue, &ev, 0));
+    EXPECT_TRUE(ev.coalesced);
+
+    /* A plain connection stops coalescing, switching back starts with nothing pending */
+    ASSERT_EQ(0, UAVObjConnectQueue(multiHandle, queue, EV_UPDATED_MANUAL));
+    UAVObjInstanceUpdated(multiHandle, 0);
+    ASSERT_EQ(0, UAVObjConnectQueueCoalesced(multiHandle, queue, EV_UPDATED_MANUAL));
+    UAVObjInstanceUpdated(multiHandle, 0);
+    UAVObjGetStats(&objStats);
+    EXPECT_EQ(3u, objStats.eventsDelivered);
+
+    while (UAVObjQueueReceive(queue, &ev, 0) == pdTRUE) {}
+    EXPECT_EQ(0, UAVObjDisconnectQueue(multiHandle, queue));
+}
+
+/* Fast callbacks of objects on different lock stripes, the first one writes the second object */
+static UAVObjHandle callbackTarget;
+static uint32_t locksHeldInCallbacks;
+static uint32_t callbacksInvoked;
+
+static void writeOtherObject(__attribute__((unused)) UAVObjEvent *ev)
+{
+    uint8_t data[OBJ_SIZE];
+
+    locksHeldInCallbacks += locksHeld();
+    callbacksInvoked++;
+    memset(data, 0, sizeof(data));
+    UAVObjSetData(callbackTarget, data);
+}
+
+static void readObject(UAVObjEvent *ev)
+{
+    uint8_t data[OBJ_SIZE];
+
+    locksHeldInCallbacks += locksHeld();
+    callbacksInvoked++;
+    UAVObjGetData(ev->obj, data);
+}
+
+TEST_F(UAVObjectManagerTest, FastCallbacksRunUnlocked) {
+    uint32_t first = 0, second = 1;
+    uint8_t data[OBJ_SIZE];
+
+    while (second < NUM_OBJECTS &&
+           (objIds[first] >> 1) % PIOS_UAVOBJECT_LOCK_STRIPES == (objIds[second] >> 1) % PIOS_UAVOBJECT_LOCK_STRIPES) {
+        second++;
+    }
+    ASSERT_LT(second, (uint32_t)NUM_OBJECTS);
+
+    callbackTarget = handles[second];
+    ASSERT_EQ(0, UAVObjConnectCallback(handles[first], &writeOtherObject, EV_UPDATED, true));
+    ASSERT_EQ(0, UAVObjConnectCallback(handles[second], &readObject, EV_UPDATED, true));
+
+    /* A task never holds two object locks, so tasks writing the objects in opposite orders cannot deadlock */
+    memset(data, 0, sizeof(data));
+    maxLocksHeld = 0;
+    locksHeldInCallbacks = 0;
+    callbacksInvoked     = 0;
+    ASSERT_EQ(0, UAVObjSetData(handles[first], data));
+    ASSERT_EQ(0, UAVObjSetData(handles[second], data));
+    EXPECT_EQ(3u, callbacksInvoked);
+    EXPECT_EQ(0u, locksHeldInCallbacks);
+    EXPECT_EQ(1u, maxLocksHeld);
+    EXPECT_EQ(0u, locksHeld());
+
+    EXPECT_EQ(0, UAVObjDisconnectCallback(handles[first], &writeOtherObject));
+    EXPECT_EQ(0, UAVObjDisconnectCallback(handles[second], &readObject));
+}
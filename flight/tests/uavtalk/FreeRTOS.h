@@ -0,0 +1,33 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+/* Single threaded stand-ins for the few FreeRTOS primitives used by UAVTalk and the object manager */
+typedef void *xSemaphoreHandle;
+typedef void *xQueueHandle;
+typedef uint32_t portTickType;
+
+#define portMAX_DELAY     0xffffffff
+#define portTICK_RATE_MS  1
+#define pdTRUE            1
+#define pdFALSE           0
+
+#define vPortFree(pv) (free(pv))
+
+/* Implemented by the test, waiting on a binary semaphore delivers the replies of the peer */
+xSemaphoreHandle xSemaphoreCreateRecursiveMutex(void);
+int xSemaphoreTakeRecursive(xSemaphoreHandle sem, portTickType ticks);
+int xSemaphoreGiveRecursive(xSemaphoreHandle sem);
+xSemaphoreHandle xSemaphoreCreateBinary(void);
+int xSemaphoreTake(xSemaphoreHandle sem, portTickType ticks);
+int xSemaphoreGive(xSemaphoreHandle sem);
+portTickType xTaskGetTickCount(void);
+
+#define vSemaphoreCreateBinary(sem) ((sem) = xSemaphoreCreateBinary())
+
+int xQueueSend(xQueueHandle queue, const void *item, portTickType ticks);
+int xQueueReceive(xQueueHandle queue, void *item, portTickType ticks);
+
+#endif /* FREERTOS_H */
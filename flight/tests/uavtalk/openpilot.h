@@ -0,0 +1,11 @@
+#ifndef OPENPILOT_H
+#define OPENPILOT_H
+
+#include <pios.h>
+
+#include <utlist.h>
+#include <uavobjectmanager.h>
+#include <eventdispatcher.h>
+#include <uavtalk.h>
+
+#endif /* OPENPILOT_H */
@@ -0,0 +1,26 @@
+#ifndef PIOS_H
+#define PIOS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/* PIOS Feature Selection */
+#include "pios_config.h"
+
+#ifdef PIOS_INCLUDE_FREERTOS
+/* FreeRTOS Includes */
+#include "FreeRTOS.h"
+#endif
+#include "pios_mem.h"
+#include <pios_helpers.h>
+#include <pios_crc.h>
+
+#define PIOS_Assert(x) \
+    if (!(x)) { while (1) {; } \
+    }
+#define PIOS_DEBUG_Assert(x) PIOS_Assert(x)
+#define PIOS_STATIC_ASSERT(test) ((void)sizeof(int[1 - 2 * !(test)]))
+
+#endif /* PIOS_H */
@@ -0,0 +1,9 @@
+#ifndef PIOS_CONFIG_H
+#define PIOS_CONFIG_H
+
+#define PIOS_INCLUDE_FREERTOS
+
+/* UAVTalk options */
+#define UAVTALK_DELTA_SLOTS 2
+
+#endif /* PIOS_CONFIG_H */
@@ -0,0 +1,7 @@
+#ifndef UAVOBJECTSINIT_H
+#define UAVOBJECTSINIT_H
+
+/* Largest object registered by the test */
+#define UAVOBJECTS_LARGEST 64
+
+#endif /* UAVOBJECTSINIT_H */
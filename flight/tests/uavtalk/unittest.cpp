@@ -0,0 +1,576 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* abort */
+#include <string.h> /* memset */
+#include <time.h> /* clock_gettime */
+#include <vector>
+
+extern "C" {
+#include "openpilot.h"
+#include "uavtalk_priv.h"
+
+/* Semaphores are numbered from 1 in creation order, with the count of the binary ones */
+#define MAX_SEMAPHORES 64
+static uint32_t numSemaphores;
+static int semCount[MAX_SEMAPHORES + 1];
+
+static void deliverReplies();
+
+static xSemaphoreHandle newSemaphore(int count)
+{
+    if (numSemaphores == MAX_SEMAPHORES) {
+        abort();
+    }
+    semCount[++numSemaphores] = count;
+    return (xSemaphoreHandle)(uintptr_t)numSemaphores;
+}
+
+xSemaphoreHandle xSemaphoreCreateRecursiveMutex(void)
+{
+    return newSemaphore(0);
+}
+
+int xSemaphoreTakeRecursive(__attribute__((unused)) xSemaphoreHandle sem, __attribute__((unused)) portTickType ticks)
+{
+    return pdTRUE;
+}
+
+int xSemaphoreGiveRecursive(__attribute__((unused)) xSemaphoreHandle sem)
+{
+    return pdTRUE;
+}
+
+xSemaphoreHandle xSemaphoreCreateBinary(void)
+{
+    return newSemaphore(1);
+}
+
+int xSemaphoreTake(xSemaphoreHandle sem, portTickType ticks)
+{
+    /* Waiting for an answer, let the peer reply */
+    if (semCount[(uintptr_t)sem] == 0 && ticks > 0) {
+        deliverReplies();
+    }
+    if (semCount[(uintptr_t)sem] == 0) {
+        return pdFALSE;
+    }
+    semCount[(uintptr_t)sem]--;
+    return pdTRUE;
+}
+
+int xSemaphoreGive(xSemaphoreHandle sem)
+{
+    semCount[(uintptr_t)sem] = 1;
+    return pdTRUE;
+}
+
+portTickType xTaskGetTickCount(void)
+{
+    return 0;
+}
+
+int xQueueSend(__attribute__((unused)) xQueueHandle queue, __attribute__((unused)) const void *item, __attribute__((unused)) portTickType ticks)
+{
+    return pdFALSE;
+}
+
+int xQueueReceive(__attribute__((unused)) xQueueHandle queue, __attribute__((unused)) void *item, __attribute__((unused)) portTickType ticks)
+{
+    return pdFALSE;
+}
+
+int32_t EventCallbackDispatch(__attribute__((unused)) UAVObjEvent *ev, __attribute__((unused)) UAVObjEventCallback cb)
+{
+    return pdTRUE;
+}
+}
+
+#define OBJ_ID          0x2A4B6C80
+#define OBJ_SIZE        48
+#define HEADER_LENGTH   10
+#define BITMAP_LENGTH   UAVTALK_DELTA_BITMAP_LENGTH(OBJ_SIZE)
+
+typedef std::vector<uint8_t> Bytes;
+
+/* Packet as seen on the link */
+typedef struct {
+    uint8_t  type;
+    uint32_t objId;
+    uint16_t instId;
+    Bytes    payload;
+} Packet;
+
+/* In the handle section, as the generated objects register theirs */
+static UAVObjHandle obj __attribute__((used, section("_uavo_handles")));
+static UAVTalkConnection connection;
+
+/* The peer keeps its own copy of the object, applies what it receives and answers */
+static Bytes peerCopy;
+static bool peerNackNext;
+static Bytes peerReplies;
+static std::vector<Packet> sent;
+
+static Bytes buildFrame(uint8_t type, uint32_t objId, uint16_t instId, const Bytes & payload)
+{
+    Bytes frame;
+    uint16_t size = HEADER_LENGTH + payload.size();
+
+    frame.push_back(UAVTALK_SYNC_VAL);
+    frame.push_back(type);
+    frame.push_back(size & 0xFF);
+    frame.push_back(size >> 8);
+    for (int i = 0; i < 4; i++) {
+        frame.push_back((objId >> (8 * i)) & 0xFF);
+    }
+    frame.push_back(instId & 0xFF);
+    frame.push_back(instId >> 8);
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    frame.push_back(PIOS_CRC_updateCRC(0, &frame[0], frame.size()));
+    return frame;
+}
+
+static void feed(const Bytes & frame)
+{
+    /* UAVTalkProcessInputStream() takes at most 255 bytes at a time */
+    for (size_t offset = 0; offset < frame.size(); offset += 255) {
+        size_t length = frame.size() - offset < 255 ? frame.size() - offset : 255;
+        UAVTalkProcessInputStream(connection, (uint8_t *)&frame[offset], length);
+    }
+}
+
+static void deliverReplies()
+{
+    Bytes replies;
+
+    replies.swap(peerReplies);
+    feed(replies);
+}
+
+/* Rebuild the object from a delta payload against the peer copy, false if it does not apply */
+static bool applyDelta(const Bytes & delta, Bytes *result)
+{
+    Bytes data = peerCopy;
+    size_t in  = 2 + BITMAP_LENGTH;
+
+    if (delta.size() < in) {
+        return false;
+    }
+    for (int chunk = 0, offset = 0; offset < OBJ_SIZE; ++chunk, offset += UAVTALK_DELTA_CHUNK_SIZE) {
+        if (delta[2 + chunk / 8] & (1 << (chunk % 8))) {
+            int size = UAVTALK_DELTA_CHUNK_LENGTH(OBJ_SIZE, offset);
+            if (in + size > delta.size()) {
+                return false;
+            }
+            memcpy(&data[offset], &delta[in], size);
+            in += size;
+        }
+    }
+    if (in != delta.size() || PIOS_CRC16_updateCRC(0, &data[0], OBJ_SIZE) != (delta[0] | (delta[1] << 8))) {
+        return false;
+    }
+    *result = data;
+    return true;
+}
+
+static int32_t outputStream(uint8_t *data, int32_t length)
+{
+    Packet packet;
+    uint16_t size = data[2] | (data[3] << 8);
+
+    EXPECT_EQ(length, size + UAVTALK_CHECKSUM_LENGTH);
+    EXPECT_EQ(data[size], PIOS_CRC_updateCRC(0, data, size));
+    packet.type   = data[1];
+    packet.objId  = data[4] | (data[5] << 8) | (data[6] << 16) | ((uint32_t)data[7] << 24);
+    packet.instId = data[8] | (data[9] << 8);
+    packet.payload.assign(data + HEADER_LENGTH, data + size);
+    sent.push_back(packet);
+
+    if (packet.type == UAVTALK_TYPE_OBJ_ACK || packet.type == UAVTALK_TYPE_OBJ_ACK_DELTA) {
+        Bytes result = packet.payload;
+        bool applied = !peerNackNext &&
+                       (packet.type == UAVTALK_TYPE_OBJ_ACK || applyDelta(packet.payload, &result));
+        if (applied) {
+            peerCopy = result;
+        }
+        Bytes reply = buildFrame(applied ? UAVTALK_TYPE_ACK : UAVTALK_TYPE_NACK, packet.objId, packet.instId, Bytes());
+        peerReplies.insert(peerReplies.end(), reply.begin(), reply.end());
+        peerNackNext = false;
+    }
+    return length;
+}
+
+static Bytes objectData()
+{
+    Bytes data(OBJ_SIZE);
+
+    UAVObjGetData(obj, &data[0]);
+    return data;
+}
+
+static void changeObject(int offset)
+{
+    Bytes data = objectData();
+
+    data[offset] ^= 0x5A;
+    UAVObjSetData(obj, &data[0]);
+}
+
+static uint32_t txDeltaBytesSaved()
+{
+    UAVTalkStats stats;
+
+    UAVTalkGetStats(connection, &stats, false);
+    return stats.txDeltaBytesSaved;
+}
+
+class UAVTalkDeltaTest : public testing::Test {
+protected:
+    static void SetUpTestCase()
+    {
+        /* Shared with the tests below */
+        if (obj) {
+            return;
+        }
+        ASSERT_EQ(0, UAVObjInitialize());
+        obj = UAVObjRegister(OBJ_ID, true, true, false, OBJ_SIZE, NULL);
+        ASSERT_TRUE(obj != NULL);
+    }
+
+    virtual void SetUp()
+    {
+        Bytes data(OBJ_SIZE);
+
+        for (int i = 0; i < OBJ_SIZE; i++) {
+            data[i] = i * 7 + 1;
+        }
+        UAVObjSetData(obj, &data[0]);
+        connection   = UAVTalkInitialize(&outputStream);
+        ASSERT_TRUE(connection != NULL);
+        peerCopy.assign(OBJ_SIZE, 0);
+        peerNackNext = false;
+        peerReplies.clear();
+        sent.clear();
+    }
+
+    /* The peer announces delta support, as the GCS does on connection */
+    void negotiate()
+    {
+        sent.clear();
+        feed(buildFrame(UAVTALK_TYPE_OBJ_REQ, UAVTALK_CAPS_OBJID, UAVTALK_CAPS_DELTA, Bytes()));
+        ASSERT_EQ(1u, sent.size());
+        EXPECT_EQ(UAVTALK_TYPE_ACK, sent.back().type);
+        EXPECT_EQ((uint32_t)UAVTALK_CAPS_OBJID, sent.back().objId);
+        EXPECT_EQ(UAVTALK_CAPS, sent.back().instId);
+        sent.clear();
+    }
+
+    int32_t sendAcked()
+    {
+        return UAVTalkSendObject(connection, obj, 0, 1, 100);
+    }
+};
+
+TEST_F(UAVTalkDeltaTest, WholeWithoutCapabilities) {
+    EXPECT_EQ(0, sendAcked());
+    changeObject(5);
+    EXPECT_EQ(0, sendAcked());
+
+    ASSERT_EQ(2u, sent.size());
+    for (size_t i = 0; i < sent.size(); i++) {
+        EXPECT_EQ(UAVTALK_TYPE_OBJ_ACK, sent[i].type);
+        EXPECT_EQ((size_t)OBJ_SIZE, sent[i].payload.size());
+    }
+    EXPECT_EQ(objectData(), peerCopy);
+    EXPECT_EQ(0u, txDeltaBytesSaved());
+}
+
+TEST_F(UAVTalkDeltaTest, WholeThenDelta) {
+    negotiate();
+
+    /* Nothing acked yet to encode against */
+    EXPECT_EQ(0, sendAcked());
+    ASSERT_EQ(1u, sent.size());
+    EXPECT_EQ(UAVTALK_TYPE_OBJ_ACK, sent.back().type);
+    EXPECT_EQ(objectData(), peerCopy);
+
+    /* Only the changed chunk goes over the link */
+    changeObject(5);
+    EXPECT_EQ(0, sendAcked());
+    ASSERT_EQ(2u, sent.size());
+    EXPECT_EQ(UAVTALK_TYPE_OBJ_ACK_DELTA, sent.back().type);
+    EXPECT_EQ((size_t)(2 + BITMAP_LENGTH + UAVTALK_DELTA_CHUNK_SIZE), sent.back().payload.size());
+    EXPECT_EQ(objectData(), peerCopy);
+    EXPECT_EQ((uint32_t)(OBJ_SIZE - sent.back().payload.size()), txDeltaBytesSaved());
+
+    /* The last, partial, chunk too */
+    changeObject(OBJ_SIZE - 1);
+    changeObject(0);
+    EXPECT_EQ(0, sendAcked());
+    EXPECT_EQ(UAVTALK_TYPE_OBJ_ACK_DELTA, sent.back().type);
+    EXPECT_EQ((size_t)(2 + BITMAP_LENGTH + 2 * UAVTALK_DELTA_CHUNK_SIZE), sent.back().payload.size());
+    EXPECT_EQ(objectData(), peerCopy);
+}
+
+TEST_F(UAVTalkDeltaTest, NackResendsWhole) {
+    negotiate();
+    EXPECT_EQ(0, sendAcked());
+
+    /* The peer copy changed meanwhile, the delta does not apply */
+    peerCopy[20] ^= 0x01;
+    changeObject(5);
+    EXPECT_EQ(-1, sendAcked());
+    EXPECT_EQ(UAVTALK_TYPE_OBJ_ACK_DELTA, sent.back().type);
+    EXPECT_NE(objectData(), peerCopy);
+
+    /* The retry is sent whole and becomes the new reference */
+    EXPECT_EQ(0, sendAcked());
+    EXPECT_EQ(UAVTALK_TYPE_OBJ_ACK, sent.back().type);
+    EXPECT_EQ(objectData(), peerCopy);
+
+    changeObject(9);
+    EXPECT_EQ(0, sendAcked());
+    EXPECT_EQ(UAVTALK_TYPE_OBJ_ACK_DELTA, sent.back().type);
+    EXPECT_EQ(objectData(), peerCopy);
+
+    /* A plain NACK has the same effect */
+    peerNackNext = true;
+    changeObject(13);
+    EXPECT_EQ(-1, sendAcked());
+    EXPECT_EQ(0, sendAcked());
+    EXPECT_EQ(UAVTALK_TYPE_OBJ_ACK, sent.back().type);
+    EXPECT_EQ(objectData(), peerCopy);
+}
+
+TEST_F(UAVTalkDeltaTest, ResetCapabilities) {
+    negotiate();
+    EXPECT_EQ(0, sendAcked());
+    changeObject(5);
+    EXPECT_EQ(0, sendAcked());
+    EXPECT_EQ(UAVTALK_TYPE_OBJ_ACK_DELTA, sent.back().type);
+
+    /* Link lost, the next peer may not know deltas */
+    UAVTalkResetCapabilities(connection);
+    changeObject(6);
+    EXPECT_EQ(0, sendAcked());
+    EXPECT_EQ(UAVTALK_TYPE_OBJ_ACK, sent.back().type);
+
+    /* A peer that negotiates again starts from a whole object */
+    negotiate();
+    changeObject(7);
+    EXPECT_EQ(0, sendAcked());
+    EXPECT_EQ(UAVTALK_TYPE_OBJ_ACK, sent.back().type);
+    changeObject(8);
+    EXPECT_EQ(0, sendAcked());
+    EXPECT_EQ(UAVTALK_TYPE_OBJ_ACK_DELTA, sent.back().type);
+    EXPECT_EQ(objectData(), peerCopy);
+}
+
+TEST_F(UAVTalkDeltaTest, ReceiveDelta) {
+    Bytes current  = objectData();
+    Bytes expected = current;
+
+    expected[13] ^= 0xFF;
+    expected[14] ^= 0x0F;
+    uint16_t crc = PIOS_CRC16_updateCRC(0, &expected[0], OBJ_SIZE);
+
+    Bytes delta;
+    delta.push_back(crc & 0xFF);
+    delta.push_back(crc >> 8);
+    delta.resize(2 + BITMAP_LENGTH, 0);
+    delta[2] = 1 << 3;
+    delta.insert(delta.end(), expected.begin() + 12, expected.begin() + 16);
+
+    /* Applied and acked */
+    feed(buildFrame(UAVTALK_TYPE_OBJ_ACK_DELTA, OBJ_ID, 0, delta));
+    ASSERT_EQ(1u, sent.size());
+    EXPECT_EQ(UAVTALK_TYPE_ACK, sent.back().type);
+    EXPECT_EQ(expected, objectData());
+
+    /* Encoded against another copy, the CRC does not match */
+    Bytes mismatch = delta;
+    mismatch[0] ^= 0x01;
+    feed(buildFrame(UAVTALK_TYPE_OBJ_ACK_DELTA, OBJ_ID, 0, mismatch));
+    EXPECT_EQ(UAVTALK_TYPE_NACK, sent.back().type);
+    EXPECT_EQ(expected, objectData());
+
+    /* Truncated */
+    UAVObjSetData(obj, &current[0]);
+    delta.pop_back();
+    feed(buildFrame(UAVTALK_TYPE_OBJ_ACK_DELTA, OBJ_ID, 0, delta));
+    EXPECT_EQ(UAVTALK_TYPE_NACK, sent.back().type);
+    EXPECT_EQ(current, objectData());
+}
+
+/* Transmit batch of the telemetry module, TELEM_TX_BATCH_SIZE */
+#define BATCH_SIZE          128
+#define THROUGHPUT_FRAMES   1000000
+
+static uint8_t batch[BATCH_SIZE];
+static uint16_t batchLength;
+static uint8_t *reserved;
+static uint32_t reserveCalls;
+static uint32_t sink;
+static uint32_t sinkSum;
+static uint32_t copied;
+
+static void flushBatch()
+{
+    for (uint16_t i = 0; i < batchLength; i++) {
+        sinkSum = sinkSum * 31 + batch[i];
+    }
+    sink += batchLength;
+    batchLength = 0;
+}
+
+/* As the telemetry module did, the frame is built in the connection buffer and copied into the batch */
+static int32_t copyStream(uint8_t *data, int32_t length)
+{
+    if (batchLength + length > BATCH_SIZE) {
+        flushBatch();
+    }
+    memcpy(&batch[batchLength], data, length);
+    copied      += length;
+    batchLength += length;
+    return length;
+}
+
+/* As the telemetry module does now, the frame is already in the batch */
+static uint8_t *batchReserve(int32_t length)
+{
+    reserveCalls++;
+    if (batchLength + length > BATCH_SIZE) {
+        flushBatch();
+    }
+    reserved = &batch[batchLength];
+    return reserved;
+}
+
+static int32_t commitStream(uint8_t *data, int32_t length)
+{
+    if (data != &batch[batchLength]) {
+        memmove(&batch[batchLength], data, length);
+        copied += length;
+    }
+    batchLength += length;
+    return length;
+}
+
+static uint8_t *noReserve(__attribute__((unused)) int32_t length)
+{
+    reserveCalls++;
+    return NULL;
+}
+
+class UAVTalkReserveTest : public UAVTalkDeltaTest {
+protected:
+    virtual void SetUp()
+    {
+        UAVTalkDeltaTest::SetUp();
+        memset(batch, 0, sizeof(batch));
+        batchLength  = 0;
+        reserved     = NULL;
+        reserveCalls = 0;
+        sink    = 0;
+        sinkSum = 0;
+        copied  = 0;
+    }
+
+    int32_t sendUnacked()
+    {
+        return UAVTalkSendObject(connection, obj, 0, 0, 0);
+    }
+
+    double elapsed(const struct timespec *start)
+    {
+        struct timespec now;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+    }
+};
+
+TEST_F(UAVTalkReserveTest, BuildsInPlace) {
+    Bytes expected;
+
+    ASSERT_EQ(0, UAVTalkSetOutputStream(connection, &commitStream));
+    ASSERT_EQ(0, UAVTalkSetOutputReserve(connection, &batchReserve));
+
+    for (int i = 0; i < 2; i++) {
+        changeObject(i);
+        EXPECT_EQ(0, sendUnacked());
+        EXPECT_EQ(&batch[i * (HEADER_LENGTH + OBJ_SIZE + UAVTALK_CHECKSUM_LENGTH)], reserved);
+
+        Bytes frame = buildFrame(UAVTALK_TYPE_OBJ, OBJ_ID, 0, objectData());
+        expected.insert(expected.end(), frame.begin(), frame.end());
+    }
+    EXPECT_EQ(2u, reserveCalls);
+    ASSERT_EQ(expected.size(), (size_t)batchLength);
+    EXPECT_EQ(expected, Bytes(batch, batch + batchLength));
+
+    /* The third does not fit, the batch goes out first */
+    EXPECT_EQ(0, sendUnacked());
+    EXPECT_EQ(expected.size(), (size_t)sink);
+    EXPECT_EQ(&batch[0], reserved);
+    EXPECT_EQ(buildFrame(UAVTALK_TYPE_OBJ, OBJ_ID, 0, objectData()), Bytes(batch, batch + batchLength));
+}
+
+TEST_F(UAVTalkReserveTest, NoRoomUsesConnectionBuffer) {
+    ASSERT_EQ(0, UAVTalkSetOutputReserve(connection, &noReserve));
+
+    changeObject(3);
+    EXPECT_EQ(0, sendAcked());
+    EXPECT_EQ(1u, reserveCalls);
+    ASSERT_EQ(1u, sent.size());
+    EXPECT_EQ(UAVTALK_TYPE_OBJ_ACK, sent.back().type);
+    EXPECT_EQ(objectData(), peerCopy);
+
+    /* Nor without a reserve at all, delta frames included */
+    ASSERT_EQ(0, UAVTalkSetOutputReserve(connection, NULL));
+    negotiate();
+    EXPECT_EQ(0, sendAcked());
+    changeObject(4);
+    EXPECT_EQ(0, sendAcked());
+    EXPECT_EQ(UAVTALK_TYPE_OBJ_ACK_DELTA, sent.back().type);
+    EXPECT_EQ(objectData(), peerCopy);
+    EXPECT_EQ(1u, reserveCalls);
+}
+
+TEST_F(UAVTalkReserveTest, CopiedVersusInPlace) {
+    const double bytes = (double)THROUGHPUT_FRAMES * (HEADER_LENGTH + OBJ_SIZE + UAVTALK_CHECKSUM_LENGTH);
+    struct timespec start;
+
+    ASSERT_EQ(0, UAVTalkSetOutputStream(connection, &copyStream));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t i = 0; i < THROUGHPUT_FRAMES; i++) {
+        sendUnacked();
+    }
+    flushBatch();
+    double copied_time    = elapsed(&start);
+    uint32_t copied_sink  = sink;
+    uint32_t copied_sum   = sinkSum;
+    uint32_t copied_bytes = copied;
+
+    sink    = 0;
+    sinkSum = 0;
+    copied  = 0;
+    ASSERT_EQ(0, UAVTalkSetOutputStream(connection, &commitStream));
+    ASSERT_EQ(0, UAVTalkSetOutputReserve(connection, &batchReserve));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t i = 0; i < THROUGHPUT_FRAMES; i++) {
+        sendUnacked();
+    }
+    flushBatch();
+    double in_place_time = elapsed(&start);
+
+    // Both ways must write the same bytes
+    EXPECT_EQ(bytes, (double)copied_sink);
+    EXPECT_EQ(copied_sink, sink);
+    EXPECT_EQ(copied_sum, sinkSum);
+    // Only the first way copies the frames into the batch
+    EXPECT_EQ(copied_sink, copied_bytes);
+    EXPECT_EQ(0u, copied);
+
+    printf("copied:   %.1f MB/s\n", bytes / copied_time / 1e6);
+    printf("in place: %.1f MB/s\n", bytes / in_place_time / 1e6);
+}
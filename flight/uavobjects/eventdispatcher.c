@@ -44,6 +44,8 @@
 #define CALLBACK_PRIORITY    CALLBACK_PRIORITY_CRITICAL
 #define TASK_PRIORITY        CALLBACK_TASK_FLIGHTCONTROL
 #define MAX_UPDATE_PERIOD_MS 1000
+#define HEAP_BLOCK_SIZE      16
+#define HEAP_NONE            0xFFFF
 
 // Private types
 
@@ -65,12 +67,28 @@ struct PeriodicObjectListStruct {
     EventCallbackInfo evInfo; /** Event callback information */
     uint16_t updatePeriodMs; /** Update period in ms or 0 if no periodic updates are needed */
     int32_t  timeToNextUpdateMs; /** Time delay to the next update */
+    int32_t  lastUpdateMs; /** Time of the last update, 0 if none yet */
+    uint16_t heapIndex; /** Position in the update heap or HEAP_NONE if not scheduled */
     struct PeriodicObjectListStruct *next; /** Needed by linked list library (utlist.h) */
 };
 typedef struct PeriodicObjectListStruct PeriodicObjectList;
 
+/**
+ * Storage of the update heap. It grows by adding blocks, each twice the size
+ * of the previous one starting from HEAP_BLOCK_SIZE, that are never freed
+ * (heap_1 does not reclaim memory).
+ */
+struct HeapBlock {
+    struct HeapBlock   *next;
+    PeriodicObjectList *entries[];
+};
+
 // Private variables
 static PeriodicObjectList *mObjList;
+/* Min-heap of the scheduled entries of mObjList, ordered by timeToNextUpdateMs */
+static struct HeapBlock *mHeap;
+static uint16_t mHeapCount;
+static uint16_t mHeapSize; /** Entries the heap blocks hold, at most HEAP_NONE */
 static xQueueHandle mQueue;
 static DelayedCallbackInfo *eventSchedulerCallback;
 static xSemaphoreHandle mMutex;
@@ -82,6 +100,11 @@ static void eventTask();
 static int32_t eventPeriodicCreate(UAVObjEvent *ev, UAVObjEventCallback cb, xQueueHandle queue, uint16_t periodMs);
 static int32_t eventPeriodicUpdate(UAVObjEvent *ev, UAVObjEventCallback cb, xQueueHandle queue, uint16_t periodMs);
 static uint16_t randomizePeriod(uint16_t periodMs);
+static PeriodicObjectList * *heapSlot(uint16_t index);
+static int32_t heapReserve();
+static int32_t heapInsert(PeriodicObjectList *objEntry);
+static void heapRemove(PeriodicObjectList *objEntry);
+static void heapSiftDown(uint16_t index);
 
 
 /**
@@ -91,7 +114,10 @@ static uint16_t randomizePeriod(uint16_t periodMs);
 int32_t EventDispatcherInitialize()
 {
     // Initialize variables
-    mObjList = NULL;
+    mObjList   = NULL;
+    mHeap      = NULL;
+    mHeapCount = 0;
+    mHeapSize  = 0;
     memset(&mStats, 0, sizeof(EventStats));
 
     // Create mMutex
@@ -227,18 +253,32 @@ static int32_t eventPeriodicCreate(UAVObjEvent *ev, UAVObjEventCallback cb, xQue
             return -1;
         }
     }
+    // Make room to schedule it first, nothing allocated can be given back
+    if (periodMs > 0 && heapReserve() != 0) {
+        xSemaphoreGiveRecursive(mMutex);
+        return -1;
+    }
     // Create handle
     objEntry = (PeriodicObjectList *)pios_malloc(sizeof(PeriodicObjectList));
     if (objEntry == NULL) {
+        xSemaphoreGiveRecursive(mMutex);
         return -1;
     }
     objEntry->evInfo.ev.obj      = ev->obj;
     objEntry->evInfo.ev.instId   = ev->instId;
     objEntry->evInfo.ev.event    = ev->event;
+    objEntry->evInfo.ev.lowPriority = ev->lowPriority;
+    objEntry->evInfo.ev.coalesced = false;
     objEntry->evInfo.cb = cb;
     objEntry->evInfo.queue       = queue;
     objEntry->updatePeriodMs     = periodMs;
     objEntry->timeToNextUpdateMs = randomizePeriod(periodMs); // avoid bunching of updates
+    objEntry->lastUpdateMs       = 0;
+    objEntry->heapIndex = HEAP_NONE;
+    // Schedule it, it has room
+    if (periodMs > 0) {
+        heapInsert(objEntry);
+    }
     // Add to list
     LL_APPEND(mObjList, objEntry);
     // Release lock
@@ -268,11 +308,18 @@ static int32_t eventPeriodicUpdate(UAVObjEvent *ev, UAVObjEventCallback cb, xQue
             objEntry->evInfo.ev.instId == ev->instId &&
             objEntry->evInfo.ev.event == ev->event) {
             // Object found, update period
+            heapRemove(objEntry);
             objEntry->updatePeriodMs     = periodMs;
             objEntry->timeToNextUpdateMs = randomizePeriod(periodMs); // avoid bunching of updates
+            objEntry->lastUpdateMs       = 0;
+            // Reschedule it
+            int32_t result = 0;
+            if (periodMs > 0) {
+                result = heapInsert(objEntry);
+            }
             // Release lock
             xSemaphoreGiveRecursive(mMutex);
-            return 0;
+            return result;
         }
     }
     // If this point is reached the object was not found
@@ -319,49 +366,205 @@ static int32_t processPeriodicUpdates()
     PeriodicObjectList *objEntry;
     int32_t timeNow;
     int32_t timeToNextUpdate;
-    int32_t offset;
+    int32_t delay;
+    int32_t jitter;
 
     // Get lock
     xSemaphoreTakeRecursive(mMutex, portMAX_DELAY);
 
-    // Iterate through each object and update its timer, if zero then transmit object.
-    // Also calculate smallest delay to next update.
-    timeToNextUpdate = xTaskGetTickCount() * portTICK_RATE_MS + MAX_UPDATE_PERIOD_MS;
-    LL_FOREACH(mObjList, objEntry) {
-        // If object is configured for periodic updates
-        if (objEntry->updatePeriodMs > 0) {
-            // Check if time for the next update
-            timeNow = xTaskGetTickCount() * portTICK_RATE_MS;
-            if (objEntry->timeToNextUpdateMs <= timeNow) {
-                // Reset timer
-                offset = (timeNow - objEntry->timeToNextUpdateMs) % objEntry->updatePeriodMs;
-                objEntry->timeToNextUpdateMs = timeNow + objEntry->updatePeriodMs - offset;
-                // Invoke callback, if one
-                if (objEntry->evInfo.cb != 0) {
-                    objEntry->evInfo.cb(&objEntry->evInfo.ev); // the function is expected to copy the event information
-                }
-                // Push event to queue, if one
-                if (objEntry->evInfo.queue != 0) {
-                    if (xQueueSend(objEntry->evInfo.queue, &objEntry->evInfo.ev, 0) != pdTRUE && !objEntry->evInfo.ev.lowPriority) { // do not block if queue is full
-                        if (objEntry->evInfo.ev.obj != NULL) {
-                            mStats.lastErrorID = UAVObjGetID(objEntry->evInfo.ev.obj);
-                        }
-                        ++mStats.eventErrors;
-                    }
-                }
+    // Pop the due objects from the heap, rescheduling each before invoking it.
+    // Limit the number of updates to the number of scheduled objects, so that
+    // callbacks rescheduling themselves can not keep us here.
+    timeNow = xTaskGetTickCount() * portTICK_RATE_MS;
+    for (uint16_t limit = mHeapCount; limit > 0 && mHeapCount > 0 && mHeap->entries[0]->timeToNextUpdateMs <= timeNow; --limit) {
+        objEntry = mHeap->entries[0];
+
+        // Dispatch latency and jitter of the period since the previous update
+        delay = timeNow - objEntry->timeToNextUpdateMs;
+        if (objEntry->lastUpdateMs != 0) {
+            jitter = timeNow - objEntry->lastUpdateMs - objEntry->updatePeriodMs;
+            if (jitter < 0) {
+                jitter = -jitter;
             }
-            // Update minimum delay
-            if (objEntry->timeToNextUpdateMs < timeToNextUpdate) {
-                timeToNextUpdate = objEntry->timeToNextUpdateMs;
+            mStats.totalJitterMs += jitter;
+            if (jitter > mStats.maxJitterMs) {
+                mStats.maxJitterMs = jitter;
+            }
+            mStats.totalLatencyMs += delay;
+            if (delay > mStats.maxLatencyMs) {
+                mStats.maxLatencyMs = delay;
+            }
+            ++mStats.periodicUpdates;
+        }
+        objEntry->lastUpdateMs = timeNow;
+
+        // Reset timer
+        objEntry->timeToNextUpdateMs = timeNow + objEntry->updatePeriodMs - (delay % objEntry->updatePeriodMs);
+        heapSiftDown(0);
+
+        // Invoke callback, if one
+        if (objEntry->evInfo.cb != 0) {
+            objEntry->evInfo.cb(&objEntry->evInfo.ev); // the function is expected to copy the event information
+        }
+        // Push event to queue, if one
+        if (objEntry->evInfo.queue != 0) {
+            if (xQueueSend(objEntry->evInfo.queue, &objEntry->evInfo.ev, 0) != pdTRUE && !objEntry->evInfo.ev.lowPriority) { // do not block if queue is full
+                if (objEntry->evInfo.ev.obj != NULL) {
+                    mStats.lastErrorID = UAVObjGetID(objEntry->evInfo.ev.obj);
+                }
+                ++mStats.eventErrors;
             }
         }
     }
 
+    // The earliest update is at the top of the heap
+    timeToNextUpdate = timeNow + MAX_UPDATE_PERIOD_MS;
+    if (mHeapCount > 0 && mHeap->entries[0]->timeToNextUpdateMs < timeToNextUpdate) {
+        timeToNextUpdate = mHeap->entries[0]->timeToNextUpdateMs;
+    }
+
     // Done
     xSemaphoreGiveRecursive(mMutex);
     return timeToNextUpdate;
 }
 
+/**
+ * Slot of a heap entry, index must be below mHeapSize
+ */
+static PeriodicObjectList * *heapSlot(uint16_t index)
+{
+    struct HeapBlock *block = mHeap;
+    uint32_t base = 0;
+    uint32_t size = HEAP_BLOCK_SIZE;
+
+    while (index >= base + size) {
+        block = block->next;
+        base += size;
+        size *= 2;
+    }
+    return &block->entries[index - base];
+}
+
+/**
+ * Move a heap entry towards the root until its parent is due earlier
+ */
+static void heapSiftUp(uint16_t index)
+{
+    PeriodicObjectList *objEntry = *heapSlot(index);
+
+    while (index > 0) {
+        uint16_t parent = (index - 1) / 2;
+        PeriodicObjectList *parentEntry = *heapSlot(parent);
+        if (parentEntry->timeToNextUpdateMs <= objEntry->timeToNextUpdateMs) {
+            break;
+        }
+        *heapSlot(index) = parentEntry;
+        parentEntry->heapIndex = index;
+        index = parent;
+    }
+    *heapSlot(index)    = objEntry;
+    objEntry->heapIndex = index;
+}
+
+/**
+ * Move a heap entry towards the leaves until its children are due later
+ */
+static void heapSiftDown(uint16_t index)
+{
+    PeriodicObjectList *objEntry = *heapSlot(index);
+
+    for (;;) {
+        uint32_t child = 2 * (uint32_t)index + 1;
+        if (child >= mHeapCount) {
+            break;
+        }
+        PeriodicObjectList *childEntry = *heapSlot(child);
+        if (child + 1 < mHeapCount && (*heapSlot(child + 1))->timeToNextUpdateMs < childEntry->timeToNextUpdateMs) {
+            childEntry = *heapSlot(++child);
+        }
+        if (objEntry->timeToNextUpdateMs <= childEntry->timeToNextUpdateMs) {
+            break;
+        }
+        *heapSlot(index) = childEntry;
+        childEntry->heapIndex = index;
+        index = child;
+    }
+    *heapSlot(index)    = objEntry;
+    objEntry->heapIndex = index;
+}
+
+/**
+ * Make sure the heap has room for one more entry, adding a block if needed.
+ * The heap stops growing at HEAP_NONE entries. Must be called with mMutex held.
+ * \return Success (0), failure (-1)
+ */
+static int32_t heapReserve()
+{
+    if (mHeapCount < mHeapSize) {
+        return 0;
+    }
+    if (mHeapSize == HEAP_NONE) {
+        return -1;
+    }
+
+    // Find the end of the block list, the blocks already there stay as they are
+    struct HeapBlock **block = &mHeap;
+    uint32_t base = 0;
+    uint32_t size = HEAP_BLOCK_SIZE;
+    while (*block) {
+        block = &(*block)->next;
+        base += size;
+        size *= 2;
+    }
+    if (size > HEAP_NONE - base) {
+        size = HEAP_NONE - base;
+    }
+
+    *block = (struct HeapBlock *)pios_malloc(sizeof(struct HeapBlock) + size * sizeof(PeriodicObjectList *));
+    if (*block == NULL) {
+        return -1;
+    }
+    (*block)->next = NULL;
+    mHeapSize = base + size;
+    return 0;
+}
+
+/**
+ * Schedule an entry, growing the heap if needed. Must be called with mMutex held.
+ * \return Success (0), failure (-1)
+ */
+static int32_t heapInsert(PeriodicObjectList *objEntry)
+{
+    if (heapReserve() != 0) {
+        return -1;
+    }
+
+    *heapSlot(mHeapCount) = objEntry;
+    heapSiftUp(mHeapCount++);
+    return 0;
+}
+
+/**
+ * Unschedule an entry, if scheduled. Must be called with mMutex held.
+ */
+static void heapRemove(PeriodicObjectList *objEntry)
+{
+    uint16_t index = objEntry->heapIndex;
+
+    if (index == HEAP_NONE) {
+        return;
+    }
+    objEntry->heapIndex = HEAP_NONE;
+
+    // Fill the hole with the last entry and restore the heap order around it
+    if (index != --mHeapCount) {
+        PeriodicObjectList *moved = *heapSlot(mHeapCount);
+        *heapSlot(index) = moved;
+        heapSiftUp(index);
+        heapSiftDown(moved->heapIndex);
+    }
+}
+
 /**
  * Return a psedorandom integer from 0 to periodMs
  * Based on the Park-Miller-Carta Pseudo-Random Number Generator
@@ -33,6 +33,11 @@
 typedef struct {
     uint32_t lastErrorID;
     uint32_t eventErrors;
+    uint32_t periodicUpdates; /** Periodic updates dispatched (latency and jitter samples) */
+    uint32_t totalLatencyMs; /** Sum of the delays between the scheduled and actual update times */
+    uint32_t totalJitterMs; /** Sum of the deviations of the update intervals from their period */
+    uint32_t maxLatencyMs;
+    uint32_t maxJitterMs;
 } EventStats;
 
 // Public functions
@@ -158,6 +158,7 @@ typedef struct {
     uint16_t        instId;
     UAVObjEventType event;
     bool lowPriority; /* if true prevents raising warnings */
+    bool coalesced; /* sent to a queue connected with UAVObjConnectQueueCoalesced() */
 } UAVObjEvent;
 
 /**
@@ -180,6 +181,10 @@ typedef struct {
     uint32_t eventCallbackErrors;
     uint32_t lastCallbackErrorID;
     uint32_t lastQueueErrorID;
+    uint32_t lockContentions; /** Object lock requests that had to wait for another task */
+    uint32_t seqlockRetries; /** Lock-free reads retried because of a concurrent write */
+    uint32_t eventsDelivered; /** Events pushed to listener queues */
+    uint32_t eventsCoalesced; /** Events merged into one already pending in a coalesced queue */
 } UAVObjStats;
 
 int32_t UAVObjInitialize();
@@ -235,7 +240,9 @@ UAVObjUpdateMode UAVObjGetLoggingUpdateMode(const UAVObjMetadata *dataOut);
 void UAVObjSetLoggingUpdateMode(UAVObjMetadata *dataOut, UAVObjUpdateMode val);
 int8_t UAVObjReadOnly(UAVObjHandle obj);
 int32_t UAVObjConnectQueue(UAVObjHandle obj_handle, xQueueHandle queue, uint8_t eventMask);
+int32_t UAVObjConnectQueueCoalesced(UAVObjHandle obj_handle, xQueueHandle queue, uint8_t eventMask);
 int32_t UAVObjDisconnectQueue(UAVObjHandle obj_handle, xQueueHandle queue);
+int32_t UAVObjQueueReceive(xQueueHandle queue, UAVObjEvent *ev, portTickType ticksToWait);
 int32_t UAVObjConnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb, uint8_t eventMask, bool fast);
 int32_t UAVObjDisconnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb);
 void UAVObjRequestUpdate(UAVObjHandle obj);
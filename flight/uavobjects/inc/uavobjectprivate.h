@@ -68,22 +68,35 @@ extern struct UAVOData *__stop__uavo_handles[] __attribute__((weak));
 /** opaque type for instances **/
 typedef void *InstanceHandle;
 
+/*
+ * Pending events of a coalesced queue, one entry per instance after a first one for
+ * UAVOBJ_ALL_INSTANCES. The first block holds UAVO_PENDING_EVENTS_BLOCK entries and each
+ * next block twice as many, blocks are only freed when the queue is disconnected.
+ */
+#define UAVO_PENDING_EVENTS_BLOCK 4
+
+struct PendingEventsBlock {
+    struct PendingEventsBlock *next;
+    uint8_t events[];
+};
+
 struct ObjectEventEntry {
     struct ObjectEventEntry *next;
     xQueueHandle queue;
     UAVObjEventCallback     cb;
     uint8_t eventMask;
     bool fast;
+    bool coalesce; /* Queue holds at most one pending event per event type (see UAVObjConnectQueueCoalesced) */
+    uint16_t pendingSlots; /* Entries the pendingEvents blocks hold */
+    struct PendingEventsBlock *pendingEvents; /* Event types sent to the queue and not yet received */
 };
 
 /*
    MetaInstance   == [UAVOBase [UAVObjMetadata]]
    SingleInstance == [UAVOBase [UAVOData [InstanceData]]]
-   MultiInstance  == [UAVOBase [UAVOData [NumInstances [InstanceData0 [next]]]]
-                                                  ____________________/
-   \-->[InstanceData1 [next]]
-                                                  _________...________/
-   \-->[InstanceDataN [next]]
+   MultiInstance  == [UAVOBase [UAVOData [NumInstances [TableSize [Instances* [InstanceData0]]]]]
+                                                                     |
+                                         [&InstanceData0 | &InstanceData1 | ... | &InstanceDataN]
  */
 
 /*
@@ -125,6 +138,10 @@ struct UAVOData {
 /* Augmented type for Single Instance Data UAVO */
 struct UAVOSingle {
     struct UAVOData uavo;
+#ifdef PIOS_UAVOBJECT_SEQLOCK_MAX_SIZE
+    /* Odd while the instance data is being written */
+    volatile uint32_t seq;
+#endif
 
     uint8_t instance0[];
     /*
@@ -133,21 +150,26 @@ struct UAVOSingle {
      */
 } __attribute__((packed));
 
-/* Part of a linked list of instances chained off of a multi instance UAVO. */
-struct UAVOMultiInst {
-    struct UAVOMultiInst *next;
-    uint8_t instance[];
-    /*
-     * Additional space will be malloc'd here to hold the
-     * the data for this instance.
-     */
-} __attribute__((packed));
+/*
+ * Multi instance UAVOs keep their instance data pointers in a list of blocks,
+ * the first one holding this many entries and each next one twice as many as
+ * the one before. Blocks are never freed or reallocated, which heap_1 could
+ * not reclaim, and an instance is found within a few blocks. The first block
+ * is only allocated once a second instance is created.
+ */
+#define UAVO_INSTANCE_TABLE_BLOCK 8
+
+struct UAVOInstanceBlock {
+    struct UAVOInstanceBlock *next;
+    void *instances[];
+};
 
 /* Augmented type for Multi Instance Data UAVO */
 struct UAVOMulti {
     struct UAVOData uavo;
     uint16_t num_instances;
-    struct UAVOMultiInst instance0 __attribute__((aligned(4)));
+    struct UAVOInstanceBlock *blocks;
+    uint8_t  instance0[] __attribute__((aligned(4)));
     /*
      * Additional space will be malloc'd here to hold the
      * the data for instance 0.
@@ -163,7 +185,6 @@ struct UAVOMulti {
 
 /** all information about instances are dependant on object type **/
 #define ObjSingleInstanceDataOffset(obj) ((void *)(&(((struct UAVOSingle *)obj)->instance0)))
-#define InstanceDataOffset(inst)         ((void *)&(((struct UAVOMultiInst *)inst)->instance))
 #define InstanceData(instance)           ((void *)instance)
 
 // Private functions
@@ -36,10 +36,19 @@
 #include "inc/uavobjectprivate.h"
 
 // Private functions
+struct DeferredCallbacks;
 static InstanceHandle createInstance(struct UAVOData *obj, uint16_t instId);
-static int32_t connectObj(UAVObjHandle obj_handle, xQueueHandle queue, UAVObjEventCallback cb, uint8_t eventMask, bool fast);
+static void * *instanceSlot(struct UAVOMulti *uavo_multi, uint16_t instId);
+static int32_t connectObj(UAVObjHandle obj_handle, xQueueHandle queue, UAVObjEventCallback cb, uint8_t eventMask, bool fast, bool coalesce);
 static int32_t disconnectObj(UAVObjHandle obj_handle, xQueueHandle queue, UAVObjEventCallback cb);
 static void instanceAutoUpdated(UAVObjHandle obj_handle, uint16_t instId);
+static void indexInsert(struct UAVOData *obj);
+static void sendEventDeferred(struct UAVOBase *obj, uint16_t instId, UAVObjEventType triggered_event, struct DeferredCallbacks *deferred);
+static void pendingEventsReserve(struct ObjectEventEntry *event, uint16_t numInstances);
+static void pendingEventsClear(struct ObjectEventEntry *event);
+static uint8_t *pendingEventsOf(struct ObjectEventEntry *event, uint16_t instId);
+static void invokeDeferred(struct DeferredCallbacks *deferred);
+static struct UAVOData *indexLookup(uint32_t id);
 
 
 int32_t UAVObjPers_stub(__attribute__((unused)) UAVObjHandle obj_handle, __attribute__((unused))  uint16_t instId)
@@ -67,6 +76,54 @@ static const UAVObjMetadata defMetadata = {
 
 static UAVObjStats stats;
 
+// Counters are updated under different object locks (or none)
+#define STATS_INC(counter) __sync_fetch_and_add(&stats.counter, 1)
+
+/*
+ * Object locks. By default every object is protected by the global mutex.
+ * Boards can opt in to PIOS_UAVOBJECT_LOCK_STRIPES recursive mutexes instead,
+ * objects (and their metaobject) being mapped to one by ID, so that tasks
+ * working on unrelated objects do not serialize.
+ *
+ * Lock order: the global mutex is taken before an object lock, and an object
+ * lock is never held while taking another one, except by the save/load-all
+ * helpers which hold the global mutex. Fast callbacks may access any object,
+ * so they are collected while the object lock is held and invoked after it is
+ * released (see sendEventDeferred()).
+ */
+#ifdef PIOS_UAVOBJECT_LOCK_STRIPES
+static xSemaphoreHandle lockStripes[PIOS_UAVOBJECT_LOCK_STRIPES];
+#endif
+
+/* Fast callbacks of one event, to be invoked once the object lock is released */
+#define UAVOBJ_MAX_DEFERRED_CALLBACKS 4
+struct DeferredCallbacks {
+    UAVObjEvent msg;
+    uint8_t     count;
+    UAVObjEventCallback cb[UAVOBJ_MAX_DEFERRED_CALLBACKS];
+};
+
+/*
+ * With PIOS_UAVOBJECT_SEQLOCK_MAX_SIZE defined, single instance data objects up
+ * to that size are read without any lock: writers bump the object sequence number
+ * before and after updating the data, readers retry on a change and fall back
+ * to the lock after a few attempts (the writer may be a preempted lower priority task).
+ */
+#define UAVOBJ_SEQLOCK_MAX_RETRIES 3
+
+/*
+ * Object ID index: open addressing hash table of data object handles, sized at
+ * init from the number of UAVO handle slots. Entries are only ever added (objects
+ * are never unregistered) and a slot is published by writing its pointer last,
+ * so readers can probe it without taking the mutex.
+ */
+#define UAVO_INDEX_MIN_SIZE 16
+static struct UAVOData **uavoIndex;
+static uint16_t uavoIndexMask;
+static uint16_t uavoIndexCount;
+static uint8_t uavoIndexShift;
+static bool uavoIndexOverflow;
+
 
 static inline bool IsMetaobject(UAVObjHandle obj_handle)
 {
@@ -100,6 +157,117 @@ static inline bool IsPriority(UAVObjHandle obj_handle)
     return uavo_base->flags.isPriority;
 }
 
+/**
+ * Return the lock protecting the data, instances and event list of an object
+ */
+static inline xSemaphoreHandle objLock(UAVObjHandle obj_handle)
+{
+#ifdef PIOS_UAVOBJECT_LOCK_STRIPES
+    struct UAVOData *uavo_data;
+
+    if (IsMetaobject(obj_handle)) {
+        /* Metaobjects share the lock of their parent */
+        uavo_data = container_of((struct UAVOMeta *)obj_handle, struct UAVOData, metaObj);
+    } else {
+        uavo_data = (struct UAVOData *)obj_handle;
+    }
+    return lockStripes[(uavo_data->id >> 1) % PIOS_UAVOBJECT_LOCK_STRIPES];
+
+#else
+    (void)obj_handle;
+    return mutex;
+
+#endif
+}
+
+/**
+ * Take the lock of an object, counting the times it is held by another task
+ * \return The lock to release
+ */
+static inline xSemaphoreHandle lockObj(UAVObjHandle obj_handle)
+{
+    xSemaphoreHandle lock = objLock(obj_handle);
+
+    if (xSemaphoreTakeRecursive(lock, 0) != pdTRUE) {
+        STATS_INC(lockContentions);
+        xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    }
+    return lock;
+}
+
+/**
+ * Run a persistence operation on instance 0 of an object with its lock held
+ */
+static int32_t persistLocked(int32_t (*operation)(UAVObjHandle obj_handle, uint16_t instId), UAVObjHandle obj_handle)
+{
+    xSemaphoreHandle lock = lockObj(obj_handle);
+    int32_t rc = operation(obj_handle, 0);
+
+    xSemaphoreGiveRecursive(lock);
+    return rc;
+}
+
+#ifdef PIOS_UAVOBJECT_SEQLOCK_MAX_SIZE
+/**
+ * Can this object be read through its sequence number instead of its lock?
+ * Settings are excluded as they are also written directly by the persistence code.
+ */
+static inline bool IsSeqlocked(UAVObjHandle obj_handle)
+{
+    return !IsMetaobject(obj_handle) && IsSingleInstance(obj_handle) && !IsSettings(obj_handle) &&
+           ((struct UAVOData *)obj_handle)->instance_size <= PIOS_UAVOBJECT_SEQLOCK_MAX_SIZE;
+}
+
+/**
+ * Lock-free read of a single instance object
+ * \return True if consistent data was copied, false if the caller must take the lock
+ */
+static bool seqlockRead(UAVObjHandle obj_handle, void *dataOut, uint32_t offset, uint32_t size)
+{
+    struct UAVOSingle *uavo_single = (struct UAVOSingle *)obj_handle;
+
+    for (uint8_t retries = 0; retries < UAVOBJ_SEQLOCK_MAX_RETRIES; ++retries) {
+        uint32_t seq = uavo_single->seq;
+        READ_MEMORY_BARRIER();
+        if ((seq & 1) == 0) {
+            memcpy(dataOut, uavo_single->instance0 + offset, size);
+            READ_MEMORY_BARRIER();
+            if (uavo_single->seq == seq) {
+                return true;
+            }
+        }
+        STATS_INC(seqlockRetries);
+    }
+    return false;
+}
+#endif /* PIOS_UAVOBJECT_SEQLOCK_MAX_SIZE */
+
+/**
+ * Mark the start of a data update, called with the object lock held
+ */
+static inline void seqlockWriteBegin(__attribute__((unused)) UAVObjHandle obj_handle)
+{
+#ifdef PIOS_UAVOBJECT_SEQLOCK_MAX_SIZE
+    if (!IsMetaobject(obj_handle) && IsSingleInstance(obj_handle)) {
+        ((struct UAVOSingle *)obj_handle)->seq++;
+        WRITE_MEMORY_BARRIER();
+    }
+#endif
+}
+
+/**
+ * Mark the end of a data update, called with the object lock held
+ */
+static inline void seqlockWriteEnd(__attribute__((unused)) UAVObjHandle obj_handle)
+{
+#ifdef PIOS_UAVOBJECT_SEQLOCK_MAX_SIZE
+    if (!IsMetaobject(obj_handle) && IsSingleInstance(obj_handle)) {
+        WRITE_MEMORY_BARRIER();
+        ((struct UAVOSingle *)obj_handle)->seq++;
+    }
+#endif
+}
+
 /**
  * Is this a metaobject?
  * \param[in] obj The object handle
@@ -166,12 +334,37 @@ int32_t UAVObjInitialize()
     memset(__start__uavo_handles, 0,
            (uintptr_t)__stop__uavo_handles - (uintptr_t)__start__uavo_handles);
 
+    // Allocate the ID index, keeping its load factor below 2/3
+    uint32_t numSlots  = __start__uavo_handles ? (__stop__uavo_handles - __start__uavo_handles) : 0;
+    uint32_t indexSize = UAVO_INDEX_MIN_SIZE;
+    uavoIndexShift = 32 - 4;
+    while (indexSize < numSlots + numSlots / 2) {
+        indexSize <<= 1;
+        --uavoIndexShift;
+    }
+    uavoIndex = (struct UAVOData * *)pios_malloc(indexSize * sizeof(struct UAVOData *));
+    if (uavoIndex) {
+        memset(uavoIndex, 0, indexSize * sizeof(struct UAVOData *));
+        uavoIndexMask = indexSize - 1;
+    }
+    uavoIndexCount    = 0;
+    uavoIndexOverflow = false;
+
     // Create mutex
     mutex = xSemaphoreCreateRecursiveMutex();
     if (mutex == NULL) {
         return -1;
     }
 
+#ifdef PIOS_UAVOBJECT_LOCK_STRIPES
+    for (uint8_t i = 0; i < PIOS_UAVOBJECT_LOCK_STRIPES; i++) {
+        lockStripes[i] = xSemaphoreCreateRecursiveMutex();
+        if (lockStripes[i] == NULL) {
+            return -1;
+        }
+    }
+#endif
+
     // Done
     return 0;
 }
@@ -237,6 +430,10 @@ static struct UAVOData *UAVObjAllocSingle(uint32_t num_bytes)
     uavo_base->flags.isSingle = true;
     uavo_base->next_event     = NULL;
 
+#ifdef PIOS_UAVOBJECT_SEQLOCK_MAX_SIZE
+    uavo_single->seq = 0;
+#endif
+
     /* Clear the instance data carried in the UAVO */
     memset(&(uavo_single->instance0), 0, num_bytes);
 
@@ -264,9 +461,10 @@ static struct UAVOData *UAVObjAllocMulti(uint32_t num_bytes)
 
     /* Set up the type-specific part of the UAVO */
     uavo_multi->num_instances = 1;
+    uavo_multi->blocks = NULL;
 
     /* Clear the multi instance data carried in the UAVO */
-    memset(&(uavo_multi->instance0), 0, sizeof(struct UAVOMultiInst) + num_bytes);
+    memset(uavo_multi->instance0, 0, num_bytes);
 
     /* Give back the generic UAVO part */
     return &(uavo_multi->uavo);
@@ -337,6 +535,9 @@ UAVObjHandle UAVObjRegister(uint32_t id,
         UAVObjLoad((UAVObjHandle)uavo_data, 0);
     }
 
+    /* Make the object visible to UAVObjGetByID() */
+    indexInsert(uavo_data);
+
     // fire events for outer object and its embedded meta object
     instanceAutoUpdated((UAVObjHandle)uavo_data, 0);
     instanceAutoUpdated((UAVObjHandle) & (uavo_data->metaObj), 0);
@@ -355,6 +556,20 @@ UAVObjHandle UAVObjGetByID(uint32_t id)
 {
     UAVObjHandle *found_obj = (UAVObjHandle *)NULL;
 
+    // Fast path, the index does not need the lock
+    if (uavoIndex && !uavoIndexOverflow) {
+        struct UAVOData *obj = indexLookup(id);
+        if (obj) {
+            return (UAVObjHandle)obj;
+        }
+        // Metaobject IDs are their parent's ID + 1
+        obj = indexLookup(id - 1);
+        if (obj && MetaObjectId(obj->id) == id) {
+            return (UAVObjHandle) & (obj->metaObj);
+        }
+        return (UAVObjHandle)NULL;
+    }
+
     // Get lock
     xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
 
@@ -488,7 +703,7 @@ uint16_t UAVObjCreateInstance(UAVObjHandle obj_handle,
     }
 
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    xSemaphoreHandle lock = lockObj(obj_handle);
 
     InstanceHandle instEntry;
     uint16_t instId = 0;
@@ -497,7 +712,8 @@ uint16_t UAVObjCreateInstance(UAVObjHandle obj_handle,
     instId    = UAVObjGetNumInstances(obj_handle);
     instEntry = createInstance((struct UAVOData *)obj_handle, instId);
     if (instEntry == NULL) {
-        goto unlock_exit;
+        xSemaphoreGiveRecursive(lock);
+        return instId;
     }
 
     // Initialize instance data
@@ -505,8 +721,10 @@ uint16_t UAVObjCreateInstance(UAVObjHandle obj_handle,
         initCb(obj_handle, instId);
     }
 
-unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
+    xSemaphoreGiveRecursive(lock);
+
+    // Fire event
+    instanceAutoUpdated(obj_handle, instId);
 
     return instId;
 }
@@ -523,9 +741,12 @@ int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId, const uint8_t *da
     PIOS_Assert(obj_handle);
 
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    xSemaphoreHandle lock = lockObj(obj_handle);
 
     int32_t rc = -1;
+    struct DeferredCallbacks deferred = { .count = 0 };
+    // Instances from created to instId were created here
+    uint16_t created = instId + 1;
 
     if (IsMetaobject(obj_handle)) {
         if (instId != 0) {
@@ -544,21 +765,30 @@ int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId, const uint8_t *da
 
         // If the instance does not exist create it and any other instances before it
         if (instEntry == NULL) {
+            created   = UAVObjGetNumInstances(obj_handle);
             instEntry = createInstance(obj, instId);
             if (instEntry == NULL) {
                 goto unlock_exit;
             }
         }
         // Set the data
+        seqlockWriteBegin(obj_handle);
         memcpy(InstanceData(instEntry), dataIn, obj->instance_size);
+        seqlockWriteEnd(obj_handle);
     }
 
     // Fire event
-    sendEvent((struct UAVOBase *)obj_handle, instId, EV_UNPACKED);
+    sendEventDeferred((struct UAVOBase *)obj_handle, instId, EV_UNPACKED, &deferred);
     rc = 0;
 
 unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
+    xSemaphoreGiveRecursive(lock);
+    if (rc == 0) {
+        for (uint16_t n = created; n <= instId; ++n) {
+            instanceAutoUpdated(obj_handle, n);
+        }
+    }
+    invokeDeferred(&deferred);
     return rc;
 }
 
@@ -574,7 +804,7 @@ int32_t UAVObjPack(UAVObjHandle obj_handle, uint16_t instId, uint8_t *dataOut)
     PIOS_Assert(obj_handle);
 
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    xSemaphoreHandle lock = lockObj(obj_handle);
 
     int32_t rc = -1;
 
@@ -602,7 +832,7 @@ int32_t UAVObjPack(UAVObjHandle obj_handle, uint16_t instId, uint8_t *dataOut)
     rc = 0;
 
 unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
+    xSemaphoreGiveRecursive(lock);
     return rc;
 }
 
@@ -618,7 +848,7 @@ uint8_t UAVObjUpdateCRC(UAVObjHandle obj_handle, uint16_t instId, uint8_t crc)
     PIOS_Assert(obj_handle);
 
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    xSemaphoreHandle lock = lockObj(obj_handle);
 
     if (IsMetaobject(obj_handle)) {
         if (instId != 0) {
@@ -642,7 +872,7 @@ uint8_t UAVObjUpdateCRC(UAVObjHandle obj_handle, uint16_t instId, uint8_t crc)
     }
 
 unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
+    xSemaphoreGiveRecursive(lock);
     return crc;
 }
 
@@ -657,7 +887,7 @@ void UAVObjInstanceWriteToLog(UAVObjHandle obj_handle, uint16_t instId)
     PIOS_Assert(obj_handle);
 
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    xSemaphoreHandle lock = lockObj(obj_handle);
 
     if (IsMetaobject(obj_handle)) {
         if (instId != 0) {
@@ -681,7 +911,7 @@ void UAVObjInstanceWriteToLog(UAVObjHandle obj_handle, uint16_t instId)
     }
 
 unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
+    xSemaphoreGiveRecursive(lock);
 }
 #else /* ifdef PIOS_INCLUDE_DEBUGLOG */
 void UAVObjInstanceWriteToLog(__attribute__((unused)) UAVObjHandle obj_handle, __attribute__((unused)) uint16_t instId) {}
@@ -702,8 +932,7 @@ int32_t UAVObjSaveSettings()
     // Check if this is a settings object
     if (IsSettings(obj)) {
         // Save object
-        if (UAVObjSave((UAVObjHandle)obj, 0) ==
-            -1) {
+        if (persistLocked(&UAVObjSave, (UAVObjHandle)obj) == -1) {
             goto unlock_exit;
         }
     }
@@ -732,8 +961,7 @@ int32_t UAVObjLoadSettings()
     // Check if this is a settings object
     if (IsSettings(obj)) {
         // Load object
-        if (UAVObjLoad((UAVObjHandle)obj, 0) ==
-            -1) {
+        if (persistLocked(&UAVObjLoad, (UAVObjHandle)obj) == -1) {
             goto unlock_exit;
         }
     }
@@ -762,8 +990,7 @@ int32_t UAVObjDeleteSettings()
     // Check if this is a settings object
     if (IsSettings(obj)) {
         // Save object
-        if (UAVObjDelete((UAVObjHandle)obj, 0)
-            == -1) {
+        if (persistLocked(&UAVObjDelete, (UAVObjHandle)obj) == -1) {
             goto unlock_exit;
         }
     }
@@ -790,8 +1017,7 @@ int32_t UAVObjSaveMetaobjects()
     // Save all settings objects
     UAVO_LIST_ITERATE(obj)
     // Save object
-    if (UAVObjSave((UAVObjHandle)MetaObjectPtr(obj), 0) ==
-        -1) {
+    if (persistLocked(&UAVObjSave, (UAVObjHandle)MetaObjectPtr(obj)) == -1) {
         goto unlock_exit;
     }
 }
@@ -817,8 +1043,7 @@ int32_t UAVObjLoadMetaobjects()
     // Load all settings objects
     UAVO_LIST_ITERATE(obj)
     // Load object
-    if (UAVObjLoad((UAVObjHandle)MetaObjectPtr(obj), 0) ==
-        -1) {
+    if (persistLocked(&UAVObjLoad, (UAVObjHandle)MetaObjectPtr(obj)) == -1) {
         goto unlock_exit;
     }
 }
@@ -844,8 +1069,7 @@ int32_t UAVObjDeleteMetaobjects()
     // Load all settings objects
     UAVO_LIST_ITERATE(obj)
     // Load object
-    if (UAVObjDelete((UAVObjHandle)MetaObjectPtr(obj), 0)
-        == -1) {
+    if (persistLocked(&UAVObjDelete, (UAVObjHandle)MetaObjectPtr(obj)) == -1) {
         goto unlock_exit;
     }
 }
@@ -914,9 +1138,10 @@ int32_t UAVObjSetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
     PIOS_Assert(obj_handle);
 
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    xSemaphoreHandle lock = lockObj(obj_handle);
 
     int32_t rc = -1;
+    struct DeferredCallbacks deferred = { .count = 0 };
 
     if (IsMetaobject(obj_handle)) {
         if (instId != 0) {
@@ -940,15 +1165,18 @@ int32_t UAVObjSetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
             goto unlock_exit;
         }
         // Set data
+        seqlockWriteBegin(obj_handle);
         memcpy(InstanceData(instEntry), dataIn, obj->instance_size);
+        seqlockWriteEnd(obj_handle);
     }
 
     // Fire event
-    sendEvent((struct UAVOBase *)obj_handle, instId, EV_UPDATED);
+    sendEventDeferred((struct UAVOBase *)obj_handle, instId, EV_UPDATED, &deferred);
     rc = 0;
 
 unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
+    xSemaphoreGiveRecursive(lock);
+    invokeDeferred(&deferred);
     return rc;
 }
 
@@ -964,9 +1192,10 @@ int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, con
     PIOS_Assert(obj_handle);
 
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    xSemaphoreHandle lock = lockObj(obj_handle);
 
     int32_t rc = -1;
+    struct DeferredCallbacks deferred = { .count = 0 };
 
     if (IsMetaobject(obj_handle)) {
         // Get instance information
@@ -1005,16 +1234,19 @@ int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, con
         }
 
         // Set data
+        seqlockWriteBegin(obj_handle);
         memcpy(InstanceData(instEntry) + offset, dataIn, size);
+        seqlockWriteEnd(obj_handle);
     }
 
 
     // Fire event
-    sendEvent((struct UAVOBase *)obj_handle, instId, EV_UPDATED);
+    sendEventDeferred((struct UAVOBase *)obj_handle, instId, EV_UPDATED, &deferred);
     rc = 0;
 
 unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
+    xSemaphoreGiveRecursive(lock);
+    invokeDeferred(&deferred);
     return rc;
 }
 
@@ -1030,8 +1262,15 @@ int32_t UAVObjGetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
 {
     PIOS_Assert(obj_handle);
 
+#ifdef PIOS_UAVOBJECT_SEQLOCK_MAX_SIZE
+    if (instId == 0 && IsSeqlocked(obj_handle) &&
+        seqlockRead(obj_handle, dataOut, 0, ((struct UAVOData *)obj_handle)->instance_size)) {
+        return 0;
+    }
+#endif
+
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    xSemaphoreHandle lock = lockObj(obj_handle);
 
     int32_t rc = -1;
 
@@ -1061,7 +1300,7 @@ int32_t UAVObjGetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
     rc = 0;
 
 unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
+    xSemaphoreGiveRecursive(lock);
     return rc;
 }
 
@@ -1076,8 +1315,16 @@ int32_t UAVObjGetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, voi
 {
     PIOS_Assert(obj_handle);
 
+#ifdef PIOS_UAVOBJECT_SEQLOCK_MAX_SIZE
+    if (instId == 0 && IsSeqlocked(obj_handle) &&
+        (size + offset) <= ((struct UAVOData *)obj_handle)->instance_size &&
+        seqlockRead(obj_handle, dataOut, offset, size)) {
+        return 0;
+    }
+#endif
+
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    xSemaphoreHandle lock = lockObj(obj_handle);
 
     int32_t rc = -1;
 
@@ -1119,7 +1366,7 @@ int32_t UAVObjGetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, voi
     rc = 0;
 
 unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
+    xSemaphoreGiveRecursive(lock);
     return rc;
 }
 
@@ -1138,11 +1385,11 @@ int32_t UAVObjSetMetadata(UAVObjHandle obj_handle, const UAVObjMetadata *dataIn)
         return -1;
     }
 
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    xSemaphoreHandle lock = lockObj(obj_handle);
 
     UAVObjSetData((UAVObjHandle)MetaObjectPtr((struct UAVOData *)obj_handle), dataIn);
 
-    xSemaphoreGiveRecursive(mutex);
+    xSemaphoreGiveRecursive(lock);
     return 0;
 }
 
@@ -1157,7 +1404,7 @@ int32_t UAVObjGetMetadata(UAVObjHandle obj_handle, UAVObjMetadata *dataOut)
     PIOS_Assert(obj_handle);
 
     // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    xSemaphoreHandle lock = lockObj(obj_handle);
 
     // Get metadata
     if (IsMetaobject(obj_handle)) {
@@ -1168,7 +1415,7 @@ int32_t UAVObjGetMetadata(UAVObjHandle obj_handle, UAVObjMetadata *dataOut)
     }
 
     // Unlock
-    xSemaphoreGiveRecursive(mutex);
+    xSemaphoreGiveRecursive(lock);
     return 0;
 }
 
@@ -1362,12 +1609,73 @@ int32_t UAVObjConnectQueue(UAVObjHandle obj_handle, xQueueHandle queue,
     PIOS_Assert(obj_handle);
     PIOS_Assert(queue);
     int32_t res;
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-    res = connectObj(obj_handle, queue, 0, eventMask, false);
-    xSemaphoreGiveRecursive(mutex);
+    xSemaphoreHandle lock = lockObj(obj_handle);
+    res = connectObj(obj_handle, queue, 0, eventMask, false, false);
+    xSemaphoreGiveRecursive(lock);
+    return res;
+}
+
+/**
+ * Connect an event queue to the object in coalescing mode, if the queue is already connected then the
+ * event mask is only updated.
+ * While an event is waiting in the queue, further events of the same type for the same instance are not
+ * queued again: the listener reads the object data when it handles the event and sees the latest value.
+ * This keeps fast producers from overflowing the queue of a slow consumer. Events must be read from the
+ * queue with UAVObjQueueReceive() so that the pending state is cleared.
+ * The pending state is kept per instance and allocated when the queue is connected or an instance is
+ * created. If there is no memory left for it the events of that instance are queued as on a plain queue.
+ * \param[in] obj The object handle
+ * \param[in] queue The event queue
+ * \param[in] eventMask The event mask, if EV_MASK_ALL then all events are enabled (e.g. EV_UPDATED | EV_UPDATED_MANUAL)
+ * \return 0 if success or -1 if failure
+ */
+int32_t UAVObjConnectQueueCoalesced(UAVObjHandle obj_handle, xQueueHandle queue,
+                                    uint8_t eventMask)
+{
+    PIOS_Assert(obj_handle);
+    PIOS_Assert(queue);
+    int32_t res;
+    xSemaphoreHandle lock = lockObj(obj_handle);
+    res = connectObj(obj_handle, queue, 0, eventMask, false, true);
+    xSemaphoreGiveRecursive(lock);
     return res;
 }
 
+/**
+ * Receive an event from a queue connected with UAVObjConnectQueue() or UAVObjConnectQueueCoalesced().
+ * Behaves like xQueueReceive(), and marks coalesced events as no longer pending.
+ * \param[in] queue The event queue
+ * \param[out] ev The received event
+ * \param[in] ticksToWait Maximum time to block waiting for an event
+ * \return pdTRUE if an event was received, pdFALSE otherwise
+ */
+int32_t UAVObjQueueReceive(xQueueHandle queue, UAVObjEvent *ev, portTickType ticksToWait)
+{
+    PIOS_Assert(queue);
+    PIOS_Assert(ev);
+
+    if (xQueueReceive(queue, ev, ticksToWait) != pdTRUE) {
+        return pdFALSE;
+    }
+
+    // Only events of coalesced connections need their pending state cleared
+    if (ev->coalesced && ev->obj) {
+        struct ObjectEventEntry *event;
+        xSemaphoreHandle lock = lockObj(ev->obj);
+        LL_FOREACH(((struct UAVOBase *)ev->obj)->next_event, event) {
+            if (event->queue == queue && event->coalesce) {
+                uint8_t *pending = pendingEventsOf(event, ev->instId);
+                if (pending) {
+                    *pending &= ~ev->event;
+                }
+            }
+        }
+        xSemaphoreGiveRecursive(lock);
+    }
+
+    return pdTRUE;
+}
+
 /**
  * Disconnect an event queue from the object.
  * \param[in] obj The object handle
@@ -1379,9 +1687,9 @@ int32_t UAVObjDisconnectQueue(UAVObjHandle obj_handle, xQueueHandle queue)
     PIOS_Assert(obj_handle);
     PIOS_Assert(queue);
     int32_t res;
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    xSemaphoreHandle lock = lockObj(obj_handle);
     res = disconnectObj(obj_handle, queue, 0);
-    xSemaphoreGiveRecursive(mutex);
+    xSemaphoreGiveRecursive(lock);
     return res;
 }
 
@@ -1391,6 +1699,8 @@ int32_t UAVObjDisconnectQueue(UAVObjHandle obj_handle, xQueueHandle queue)
  * \param[in] obj The object handle
  * \param[in] cb The event callback
  * \param[in] eventMask The event mask, if EV_MASK_ALL then all events are enabled (e.g. EV_UPDATED | EV_UPDATED_MANUAL)
+ * \param[in] fast Invoke the callback from the task triggering the event (after the object lock is released)
+ *                 instead of the event task
  * \return 0 if success or -1 if failure
  */
 int32_t UAVObjConnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb,
@@ -1398,9 +1708,9 @@ int32_t UAVObjConnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb,
 {
     PIOS_Assert(obj_handle);
     int32_t res;
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-    res = connectObj(obj_handle, 0, cb, eventMask, fast);
-    xSemaphoreGiveRecursive(mutex);
+    xSemaphoreHandle lock = lockObj(obj_handle);
+    res = connectObj(obj_handle, 0, cb, eventMask, fast, false);
+    xSemaphoreGiveRecursive(lock);
     return res;
 }
 
@@ -1414,9 +1724,9 @@ int32_t UAVObjDisconnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb
 {
     PIOS_Assert(obj_handle);
     int32_t res;
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    xSemaphoreHandle lock = lockObj(obj_handle);
     res = disconnectObj(obj_handle, 0, cb);
-    xSemaphoreGiveRecursive(mutex);
+    xSemaphoreGiveRecursive(lock);
     return res;
 }
 
@@ -1439,9 +1749,12 @@ void UAVObjRequestUpdate(UAVObjHandle obj_handle)
 void UAVObjRequestInstanceUpdate(UAVObjHandle obj_handle, uint16_t instId)
 {
     PIOS_Assert(obj_handle);
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-    sendEvent((struct UAVOBase *)obj_handle, instId, EV_UPDATE_REQ);
-    xSemaphoreGiveRecursive(mutex);
+    struct DeferredCallbacks deferred = { .count = 0 };
+    xSemaphoreHandle lock = lockObj(obj_handle);
+
+    sendEventDeferred((struct UAVOBase *)obj_handle, instId, EV_UPDATE_REQ, &deferred);
+    xSemaphoreGiveRecursive(lock);
+    invokeDeferred(&deferred);
 }
 
 /**
@@ -1461,9 +1774,12 @@ void UAVObjUpdated(UAVObjHandle obj_handle)
 void UAVObjInstanceUpdated(UAVObjHandle obj_handle, uint16_t instId)
 {
     PIOS_Assert(obj_handle);
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-    sendEvent((struct UAVOBase *)obj_handle, instId, EV_UPDATED_MANUAL);
-    xSemaphoreGiveRecursive(mutex);
+    struct DeferredCallbacks deferred = { .count = 0 };
+    xSemaphoreHandle lock = lockObj(obj_handle);
+
+    sendEventDeferred((struct UAVOBase *)obj_handle, instId, EV_UPDATED_MANUAL, &deferred);
+    xSemaphoreGiveRecursive(lock);
+    invokeDeferred(&deferred);
 }
 
 /**
@@ -1474,9 +1790,12 @@ void UAVObjInstanceUpdated(UAVObjHandle obj_handle, uint16_t instId)
 static void instanceAutoUpdated(UAVObjHandle obj_handle, uint16_t instId)
 {
     PIOS_Assert(obj_handle);
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-    sendEvent((struct UAVOBase *)obj_handle, instId, EV_UPDATED);
-    xSemaphoreGiveRecursive(mutex);
+    struct DeferredCallbacks deferred = { .count = 0 };
+    xSemaphoreHandle lock = lockObj(obj_handle);
+
+    sendEventDeferred((struct UAVOBase *)obj_handle, instId, EV_UPDATED, &deferred);
+    xSemaphoreGiveRecursive(lock);
+    invokeDeferred(&deferred);
 }
 
 /*
@@ -1496,9 +1815,12 @@ void UAVObjLogging(UAVObjHandle obj_handle)
 void UAVObjInstanceLogging(UAVObjHandle obj_handle, uint16_t instId)
 {
     PIOS_Assert(obj_handle);
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-    sendEvent((struct UAVOBase *)obj_handle, instId, EV_LOGGING_MANUAL);
-    xSemaphoreGiveRecursive(mutex);
+    struct DeferredCallbacks deferred = { .count = 0 };
+    xSemaphoreHandle lock = lockObj(obj_handle);
+
+    sendEventDeferred((struct UAVOBase *)obj_handle, instId, EV_LOGGING_MANUAL, &deferred);
+    xSemaphoreGiveRecursive(lock);
+    invokeDeferred(&deferred);
 }
 
 /**
@@ -1525,8 +1847,23 @@ xSemaphoreGiveRecursive(mutex);
 
 /**
  * Send a triggered event to all event queues registered on the object.
+ * Fast callbacks are invoked before returning, with the caller's locks held.
  */
 int32_t sendEvent(struct UAVOBase *obj, uint16_t instId, UAVObjEventType triggered_event)
+{
+    struct DeferredCallbacks deferred = { .count = 0 };
+
+    sendEventDeferred(obj, instId, triggered_event, &deferred);
+    invokeDeferred(&deferred);
+    return 0;
+}
+
+/**
+ * Send a triggered event to all event queues registered on the object, called with
+ * the object lock held. Fast callbacks are added to deferred, for the caller to invoke
+ * with invokeDeferred() once it released the lock.
+ */
+static void sendEventDeferred(struct UAVOBase *obj, uint16_t instId, UAVObjEventType triggered_event, struct DeferredCallbacks *deferred)
 {
     /* Set up the message that will be sent to all registered listeners */
     UAVObjEvent msg = {
@@ -1534,8 +1871,15 @@ int32_t sendEvent(struct UAVOBase *obj, uint16_t instId, UAVObjEventType trigger
         .event  = triggered_event,
         .instId = instId,
         .lowPriority = false,
+        .coalesced   = false,
     };
 
+    deferred->msg = msg;
+
+    /* The same message, telling UAVObjQueueReceive() the queue tracks pending events */
+    UAVObjEvent coalescedMsg = msg;
+    coalescedMsg.coalesced = true;
+
     // Go through each object and push the event message in the queue (if event is activated for the queue)
     struct ObjectEventEntry *event;
 
@@ -1543,36 +1887,121 @@ int32_t sendEvent(struct UAVOBase *obj, uint16_t instId, UAVObjEventType trigger
         if (event->eventMask == 0 || (event->eventMask & triggered_event) != 0) {
             // Send to queue if a valid queue is registered
             if (event->queue) {
-                // will not block
-                if (xQueueSend(event->queue, &msg, 0) != pdTRUE) {
-                    ++stats.eventQueueErrors;
+                // Without room to track the instance the event is queued as on a plain queue
+                uint8_t *pending = event->coalesce ? pendingEventsOf(event, instId) : NULL;
+                if (pending && (*pending & triggered_event)) {
+                    // Same event is still waiting in the queue, the listener will pick up the latest data
+                    STATS_INC(eventsCoalesced);
+                } else if (xQueueSend(event->queue, pending ? &coalescedMsg : &msg, 0) != pdTRUE) {
+                    // will not block
+                    STATS_INC(eventQueueErrors);
                     stats.lastQueueErrorID = UAVObjGetID(obj);
+                } else {
+                    STATS_INC(eventsDelivered);
+                    if (pending) {
+                        *pending |= triggered_event;
+                    }
                 }
             }
 
             // Invoke callback (from event task) if a valid one is registered
             if (event->cb) {
                 if (event->fast) {
-                    event->cb(&msg);
+                    if (deferred->count < UAVOBJ_MAX_DEFERRED_CALLBACKS) {
+                        deferred->cb[deferred->count++] = event->cb;
+                    } else if (EventCallbackDispatch(&msg, event->cb) != pdTRUE) {
+                        // No room left, the event task invokes it instead, will not block
+                        STATS_INC(eventCallbackErrors);
+                        stats.lastCallbackErrorID = UAVObjGetID(obj);
+                    }
                 } else if (EventCallbackDispatch(&msg, event->cb) != pdTRUE) {
                     // invoke callback from the event task, will not block
-                    ++stats.eventCallbackErrors;
+                    STATS_INC(eventCallbackErrors);
                     stats.lastCallbackErrorID = UAVObjGetID(obj);
                 }
             }
         }
     }
+}
 
-    return 0;
+/**
+ * Add pending event blocks until the instances 0 to numInstances - 1 have an entry,
+ * called with the object lock held. If memory runs out the missing instances are not tracked.
+ */
+static void pendingEventsReserve(struct ObjectEventEntry *event, uint16_t numInstances)
+{
+    struct PendingEventsBlock **block = &event->pendingEvents;
+    uint32_t size = UAVO_PENDING_EVENTS_BLOCK;
+
+    while (event->pendingSlots < (uint32_t)numInstances + 1) {
+        if (!*block) {
+            *block = (struct PendingEventsBlock *)pios_malloc(sizeof(struct PendingEventsBlock) + size);
+            if (!*block) {
+                return;
+            }
+            (*block)->next = NULL;
+            memset((*block)->events, 0, size);
+            event->pendingSlots += size;
+        }
+        block = &(*block)->next;
+        size *= 2;
+    }
+}
+
+/**
+ * Mark all events of a coalesced queue as no longer pending
+ */
+static void pendingEventsClear(struct ObjectEventEntry *event)
+{
+    struct PendingEventsBlock *block = event->pendingEvents;
+    uint32_t size = UAVO_PENDING_EVENTS_BLOCK;
+
+    for (; block; block = block->next) {
+        memset(block->events, 0, size);
+        size *= 2;
+    }
+}
+
+/**
+ * Pending events of a coalesced queue for one instance, UAVOBJ_ALL_INSTANCES has an entry of its own.
+ * \return the pending event types or NULL if the instance is not tracked
+ */
+static uint8_t *pendingEventsOf(struct ObjectEventEntry *event, uint16_t instId)
+{
+    uint32_t slot = (instId == UAVOBJ_ALL_INSTANCES) ? 0 : (uint32_t)instId + 1;
+
+    if (slot >= event->pendingSlots) {
+        return NULL;
+    }
+
+    struct PendingEventsBlock *block = event->pendingEvents;
+    uint32_t size = UAVO_PENDING_EVENTS_BLOCK;
+    while (slot >= size) {
+        block = block->next;
+        slot -= size;
+        size *= 2;
+    }
+    return &block->events[slot];
+}
+
+/**
+ * Invoke the fast callbacks collected by sendEventDeferred()
+ */
+static void invokeDeferred(struct DeferredCallbacks *deferred)
+{
+    for (uint8_t i = 0; i < deferred->count; i++) {
+        deferred->cb[i](&deferred->msg);
+    }
 }
 
 /**
  * Create a new object instance, return the instance info or NULL if failure.
+ * Any missing instances before instId are created along with it. Called with
+ * the object lock held, the caller fires the EV_UPDATED events of the new
+ * instances once it released it.
  */
 static InstanceHandle createInstance(struct UAVOData *obj, uint16_t instId)
 {
-    struct UAVOMultiInst *instEntry;
-
     /* Don't allow more than one instance for single instance objects */
     if (IsSingleInstance(&(obj->base))) {
         PIOS_Assert(0);
@@ -1589,29 +2018,74 @@ static InstanceHandle createInstance(struct UAVOData *obj, uint16_t instId)
         return NULL;
     }
 
-    // Create any missing instances (all instance IDs must be sequential)
-    for (uint16_t n = UAVObjGetNumInstances(&(obj->base)); n < instId; ++n) {
-        if (createInstance(obj, n) == NULL) {
-            return NULL;
+    struct UAVOMulti *uavo_multi = (struct UAVOMulti *)obj;
+
+    /* Add instance table blocks until instId has a slot, the ones already there stay as they are */
+    struct UAVOInstanceBlock **block = &uavo_multi->blocks;
+    uint16_t base = 0;
+    uint16_t size = UAVO_INSTANCE_TABLE_BLOCK;
+    for (;;) {
+        if (!*block) {
+            *block = (struct UAVOInstanceBlock *)pios_malloc(sizeof(struct UAVOInstanceBlock) + size * sizeof(void *));
+            if (!*block) {
+                return NULL;
+            }
+            (*block)->next = NULL;
+            if (base == 0) {
+                (*block)->instances[0] = uavo_multi->instance0;
+            }
         }
+        if (instId < base + size) {
+            break;
+        }
+        block = &(*block)->next;
+        base += size;
+        size *= 2;
     }
 
-    /* Create the actual instance */
-    uint32_t size = sizeof(struct UAVOMultiInst) + obj->instance_size;
-    instEntry = (struct UAVOMultiInst *)pios_malloc(size);
-    if (!instEntry) {
+    /* Create the actual instance and any missing ones before it (all instance IDs must be sequential) in one go */
+    uint16_t first  = uavo_multi->num_instances;
+    uint16_t count  = instId - first + 1;
+    uint32_t stride = (obj->instance_size + 3) & ~3;
+    uint8_t *data   = (uint8_t *)pios_malloc(count * stride);
+    if (!data) {
         return NULL;
     }
-    memset(instEntry, 0, size);
-    LL_APPEND(((struct UAVOMulti *)obj)->instance0.next, instEntry);
+    memset(data, 0, count * stride);
 
-    ((struct UAVOMulti *)obj)->num_instances++;
+    for (uint16_t n = first; n <= instId; ++n) {
+        *instanceSlot(uavo_multi, n) = data;
+        data += stride;
+        uavo_multi->num_instances++;
+    }
 
-    // Fire event
-    instanceAutoUpdated((UAVObjHandle)obj, instId);
+    /* Coalesced queues track the new instances too */
+    struct ObjectEventEntry *event;
+    LL_FOREACH(obj->base.next_event, event) {
+        if (event->coalesce) {
+            pendingEventsReserve(event, uavo_multi->num_instances);
+        }
+    }
 
     // Done
-    return InstanceDataOffset(instEntry);
+    return *instanceSlot(uavo_multi, instId);
+}
+
+/**
+ * Slot of an instance in the instance table, which must have been grown to hold it
+ */
+static void * *instanceSlot(struct UAVOMulti *uavo_multi, uint16_t instId)
+{
+    struct UAVOInstanceBlock *block = uavo_multi->blocks;
+    uint16_t base = 0;
+    uint16_t size = UAVO_INSTANCE_TABLE_BLOCK;
+
+    while (instId >= base + size) {
+        block = block->next;
+        base += size;
+        size *= 2;
+    }
+    return &block->instances[instId - base];
 }
 
 /**
@@ -1647,17 +2121,69 @@ InstanceHandle getInstance(struct UAVOData *obj, uint16_t instId)
             return NULL;
         }
 
-        // Look for specified instance ID
-        uint16_t instance = 0;
-        struct UAVOMultiInst *instEntry;
-        LL_FOREACH(&(uavo_multi->instance0), instEntry) {
-            if (instance++ == instId) {
-                /* Found it */
-                return &(instEntry->instance);
-            }
+        /* The instance table only exists once there is more than one instance */
+        if (instId == 0) {
+            return uavo_multi->instance0;
         }
-        /* Instance was not found */
-        return NULL;
+        return *instanceSlot(uavo_multi, instId);
+    }
+}
+
+/**
+ * Home slot of an object ID in the index (Fibonacci hashing, object IDs
+ * have their lowest bit clear so the high bits of the product are used)
+ */
+static inline uint16_t indexHash(uint32_t id)
+{
+    return (uint16_t)((id * 2654435761u) >> uavoIndexShift) & uavoIndexMask;
+}
+
+/**
+ * Add a data object to the ID index. Must be called with the mutex held.
+ * Should the index ever fill up, UAVObjGetByID() reverts to scanning the
+ * handle list.
+ */
+static void indexInsert(struct UAVOData *obj)
+{
+    if (!uavoIndex || uavoIndexOverflow) {
+        return;
+    }
+
+    // Always keep one free slot so that lookups terminate
+    if (uavoIndexCount >= uavoIndexMask) {
+        uavoIndexOverflow = true;
+        return;
+    }
+
+    uint16_t slot = indexHash(obj->id);
+    while (uavoIndex[slot] != NULL) {
+        slot = (slot + 1) & uavoIndexMask;
+    }
+
+    // The object is fully initialized before its pointer is published
+    WRITE_MEMORY_BARRIER();
+    uavoIndex[slot] = obj;
+    ++uavoIndexCount;
+}
+
+/**
+ * Find a data object in the ID index, return NULL if not found.
+ * Safe to call without the mutex.
+ */
+static struct UAVOData *indexLookup(uint32_t id)
+{
+    uint16_t slot = indexHash(id);
+
+    for (;;) {
+        struct UAVOData *obj = uavoIndex[slot];
+        READ_MEMORY_BARRIER();
+        if (obj == NULL) {
+            return NULL;
+        }
+        if (obj->id == id) {
+            return obj;
+        }
+        slot = (slot + 1) & uavoIndexMask;
     }
 }
 
@@ -1667,10 +2193,12 @@ InstanceHandle getInstance(struct UAVOData *obj, uint16_t instId)
  * \param[in] queue The event queue
  * \param[in] cb The event callback
  * \param[in] eventMask The event mask, if EV_MASK_ALL then all events are enabled (e.g. EV_UPDATED | EV_UPDATED_MANUAL)
+ * \param[in] fast Invoke the callback directly instead of from the event task
+ * \param[in] coalesce Merge events already pending in the queue
  * \return 0 if success or -1 if failure
  */
 static int32_t connectObj(UAVObjHandle obj_handle, xQueueHandle queue,
-                          UAVObjEventCallback cb, uint8_t eventMask, bool fast)
+                          UAVObjEventCallback cb, uint8_t eventMask, bool fast, bool coalesce)
 {
     struct ObjectEventEntry *event;
     struct UAVOBase *obj;
@@ -1682,6 +2210,13 @@ static int32_t connectObj(UAVObjHandle obj_handle, xQueueHandle queue,
             // Already connected, update event mask and return
             event->eventMask = eventMask;
             event->fast = fast;
+            if (event->coalesce != coalesce) {
+                event->coalesce = coalesce;
+                pendingEventsClear(event);
+            }
+            if (coalesce) {
+                pendingEventsReserve(event, UAVObjGetNumInstances(obj_handle));
+            }
             return 0;
         }
     }
@@ -1695,6 +2230,12 @@ static int32_t connectObj(UAVObjHandle obj_handle, xQueueHandle queue,
     event->cb        = cb;
     event->eventMask = eventMask;
     event->fast      = fast;
+    event->coalesce  = coalesce;
+    event->pendingSlots  = 0;
+    event->pendingEvents = NULL;
+    if (coalesce) {
+        pendingEventsReserve(event, UAVObjGetNumInstances(obj_handle));
+    }
     LL_APPEND(obj->next_event, event);
 
     // Done
@@ -1720,6 +2261,11 @@ static int32_t disconnectObj(UAVObjHandle obj_handle, xQueueHandle queue,
         if ((event->queue == queue
              && event->cb == cb)) {
             LL_DELETE(obj->next_event, event);
+            while (event->pendingEvents) {
+                struct PendingEventsBlock *block = event->pendingEvents;
+                event->pendingEvents = block->next;
+                vPortFree(block);
+            }
             vPortFree(event);
             return 0;
         }
@@ -31,6 +31,8 @@
 
 // Public types
 typedef int32_t (*UAVTalkOutputStream)(uint8_t *data, int32_t length);
+// Returns where to build the next frame, of at most length bytes, or NULL to build it in the connection buffer
+typedef uint8_t *(*UAVTalkOutputReserve)(int32_t length);
 
 typedef struct {
     uint32_t txBytes;
@@ -44,6 +46,9 @@ typedef struct {
     uint32_t rxErrors;
     uint32_t rxSyncErrors;
     uint32_t rxCrcErrors;
+
+    uint32_t txDeltaBytesSaved;
+    uint32_t rxDeltaBytesSaved;
 } UAVTalkStats;
 
 typedef void *UAVTalkConnection;
@@ -54,6 +59,7 @@ typedef enum { UAVTALK_STATE_ERROR = 0, UAVTALK_STATE_SYNC, UAVTALK_STATE_TYPE,
 UAVTalkConnection UAVTalkInitialize(UAVTalkOutputStream outputStream);
 int32_t UAVTalkSetOutputStream(UAVTalkConnection connection, UAVTalkOutputStream outputStream);
 UAVTalkOutputStream UAVTalkGetOutputStream(UAVTalkConnection connection);
+int32_t UAVTalkSetOutputReserve(UAVTalkConnection connection, UAVTalkOutputReserve outputReserve);
 int32_t UAVTalkSendObject(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId, uint8_t acked, int32_t timeoutMs);
 int32_t UAVTalkSendObjectTimestamped(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId, uint8_t acked, int32_t timeoutMs);
 int32_t UAVTalkSendObjectRequest(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId, int32_t timeoutMs);
@@ -64,6 +70,7 @@ int32_t UAVTalkReceiveObject(UAVTalkConnection connectionHandle);
 void UAVTalkGetStats(UAVTalkConnection connection, UAVTalkStats *stats, bool reset);
 void UAVTalkAddStats(UAVTalkConnection connection, UAVTalkStats *stats, bool reset);
 void UAVTalkResetStats(UAVTalkConnection connection);
+void UAVTalkResetCapabilities(UAVTalkConnection connection);
 void UAVTalkGetLastTimestamp(UAVTalkConnection connection, uint16_t *timestamp);
 uint32_t UAVTalkGetPacketObjId(UAVTalkConnection connection);
 
@@ -46,6 +46,28 @@
 #define UAVTALK_MIN_PACKET_LENGTH  UAVTALK_MAX_HEADER_LENGTH + UAVTALK_CHECKSUM_LENGTH
 #define UAVTALK_MAX_PACKET_LENGTH  UAVTALK_MIN_PACKET_LENGTH + UAVTALK_MAX_PAYLOAD_LENGTH
 
+// delta payload : CRC16 of the whole object(2), bitmap with one bit per chunk, changed chunks
+#define UAVTALK_DELTA_CHUNK_SIZE   4
+#define UAVTALK_DELTA_CHUNKS(length)        (((length) + UAVTALK_DELTA_CHUNK_SIZE - 1) / UAVTALK_DELTA_CHUNK_SIZE)
+#define UAVTALK_DELTA_BITMAP_LENGTH(length) ((UAVTALK_DELTA_CHUNKS(length) + 7) / 8)
+#define UAVTALK_DELTA_CHUNK_LENGTH(length, offset) \
+    (((length) - (offset)) < UAVTALK_DELTA_CHUNK_SIZE ? ((length) - (offset)) : UAVTALK_DELTA_CHUNK_SIZE)
+
+// Number of acked objects remembered per connection to delta encode the next update against,
+// decoding does not need any memory so this can stay 0 on targets short of RAM
+#ifndef UAVTALK_DELTA_SLOTS
+#define UAVTALK_DELTA_SLOTS        0
+#endif
+
+typedef enum { UAVTALK_DELTA_EMPTY = 0, UAVTALK_DELTA_PENDING, UAVTALK_DELTA_ACKED } UAVTalkDeltaState;
+
+typedef struct {
+    uint32_t objId;
+    uint16_t instId;
+    uint8_t  state;
+    uint8_t  *data;
+} UAVTalkDeltaRef;
+
 typedef struct {
     uint8_t  type;
     uint16_t packet_size;
@@ -63,6 +85,7 @@ typedef struct {
 typedef struct {
     uint8_t canari;
     UAVTalkOutputStream outStream;
+    UAVTalkOutputReserve outReserve;
     xSemaphoreHandle    lock;
     xSemaphoreHandle    transLock;
     xSemaphoreHandle    respSema;
@@ -73,6 +96,11 @@ typedef struct {
     UAVTalkInputProcessor iproc;
     uint8_t      *rxBuffer;
     uint8_t      *txBuffer;
+    uint16_t     peerCaps;
+#if UAVTALK_DELTA_SLOTS > 0
+    UAVTalkDeltaRef deltaRefs[UAVTALK_DELTA_SLOTS];
+    uint8_t      deltaNext;
+#endif
 } UAVTalkConnectionData;
 
 #define UAVTALK_CANARI          0xCA
@@ -86,9 +114,17 @@ typedef struct {
 #define UAVTALK_TYPE_OBJ_ACK    (UAVTALK_TYPE_VER | 0x02)
 #define UAVTALK_TYPE_ACK        (UAVTALK_TYPE_VER | 0x03)
 #define UAVTALK_TYPE_NACK       (UAVTALK_TYPE_VER | 0x04)
+#define UAVTALK_TYPE_OBJ_ACK_DELTA (UAVTALK_TYPE_VER | 0x05)
 #define UAVTALK_TYPE_OBJ_TS     (UAVTALK_TIMESTAMPED | UAVTALK_TYPE_OBJ)
 #define UAVTALK_TYPE_OBJ_ACK_TS (UAVTALK_TIMESTAMPED | UAVTALK_TYPE_OBJ_ACK)
 
+// Optional protocol features are negotiated with an OBJ_REQ for this object ID carrying the
+// sender's feature bits as instance ID, the peer answers with an ACK carrying its own bits.
+// Older peers do not know the object and NACK the request.
+#define UAVTALK_CAPS_OBJID      0x55415654
+#define UAVTALK_CAPS_DELTA      0x0001
+#define UAVTALK_CAPS            UAVTALK_CAPS_DELTA
+
 // macros
 #define CHECKCONHANDLE(handle, variable, failcommand) \
     variable = (UAVTalkConnectionData *)handle; \
@@ -53,6 +53,11 @@ static int32_t sendObject(UAVTalkConnectionData *connection, uint8_t type, uint3
 static int32_t sendSingleObject(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId, UAVObjHandle obj);
 static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId, uint8_t *data);
 static void updateAck(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId);
+static int32_t unpackDelta(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, const uint8_t *data, int32_t deltaLength);
+#if UAVTALK_DELTA_SLOTS > 0
+static int32_t packDelta(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId, uint8_t *data, int32_t length);
+static UAVTalkDeltaRef *findDeltaRef(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId, bool create);
+#endif
 // UavTalk Process FSM functions
 static bool UAVTalkProcess_SYNC(UAVTalkConnectionData *connection, UAVTalkInputProcessor *iproc, uint8_t *rxbuffer, uint8_t length, uint8_t *position);
 static bool UAVTalkProcess_TYPE(UAVTalkConnectionData *connection, UAVTalkInputProcessor *iproc, uint8_t *rxbuffer, uint8_t length, uint8_t *position);
@@ -81,6 +86,7 @@ UAVTalkConnection UAVTalkInitialize(UAVTalkOutputStream outputStream)
     connection->iproc.rxPacketLength = 0;
     connection->iproc.state = UAVTALK_STATE_SYNC;
     connection->outStream   = outputStream;
+    connection->outReserve  = NULL;
     connection->lock = xSemaphoreCreateRecursiveMutex();
     connection->transLock   = xSemaphoreCreateRecursiveMutex();
     // allocate buffers
@@ -92,6 +98,11 @@ UAVTalkConnection UAVTalkInitialize(UAVTalkOutputStream outputStream)
     if (!connection->txBuffer) {
         return 0;
     }
+    connection->peerCaps = 0;
+#if UAVTALK_DELTA_SLOTS > 0
+    memset(connection->deltaRefs, 0, sizeof(connection->deltaRefs));
+    connection->deltaNext = 0;
+#endif
     vSemaphoreCreateBinary(connection->respSema);
     xSemaphoreTake(connection->respSema, 0); // reset to zero
     UAVTalkResetStats((UAVTalkConnection)connection);
@@ -136,6 +147,32 @@ UAVTalkOutputStream UAVTalkGetOutputStream(UAVTalkConnection connectionHandle)
     return connection->outStream;
 }
 
+/**
+ * Set where object frames are built before they go to the output stream.
+ * Without it, or when it returns NULL, frames are built in the connection buffer.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] outputReserve Function pointer that is called for room for each frame, or NULL
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkSetOutputReserve(UAVTalkConnection connectionHandle, UAVTalkOutputReserve outputReserve)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    // Lock
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+
+    // set output reserve
+    connection->outReserve = outputReserve;
+
+    // Release lock
+    xSemaphoreGiveRecursive(connection->lock);
+
+    return 0;
+}
+
 /**
  * Get communication statistics counters
  * \param[in] connection UAVTalkConnection to be used
@@ -187,6 +224,8 @@ void UAVTalkAddStats(UAVTalkConnection connectionHandle, UAVTalkStats *statsOut,
     statsOut->rxErrors      += connection->stats.rxErrors;
     statsOut->rxSyncErrors  += connection->stats.rxSyncErrors;
     statsOut->rxCrcErrors   += connection->stats.rxCrcErrors;
+    statsOut->txDeltaBytesSaved += connection->stats.txDeltaBytesSaved;
+    statsOut->rxDeltaBytesSaved += connection->stats.rxDeltaBytesSaved;
 
     if (reset) {
         // Clear stats
@@ -217,6 +256,31 @@ void UAVTalkResetStats(UAVTalkConnection connectionHandle)
     xSemaphoreGiveRecursive(connection->lock);
 }
 
+/**
+ * Forget the optional features negotiated with the peer, along with the delta references.
+ * To be called when the link is lost, the next peer negotiates again.
+ * \param[in] connection UAVTalkConnection to be used
+ */
+void UAVTalkResetCapabilities(UAVTalkConnection connectionHandle)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return );
+
+    // Lock
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+
+    connection->peerCaps = 0;
+#if UAVTALK_DELTA_SLOTS > 0
+    for (uint8_t n = 0; n < UAVTALK_DELTA_SLOTS; ++n) {
+        connection->deltaRefs[n].state = UAVTALK_DELTA_EMPTY;
+    }
+#endif
+
+    // Release lock
+    xSemaphoreGiveRecursive(connection->lock);
+}
+
 /**
  * Accessor method to get the timestamp from the last UAVTalk message
  */
@@ -650,7 +714,26 @@ static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, ui
         }
         break;
 
+    case UAVTALK_TYPE_OBJ_ACK_DELTA:
+        UAVT_DEBUGLOG_CPRINTF(objId, "OBJ_ACK_DELTA %X %d", objId, instId);
+        // The instance must exist, the delta is applied to its current data
+        if (obj && (instId != UAVOBJ_ALL_INSTANCES) && unpackDelta(connection, obj, instId, data, connection->iproc.length) == 0) {
+            sendObject(connection, UAVTALK_TYPE_ACK, objId, instId, NULL);
+        } else {
+            // Our copy differs from the one the sender encoded against, it will resend the whole object
+            UAVT_DEBUGLOG_PRINTF("OBJ DELTA NACK %X %d", objId, instId);
+            sendObject(connection, UAVTALK_TYPE_NACK, objId, instId, NULL);
+            ret = -1;
+        }
+        break;
+
     case UAVTALK_TYPE_OBJ_REQ:
+        if (objId == UAVTALK_CAPS_OBJID) {
+            // Capability probe, remember what the peer supports and answer with ours
+            connection->peerCaps = instId;
+            ret = sendObject(connection, UAVTALK_TYPE_ACK, objId, UAVTALK_CAPS, NULL);
+            break;
+        }
         // Check if requested object exists
         UAVT_DEBUGLOG_CPRINTF(objId, "REQ %X %d", objId, instId);
         if (obj) {
@@ -668,6 +751,15 @@ static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, ui
         break;
 
     case UAVTALK_TYPE_NACK:
+#if UAVTALK_DELTA_SLOTS > 0
+        {
+            // The peer could not apply a delta, send the whole object next time
+            UAVTalkDeltaRef *ref = findDeltaRef(connection, objId, instId, false);
+            if (ref) {
+                ref->state = UAVTALK_DELTA_EMPTY;
+            }
+        }
+#endif
         // Do nothing on flight side, let it time out.
         // TODO:
         // The transaction takes the result code of the "semaphore taking operation" into account to determine success.
@@ -679,8 +771,20 @@ static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, ui
         break;
 
     case UAVTALK_TYPE_ACK:
+        if (objId == UAVTALK_CAPS_OBJID) {
+            // Answer to a capability probe
+            connection->peerCaps = instId;
+            break;
+        }
         // All instances not allowed for ACK messages
         if (obj && (instId != UAVOBJ_ALL_INSTANCES)) {
+#if UAVTALK_DELTA_SLOTS > 0
+            // The peer now holds the copy last sent, use it as reference for the next delta
+            UAVTalkDeltaRef *ref = findDeltaRef(connection, objId, instId, false);
+            if (ref && ref->state == UAVTALK_DELTA_PENDING) {
+                ref->state = UAVTALK_DELTA_ACKED;
+            }
+#endif
             // Check if an ACK is pending
             updateAck(connection, type, objId, instId);
         } else {
@@ -789,28 +893,7 @@ static int32_t sendSingleObject(UAVTalkConnectionData *connection, uint8_t type,
         return -1;
     }
 
-    // Setup sync byte
-    connection->txBuffer[0] = UAVTALK_SYNC_VAL;
-    // Setup type
-    connection->txBuffer[1] = type;
-    // next 2 bytes are reserved for data length (inserted here later)
-    // Setup object ID
-    connection->txBuffer[4] = (uint8_t)(objId & 0xFF);
-    connection->txBuffer[5] = (uint8_t)((objId >> 8) & 0xFF);
-    connection->txBuffer[6] = (uint8_t)((objId >> 16) & 0xFF);
-    connection->txBuffer[7] = (uint8_t)((objId >> 24) & 0xFF);
-    // Setup instance ID
-    connection->txBuffer[8] = (uint8_t)(instId & 0xFF);
-    connection->txBuffer[9] = (uint8_t)((instId >> 8) & 0xFF);
-    int32_t headerLength = 10;
-
-    // Add timestamp when the transaction type is appropriate
-    if (type & UAVTALK_TIMESTAMPED) {
-        portTickType time = xTaskGetTickCount();
-        connection->txBuffer[10] = (uint8_t)(time & 0xFF);
-        connection->txBuffer[11] = (uint8_t)((time >> 8) & 0xFF);
-        headerLength += 2;
-    }
+    int32_t headerLength = (type & UAVTALK_TIMESTAMPED) ? 12 : 10;
 
     // Determine data length
     int32_t length;
@@ -826,30 +909,74 @@ static int32_t sendSingleObject(UAVTalkConnectionData *connection, uint8_t type,
         return -1;
     }
 
+    // Build the frame where the output stream takes it from, if it says so
+    uint8_t *txBuffer = NULL;
+    if (connection->outReserve) {
+        txBuffer = (*connection->outReserve)(headerLength + length + UAVTALK_CHECKSUM_LENGTH);
+    }
+    if (!txBuffer) {
+        txBuffer = connection->txBuffer;
+    }
+
+    // Setup sync byte
+    txBuffer[0] = UAVTALK_SYNC_VAL;
+    // Setup type
+    txBuffer[1] = type;
+    // next 2 bytes are reserved for data length (inserted here later)
+    // Setup object ID
+    txBuffer[4] = (uint8_t)(objId & 0xFF);
+    txBuffer[5] = (uint8_t)((objId >> 8) & 0xFF);
+    txBuffer[6] = (uint8_t)((objId >> 16) & 0xFF);
+    txBuffer[7] = (uint8_t)((objId >> 24) & 0xFF);
+    // Setup instance ID
+    txBuffer[8] = (uint8_t)(instId & 0xFF);
+    txBuffer[9] = (uint8_t)((instId >> 8) & 0xFF);
+
+    // Add timestamp when the transaction type is appropriate
+    if (type & UAVTALK_TIMESTAMPED) {
+        portTickType time = xTaskGetTickCount();
+        txBuffer[10] = (uint8_t)(time & 0xFF);
+        txBuffer[11] = (uint8_t)((time >> 8) & 0xFF);
+    }
+
     // Copy data (if any)
     if (length > 0) {
-        if (UAVObjPack(obj, instId, &connection->txBuffer[headerLength]) == -1) {
+        if (UAVObjPack(obj, instId, &txBuffer[headerLength]) == -1) {
             connection->stats.txErrors++;
             return -1;
         }
     }
 
+    // Only send the changes if the peer acked a previous copy of the object
+    int32_t saved = 0;
+#if UAVTALK_DELTA_SLOTS > 0
+    if (type == UAVTALK_TYPE_OBJ_ACK && length > 0 && (connection->peerCaps & UAVTALK_CAPS_DELTA)) {
+        int32_t deltaLength = packDelta(connection, objId, instId, &txBuffer[headerLength], length);
+        if (deltaLength > 0) {
+            txBuffer[1] = UAVTALK_TYPE_OBJ_ACK_DELTA;
+            saved  = length - deltaLength;
+            length = deltaLength;
+        }
+    }
+#endif
+
     // Store the packet length
-    connection->txBuffer[2] = (uint8_t)((headerLength + length) & 0xFF);
-    connection->txBuffer[3] = (uint8_t)(((headerLength + length) >> 8) & 0xFF);
+    txBuffer[2] = (uint8_t)((headerLength + length) & 0xFF);
+    txBuffer[3] = (uint8_t)(((headerLength + length) >> 8) & 0xFF);
 
     // Calculate and store checksum
-    connection->txBuffer[headerLength + length] = PIOS_CRC_updateCRC(0, connection->txBuffer, headerLength + length);
+    txBuffer[headerLength + length] = PIOS_CRC_updateCRC(0, txBuffer, headerLength + length);
 
     // Send object
     uint16_t tx_msg_len = headerLength + length + UAVTALK_CHECKSUM_LENGTH;
-    int32_t rc = (*connection->outStream)(connection->txBuffer, tx_msg_len);
+    int32_t rc = (*connection->outStream)(txBuffer, tx_msg_len);
 
     // Update stats
     if (rc == tx_msg_len) {
         ++connection->stats.txObjects;
         connection->stats.txObjectBytes += length;
         connection->stats.txBytes += tx_msg_len;
+        connection->stats.txDeltaBytesSaved += saved;
     } else {
         connection->stats.txErrors++;
         // TODO rc == -1 connection not open, -2 buffer full should retry
@@ -861,6 +988,155 @@ static int32_t sendSingleObject(UAVTalkConnectionData *connection, uint8_t type,
     return 0;
 }
 
+/**
+ * Apply a delta encoded update to the current data of an object instance.
+ * The delta must produce the copy the sender encoded it from, checked with the CRC16 it carries.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object to update
+ * \param[in] instId The instance ID, the instance must exist
+ * \param[in] data Delta payload
+ * \param[in] deltaLength Length of the delta payload
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t unpackDelta(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, const uint8_t *data, int32_t deltaLength)
+{
+    int32_t length = UAVObjGetNumBytes(obj);
+    int32_t bitmapLength = UAVTALK_DELTA_BITMAP_LENGTH(length);
+
+    if (deltaLength < 2 + bitmapLength || length > UAVOBJECTS_LARGEST) {
+        return -1;
+    }
+
+    // The transmit buffer is free while the connection is locked, use it to rebuild the object
+    uint8_t *buffer = connection->txBuffer;
+    if (UAVObjPack(obj, instId, buffer) == -1) {
+        return -1;
+    }
+
+    const uint8_t *bitmap = &data[2];
+    const uint8_t *in     = &data[2 + bitmapLength];
+    const uint8_t *end    = &data[deltaLength];
+    for (int32_t chunk = 0, offset = 0; offset < length; ++chunk, offset += UAVTALK_DELTA_CHUNK_SIZE) {
+        if (bitmap[chunk / 8] & (1 << (chunk % 8))) {
+            int32_t size = UAVTALK_DELTA_CHUNK_LENGTH(length, offset);
+            if (in + size > end) {
+                return -1;
+            }
+            memcpy(&buffer[offset], in, size);
+            in += size;
+        }
+    }
+    if (in != end) {
+        return -1;
+    }
+
+    uint16_t crc = data[0] | (data[1] << 8);
+    if (PIOS_CRC16_updateCRC(0, buffer, length) != crc) {
+        return -1;
+    }
+
+    if (UAVObjUnpack(obj, instId, buffer) == -1) {
+        return -1;
+    }
+    connection->stats.rxDeltaBytesSaved += length - deltaLength;
+    return 0;
+}
+
+#if UAVTALK_DELTA_SLOTS > 0
+/**
+ * Replace packed object data by its delta against the copy the peer last acked.
+ * The packed data always becomes the new reference, pending until the peer acks it.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] objId The object ID
+ * \param[in] instId The instance ID
+ * \param[in,out] data Packed object data, replaced by the delta payload on success
+ * \param[in] length Length of the packed object data
+ * \return Length of the delta payload or -1 if the whole object has to be sent
+ */
+static int32_t packDelta(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId, uint8_t *data, int32_t length)
+{
+    UAVTalkDeltaRef *ref = findDeltaRef(connection, objId, instId, true);
+
+    if (!ref) {
+        return -1;
+    }
+
+    bool haveBase = (ref->state == UAVTALK_DELTA_ACKED);
+    uint8_t bitmap[UAVTALK_DELTA_BITMAP_LENGTH(UAVOBJECTS_LARGEST)];
+    int32_t bitmapLength = UAVTALK_DELTA_BITMAP_LENGTH(length);
+    int32_t deltaLength  = 2 + bitmapLength;
+
+    if (haveBase) {
+        memset(bitmap, 0, bitmapLength);
+        for (int32_t chunk = 0, offset = 0; offset < length; ++chunk, offset += UAVTALK_DELTA_CHUNK_SIZE) {
+            int32_t size = UAVTALK_DELTA_CHUNK_LENGTH(length, offset);
+            if (memcmp(&ref->data[offset], &data[offset], size) != 0) {
+                bitmap[chunk / 8] |= 1 << (chunk % 8);
+                deltaLength += size;
+            }
+        }
+    }
+
+    memcpy(ref->data, data, length);
+    ref->state = UAVTALK_DELTA_PENDING;
+
+    if (!haveBase || deltaLength >= length) {
+        return -1;
+    }
+
+    // Changed chunks are taken from the reference, which now holds the new data
+    uint16_t crc = PIOS_CRC16_updateCRC(0, ref->data, length);
+    uint8_t *out = &data[2 + bitmapLength];
+    for (int32_t chunk = 0, offset = 0; offset < length; ++chunk, offset += UAVTALK_DELTA_CHUNK_SIZE) {
+        if (bitmap[chunk / 8] & (1 << (chunk % 8))) {
+            int32_t size = UAVTALK_DELTA_CHUNK_LENGTH(length, offset);
+            memcpy(out, &ref->data[offset], size);
+            out += size;
+        }
+    }
+    data[0] = (uint8_t)(crc & 0xFF);
+    data[1] = (uint8_t)((crc >> 8) & 0xFF);
+    memcpy(&data[2], bitmap, bitmapLength);
+
+    return deltaLength;
+}
+
+/**
+ * Find the delta reference of an object instance, optionally recycling the oldest slot for it.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] objId The object ID
+ * \param[in] instId The instance ID
+ * \param[in] create Take a slot if the instance has none
+ * \return The reference or NULL
+ */
+static UAVTalkDeltaRef *findDeltaRef(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId, bool create)
+{
+    for (uint8_t n = 0; n < UAVTALK_DELTA_SLOTS; ++n) {
+        UAVTalkDeltaRef *ref = &connection->deltaRefs[n];
+        if (ref->data && ref->objId == objId && ref->instId == instId) {
+            return ref;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+
+    UAVTalkDeltaRef *ref = &connection->deltaRefs[connection->deltaNext];
+    if (!ref->data) {
+        ref->data = pios_malloc(UAVOBJECTS_LARGEST);
+        if (!ref->data) {
+            return NULL;
+        }
+    }
+    connection->deltaNext = (connection->deltaNext + 1) % UAVTALK_DELTA_SLOTS;
+    ref->objId  = objId;
+    ref->instId = instId;
+    ref->state  = UAVTALK_DELTA_EMPTY;
+    return ref;
+}
+#endif /* if UAVTALK_DELTA_SLOTS > 0 */
+
 /*
  * Functions that implements the UAVTalk Process FSM. return false to break out of current cycle
  */
@@ -973,7 +1249,7 @@ static bool UAVTalkProcess_INSTID(UAVTalkConnectionData *connection, UAVTalkInpu
         iproc->timestampLength = 0;
     } else {
         iproc->timestampLength = (iproc->type & UAVTALK_TIMESTAMPED) ? 2 : 0;
-        if (obj) {
+        if (obj && iproc->type != UAVTALK_TYPE_OBJ_ACK_DELTA) {
             iproc->length = UAVObjGetNumBytes(obj);
         } else {
             iproc->length = iproc->packet_size - iproc->rxPacketLength - iproc->timestampLength;
@@ -15,3 +15,13 @@ SUBDIRS = \
 osg {
     SUBDIRS += osgearth
 }
+
+# Unit tests, built along with debug builds like the rest of WITH_TESTS (see gcs.pri)
+# and run by make check
+isEmpty(TEST):CONFIG(debug, debug|release) {
+    TEST = 1
+}
+equals(TEST, 1) {
+    SUBDIRS += utils/test \
+        opmapcontrol/src/test
+}
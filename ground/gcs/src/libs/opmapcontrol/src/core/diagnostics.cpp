@@ -26,5 +26,7 @@
  */
 #include "diagnostics.h"
 
-diagnostics::diagnostics() : networkerrors(0), emptytiles(0), timeouts(0), runningThreads(0), tilesFromMem(0), tilesFromNet(0), tilesFromDB(0)
+diagnostics::diagnostics() : networkerrors(0), emptytiles(0), timeouts(0), runningThreads(0), tilesFromMem(0), tilesFromNet(0), tilesFromDB(0),
+    memoryHits(0), memoryMisses(0), memoryEvictions(0), imagesReused(0), tilesInMemory(0), memoryUsed(0),
+    prefetchQueued(0), tilesPrefetched(0), prefetchHits(0)
 {}
@@ -36,9 +36,20 @@ struct diagnostics {
     int     tilesFromMem;
     int     tilesFromNet;
     int     tilesFromDB;
+    int     memoryHits;
+    int     memoryMisses;
+    int     memoryEvictions;
+    int     imagesReused;
+    int     tilesInMemory;
+    int     memoryUsed; // kB
+    int     prefetchQueued;
+    int     tilesPrefetched;
+    int     prefetchHits;
     QString toString()
     {
-        return QString("Network errors:%1\nEmpty Tiles:%2\nTimeOuts:%3\nRunningThreads:%4\nTilesFromMem:%5\nTilesFromNet:%6\nTilesFromDB:%7").arg(networkerrors).arg(emptytiles).arg(timeouts).arg(runningThreads).arg(tilesFromMem).arg(tilesFromNet).arg(tilesFromDB);
+        return QString("Network errors:%1\nEmpty Tiles:%2\nTimeOuts:%3\nRunningThreads:%4\nTilesFromMem:%5\nTilesFromNet:%6\nTilesFromDB:%7").arg(networkerrors).arg(emptytiles).arg(timeouts).arg(runningThreads).arg(tilesFromMem).arg(tilesFromNet).arg(tilesFromDB)
+               + QString("\nMemoryHits:%1\nMemoryMisses:%2\nMemoryEvictions:%3\nImagesReused:%4\nTilesInMemory:%5\nMemoryUsed:%6kB").arg(memoryHits).arg(memoryMisses).arg(memoryEvictions).arg(imagesReused).arg(tilesInMemory).arg(memoryUsed)
+               + QString("\nPrefetchQueued:%1\nTilesPrefetched:%2\nPrefetchHits:%3").arg(prefetchQueued).arg(tilesPrefetched).arg(prefetchHits);
 
         ;
     }
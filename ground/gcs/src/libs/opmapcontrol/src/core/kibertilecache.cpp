@@ -26,43 +26,172 @@
  */
 #include "kibertilecache.h"
 
-// TODO add readwrite lock
-
 namespace core {
-KiberTileCache::KiberTileCache()
+KiberTileCache::KiberTileCache() : memoryCacheSize(0), hits(0), misses(0), evictions(0), imagesReused(0), prefetchHits(0), head(0), tail(0)
 {
-    memoryCacheSize = 0;
-    _MemoryCacheCapacity = 22;
+    // Same 22MB default as before the decoded images were kept
+    capacity = 22 * 1048576L;
+}
+KiberTileCache::~KiberTileCache()
+{
+    Clear();
 }
 
 void KiberTileCache::setMemoryCacheCapacity(const int &value)
 {
-    kiberCacheLock.lockForWrite();
-    _MemoryCacheCapacity = value;
-    kiberCacheLock.unlock();
+    mutex.lock();
+    capacity = value * 1048576L;
+    removeOverload();
+    mutex.unlock();
 }
 int KiberTileCache::MemoryCacheCapacity()
 {
-    kiberCacheLock.lockForRead();
-    return _MemoryCacheCapacity;
+    QMutexLocker locker(&mutex);
 
-    kiberCacheLock.unlock();
+    return capacity / 1048576L;
 }
 
 void KiberTileCache::RemoveMemoryOverload()
 {
-    while (MemoryCacheSize() > MemoryCacheCapacity()) {
-        if (cachequeue.count() > 0 && list.count() > 0) {
+    mutex.lock();
+    removeOverload();
+    mutex.unlock();
+}
+
+QByteArray KiberTileCache::Data(const RawTile &tile)
+{
+    QMutexLocker locker(&mutex);
+    Entry *entry = entries.value(tile);
+
+    if (!entry) {
+        ++misses;
+        return QByteArray();
+    }
+    ++hits;
+    if (entry->prefetched) {
+        entry->prefetched = false;
+        ++prefetchHits;
+    }
+    unlink(entry);
+    pushFront(entry);
+    return entry->data;
+}
+QImage KiberTileCache::Image(const RawTile &tile)
+{
+    QMutexLocker locker(&mutex);
+    Entry *entry = entries.value(tile);
+
+    if (!entry || entry->image.isNull()) {
+        return QImage();
+    }
+    ++imagesReused;
+    unlink(entry);
+    pushFront(entry);
+    return entry->image;
+}
+bool KiberTileCache::Contains(const RawTile &tile)
+{
+    QMutexLocker locker(&mutex);
+
+    return entries.contains(tile);
+}
+void KiberTileCache::Insert(const RawTile &tile, const QByteArray &data, bool prefetched)
+{
+    QMutexLocker locker(&mutex);
+    Entry *entry = entries.value(tile);
+
+    if (entry) {
+        memoryCacheSize -= entry->cost();
+        unlink(entry);
+    } else {
+        entry = new Entry(tile);
+        entries.insert(tile, entry);
+    }
+    entry->data  = data;
+    // The image decoded from the previous data is stale
+    entry->image = QImage();
+    entry->prefetched = prefetched;
+    memoryCacheSize += entry->cost();
+    pushFront(entry);
 #ifdef DEBUG_MEMORY_CACHE
-            qDebug() << "Cleaning Memory cache=" << " started with " << cachequeue.count() << " tile " << "ocupying " << memoryCacheSize << " bytes";
+    qDebug() << "Current memory=" << memoryCacheSize << " in " << entries.count() << " tiles";
 #endif
-            RawTile first = list.dequeue();
-            memoryCacheSize -= cachequeue.value(first).size();
-            cachequeue.remove(first);
-        }
+    removeOverload();
+}
+void KiberTileCache::SetImage(const RawTile &tile, const QImage &image)
+{
+    QMutexLocker locker(&mutex);
+    Entry *entry = entries.value(tile);
+
+    // Only tiles still in the cache keep their image
+    if (entry) {
+        memoryCacheSize -= entry->cost();
+        entry->image     = image;
+        memoryCacheSize += entry->cost();
+        removeOverload();
     }
+}
+void KiberTileCache::Clear()
+{
+    QMutexLocker locker(&mutex);
+
+    qDeleteAll(entries);
+    entries.clear();
+    head = tail = 0;
+    memoryCacheSize = 0;
+}
+void KiberTileCache::GetDiagnostics(diagnostics &diag)
+{
+    QMutexLocker locker(&mutex);
+
+    diag.memoryHits      = hits;
+    diag.memoryMisses    = misses;
+    diag.memoryEvictions = evictions;
+    diag.imagesReused    = imagesReused;
+    diag.prefetchHits    = prefetchHits;
+    diag.tilesInMemory   = entries.count();
+    diag.memoryUsed      = memoryCacheSize / 1024;
+}
+
+void KiberTileCache::unlink(Entry *entry)
+{
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        head = entry->next;
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        tail = entry->prev;
+    }
+    entry->prev = entry->next = 0;
+}
+void KiberTileCache::pushFront(Entry *entry)
+{
+    entry->next = head;
+    if (head) {
+        head->prev = entry;
+    }
+    head = entry;
+    if (!tail) {
+        tail = entry;
+    }
+}
+// Must be called with mutex held
+void KiberTileCache::removeOverload()
+{
+    // The most recent tile stays even if it alone is over the budget
+    while (memoryCacheSize > capacity && tail && tail != head) {
+        Entry *last = tail;
 #ifdef DEBUG_MEMORY_CACHE
-    qDebug() << "Cleaning Memory cache=" << " ended with " << cachequeue.count() << " tile " << "ocupying " << memoryCacheSize << " bytes";
+        qDebug() << "Cleaning Memory cache=" << " evicting " << last->cost() << " bytes";
 #endif
+        unlink(last);
+        entries.remove(last->tile);
+        memoryCacheSize -= last->cost();
+        ++evictions;
+        delete last;
+    }
 }
 }
@@ -29,14 +29,21 @@
 
 #include "rawtile.h"
 #include <QMutex>
-#include <QReadWriteLock>
-#include <QQueue>
+#include <QHash>
+#include <QImage>
 #include <QDebug>
 #include "debugheader.h"
+#include "diagnostics.h"
 namespace core {
+/**
+ * Least recently used tile cache with a budget in bytes.
+ * Holds the tile as received and, once someone asked for it, the decoded image,
+ * both count against the budget. All methods are thread safe.
+ */
 class KiberTileCache {
 public:
     KiberTileCache();
+    ~KiberTileCache();
 
     void setMemoryCacheCapacity(const int &value);
     int MemoryCacheCapacity();
@@ -45,12 +52,47 @@ public:
         return memoryCacheSize / 1048576.0;
     }
     void RemoveMemoryOverload();
-    QReadWriteLock kiberCacheLock;
-    QHash <RawTile, QByteArray> cachequeue;
-    QQueue <RawTile> list;
+
+    QByteArray Data(const RawTile &tile);
+    QImage Image(const RawTile &tile);
+    bool Contains(const RawTile &tile);
+    // Prefetched tiles are counted as prefetch hits the first time Data() finds them
+    void Insert(const RawTile &tile, const QByteArray &data, bool prefetched = false);
+    void SetImage(const RawTile &tile, const QImage &image);
+    void Clear();
+    // Adds the cache counters to diag
+    void GetDiagnostics(diagnostics &diag);
+
     long memoryCacheSize;
 private:
-    int _MemoryCacheCapacity;
+    struct Entry {
+        Entry(const RawTile &tile) : tile(tile), prefetched(false), prev(0), next(0) {}
+        long cost() const
+        {
+            return data.size() + image.byteCount();
+        }
+        RawTile tile;
+        QByteArray data;
+        QImage image;
+        bool prefetched;
+        Entry *prev;
+        Entry *next;
+    };
+    void unlink(Entry *entry);
+    void pushFront(Entry *entry);
+    void removeOverload();
+
+    QMutex mutex;
+    int hits;
+    int misses;
+    int evictions;
+    int imagesReused;
+    int prefetchHits;
+    QHash<RawTile, Entry *> entries;
+    // Most recently used first
+    Entry *head;
+    Entry *tail;
+    long capacity;
 };
 }
 #endif // KIBERTILECACHE_H
@@ -29,8 +29,7 @@
 
 #include "rawtile.h"
 #include <QMutex>
-#include <QReadWriteLock>
-#include <QQueue>
+#include <QImage>
 #include "kibertilecache.h"
 #include <QDebug>
 #include "debugheader.h"
@@ -42,7 +41,8 @@ public:
     KiberTileCache TilesInMemory;
     QByteArray GetTileFromMemoryCache(const RawTile &tile);
     void AddTileToMemoryCache(const RawTile &tile, const QByteArray &pic);
-    QReadWriteLock kiberCacheLock;
+    // Decodes pic, or returns the image decoded from it before
+    QImage GetImageFromMemoryCache(const RawTile &tile, const QByteArray &pic);
 };
 }
 #endif // MEMORYCACHE_H
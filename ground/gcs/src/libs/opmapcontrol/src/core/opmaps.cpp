@@ -243,6 +243,36 @@ QByteArray OPMaps::GetImageFrom(const MapType::Types &type, const Point &pos, co
     return ret;
 }
 
+QImage OPMaps::DecodeImage(const MapType::Types &type, const Point &pos, const int &zoom, const QByteArray &img)
+{
+    if (useMemoryCache) {
+        return GetImageFromMemoryCache(RawTile(type, pos, zoom), img);
+    }
+    return QImage::fromData(img).convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
+
+bool OPMaps::PrefetchImage(const MapType::Types &type, const Point &pos, const int &zoom)
+{
+    if (!useMemoryCache || accessmode == AccessMode::ServerOnly) {
+        return false;
+    }
+    RawTile tile(type, pos, zoom);
+    if (TilesInMemory.Contains(tile)) {
+        return false;
+    }
+    QByteArray img = Cache::Instance()->ImageCache.GetImageFromCache(type, pos, zoom);
+    if (img.isEmpty()) {
+        return false;
+    }
+    // Only the compressed tile, a whole ring of decoded images would crowd the visible ones out.
+    // Core::run() decodes it once the tile comes into view
+    TilesInMemory.Insert(tile, img, true);
+    errorvars.lock();
+    ++diag.tilesPrefetched;
+    errorvars.unlock();
+    return true;
+}
+
 bool OPMaps::ExportToGMDB(const QString &file)
 {
     return Cache::Instance()->ImageCache.ExportMapDataToDB(Cache::Instance()->ImageCache.GtileCache() + QDir::separator() + "Data.qmdb", file);
@@ -259,6 +289,7 @@ diagnostics OPMaps::GetDiagnostics()
     errorvars.lock();
     i = diag;
     errorvars.unlock();
+    TilesInMemory.GetDiagnostics(i);
     return i;
 }
 }
@@ -57,6 +57,9 @@ public: ~OPMaps();
 
 
     QByteArray GetImageFrom(const MapType::Types &type, const core::Point &pos, const int &zoom);
+    QImage DecodeImage(const MapType::Types &type, const core::Point &pos, const int &zoom, const QByteArray &img);
+    // Moves a tile from the database to the memory cache ahead of use, never goes to the server
+    bool PrefetchImage(const MapType::Types &type, const core::Point &pos, const int &zoom);
     bool UseMemoryCache()
     {
         return useMemoryCache;
@@ -101,6 +101,14 @@ bool PureImageCache::CreateEmptyDB(const QString &file)
     if (query.numRowsAffected() == -1) {
 #ifdef DEBUG_PUREIMAGECACHE
         qDebug() << "CreateEmptyDB: " << query.lastError().driverText();
+#endif // DEBUG_PUREIMAGECACHE
+        db.close();
+        return false;
+    }
+    query.exec("CREATE INDEX IF NOT EXISTS IndexOfTiles ON Tiles (X, Y, Zoom, Type)");
+    if (query.numRowsAffected() == -1) {
+#ifdef DEBUG_PUREIMAGECACHE
+        qDebug() << "CreateEmptyDB: " << query.lastError().driverText();
 #endif // DEBUG_PUREIMAGECACHE
         db.close();
         return false;
@@ -158,6 +166,87 @@ bool PureImageCache::CreateEmptyDB(const QString &file)
     QSqlDatabase::removeDatabase(QLatin1String("CreateConn"));
     return true;
 }
+PureImageCache::Connection::Connection(const QString &name, const QString &file) :
+    name(name), file(file), select(0), insertTile(0), insertData(0)
+{
+    QSqlDatabase cn = QSqlDatabase::addDatabase("QSQLITE", name);
+
+    cn.setDatabaseName(file);
+    // Readers only wait for the short exclusive lock taken when a batch commits
+    cn.setConnectOptions("QSQLITE_BUSY_TIMEOUT=2000");
+    if (!cn.open()) {
+#ifdef DEBUG_PUREIMAGECACHE
+        qDebug() << "Connection: Unable to open" << file << cn.lastError().driverText();
+#endif // DEBUG_PUREIMAGECACHE
+        return;
+    }
+    {
+        // Caches created before the index existed get it on first use
+        QSqlQuery query(cn);
+        query.exec("CREATE INDEX IF NOT EXISTS IndexOfTiles ON Tiles (X, Y, Zoom, Type)");
+    }
+    select     = new QSqlQuery(cn);
+    select->setForwardOnly(true);
+    select->prepare("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=? AND Y=? AND Zoom=? AND Type=?)");
+    insertTile = new QSqlQuery(cn);
+    insertTile->prepare("INSERT INTO Tiles(X, Y, Zoom, Type,Date) VALUES(?, ?, ?, ?,?)");
+    insertData = new QSqlQuery(cn);
+    insertData->prepare("INSERT INTO TilesData(id, Tile) VALUES((SELECT last_insert_rowid()), ?)");
+}
+PureImageCache::Connection::~Connection()
+{
+    // The queries have to be gone before the connection can be removed
+    delete select;
+    delete insertTile;
+    delete insertData;
+    {
+        QSqlDatabase cn = database();
+        cn.close();
+    }
+    QSqlDatabase::removeDatabase(name);
+}
+QSqlDatabase PureImageCache::Connection::database() const
+{
+    return QSqlDatabase::database(name, false);
+}
+bool PureImageCache::Connection::insert(const QByteArray &tile, const MapType::Types &type, const Point &pos, const int &zoom)
+{
+    insertTile->addBindValue(pos.X());
+    insertTile->addBindValue(pos.Y());
+    insertTile->addBindValue(zoom);
+    insertTile->addBindValue((int)type);
+    insertTile->addBindValue(QDateTime::currentDateTime().toString());
+    if (!insertTile->exec()) {
+#ifdef DEBUG_PUREIMAGECACHE
+        qDebug() << "insert: " << insertTile->lastError().driverText();
+#endif // DEBUG_PUREIMAGECACHE
+        return false;
+    }
+    insertData->addBindValue(tile);
+    if (!insertData->exec()) {
+#ifdef DEBUG_PUREIMAGECACHE
+        qDebug() << "insert: " << insertData->lastError().driverText();
+#endif // DEBUG_PUREIMAGECACHE
+        return false;
+    }
+    return true;
+}
+// Must be called with lock held
+PureImageCache::Connection *PureImageCache::connection()
+{
+    QString db     = gtilecache + "Data.qmdb";
+    Connection *cn = connections.localData();
+
+    if (!cn || cn->file != db) {
+        Mcounter.lock();
+        qlonglong id = ++ConnCounter;
+        Mcounter.unlock();
+        // The connection this thread had before, if any, is deleted here
+        cn = new Connection(QString("PureImageCache%1").arg(id), db);
+        connections.setLocalData(cn);
+    }
+    return cn->isOpen() ? cn : 0;
+}
 bool PureImageCache::PutImageToCache(const QByteArray &tile, const MapType::Types &type, const Point &pos, const int &zoom)
 {
     if (gtilecache.isEmpty() | gtilecache.isNull()) {
@@ -167,78 +256,65 @@ bool PureImageCache::PutImageToCache(const QByteArray &tile, const MapType::Type
 #ifdef DEBUG_PUREIMAGECACHE
     qDebug() << "PutImageToCache Start:"; // <<pos;
 #endif // DEBUG_PUREIMAGECACHE
-    Mcounter.lock();
-    qlonglong id = ++ConnCounter;
-    Mcounter.unlock();
-    {
-        QSqlDatabase cn;
-        cn = QSqlDatabase::addDatabase("QSQLITE", QString::number(id));
-        QString db = gtilecache + "Data.qmdb";
-        cn.setDatabaseName(db);
-        cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-        if (cn.open()) {
-            {
-                QSqlQuery query(cn);
-                query.prepare("INSERT INTO Tiles(X, Y, Zoom, Type,Date) VALUES(?, ?, ?, ?,?)");
-                query.addBindValue(pos.X());
-                query.addBindValue(pos.Y());
-                query.addBindValue(zoom);
+    Connection *cn = connection();
+    if (cn) {
+        cn->insert(tile, type, pos, zoom);
+    }
+    lock.unlock();
+    return true;
+}
+int PureImageCache::PutImagesToCache(const QList<CacheItemQueue *> &tiles)
+{
+    int count = 0;
 
-                query.addBindValue((int)type);
-                query.addBindValue(QDateTime::currentDateTime().toString());
-                query.exec();
-            }
-            {
-                QSqlQuery query(cn);
-                query.prepare("INSERT INTO TilesData(id, Tile) VALUES((SELECT last_insert_rowid()), ?)");
-                query.addBindValue(tile);
-                query.exec();
+    if (gtilecache.isEmpty() | gtilecache.isNull()) {
+        return count;
+    }
+    lock.lockForRead();
+    Connection *cn = connection();
+    if (cn) {
+        QSqlDatabase db = cn->database();
+        bool transaction = db.transaction();
+        foreach(CacheItemQueue * task, tiles) {
+            if (cn->insert(task->GetImg(), task->GetMapType(), task->GetPosition(), task->GetZoom())) {
+                ++count;
             }
-            cn.close();
+        }
+        if (transaction && !db.commit()) {
+#ifdef DEBUG_PUREIMAGECACHE
+            qDebug() << "PutImagesToCache: " << db.lastError().driverText();
+#endif // DEBUG_PUREIMAGECACHE
+            db.rollback();
+            count = 0;
         }
     }
-    QSqlDatabase::removeDatabase(QString::number(id));
     lock.unlock();
-    return true;
+    return count;
 }
 QByteArray PureImageCache::GetImageFromCache(MapType::Types type, Point pos, int zoom)
 {
-    lock.lockForRead();
     QByteArray ar;
+
     if (gtilecache.isEmpty() | gtilecache.isNull()) {
         return ar;
     }
-    QString dir  = gtilecache;
-    Mcounter.lock();
-    qlonglong id = ++ConnCounter;
-    Mcounter.unlock();
+    lock.lockForRead();
 #ifdef DEBUG_PUREIMAGECACHE
-    qDebug() << "Cache dir=" << dir << " Try to GET:" << pos.X() + "," + pos.Y();
+    qDebug() << "Cache dir=" << gtilecache << " Try to GET:" << pos.X() + "," + pos.Y();
 #endif // DEBUG_PUREIMAGECACHE
-
-    {
-        QString db = dir + "Data.qmdb";
-        {
-            QSqlDatabase cn;
-
-            cn = QSqlDatabase::addDatabase("QSQLITE", QString::number(id));
-
-            cn.setDatabaseName(db);
-            cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-            if (cn.open()) {
-                {
-                    QSqlQuery query(cn);
-                    query.exec(QString("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=%1 AND Y=%2 AND Zoom=%3 AND Type=%4)").arg(pos.X()).arg(pos.Y()).arg(zoom).arg((int)type));
-                    query.next();
-                    if (query.isValid()) {
-                        ar = query.value(0).toByteArray();
-                    }
-                }
-                cn.close();
-            }
+    Connection *cn = connection();
+    if (cn) {
+        QSqlQuery *query = cn->select;
+        query->addBindValue(pos.X());
+        query->addBindValue(pos.Y());
+        query->addBindValue(zoom);
+        query->addBindValue((int)type);
+        if (query->exec() && query->next()) {
+            ar = query->value(0).toByteArray();
         }
+        // Release the read lock so the cache queue can commit
+        query->finish();
     }
-    QSqlDatabase::removeDatabase(QString::number(id));
     lock.unlock();
     return ar;
 }
@@ -247,39 +323,37 @@ void PureImageCache::deleteOlderTiles(int const & days)
     if (gtilecache.isEmpty() | gtilecache.isNull()) {
         return;
     }
+    // Nothing to delete, and opening a connection would create the database
+    if (!QFileInfo(gtilecache + "Data.qmdb").exists()) {
+        return;
+    }
     QList<long> add;
-    bool ret    = true;
-    QString dir = gtilecache;
-    {
-        QString db = dir + "Data.qmdb";
-        ret = QFileInfo(db).exists();
-        if (ret) {
-            QSqlDatabase cn;
-            Mcounter.lock();
-            qlonglong id = ++ConnCounter;
-            Mcounter.unlock();
-            cn = QSqlDatabase::addDatabase("QSQLITE", QString::number(id));
-            cn.setDatabaseName(db);
-            cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-            if (cn.open()) {
-                {
-                    QSqlQuery query(cn);
-                    query.exec(QString("SELECT id, X, Y, Zoom, Type, Date FROM Tiles"));
-                    while (query.next()) {
-                        if (QDateTime::fromString(query.value(5).toString()).daysTo(QDateTime::currentDateTime()) > days) {
-                            add.append(query.value(0).toLongLong());
-                        }
-                    }
-                    foreach(long i, add) {
-                        query.exec(QString("DELETE FROM Tiles WHERE id = %1;").arg(i));
-                    }
+    lock.lockForRead();
+    Connection *cn = connection();
+    if (cn) {
+        QSqlDatabase db = cn->database();
+        {
+            QSqlQuery query(db);
+            query.setForwardOnly(true);
+            query.exec(QString("SELECT id, Date FROM Tiles"));
+            while (query.next()) {
+                if (QDateTime::fromString(query.value(1).toString()).daysTo(QDateTime::currentDateTime()) > days) {
+                    add.append(query.value(0).toLongLong());
                 }
-
-                cn.close();
             }
-            QSqlDatabase::removeDatabase(QString::number(id));
+        }
+        {
+            QSqlQuery query(db);
+            query.prepare("DELETE FROM Tiles WHERE id = ?");
+            db.transaction();
+            foreach(long i, add) {
+                query.addBindValue((qlonglong)i);
+                query.exec();
+            }
+            db.commit();
         }
     }
+    lock.unlock();
 }
 // PureImageCache::ExportMapDataToDB("C:/Users/Xapo/Documents/mapcontrol/debug/mapscache/data.qmdb","C:/Users/Xapo/Documents/mapcontrol/debug/mapscache/data2.qmdb");
 bool PureImageCache::ExportMapDataToDB(QString sourceFile, QString destFile)
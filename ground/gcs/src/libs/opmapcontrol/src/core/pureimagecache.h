@@ -42,18 +42,42 @@
 #include <QList>
 #include <QMutex>
 #include <QReadWriteLock>
+#include <QThreadStorage>
+#include "cacheitemqueue.h"
 namespace core {
 class PureImageCache {
 public:
     PureImageCache();
     static bool CreateEmptyDB(const QString &file);
     bool PutImageToCache(const QByteArray &tile, const MapType::Types &type, const core::Point &pos, const int &zoom);
+    // Stores all tiles in a single transaction, returns the number stored
+    int PutImagesToCache(const QList<CacheItemQueue *> &tiles);
     QByteArray GetImageFromCache(MapType::Types type, core::Point pos, int zoom);
     QString GtileCache();
     void setGtileCache(const QString &value);
     static bool ExportMapDataToDB(QString sourceFile, QString destFile);
     void deleteOlderTiles(int const & days);
 private:
+    // One open database per thread, with its statements prepared once
+    class Connection {
+    public:
+        Connection(const QString &name, const QString &file);
+        ~Connection();
+        bool isOpen() const
+        {
+            return select != 0;
+        }
+        QSqlDatabase database() const;
+        bool insert(const QByteArray &tile, const MapType::Types &type, const core::Point &pos, const int &zoom);
+
+        QString name;
+        QString file;
+        QSqlQuery *select;
+        QSqlQuery *insertTile;
+        QSqlQuery *insertData;
+    };
+    Connection *connection();
+    QThreadStorage<Connection *> connections;
     QString gtilecache;
     QMutex Mcounter;
     QReadWriteLock lock;
@@ -29,6 +29,9 @@
 
 // #define DEBUG_TILECACHEQUEUE
 
+// Largest number of tiles written in one transaction, bounds how long readers can be kept waiting
+#define TILECACHEQUEUE_BATCH 64
+
 namespace core {
 TileCacheQueue::TileCacheQueue()
 {}
@@ -71,20 +74,23 @@ void TileCacheQueue::run()
     qDebug() << "Cache Engine Start";
 #endif // DEBUG_TILECACHEQUEUE
     while (true) {
-        CacheItemQueue *task;
 #ifdef DEBUG_TILECACHEQUEUE
         qDebug() << "Cache";
 #endif // DEBUG_TILECACHEQUEUE
         if (tileCacheQueue.count() > 0) {
+            // Queued tiles go to the database in batches, one transaction each
+            QList<CacheItemQueue *> tasks;
             mutex.lock();
-            task = tileCacheQueue.dequeue();
+            while (tileCacheQueue.count() > 0 && tasks.count() < TILECACHEQUEUE_BATCH) {
+                tasks.append(tileCacheQueue.dequeue());
+            }
             mutex.unlock();
 #ifdef DEBUG_TILECACHEQUEUE
-            qDebug() << "Cache engine Put:" << task->GetPosition().X() << "," << task->GetPosition().Y();
+            qDebug() << "Cache engine Put:" << tasks.count() << "tiles";
 #endif // DEBUG_TILECACHEQUEUE
-            Cache::Instance()->ImageCache.PutImageToCache(task->GetImg(), task->GetMapType(), task->GetPosition(), task->GetZoom());
+            Cache::Instance()->ImageCache.PutImagesToCache(tasks);
+            qDeleteAll(tasks);
             usleep(44);
-            delete task;
         } else {
 #ifdef DEBUG_TILECACHEQUEUE
             qDebug() << "Cache engine BEGIN WAIT";
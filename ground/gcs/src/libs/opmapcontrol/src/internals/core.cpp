@@ -32,9 +32,19 @@ qlonglong internals::Core::debugcounter = 0;
 
 using namespace projections;
 
+// How far ahead of the map center tiles are prefetched, in seconds of travel and at most in tiles
+#define PREFETCH_LOOKAHEAD 10.0
+#define PREFETCH_MAX_AHEAD 3
+// Bounds the work queued by one UpdateBounds()
+#define PREFETCH_MAX_TASKS 256
+// Below the visible tiles, which are started with the default priority 0
+#define PREFETCH_PRIORITY  -1
+// Threads of ProcessLoadTaskCallback serving the prefetch queue at most
+#define PREFETCH_LOADERS   2
+
 namespace internals {
 Core::Core() : MouseWheelZooming(false), currentPosition(0, 0), currentPositionPixel(0, 0), LastLocationInBounds(-1, -1), sizeOfMapArea(0, 0)
-    , minOfTiles(0, 0), maxOfTiles(0, 0), zoom(0), isDragging(false), TooltipTextPadding(10, 10), loaderLimit(5), maxzoom(21), runningThreads(0), started(false)
+    , minOfTiles(0, 0), maxOfTiles(0, 0), prefetchQueued(0), prefetchLoaders(0), prefetchNorth(0), prefetchEast(0), zoom(0), isDragging(false), TooltipTextPadding(10, 10), loaderLimit(5), maxzoom(21), runningThreads(0), started(false)
 {
     mousewheelzoomtype = MouseWheelZoomType::MousePositionAndCenter;
     SetProjection(new MercatorProjection());
@@ -48,6 +58,9 @@ Core::Core() : MouseWheelZooming(false), currentPosition(0, 0), currentPositionP
 }
 Core::~Core()
 {
+    MtileLoadQueue.lock();
+    prefetchQueue.clear();
+    MtileLoadQueue.unlock();
     ProcessLoadTaskCallback.waitForDone();
 }
 
@@ -120,9 +133,11 @@ void Core::run()
 #endif // DEBUG_CORE
 
                                 if (img.length() != 0) {
+                                    // Decoded here once instead of on every repaint
+                                    QImage image = OPMaps::Instance()->DecodeImage(tl, task.Pos, task.Zoom, img);
                                     Moverlays.lock();
-                                    {
-                                        t->Overlays.append(img);
+                                    if (!image.isNull()) {
+                                        t->Overlays.append(image);
 #ifdef DEBUG_CORE
                                         qDebug() << "Core::run append img:" << img.length() << " to tile:" << t->GetPos().ToString() << " now has " << t->Overlays.count() << " overlays" << " ID=" << debug;
 #endif // DEBUG_CORE
@@ -168,10 +183,6 @@ void Core::run()
                 {
                     // last buddy cleans stuff ;}
                     if (last) {
-                        OPMaps::Instance()->kiberCacheLock.lockForWrite();
-                        OPMaps::Instance()->TilesInMemory.RemoveMemoryOverload();
-                        OPMaps::Instance()->kiberCacheLock.unlock();
-
                         MtileDrawingList.lock();
                         {
                             Matrix.ClearPointsNotIn(tileDrawingList);
@@ -193,16 +204,55 @@ void Core::run()
             loaderLimit.release();
         }
     }
+    MtileLoadQueue.lock();
+    StartPrefetchLoaders();
+    MtileLoadQueue.unlock();
     MrunningThreads.lock();
     --runningThreads;
     MrunningThreads.unlock();
 }
+// Must be called with MtileLoadQueue held
+void Core::StartPrefetchLoaders()
+{
+    // Visible tiles first, run() calls this again once they are all taken
+    if (!tileLoadQueue.isEmpty()) {
+        return;
+    }
+    while (prefetchLoaders < PREFETCH_LOADERS && prefetchLoaders < prefetchQueue.count()) {
+        ++prefetchLoaders;
+        ProcessLoadTaskCallback.start(new PrefetchLoader(this), PREFETCH_PRIORITY);
+    }
+}
+void Core::RunPrefetch()
+{
+    forever {
+        LoadTask task;
+
+        MtileLoadQueue.lock();
+        // Stops as soon as the queue is cleared or a visible tile is waiting
+        if (prefetchQueue.isEmpty() || !tileLoadQueue.isEmpty()) {
+            --prefetchLoaders;
+            MtileLoadQueue.unlock();
+            return;
+        }
+        task = prefetchQueue.dequeue();
+        MtileLoadQueue.unlock();
+
+        // Only warms the memory cache, the tile matrix is filled when the tile comes into view
+        foreach(MapType::Types tl, OPMaps::Instance()->GetAllLayersOfType(GetMapType())) {
+            OPMaps::Instance()->PrefetchImage(tl, task.Pos, task.Zoom);
+        }
+    }
+}
 diagnostics Core::GetDiagnostics()
 {
     MrunningThreads.lock();
     diag = OPMaps::Instance()->GetDiagnostics();
     diag.runningThreads = runningThreads;
     MrunningThreads.unlock();
+    MtileLoadQueue.lock();
+    diag.prefetchQueued = prefetchQueued;
+    MtileLoadQueue.unlock();
     return diag;
 }
 
@@ -216,6 +266,7 @@ void Core::SetZoom(const int &value)
         if (started) {
             MtileLoadQueue.lock();
             tileLoadQueue.clear();
+            prefetchQueue.clear();
             MtileLoadQueue.unlock();
             MtileToload.lock();
             tilesToload = 0;
@@ -418,6 +469,7 @@ void Core::ReloadMap()
         MtileLoadQueue.lock();
         {
             tileLoadQueue.clear();
+            prefetchQueue.clear();
         }
         MtileLoadQueue.unlock();
         MtileToload.lock();
@@ -510,6 +562,10 @@ void Core::Drag(Point const & pt)
 void Core::CancelAsyncTasks()
 {
     if (started) {
+        // The prefetch loaders return after their current tile
+        MtileLoadQueue.lock();
+        prefetchQueue.clear();
+        MtileLoadQueue.unlock();
         ProcessLoadTaskCallback.waitForDone();
         MtileLoadQueue.lock();
         {
@@ -555,10 +611,84 @@ void Core::UpdateBounds()
                 MtileLoadQueue.unlock();
             }
         }
+        UpdatePrefetch();
     }
     MtileDrawingList.unlock();
     UpdateGroundResolution();
 }
+// Must be called with MtileDrawingList held
+void Core::UpdatePrefetch()
+{
+    QList<LoadTask> tasks;
+
+    FindTilesAhead(tasks);
+
+    MtileLoadQueue.lock();
+    {
+        // What was predicted for the previous center is stale
+        prefetchQueue.clear();
+        foreach(LoadTask task, tasks) {
+            if (prefetchQueue.count() >= PREFETCH_MAX_TASKS) {
+                break;
+            }
+            if (!tileLoadQueue.contains(task) && !prefetchQueue.contains(task)) {
+                prefetchQueue.enqueue(task);
+                ++prefetchQueued;
+            }
+        }
+        StartPrefetchLoaders();
+    }
+    MtileLoadQueue.unlock();
+}
+void Core::FindTilesAhead(QList<LoadTask> &list)
+{
+    list.clear();
+
+    // Where the center will be after PREFETCH_LOOKAHEAD seconds, in tiles
+    int dx = 0;
+    int dy = 0;
+    if (prefetchNorth != 0 || prefetchEast != 0) {
+        double rez = Projection()->GetGroundResolution(Zoom(), CurrentPosition().Lat());
+        double tileWidth  = Projection()->TileSize().Width() * rez;
+        double tileHeight = Projection()->TileSize().Height() * rez;
+        dx = qBound(-PREFETCH_MAX_AHEAD, qRound(prefetchEast * PREFETCH_LOOKAHEAD / tileWidth), PREFETCH_MAX_AHEAD);
+        dy = qBound(-PREFETCH_MAX_AHEAD, qRound(-prefetchNorth * PREFETCH_LOOKAHEAD / tileHeight), PREFETCH_MAX_AHEAD);
+    }
+
+    // The ring around the view, stretched towards where the map is heading
+    for (int i = qMin(dx, 0) - sizeOfMapArea.Width() - 1; i <= qMax(dx, 0) + sizeOfMapArea.Width() + 1; i++) {
+        for (int j = qMin(dy, 0) - sizeOfMapArea.Height() - 1; j <= qMax(dy, 0) + sizeOfMapArea.Height() + 1; j++) {
+            Point p(centerTileXYLocation.X() + i, centerTileXYLocation.Y() + j);
+            if (p.X() >= minOfTiles.Width() && p.Y() >= minOfTiles.Height() && p.X() <= maxOfTiles.Width() && p.Y() <= maxOfTiles.Height()) {
+                if (!tileDrawingList.contains(p)) {
+                    list.append(LoadTask(p, Zoom()));
+                }
+            }
+        }
+    }
+
+    // The view one zoom level out and the middle of it one level in
+    if (Zoom() > 0) {
+        FindTilesAt(Zoom() - 1, Point(centerTileXYLocation.X() / 2, centerTileXYLocation.Y() / 2), sizeOfMapArea.Width() / 2 + 1, sizeOfMapArea.Height() / 2 + 1, list);
+    }
+    if (Zoom() < MaxZoom()) {
+        FindTilesAt(Zoom() + 1, Point(centerTileXYLocation.X() * 2, centerTileXYLocation.Y() * 2), sizeOfMapArea.Width(), sizeOfMapArea.Height(), list);
+    }
+}
+void Core::FindTilesAt(int const & zoom, Point const & center, int const & width, int const & height, QList<LoadTask> &list)
+{
+    Size minTiles = Projection()->GetTileMatrixMinXY(zoom);
+    Size maxTiles = Projection()->GetTileMatrixMaxXY(zoom);
+
+    for (int i = -width; i <= width; i++) {
+        for (int j = -height; j <= height; j++) {
+            Point p(center.X() + i, center.Y() + j);
+            if (p.X() >= minTiles.Width() && p.Y() >= minTiles.Height() && p.X() <= maxTiles.Width() && p.Y() <= maxTiles.Height()) {
+                list.append(LoadTask(p, zoom));
+            }
+        }
+    }
+}
 void Core::FindTilesAround(QList<Point> &list)
 {
     list.clear();;
@@ -292,6 +292,15 @@ public:
 
     void FindTilesAround(QList<core::Point> &list);
 
+    /**
+     * @brief Velocity the map center is following, in m/s, used to prefetch tiles ahead of it
+     */
+    void SetPrefetchVelocity(double const & north, double const & east)
+    {
+        prefetchNorth = north;
+        prefetchEast  = east;
+    }
+
     void UpdateGroundResolution();
 
     TileMatrix Matrix;
@@ -343,6 +352,28 @@ private:
 
     QQueue<LoadTask> tileLoadQueue;
 
+    // Served by at most PREFETCH_LOADERS PrefetchLoader, only while tileLoadQueue is empty
+    QQueue<LoadTask> prefetchQueue;
+    int prefetchQueued;
+    int prefetchLoaders;
+    class PrefetchLoader : public QRunnable {
+public:
+        PrefetchLoader(Core *core) : core(core) {}
+        void run()
+        {
+            core->RunPrefetch();
+        }
+private:
+        Core *core;
+    };
+    void StartPrefetchLoaders();
+    void RunPrefetch();
+    double prefetchNorth;
+    double prefetchEast;
+    void UpdatePrefetch();
+    void FindTilesAhead(QList<LoadTask> &list);
+    void FindTilesAt(int const & zoom, core::Point const & center, int const & width, int const & height, QList<LoadTask> &list);
+
     int zoom;
 
     PureProjection *projection;
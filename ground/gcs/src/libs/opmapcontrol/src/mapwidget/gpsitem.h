@@ -34,12 +34,12 @@
 #include "mapgraphicitem.h"
 #include "waypointitem.h"
 #include <QObject>
+#include <QPointer>
 #include "uavmapfollowtype.h"
 #include "uavtrailtype.h"
 #include <QtSvg/QSvgRenderer>
 #include "opmapwidget.h"
-#include "trailitem.h"
-#include "traillineitem.h"
+#include "trailpathitem.h"
 namespace mapcontrol {
 class WayPointItem;
 class OPMapWidget;
@@ -242,9 +242,7 @@ private:
     QPixmap pic;
     core::Point localposition;
     OPMapWidget *mapwidget;
-    QGraphicsItemGroup *trail;
-    QGraphicsItemGroup *trailLine;
-    internals::PointLatLng lasttrailline;
+    QPointer<TrailPathItem> trail;
     QTime timer;
     bool showtrail;
     bool showtrailline;
@@ -261,8 +259,6 @@ public slots:
 signals:
     void UAVReachedWayPoint(int const & waypointnumber, WayPointItem *waypoint);
     void UAVLeftSafetyBouble(internals::PointLatLng const & position);
-    void setChildPosition();
-    void setChildLine();
 };
 }
 #endif // GPSITEM_H
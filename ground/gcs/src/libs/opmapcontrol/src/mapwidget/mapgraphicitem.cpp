@@ -317,13 +317,13 @@ void MapGraphicItem::DrawMap2D(QPainter *painter)
                         // render tile
                         // lock(t.Overlays)
                         if (t != 0) {
-                            foreach(QByteArray img, t->Overlays) {
-                                if (img.count() != 0) {
+                            foreach(QImage img, t->Overlays) {
+                                if (!img.isNull()) {
                                     if (!found) {
                                         found = true;
                                     }
                                     {
-                                        painter->drawPixmap(core->tileRect.X(), core->tileRect.Y(), core->tileRect.Width(), core->tileRect.Height(), PureImageProxy::FromStream(img));
+                                        painter->drawImage(QRect(core->tileRect.X(), core->tileRect.Y(), core->tileRect.Width(), core->tileRect.Height()), img);
                                     }
                                 }
                             }
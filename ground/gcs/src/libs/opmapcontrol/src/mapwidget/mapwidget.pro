@@ -10,12 +10,11 @@ SOURCES += mapgraphicitem.cpp \
     waypointitem.cpp \
     uavitem.cpp \
     gpsitem.cpp \
-    trailitem.cpp \
+    trailpathitem.cpp \
     homeitem.cpp \
     navitem.cpp \
     mapripform.cpp \
     mapripper.cpp \
-    traillineitem.cpp \
     waypointline.cpp \
     waypointcircle.cpp
 
@@ -38,12 +37,11 @@ HEADERS += mapgraphicitem.h \
     gpsitem.h \
     uavmapfollowtype.h \
     uavtrailtype.h \
-    trailitem.h \
+    trailpathitem.h \
     homeitem.h \
     navitem.h \
     mapripform.h \
     mapripper.h \
-    traillineitem.h \
     waypointline.h \
     waypointcircle.h
 QT += opengl
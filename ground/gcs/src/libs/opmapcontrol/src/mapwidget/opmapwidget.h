@@ -326,6 +326,17 @@ public:
         map->core->SetCurrentPosition(value);
     }
 
+    /**
+     * @brief Sets the velocity the map center is moving with, tiles ahead of it are loaded early
+     *
+     * @param north velocity in m/s
+     * @param east velocity in m/s
+     */
+    void SetPrefetchVelocity(double const & north, double const & east)
+    {
+        map->core->SetPrefetchVelocity(north, east);
+    }
+
     double ZoomReal()
     {
         return map->Zoom();
@@ -0,0 +1,247 @@
+/**
+ ******************************************************************************
+ *
+ * @file       trailpathitem.cpp
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      A graphicsItem representing a whole vehicle trail
+ * @see        The GNU Public License (GPL) Version 3
+ * @defgroup   OPMapWidget
+ * @{
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include "trailpathitem.h"
+#include <QDateTime>
+#include <QGraphicsSceneHoverEvent>
+#include <QPair>
+#include <math.h>
+
+#define TRAIL_EARTH_RADIUS        6378137.0
+// How close the mouse has to be to a point to show its tooltip, in pixels
+#define TRAIL_TOOLTIP_DISTANCE    4
+
+namespace mapcontrol {
+TrailPathItem::TrailPathItem(QColor pointColor, QColor lineColor, MapGraphicItem *map, int capacity) : QGraphicsItem(map),
+    ring(qMax(capacity, (int)MinCapacity)), first(0), count(0), simplified(0), showPoints(true), showLine(true), m_map(map)
+{
+    pointPen.setColor(pointColor);
+    pointPen.setWidth(4);
+    pointPen.setCapStyle(Qt::RoundCap);
+    linePen.setColor(lineColor);
+    linePen.setWidth(1);
+    setAcceptHoverEvents(true);
+    connect(map, SIGNAL(childRefreshPosition()), this, SLOT(RefreshPos()));
+}
+
+void TrailPathItem::AddPoint(internals::PointLatLng const & coord, int const & altitude)
+{
+    if (count == ring.size()) {
+        simplify();
+    }
+    if (count == ring.size()) {
+        first = (first + 1) % ring.size();
+        --count;
+        simplified = qMax(simplified - 1, 0);
+        local.remove(0);
+    }
+
+    TrailPoint &p = at(count);
+    p.coord    = coord;
+    p.altitude = altitude;
+    p.time     = QDateTime::currentMSecsSinceEpoch();
+    ++count;
+
+    QPolygonF points(local);
+    core::Point pos = m_map->FromLatLngToLocal(coord);
+    points.append(QPointF(pos.X(), pos.Y()));
+    setLocal(points);
+
+    if (count - simplified >= FreshPoints + SimplifyBatch) {
+        simplify();
+    }
+}
+
+void TrailPathItem::Clear()
+{
+    first      = 0;
+    count      = 0;
+    simplified = 0;
+    setLocal(QPolygonF());
+}
+
+void TrailPathItem::SetShowPoints(bool const & value)
+{
+    showPoints = value;
+    update();
+}
+
+void TrailPathItem::SetShowLine(bool const & value)
+{
+    showLine = value;
+    update();
+}
+
+void TrailPathItem::simplify()
+{
+    // Overlap the previous batch by one point so the two join up
+    int start = qMax(simplified - 1, 0);
+    int last  = count - 1 - FreshPoints;
+    int n     = last - start + 1;
+
+    if (n < 3) {
+        return;
+    }
+
+    // Flat projection around the first point, good enough for the length of a batch
+    double lat0 = at(start).coord.Lat();
+    double lng0 = at(start).coord.Lng();
+    double ky   = TRAIL_EARTH_RADIUS * M_PI / 180.0;
+    double kx   = ky * cos(lat0 * M_PI / 180.0);
+    QVector<QPointF> xy(n);
+    for (int i = 0; i < n; i++) {
+        const TrailPoint &p = at(start + i);
+        xy[i] = QPointF((p.coord.Lng() - lng0) * kx, (p.coord.Lat() - lat0) * ky);
+    }
+
+    // Douglas-Peucker, with an explicit stack as batches can be long
+    QVector<bool> keep(n, false);
+    QVector<QPair<int, int> > stack;
+    keep[0]     = true;
+    keep[n - 1] = true;
+    stack.append(qMakePair(0, n - 1));
+    while (!stack.isEmpty()) {
+        QPair<int, int> span = stack.takeLast();
+        QPointF a   = xy[span.first];
+        QPointF ab  = xy[span.second] - a;
+        double len2 = ab.x() * ab.x() + ab.y() * ab.y();
+        double maxDist = 0;
+        int index = -1;
+        for (int i = span.first + 1; i < span.second; i++) {
+            QPointF ap = xy[i] - a;
+            double t   = len2 > 0 ? qBound(0.0, (ap.x() * ab.x() + ap.y() * ab.y()) / len2, 1.0) : 0.0;
+            QPointF d  = ap - t * ab;
+            double dist = d.x() * d.x() + d.y() * d.y();
+            if (dist > maxDist) {
+                maxDist = dist;
+                index   = i;
+            }
+        }
+        if (index >= 0 && maxDist > SimplifyTolerance * SimplifyTolerance) {
+            keep[index] = true;
+            stack.append(qMakePair(span.first, index));
+            stack.append(qMakePair(index, span.second));
+        }
+    }
+
+    // Compact the kept points in place and move the fresh ones down behind them
+    int out = start;
+    for (int i = 0; i < n; i++) {
+        if (keep[i]) {
+            at(out++) = at(start + i);
+        }
+    }
+    int end = out;
+    for (int i = last + 1; i < count; i++) {
+        at(out++) = at(i);
+    }
+    count      = out;
+    simplified = end;
+
+    QPolygonF points;
+    points.reserve(count);
+    for (int i = 0; i < count; i++) {
+        core::Point pos = m_map->FromLatLngToLocal(at(i).coord);
+        points.append(QPointF(pos.X(), pos.Y()));
+    }
+    setLocal(points);
+}
+
+void TrailPathItem::setLocal(QPolygonF const & points)
+{
+    prepareGeometryChange();
+    local  = points;
+    // Leave room for the dots
+    bounds = local.boundingRect().adjusted(-3, -3, 3, 3);
+    update();
+}
+
+void TrailPathItem::RefreshPos()
+{
+    if (count == 0) {
+        return;
+    }
+    // The map only moved if the ends of the trail did
+    core::Point firstPos = m_map->FromLatLngToLocal(at(0).coord);
+    core::Point lastPos  = m_map->FromLatLngToLocal(at(count - 1).coord);
+    if (QPointF(firstPos.X(), firstPos.Y()) == local.first() && QPointF(lastPos.X(), lastPos.Y()) == local.last()) {
+        return;
+    }
+    QPolygonF points;
+    points.reserve(count);
+    for (int i = 0; i < count; i++) {
+        core::Point pos = m_map->FromLatLngToLocal(at(i).coord);
+        points.append(QPointF(pos.X(), pos.Y()));
+    }
+    setLocal(points);
+}
+
+void TrailPathItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    Q_UNUSED(option);
+    Q_UNUSED(widget);
+
+    if (showLine && local.count() > 1) {
+        painter->setPen(linePen);
+        painter->drawPolyline(local);
+    }
+    if (showPoints) {
+        painter->setPen(pointPen);
+        painter->drawPoints(local);
+    }
+}
+
+QRectF TrailPathItem::boundingRect() const
+{
+    return bounds;
+}
+
+int TrailPathItem::type() const
+{
+    return Type;
+}
+
+void TrailPathItem::hoverMoveEvent(QGraphicsSceneHoverEvent *event)
+{
+    QPointF mouse = event->pos();
+    int index     = -1;
+
+    for (int i = local.count() - 1; i >= 0; i--) {
+        QPointF d = local[i] - mouse;
+        if (qAbs(d.x()) <= TRAIL_TOOLTIP_DISTANCE && qAbs(d.y()) <= TRAIL_TOOLTIP_DISTANCE) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0 || !showPoints) {
+        setToolTip(QString());
+        return;
+    }
+    const TrailPoint &p = at(index);
+    QString coord_str   = " " + QString::number(p.coord.Lat(), 'f', 6) + "   " + QString::number(p.coord.Lng(), 'f', 6);
+    setToolTip(QString(tr("Position:") + "%1\n" + tr("Altitude:") + "%2\n" + tr("Time:") + "%3").arg(coord_str).arg(QString::number(p.altitude)).arg(QDateTime::fromMSecsSinceEpoch(p.time).toString()));
+}
+}
@@ -0,0 +1,122 @@
+/**
+ ******************************************************************************
+ *
+ * @file       trailpathitem.h
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      A graphicsItem representing a whole vehicle trail
+ * @see        The GNU Public License (GPL) Version 3
+ * @defgroup   OPMapWidget
+ * @{
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef TRAILPATHITEM_H
+#define TRAILPATHITEM_H
+
+#include <QGraphicsItem>
+#include <QPainter>
+#include <QPolygonF>
+#include <QVector>
+#include "../internals/pointlatlng.h"
+#include <QObject>
+#include "mapgraphicitem.h"
+
+namespace mapcontrol {
+/**
+ * @brief The trail of a vehicle drawn by a single item, as dots, a line or both.
+ *
+ * Points are kept in a ring of fixed capacity. Once enough points have aged
+ * behind the most recent ones they are simplified with Douglas-Peucker, so
+ * long flights keep their shape while memory and paint cost stay bounded.
+ */
+class TrailPathItem : public QObject, public QGraphicsItem {
+    Q_OBJECT Q_INTERFACES(QGraphicsItem)
+public:
+    enum { Type = UserType + 10 };
+    enum {
+        // The most recent points are never simplified, the trail right behind the vehicle is still changing
+        FreshPoints   = 128,
+        // Aged points are simplified in batches of at least this many
+        SimplifyBatch = 256,
+        // Smaller capacities are raised to this
+        MinCapacity   = FreshPoints + SimplifyBatch
+    };
+    // Largest distance a simplified trail may be off the flown one, in meters
+    constexpr static const double SimplifyTolerance = 2.0;
+
+    TrailPathItem(QColor pointColor, QColor lineColor, MapGraphicItem *map, int capacity = 4096);
+    /**
+     * @brief Appends a point to the trail, the oldest one is dropped if the trail is full
+     */
+    void AddPoint(internals::PointLatLng const & coord, int const & altitude);
+    void Clear();
+    int Count() const
+    {
+        return count;
+    }
+    /**
+     * @brief Position of a trail point, from 0 for the oldest to Count() - 1
+     */
+    internals::PointLatLng Coord(int index) const
+    {
+        return at(index).coord;
+    }
+    void SetShowPoints(bool const & value);
+    void SetShowLine(bool const & value);
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+               QWidget *widget);
+    QRectF boundingRect() const;
+    int type() const;
+
+protected:
+    void hoverMoveEvent(QGraphicsSceneHoverEvent *event);
+
+private:
+    struct TrailPoint {
+        internals::PointLatLng coord;
+        int    altitude;
+        qint64 time; // ms since epoch
+    };
+    TrailPoint &at(int index)
+    {
+        return ring[(first + index) % ring.size()];
+    }
+    const TrailPoint &at(int index) const
+    {
+        return ring[(first + index) % ring.size()];
+    }
+    void simplify();
+    void setLocal(QPolygonF const & points);
+
+    QVector<TrailPoint> ring;
+    int first;
+    int count;
+    // Points before this index have been simplified already
+    int simplified;
+    // Where the points are on the map, in the same order
+    QPolygonF local;
+    QRectF bounds;
+    QPen pointPen;
+    QPen linePen;
+    bool showPoints;
+    bool showLine;
+    MapGraphicItem *m_map;
+public slots:
+    void RefreshPos();
+};
+}
+#endif // TRAILPATHITEM_H
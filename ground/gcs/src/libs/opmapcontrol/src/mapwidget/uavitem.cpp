@@ -40,10 +40,7 @@ UAVItem::UAVItem(MapGraphicItem *map, OPMapWidget *parent, QString uavPic) : map
     localposition = map->FromLatLngToLocal(mapwidget->CurrentPosition());
     this->setPos(localposition.X(), localposition.Y());
     this->setZValue(4);
-    trail     = new QGraphicsItemGroup(this);
-    trail->setParentItem(map);
-    trailLine = new QGraphicsItemGroup(this);
-    trailLine->setParentItem(map);
+    trail = new TrailPathItem(Qt::green, Qt::red, map);
     this->setFlag(QGraphicsItem::ItemIgnoresTransformations, true);
     setCacheMode(QGraphicsItem::ItemCoordinateCache);
     mapfollowtype = UAVMapFollowType::None;
@@ -58,7 +55,10 @@ UAVItem::UAVItem(MapGraphicItem *map, OPMapWidget *parent, QString uavPic) : map
     connect(map, SIGNAL(zoomChanged(double, double, double)), this, SLOT(zoomChangedSlot()));
 }
 UAVItem::~UAVItem()
-{}
+{
+    // Null if the map deleted it along with its other children already
+    delete trail;
+}
 
 void UAVItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
 {
@@ -238,6 +238,12 @@ void UAVItem::SetGroundspeed(double vNED[3], int m_maxUpdateRate_ms)
     precalcRings     = groundspeed_mps_filt * ringTime * meters2pixels;
     boundingRectSize = groundspeed_mps_filt * ringTime * 4 * meters2pixels + 20;
     prepareGeometryChange();
+    // The map only moves with the UAV when following it
+    if (mapfollowtype == UAVMapFollowType::CenterAndRotateMap || mapfollowtype == UAVMapFollowType::CenterMap) {
+        mapwidget->SetPrefetchVelocity(vNED[0], vNED[1]);
+    } else {
+        mapwidget->SetPrefetchVelocity(0, 0);
+    }
 }
 
 
@@ -249,29 +255,13 @@ void UAVItem::SetUAVPos(const internals::PointLatLng &position, const int &altit
     if (coord != position) {
         if (trailtype == UAVTrailType::ByTimeElapsed) {
             if (timer.elapsed() > trailtime * 1000) {
-                TrailItem *ob = new TrailItem(position, altitude, Qt::green, map);
-                trail->addToGroup(ob);
-                connect(this, SIGNAL(setChildPosition()), ob, SLOT(setPosSLOT()));
-                if (!lasttrailline.IsEmpty()) {
-                    TrailLineItem *obj = new TrailLineItem(lasttrailline, position, Qt::red, map);
-                    trailLine->addToGroup(obj);
-                    connect(this, SIGNAL(setChildLine()), obj, SLOT(setLineSlot()));
-                }
-                lasttrailline = position;
+                trail->AddPoint(position, altitude);
                 timer.restart();
             }
         } else if (trailtype == UAVTrailType::ByDistance) {
             if (qAbs(internals::PureProjection::DistanceBetweenLatLng(lastcoord, position) * 1000) > traildistance) {
-                TrailItem *ob = new TrailItem(position, altitude, Qt::green, map);
-                trail->addToGroup(ob);
-                connect(this, SIGNAL(setChildPosition()), ob, SLOT(setPosSLOT()));
-                if (!lasttrailline.IsEmpty()) {
-                    TrailLineItem *obj = new TrailLineItem(lasttrailline, position, Qt::red, map);
-                    trailLine->addToGroup(obj);
-                    connect(this, SIGNAL(setChildLine()), obj, SLOT(setLineSlot()));
-                }
-                lasttrailline = position;
-                lastcoord     = position;
+                trail->AddPoint(position, altitude);
+                lastcoord = position;
             }
         }
         coord = position;
@@ -336,8 +326,6 @@ void UAVItem::RefreshPos()
 {
     localposition = map->FromLatLngToLocal(coord);
     this->setPos(localposition.X(), localposition.Y());
-    emit setChildPosition();
-    emit setChildLine();
     updateTextOverlay();
 }
 
@@ -366,20 +354,17 @@ void UAVItem::SetTrailType(const UAVTrailType::Types &value)
 void UAVItem::SetShowTrail(const bool &value)
 {
     showtrail = value;
-    trail->setVisible(value);
+    trail->SetShowPoints(value);
 }
 void UAVItem::SetShowTrailLine(const bool &value)
 {
     showtrailline = value;
-    trailLine->setVisible(value);
+    trail->SetShowLine(value);
 }
 
 void UAVItem::DeleteTrail() const
 {
-    foreach(QGraphicsItem * i, trail->childItems())
-    delete i;
-    foreach(QGraphicsItem * i, trailLine->childItems())
-    delete i;
+    trail->Clear();
 }
 double UAVItem::Distance3D(const internals::PointLatLng &coord, const int &altitude)
 {
@@ -0,0 +1,5 @@
+TARGET = tst_kibertilecache
+
+include(../test.pri)
+
+SOURCES += tst_kibertilecache.cpp
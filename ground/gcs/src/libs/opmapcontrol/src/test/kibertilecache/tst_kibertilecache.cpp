@@ -0,0 +1,211 @@
+/**
+ ******************************************************************************
+ *
+ * @file       tst_kibertilecache.cpp
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      Memory tile cache tests, eviction order, byte budget and image reuse
+ * @see        The GNU Public License (GPL) Version 3
+ * @defgroup   OPMapWidget
+ * @{
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "kibertilecache.h"
+
+#include <QtCore/QObject>
+#include <QtTest/QtTest>
+
+using namespace core;
+
+// Budget used by the tests, in MB as setMemoryCacheCapacity() takes it
+#define CAPACITY_MB   1
+#define CAPACITY      (CAPACITY_MB * 1048576L)
+// Five of these fit in the budget, a sixth does not
+#define TILE_BYTES    (200 * 1024)
+#define TILES_IN_BUDGET 5
+
+class tst_KiberTileCache : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void evictionOrder();
+    void byteBudget();
+    void imageReuse();
+    void imageCountsAgainstBudget();
+    void counters();
+
+private:
+    RawTile tile(int x);
+    QByteArray data(int x, int size = TILE_BYTES);
+    diagnostics diag();
+
+    KiberTileCache *cache;
+};
+
+void tst_KiberTileCache::init()
+{
+    cache = new KiberTileCache();
+    cache->setMemoryCacheCapacity(CAPACITY_MB);
+}
+
+void tst_KiberTileCache::cleanup()
+{
+    delete cache;
+}
+
+RawTile tst_KiberTileCache::tile(int x)
+{
+    return RawTile(MapType::GoogleSatellite, Point(x, 0), 17);
+}
+
+QByteArray tst_KiberTileCache::data(int x, int size)
+{
+    return QByteArray(size, (char)x);
+}
+
+diagnostics tst_KiberTileCache::diag()
+{
+    diagnostics result;
+
+    cache->GetDiagnostics(result);
+    return result;
+}
+
+void tst_KiberTileCache::evictionOrder()
+{
+    for (int x = 0; x < TILES_IN_BUDGET; x++) {
+        cache->Insert(tile(x), data(x));
+    }
+    QCOMPARE(diag().memoryEvictions, 0);
+
+    // Using the oldest tile makes the next one the least recently used
+    QCOMPARE(cache->Data(tile(0)), data(0));
+    cache->Insert(tile(5), data(5));
+    QVERIFY(cache->Contains(tile(0)));
+    QVERIFY(!cache->Contains(tile(1)));
+
+    cache->Insert(tile(6), data(6));
+    QVERIFY(!cache->Contains(tile(2)));
+    for (int x = 3; x <= 6; x++) {
+        QVERIFY(cache->Contains(tile(x)));
+    }
+    QVERIFY(cache->Contains(tile(0)));
+    QCOMPARE(diag().memoryEvictions, 2);
+
+    // Replacing a tile also makes it the most recent
+    cache->Insert(tile(3), data(3));
+    cache->Insert(tile(7), data(7));
+    QVERIFY(cache->Contains(tile(3)));
+    QVERIFY(!cache->Contains(tile(4)));
+}
+
+void tst_KiberTileCache::byteBudget()
+{
+    for (int x = 0; x < 4 * TILES_IN_BUDGET; x++) {
+        cache->Insert(tile(x), data(x));
+        QVERIFY(cache->memoryCacheSize <= CAPACITY);
+    }
+    QCOMPARE(diag().tilesInMemory, TILES_IN_BUDGET);
+    QCOMPARE(cache->memoryCacheSize, (long)TILES_IN_BUDGET * TILE_BYTES);
+    QCOMPARE(diag().memoryUsed, TILES_IN_BUDGET * TILE_BYTES / 1024);
+
+    // A smaller budget evicts right away
+    cache->setMemoryCacheCapacity(0);
+    QCOMPARE(diag().tilesInMemory, 1);
+    QVERIFY(cache->Contains(tile(4 * TILES_IN_BUDGET - 1)));
+
+    // The most recent tile stays even if it alone is over the budget
+    cache->setMemoryCacheCapacity(CAPACITY_MB);
+    cache->Insert(tile(100), data(100, 2 * CAPACITY));
+    QCOMPARE(diag().tilesInMemory, 1);
+    QVERIFY(cache->Contains(tile(100)));
+    QCOMPARE(cache->memoryCacheSize, 2 * CAPACITY);
+
+    cache->Clear();
+    QCOMPARE(cache->memoryCacheSize, 0L);
+    QCOMPARE(diag().tilesInMemory, 0);
+}
+
+void tst_KiberTileCache::imageReuse()
+{
+    QImage image(256, 256, QImage::Format_ARGB32);
+
+    image.fill(Qt::red);
+
+    cache->Insert(tile(0), data(0, 1024));
+    QVERIFY(cache->Image(tile(0)).isNull());
+    QCOMPARE(diag().imagesReused, 0);
+
+    cache->SetImage(tile(0), image);
+    QCOMPARE(cache->Image(tile(0)), image);
+    QCOMPARE(cache->Image(tile(0)), image);
+    QCOMPARE(diag().imagesReused, 2);
+    QCOMPARE(cache->memoryCacheSize, 1024L + image.byteCount());
+
+    // New data makes the decoded image stale
+    cache->Insert(tile(0), data(1, 2048));
+    QVERIFY(cache->Image(tile(0)).isNull());
+    QCOMPARE(cache->memoryCacheSize, 2048L);
+
+    // Tiles that already left the cache do not come back with their image
+    cache->SetImage(tile(1), image);
+    QVERIFY(!cache->Contains(tile(1)));
+    QVERIFY(cache->Image(tile(1)).isNull());
+    QCOMPARE(cache->memoryCacheSize, 2048L);
+}
+
+void tst_KiberTileCache::imageCountsAgainstBudget()
+{
+    QImage image(256, 256, QImage::Format_ARGB32);
+
+    for (int x = 0; x < TILES_IN_BUDGET - 1; x++) {
+        cache->Insert(tile(x), data(x));
+    }
+    QCOMPARE(diag().memoryEvictions, 0);
+
+    // The map asks for the data, decodes it and stores the image
+    QCOMPARE(cache->Data(tile(0)), data(0));
+    cache->SetImage(tile(0), image);
+    QVERIFY(cache->memoryCacheSize <= CAPACITY);
+    QCOMPARE(diag().memoryEvictions, 1);
+    QVERIFY(!cache->Contains(tile(1)));
+    QCOMPARE(cache->Image(tile(0)), image);
+}
+
+void tst_KiberTileCache::counters()
+{
+    QVERIFY(cache->Data(tile(0)).isEmpty());
+    cache->Insert(tile(0), data(0));
+    cache->Insert(tile(1), data(1), true);
+    QVERIFY(!cache->Data(tile(0)).isEmpty());
+    QVERIFY(!cache->Data(tile(1)).isEmpty());
+    // A prefetched tile only counts as a prefetch hit the first time
+    QVERIFY(!cache->Data(tile(1)).isEmpty());
+
+    diagnostics result = diag();
+    QCOMPARE(result.memoryMisses, 1);
+    QCOMPARE(result.memoryHits, 3);
+    QCOMPARE(result.prefetchHits, 1);
+    QCOMPARE(result.tilesInMemory, 2);
+}
+
+QTEST_GUILESS_MAIN(tst_KiberTileCache)
+
+#include "tst_kibertilecache.moc"
@@ -0,0 +1,5 @@
+TARGET = tst_prefetch
+
+include(../test.pri)
+
+SOURCES += tst_prefetch.cpp
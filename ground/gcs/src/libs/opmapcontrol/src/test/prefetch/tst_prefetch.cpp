@@ -0,0 +1,158 @@
+/**
+ ******************************************************************************
+ *
+ * @file       tst_prefetch.cpp
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      Tile prefetch tests, from the database to the memory cache
+ * @see        The GNU Public License (GPL) Version 3
+ * @defgroup   OPMapWidget
+ * @{
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "opmaps.h"
+
+#include <QtCore/QObject>
+#include <QtTest/QtTest>
+#include <QBuffer>
+#include <QTemporaryDir>
+
+using namespace core;
+
+#define TILE_ZOOM 17
+#define TILE_TYPE MapType::GoogleSatellite
+
+class tst_Prefetch : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void keepsCompressedTile();
+    void decodesOnFirstUse();
+    void onlyFromDatabase();
+
+private:
+    // Stores a 256x256 PNG tile at pos in the database and returns it
+    QByteArray storeTile(const Point &pos);
+    diagnostics memoryDiag();
+
+    QTemporaryDir dir;
+    OPMaps *maps;
+};
+
+void tst_Prefetch::initTestCase()
+{
+    QVERIFY(dir.isValid());
+    Cache::Instance()->setCacheLocation(dir.path() + QDir::separator());
+    maps = OPMaps::Instance();
+    maps->setUseMemoryCache(true);
+    maps->setAccessMode(AccessMode::ServerAndCache);
+}
+
+QByteArray tst_Prefetch::storeTile(const Point &pos)
+{
+    QImage image(256, 256, QImage::Format_RGB32);
+    QByteArray tile;
+    QBuffer buffer(&tile);
+
+    image.fill(QColor(pos.X() % 256, pos.Y() % 256, 128));
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG");
+    Cache::Instance()->ImageCache.PutImageToCache(tile, TILE_TYPE, pos, TILE_ZOOM);
+    return tile;
+}
+
+diagnostics tst_Prefetch::memoryDiag()
+{
+    diagnostics result;
+
+    maps->TilesInMemory.GetDiagnostics(result);
+    return result;
+}
+
+void tst_Prefetch::keepsCompressedTile()
+{
+    Point pos(10, 20);
+    RawTile tile(TILE_TYPE, pos, TILE_ZOOM);
+    QByteArray data = storeTile(pos);
+    long used = maps->TilesInMemory.memoryCacheSize;
+    int prefetched = maps->GetDiagnostics().tilesPrefetched;
+
+    QVERIFY(maps->PrefetchImage(TILE_TYPE, pos, TILE_ZOOM));
+    QVERIFY(maps->TilesInMemory.Contains(tile));
+    // Not decoded, only the compressed bytes count against the budget
+    QVERIFY(maps->TilesInMemory.Image(tile).isNull());
+    QCOMPARE(maps->TilesInMemory.memoryCacheSize, used + data.size());
+    QCOMPARE(maps->GetDiagnostics().tilesPrefetched, prefetched + 1);
+
+    // Already in memory
+    QVERIFY(!maps->PrefetchImage(TILE_TYPE, pos, TILE_ZOOM));
+    QCOMPARE(maps->GetDiagnostics().tilesPrefetched, prefetched + 1);
+}
+
+void tst_Prefetch::decodesOnFirstUse()
+{
+    Point pos(11, 20);
+    RawTile tile(TILE_TYPE, pos, TILE_ZOOM);
+    QByteArray data = storeTile(pos);
+    int prefetchHits = memoryDiag().prefetchHits;
+
+    QVERIFY(maps->PrefetchImage(TILE_TYPE, pos, TILE_ZOOM));
+
+    // The regular load finds it in memory, as Core::run() does when the tile comes into view
+    QByteArray img = maps->GetImageFrom(TILE_TYPE, pos, TILE_ZOOM);
+    QCOMPARE(img, data);
+    QCOMPARE(memoryDiag().prefetchHits, prefetchHits + 1);
+
+    long used    = maps->TilesInMemory.memoryCacheSize;
+    QImage image = maps->DecodeImage(TILE_TYPE, pos, TILE_ZOOM, img);
+    QCOMPARE(image.size(), QSize(256, 256));
+    QCOMPARE(maps->TilesInMemory.Image(tile), image);
+    QCOMPARE(maps->TilesInMemory.memoryCacheSize, used + image.byteCount());
+
+    // Only counted once
+    maps->GetImageFrom(TILE_TYPE, pos, TILE_ZOOM);
+    QCOMPARE(memoryDiag().prefetchHits, prefetchHits + 1);
+}
+
+void tst_Prefetch::onlyFromDatabase()
+{
+    Point missing(12, 20);
+    Point stored(13, 20);
+
+    storeTile(stored);
+
+    // Never goes to the server for tiles the database does not have
+    QVERIFY(!maps->PrefetchImage(TILE_TYPE, missing, TILE_ZOOM));
+    QVERIFY(!maps->TilesInMemory.Contains(RawTile(TILE_TYPE, missing, TILE_ZOOM)));
+
+    maps->setAccessMode(AccessMode::ServerOnly);
+    QVERIFY(!maps->PrefetchImage(TILE_TYPE, stored, TILE_ZOOM));
+    maps->setAccessMode(AccessMode::ServerAndCache);
+
+    maps->setUseMemoryCache(false);
+    QVERIFY(!maps->PrefetchImage(TILE_TYPE, stored, TILE_ZOOM));
+    maps->setUseMemoryCache(true);
+
+    QVERIFY(!maps->TilesInMemory.Contains(RawTile(TILE_TYPE, stored, TILE_ZOOM)));
+    QVERIFY(maps->PrefetchImage(TILE_TYPE, stored, TILE_ZOOM));
+}
+
+QTEST_GUILESS_MAIN(tst_Prefetch)
+
+#include "tst_prefetch.moc"
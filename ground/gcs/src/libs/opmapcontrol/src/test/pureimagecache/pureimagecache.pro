@@ -0,0 +1,5 @@
+TARGET = tst_pureimagecache
+
+include(../test.pri)
+
+SOURCES += tst_pureimagecache.cpp
@@ -0,0 +1,178 @@
+/**
+ ******************************************************************************
+ *
+ * @file       tst_pureimagecache.cpp
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      Tile database tests and warm cache benchmark
+ * @see        The GNU Public License (GPL) Version 3
+ * @defgroup   OPMapWidget
+ * @{
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "pureimagecache.h"
+
+#include <QtCore/QObject>
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QThread>
+
+using namespace core;
+
+// Tiles along each side of the square area stored in the cache
+#define TILES_PER_SIDE 32
+#define TILE_ZOOM      17
+#define TILE_TYPE      MapType::GoogleSatellite
+
+class tst_PureImageCache : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void putAndGet();
+    void missingTile();
+    void otherThread();
+    void deleteOlderTilesWithoutDatabase();
+    void benchmarkWarmCache();
+
+private:
+    QByteArray makeTile(int x, int y);
+    void fill();
+
+    QTemporaryDir *dir;
+    // Shared by all tests, each one points it at a new database
+    PureImageCache cache;
+};
+
+// Reads tiles back from a thread of its own, like the map's tile loaders do
+class ReaderThread : public QThread {
+public:
+    ReaderThread(PureImageCache *cache) : cache(cache), found(0) {}
+    void run()
+    {
+        for (int x = 0; x < TILES_PER_SIDE; x++) {
+            if (!cache->GetImageFromCache(TILE_TYPE, Point(x, 0), TILE_ZOOM).isEmpty()) {
+                found++;
+            }
+        }
+    }
+    PureImageCache *cache;
+    int found;
+};
+
+void tst_PureImageCache::init()
+{
+    dir = new QTemporaryDir();
+    QVERIFY(dir->isValid());
+    cache.setGtileCache(dir->path() + QDir::separator());
+}
+
+void tst_PureImageCache::cleanup()
+{
+    delete dir;
+}
+
+QByteArray tst_PureImageCache::makeTile(int x, int y)
+{
+    // About the size of a compressed 256x256 map tile
+    QByteArray tile(12 * 1024, 0);
+
+    for (int i = 0; i < tile.size(); i++) {
+        tile[i] = (char)(x * 31 + y * 17 + i);
+    }
+    return tile;
+}
+
+void tst_PureImageCache::fill()
+{
+    QList<CacheItemQueue *> tiles;
+
+    for (int x = 0; x < TILES_PER_SIDE; x++) {
+        for (int y = 0; y < TILES_PER_SIDE; y++) {
+            tiles.append(new CacheItemQueue(TILE_TYPE, Point(x, y), makeTile(x, y), TILE_ZOOM));
+        }
+    }
+    QCOMPARE(cache.PutImagesToCache(tiles), TILES_PER_SIDE * TILES_PER_SIDE);
+    qDeleteAll(tiles);
+}
+
+void tst_PureImageCache::putAndGet()
+{
+    QVERIFY(cache.PutImageToCache(makeTile(3, 4), TILE_TYPE, Point(3, 4), TILE_ZOOM));
+    QCOMPARE(cache.GetImageFromCache(TILE_TYPE, Point(3, 4), TILE_ZOOM), makeTile(3, 4));
+
+    fill();
+    QCOMPARE(cache.GetImageFromCache(TILE_TYPE, Point(5, 7), TILE_ZOOM), makeTile(5, 7));
+    QCOMPARE(cache.GetImageFromCache(TILE_TYPE, Point(TILES_PER_SIDE - 1, 0), TILE_ZOOM), makeTile(TILES_PER_SIDE - 1, 0));
+}
+
+void tst_PureImageCache::missingTile()
+{
+    fill();
+    QVERIFY(cache.GetImageFromCache(TILE_TYPE, Point(TILES_PER_SIDE, 0), TILE_ZOOM).isEmpty());
+    QVERIFY(cache.GetImageFromCache(TILE_TYPE, Point(0, 0), TILE_ZOOM + 1).isEmpty());
+    QVERIFY(cache.GetImageFromCache(MapType::GoogleMap, Point(0, 0), TILE_ZOOM).isEmpty());
+}
+
+void tst_PureImageCache::otherThread()
+{
+    fill();
+    ReaderThread reader(&cache);
+    reader.start();
+    QVERIFY(reader.wait(10000));
+    QCOMPARE(reader.found, TILES_PER_SIDE);
+}
+
+void tst_PureImageCache::deleteOlderTilesWithoutDatabase()
+{
+    QString db = dir->path() + QDir::separator() + "Data.qmdb";
+
+    QVERIFY(QFile::remove(db));
+    cache.deleteOlderTiles(0);
+    QVERIFY(!QFileInfo(db).exists());
+}
+
+void tst_PureImageCache::benchmarkWarmCache()
+{
+    fill();
+
+    const int passes = 10;
+    int served = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int pass = 0; pass < passes; pass++) {
+        for (int x = 0; x < TILES_PER_SIDE; x++) {
+            for (int y = 0; y < TILES_PER_SIDE; y++) {
+                if (!cache.GetImageFromCache(TILE_TYPE, Point(x, y), TILE_ZOOM).isEmpty()) {
+                    served++;
+                }
+            }
+        }
+    }
+    qint64 elapsed = qMax(timer.nsecsElapsed(), (qint64)1);
+
+    qDebug() << "Warm cache:" << served << "tiles in" << elapsed / 1000000 << "ms,"
+             << (qint64)(served * 1e9 / elapsed) << "tiles/sec";
+    QCOMPARE(served, passes * TILES_PER_SIDE * TILES_PER_SIDE);
+}
+
+QTEST_GUILESS_MAIN(tst_PureImageCache)
+
+#include "tst_pureimagecache.moc"
@@ -0,0 +1,13 @@
+# Shared by the opmapcontrol unit tests, which link against the static core library
+QT += testlib sql network xml widgets
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include($$PWD/../../../../../gcs.pri)
+include($$PWD/../../../utils/utils.pri)
+
+INCLUDEPATH += $$PWD/../core $$GCS_SOURCE_TREE/src/libs
+LIBS += -L$$OUT_PWD/../../build \
+    -lcore
+POST_TARGETDEPS += $$OUT_PWD/../../build/libcore.a
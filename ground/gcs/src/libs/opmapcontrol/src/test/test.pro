@@ -0,0 +1,6 @@
+TEMPLATE = subdirs
+
+SUBDIRS = pureimagecache \
+    kibertilecache \
+    prefetch \
+    trailpathitem
@@ -0,0 +1,15 @@
+TARGET = tst_trailpathitem
+
+include(../test.pri)
+include(../../../opmapcontrol.pri)
+
+QT += opengl svg
+
+INCLUDEPATH += $$PWD/../../mapwidget
+# order of linking matters
+LIBS += -L$$OUT_PWD/../../build \
+    -linternals \
+    -lcore
+POST_TARGETDEPS += $$OUT_PWD/../../build/libinternals.a
+
+SOURCES += tst_trailpathitem.cpp
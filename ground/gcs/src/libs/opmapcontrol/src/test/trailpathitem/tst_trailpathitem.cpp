@@ -0,0 +1,227 @@
+/**
+ ******************************************************************************
+ *
+ * @file       tst_trailpathitem.cpp
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      Trail tests, ring of points and Douglas-Peucker simplification
+ * @see        The GNU Public License (GPL) Version 3
+ * @defgroup   OPMapWidget
+ * @{
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "trailpathitem.h"
+#include "configuration.h"
+
+#include <QtCore/QObject>
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include <math.h>
+
+using namespace mapcontrol;
+using internals::PointLatLng;
+
+// WGS84 equatorial radius, the trail measures its tolerance with it
+#define EARTH_RADIUS 6378137.0
+// The smallest ring a trail accepts
+#define MIN_CAPACITY int(TrailPathItem::MinCapacity)
+
+// Where the test trails start
+#define LAT0 47.0
+#define LNG0 8.0
+
+// Position x meters east and y meters north of LAT0, LNG0
+static PointLatLng offset(double x, double y)
+{
+    double ky = EARTH_RADIUS * M_PI / 180.0;
+    double kx = ky * cos(LAT0 * M_PI / 180.0);
+
+    return PointLatLng(LAT0 + y / ky, LNG0 + x / kx);
+}
+
+// Back to meters east and north of LAT0, LNG0
+static QPointF meters(const PointLatLng &coord)
+{
+    double ky = EARTH_RADIUS * M_PI / 180.0;
+    double kx = ky * cos(LAT0 * M_PI / 180.0);
+
+    return QPointF((coord.Lng() - LNG0) * kx, (coord.Lat() - LAT0) * ky);
+}
+
+static double distanceToSegment(const QPointF &p, const QPointF &a, const QPointF &b)
+{
+    QPointF ab  = b - a;
+    QPointF ap  = p - a;
+    double len2 = ab.x() * ab.x() + ab.y() * ab.y();
+    double t    = len2 > 0 ? qBound(0.0, (ap.x() * ab.x() + ap.y() * ab.y()) / len2, 1.0) : 0.0;
+    QPointF d   = ap - t * ab;
+
+    return sqrt(d.x() * d.x() + d.y() * d.y());
+}
+
+class tst_TrailPathItem : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void ringDropsOldest();
+    void straightLineCollapses();
+    void simplifiedWithinTolerance();
+    void clear();
+
+private:
+    // Index of each trail point in path, -1 if it is not one of them
+    QVector<int> indicesIn(const TrailPathItem *trail, const QVector<PointLatLng> &path);
+
+    QTemporaryDir dir;
+    internals::Core *core;
+    Configuration *config;
+    MapGraphicItem *map;
+};
+
+void tst_TrailPathItem::initTestCase()
+{
+    // The map core opens the tile database, keep it out of the user's cache
+    QVERIFY(dir.isValid());
+    core::Cache::Instance()->setCacheLocation(dir.path() + QDir::separator());
+}
+
+void tst_TrailPathItem::init()
+{
+    core   = new internals::Core;
+    config = new Configuration;
+    map    = new MapGraphicItem(core, config);
+}
+
+void tst_TrailPathItem::cleanup()
+{
+    // Deletes the trails too
+    delete map;
+    delete core;
+    delete config;
+}
+
+QVector<int> tst_TrailPathItem::indicesIn(const TrailPathItem *trail, const QVector<PointLatLng> &path)
+{
+    QVector<int> indices;
+    int from = 0;
+
+    for (int i = 0; i < trail->Count(); i++) {
+        int index = -1;
+        for (int j = from; j < path.size(); j++) {
+            if (path.at(j) == trail->Coord(i)) {
+                index = j;
+                break;
+            }
+        }
+        indices.append(index);
+        from = index + 1;
+    }
+    return indices;
+}
+
+void tst_TrailPathItem::ringDropsOldest()
+{
+    TrailPathItem *trail = new TrailPathItem(Qt::green, Qt::red, map, MIN_CAPACITY);
+    QVector<PointLatLng> path;
+
+    // A zigzag far wider than the tolerance, nothing can be simplified away
+    for (int i = 0; i < 3 * MIN_CAPACITY; i++) {
+        path.append(offset(i * 10.0, (i % 2) * 10.0));
+        trail->AddPoint(path.last(), 100);
+        QCOMPARE(trail->Count(), qMin(i + 1, MIN_CAPACITY));
+    }
+    for (int i = 0; i < MIN_CAPACITY; i++) {
+        QVERIFY(trail->Coord(i) == path.at(path.size() - MIN_CAPACITY + i));
+    }
+}
+
+void tst_TrailPathItem::straightLineCollapses()
+{
+    TrailPathItem *trail = new TrailPathItem(Qt::green, Qt::red, map);
+    QVector<PointLatLng> path;
+
+    for (int i = 0; i < 10 * MIN_CAPACITY; i++) {
+        path.append(offset(0, i));
+        trail->AddPoint(path.last(), 100);
+    }
+    // Each batch collapses to its two ends
+    QVERIFY(trail->Count() < path.size() / 4);
+    // The start stays, and the most recent points are all there
+    QVERIFY(trail->Coord(0) == path.first());
+    for (int i = 0; i < TrailPathItem::FreshPoints; i++) {
+        QVERIFY(trail->Coord(trail->Count() - 1 - i) == path.at(path.size() - 1 - i));
+    }
+}
+
+void tst_TrailPathItem::simplifiedWithinTolerance()
+{
+    TrailPathItem *trail = new TrailPathItem(Qt::green, Qt::red, map);
+    QVector<PointLatLng> path;
+
+    // North then east, wobbling well within the tolerance
+    for (int i = 0; i < 2 * MIN_CAPACITY; i++) {
+        double wobble = (i % 2) * 0.5;
+        if (i < MIN_CAPACITY) {
+            path.append(offset(wobble, i));
+        } else {
+            path.append(offset(i - MIN_CAPACITY, MIN_CAPACITY + wobble));
+        }
+        trail->AddPoint(path.last(), 100);
+    }
+    QVERIFY(trail->Count() < path.size() / 2);
+
+    // What is left are points of the path, in order
+    QVector<int> indices = indicesIn(trail, path);
+    QCOMPARE(indices.first(), 0);
+    QCOMPARE(indices.last(), path.size() - 1);
+    QVERIFY(!indices.contains(-1));
+
+    // and every point dropped is close to the line between the kept ones around it
+    for (int k = 0; k + 1 < indices.size(); k++) {
+        QPointF a = meters(path.at(indices.at(k)));
+        QPointF b = meters(path.at(indices.at(k + 1)));
+        for (int i = indices.at(k) + 1; i < indices.at(k + 1); i++) {
+            QVERIFY(distanceToSegment(meters(path.at(i)), a, b) <= TrailPathItem::SimplifyTolerance + 0.01);
+        }
+    }
+    for (int i = 0; i < TrailPathItem::FreshPoints; i++) {
+        QCOMPARE(indices.at(indices.size() - 1 - i), path.size() - 1 - i);
+    }
+}
+
+void tst_TrailPathItem::clear()
+{
+    TrailPathItem *trail = new TrailPathItem(Qt::green, Qt::red, map, MIN_CAPACITY);
+
+    for (int i = 0; i < 2 * MIN_CAPACITY; i++) {
+        trail->AddPoint(offset(i * 10.0, (i % 2) * 10.0), 100);
+    }
+    trail->Clear();
+    QCOMPARE(trail->Count(), 0);
+
+    trail->AddPoint(offset(5, 5), 100);
+    QCOMPARE(trail->Count(), 1);
+    QVERIFY(trail->Coord(0) == offset(5, 5));
+}
+
+QTEST_MAIN(tst_TrailPathItem)
+
+#include "tst_trailpathitem.moc"
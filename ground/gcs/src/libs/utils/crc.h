@@ -52,6 +52,16 @@ public:
      * \return         The updated crc value.
      */
     static quint8 updateCRC(quint8 crc, const quint8 *data, qint32 length);
+
+    /**
+     * Update the 16 bit crc value with new data.
+     *
+     * \param crc      The current crc value.
+     * \param data     Pointer to a buffer of \a data_len bytes.
+     * \param length   Number of bytes in the \a data buffer.
+     * \return         The updated crc value.
+     */
+    static quint16 updateCRC16(quint16 crc, const quint8 *data, qint32 length);
 };
 } // namespace Utils
 
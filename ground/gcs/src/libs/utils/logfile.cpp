@@ -2,6 +2,10 @@
 #include <QDebug>
 #include <QtGlobal>
 
+#define REPLAY_TIMER_INTERVAL   10
+// Data queued ahead of the reader when replaying as fast as possible
+#define REPLAY_FAST_BUFFER_SIZE (256 * 1024)
+
 LogFile::LogFile(QObject *parent) :
     QIODevice(parent),
     m_lastTimeStamp(0),
@@ -9,7 +13,12 @@ LogFile::LogFile(QObject *parent) :
     m_timeOffset(0),
     m_playbackSpeed(1.0),
     m_nextTimeStamp(0),
-    m_useProvidedTimeStamp(false)
+    m_useProvidedTimeStamp(false),
+    m_data(NULL),
+    m_dataSize(0),
+    m_nextRecord(0),
+    m_replayFast(false),
+    m_refillPending(false)
 {
     connect(&m_timer, SIGNAL(timeout()), this, SLOT(timerFired()));
 }
@@ -54,7 +63,13 @@ void LogFile::close()
     if (m_timer.isActive()) {
         m_timer.stop();
     }
+    // Also unmaps the file
     m_file.close();
+    m_data     = NULL;
+    m_dataSize = 0;
+    m_fileData.clear();
+    m_index.clear();
+    m_nextRecord = 0;
     QIODevice::close();
 }
 
@@ -86,6 +101,12 @@ qint64 LogFile::readData(char *data, qint64 maxSize)
 
     memcpy(data, m_dataBuffer.data(), toRead);
     m_dataBuffer.remove(0, toRead);
+
+    // When replaying as fast as possible, the reader taking data is what drives the replay
+    if (m_replayFast && !m_refillPending && m_dataBuffer.size() < REPLAY_FAST_BUFFER_SIZE / 2) {
+        m_refillPending = true;
+        QMetaObject::invokeMethod(this, "timerFired", Qt::QueuedConnection);
+    }
     return toRead;
 }
 
@@ -96,75 +117,178 @@ qint64 LogFile::bytesAvailable() const
 
 void LogFile::timerFired()
 {
-    qint64 dataSize;
+    // Refills requested by the reader are dropped while paused or stopped
+    if (!m_timer.isActive()) {
+        return;
+    }
 
-    if (m_file.bytesAvailable() > 4) {
-        int time;
-        time = m_myTime.elapsed();
+    int time = m_myTime.elapsed();
 
-        // TODO: going back in time will be a problem
-        while ((m_lastPlayed + ((double)(time - m_timeOffset) * m_playbackSpeed) > m_lastTimeStamp)) {
-            m_lastPlayed += ((double)(time - m_timeOffset) * m_playbackSpeed);
-            if (m_file.bytesAvailable() < (qint64)sizeof(dataSize)) {
-                stopReplay();
-                return;
-            }
+    m_lastPlayed += (double)(time - m_timeOffset) * m_playbackSpeed;
+    m_timeOffset  = time;
 
-            m_file.read((char *)&dataSize, sizeof(dataSize));
+    // Queue all records due by now, or as much as the reader keeps up with
+    bool newData = false;
+    m_mutex.lock();
+    m_refillPending = false;
+    while (m_nextRecord < m_index.size()) {
+        const LogRecord &record = m_index.at(m_nextRecord);
+        if (m_replayFast ? m_dataBuffer.size() >= REPLAY_FAST_BUFFER_SIZE : record.timeStamp > m_lastPlayed) {
+            break;
+        }
+        m_dataBuffer.append((const char *)m_data + record.offset, record.size);
+        m_lastTimeStamp = record.timeStamp;
+        m_nextRecord++;
+        newData = true;
+    }
+    bool finished = m_nextRecord >= m_index.size() && m_dataBuffer.isEmpty();
+    m_mutex.unlock();
 
-            if (dataSize < 1 || dataSize > (1024 * 1024)) {
-                qDebug() << "Error: Logfile corrupted! Unlikely packet size: " << dataSize << "\n";
-                stopReplay();
-                return;
-            }
+    if (m_replayFast) {
+        m_lastPlayed = m_lastTimeStamp;
+    }
 
-            if (m_file.bytesAvailable() < dataSize) {
-                stopReplay();
-                return;
-            }
+    if (newData) {
+        emit readyRead();
+    }
+
+    // Stop once the reader got everything
+    if (finished) {
+        stopReplay();
+    }
+}
 
-            m_mutex.lock();
-            m_dataBuffer.append(m_file.read(dataSize));
-            m_mutex.unlock();
+/**
+ * Map the log into memory, or read it completely if mapping is not supported.
+ */
+bool LogFile::mapFile()
+{
+    m_dataSize = m_file.size();
+    m_data     = m_file.map(0, m_dataSize);
+    if (m_data == NULL) {
+        m_file.seek(0);
+        m_fileData = m_file.readAll();
+        m_data     = (const uchar *)m_fileData.constData();
+        m_dataSize = m_fileData.size();
+    }
+    return m_dataSize > 0;
+}
 
-            emit readyRead();
+/**
+ * Scan the log once and record the position and timestamp of each record.
+ * The index stops at the first corrupted or truncated record.
+ */
+void LogFile::buildIndex()
+{
+    const qint64 headerSize = sizeof(quint32) + sizeof(qint64);
+    qint64 pos = 0;
 
-            if (m_file.bytesAvailable() < (qint64)sizeof(m_lastTimeStamp)) {
-                stopReplay();
-                return;
-            }
+    m_index.clear();
+    while (pos + headerSize <= m_dataSize) {
+        LogRecord record;
+        memcpy(&record.timeStamp, m_data + pos, sizeof(record.timeStamp));
+        memcpy(&record.size, m_data + pos + sizeof(record.timeStamp), sizeof(record.size));
+        record.offset = pos + headerSize;
 
-            int save = m_lastTimeStamp;
-            m_file.read((char *)&m_lastTimeStamp, sizeof(m_lastTimeStamp));
+        if (record.size < 1 || record.size > (1024 * 1024)) {
+            qDebug() << "Error: Logfile corrupted! Unlikely packet size: " << record.size << "\n";
+            break;
+        }
+        if (record.offset + record.size > m_dataSize) {
+            break;
+        }
+        if (!m_index.isEmpty()) {
+            quint32 save = m_index.last().timeStamp;
             // some validity checks
-            if (m_lastTimeStamp < save // logfile goes back in time
-                || (m_lastTimeStamp - save) > (60 * 60 * 1000)) { // gap of more than 60 minutes)
-                qDebug() << "Error: Logfile corrupted! Unlikely timestamp " << m_lastTimeStamp << " after " << save << "\n";
-                stopReplay();
-                return;
+            if (record.timeStamp < save // logfile goes back in time
+                || (record.timeStamp - save) > (60 * 60 * 1000)) { // gap of more than 60 minutes)
+                qDebug() << "Error: Logfile corrupted! Unlikely timestamp " << record.timeStamp << " after " << save << "\n";
+                break;
             }
-
-            m_timeOffset = time;
-            time = m_myTime.elapsed();
         }
-    } else {
-        stopReplay();
+
+        m_index.append(record);
+        pos = record.offset + record.size;
     }
 }
 
 bool LogFile::startReplay()
 {
     m_dataBuffer.clear();
+    if (!mapFile()) {
+        qDebug() << "Error: Unable to read logfile" << m_file.fileName();
+        stopReplay();
+        return false;
+    }
+    buildIndex();
+    if (m_index.isEmpty()) {
+        qDebug() << "Error: Logfile contains no records";
+        stopReplay();
+        return false;
+    }
+
+    m_nextRecord    = 0;
+    m_lastTimeStamp = m_index.first().timeStamp;
+    m_lastPlayed    = m_lastTimeStamp;
     m_myTime.restart();
-    m_timeOffset = 0;
-    m_lastPlayed = 0;
-    m_file.read((char *)&m_lastTimeStamp, sizeof(m_lastTimeStamp));
-    m_timer.setInterval(10);
-    m_timer.start();
+    m_timeOffset    = 0;
+    m_timer.start(REPLAY_TIMER_INTERVAL);
     emit replayStarted();
     return true;
 }
 
+quint32 LogFile::getFirstTimeStamp() const
+{
+    return m_index.isEmpty() ? 0 : m_index.first().timeStamp;
+}
+
+quint32 LogFile::getLastTimeStamp() const
+{
+    return m_index.isEmpty() ? 0 : m_index.last().timeStamp;
+}
+
+/**
+ * Replay as fast as the reader takes the data instead of following the log timestamps.
+ * The buffer is refilled as the reader empties it (see readData()), the timer only
+ * starts the replay and picks it up again after a pause.
+ */
+void LogFile::setReplayAsFastAsPossible(bool fast)
+{
+    m_replayFast = fast;
+    m_lastPlayed = m_lastTimeStamp;
+    m_timeOffset = m_myTime.elapsed();
+}
+
+/**
+ * Continue the replay from the first record at or after the given timestamp.
+ * Data not yet read from the previous position is dropped.
+ */
+bool LogFile::setReplayPosition(quint32 timeStamp)
+{
+    if (m_index.isEmpty()) {
+        return false;
+    }
+
+    int first = 0;
+    int last  = m_index.size();
+    while (first < last) {
+        int middle = (first + last) / 2;
+        if (m_index.at(middle).timeStamp < timeStamp) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_dataBuffer.clear();
+    m_nextRecord    = first;
+    m_lastTimeStamp = timeStamp;
+    m_lastPlayed    = timeStamp;
+    m_timeOffset    = m_myTime.elapsed();
+    return true;
+}
+
 bool LogFile::stopReplay()
 {
     close();
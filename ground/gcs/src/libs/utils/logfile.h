@@ -8,6 +8,7 @@
 #include <QDebug>
 #include <QBuffer>
 #include <QFile>
+#include <QVector>
 #include "utils_global.h"
 
 class QTCREATOR_UTILS_EXPORT LogFile : public QIODevice {
@@ -30,6 +31,14 @@ public:
 
     bool startReplay();
     bool stopReplay();
+
+    // Timestamps of the first and last record, and of the last replayed record
+    quint32 getFirstTimeStamp() const;
+    quint32 getLastTimeStamp() const;
+    quint32 getReplayPosition() const
+    {
+        return m_lastTimeStamp;
+    };
     void useProvidedTimeStamp(bool useProvidedTimeStamp)
     {
         m_useProvidedTimeStamp = useProvidedTimeStamp;
@@ -46,6 +55,8 @@ public slots:
         m_playbackSpeed = val;
         qDebug() << "Playback speed is now" << m_playbackSpeed;
     };
+    void setReplayAsFastAsPossible(bool fast);
+    bool setReplayPosition(quint32 timeStamp);
     void pauseReplay();
     void resumeReplay();
 
@@ -58,6 +69,13 @@ signals:
     void replayFinished();
 
 protected:
+    // One entry per log record, built in a single pass when the replay starts
+    typedef struct {
+        qint64  offset; // Position of the record data in the file
+        qint64  size;
+        quint32 timeStamp;
+    } LogRecord;
+
     QByteArray m_dataBuffer;
     QTimer m_timer;
     QTime m_myTime;
@@ -73,6 +91,18 @@ protected:
 private:
     quint32 m_nextTimeStamp;
     bool m_useProvidedTimeStamp;
+
+    // Replay state
+    const uchar *m_data;
+    qint64 m_dataSize;
+    QByteArray m_fileData;
+    QVector<LogRecord> m_index;
+    int m_nextRecord;
+    bool m_replayFast;
+    bool m_refillPending;
+
+    bool mapFile();
+    void buildIndex();
 };
 
 #endif // LOGFILE_H
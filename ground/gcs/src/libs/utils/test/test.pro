@@ -0,0 +1,12 @@
+QT += testlib
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+TARGET = tst_logfile
+
+include(../../../../gcs.pri)
+include(../utils.pri)
+
+INCLUDEPATH += $$GCS_SOURCE_TREE/src/libs
+
+SOURCES += tst_logfile.cpp
@@ -0,0 +1,150 @@
+/**
+ ******************************************************************************
+ *
+ * @file       tst_logfile.cpp
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      LogFile replay tests
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <utils/logfile.h>
+
+#include <QtCore/QObject>
+#include <QtTest/QtTest>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+// Records in the test log, one every RECORD_PERIOD ms, more than the replay queues ahead
+#define NUM_RECORDS   1000
+#define RECORD_PERIOD 100
+#define RECORD_SIZE   512
+
+class tst_LogFile : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void replayFast();
+    void seek();
+    void pauseStopsFastReplay();
+
+private:
+    QTemporaryDir dir;
+    QString logName;
+    QByteArray expected;
+
+    static QByteArray record(int n);
+    static QByteArray readUntilFinished(LogFile *log, int maxBytes = -1);
+};
+
+QByteArray tst_LogFile::record(int n)
+{
+    return QByteArray(RECORD_SIZE, (char)n);
+}
+
+// Reads what the replay delivers, the way UAVTalk does on readyRead()
+QByteArray tst_LogFile::readUntilFinished(LogFile *log, int maxBytes)
+{
+    QSignalSpy finished(log, SIGNAL(replayFinished()));
+    QByteArray data;
+
+    while (finished.isEmpty() && (maxBytes < 0 || data.size() < maxBytes)) {
+        QTest::qWait(1);
+        data.append(log->read(RECORD_SIZE * 16));
+    }
+    return data;
+}
+
+void tst_LogFile::initTestCase()
+{
+    QVERIFY(dir.isValid());
+    logName = dir.path() + "/test.opl";
+
+    LogFile log;
+    log.setFileName(logName);
+    log.useProvidedTimeStamp(true);
+    QVERIFY(log.open(QIODevice::WriteOnly));
+    for (int n = 0; n < NUM_RECORDS; n++) {
+        log.setNextTimeStamp(n * RECORD_PERIOD);
+        log.write(record(n));
+        expected.append(record(n));
+    }
+    log.close();
+}
+
+void tst_LogFile::replayFast()
+{
+    LogFile log;
+
+    log.setFileName(logName);
+    QVERIFY(log.open(QIODevice::ReadOnly));
+    QVERIFY(log.startReplay());
+    QCOMPARE(log.getFirstTimeStamp(), (quint32)0);
+    QCOMPARE(log.getLastTimeStamp(), (quint32)(NUM_RECORDS - 1) * RECORD_PERIOD);
+
+    // The whole log, 100 s at normal speed, is replayed as fast as it is read
+    QElapsedTimer timer;
+    timer.start();
+    log.setReplayAsFastAsPossible(true);
+    QByteArray data = readUntilFinished(&log);
+    QVERIFY(timer.elapsed() < 10000);
+    QCOMPARE(data, expected);
+}
+
+void tst_LogFile::seek()
+{
+    LogFile log;
+
+    log.setFileName(logName);
+    QVERIFY(log.open(QIODevice::ReadOnly));
+    QVERIFY(log.startReplay());
+    log.setReplayAsFastAsPossible(true);
+
+    // Replay continues from the first record at or after the position
+    QVERIFY(log.setReplayPosition(NUM_RECORDS / 2 * RECORD_PERIOD - RECORD_PERIOD / 2));
+    QByteArray data = readUntilFinished(&log);
+    QCOMPARE(data, expected.mid(NUM_RECORDS / 2 * RECORD_SIZE));
+}
+
+void tst_LogFile::pauseStopsFastReplay()
+{
+    LogFile log;
+
+    log.setFileName(logName);
+    QVERIFY(log.open(QIODevice::ReadOnly));
+    QVERIFY(log.startReplay());
+    log.setReplayAsFastAsPossible(true);
+
+    QByteArray data = readUntilFinished(&log, RECORD_SIZE);
+    log.pauseReplay();
+
+    // Reading what was queued before the pause does not bring in more records
+    data.append(log.readAll());
+    QTest::qWait(50);
+    QCOMPARE(log.bytesAvailable(), (qint64)0);
+    quint32 position = log.getReplayPosition();
+    QTest::qWait(50);
+    QCOMPARE(log.getReplayPosition(), position);
+
+    log.resumeReplay();
+    data.append(readUntilFinished(&log));
+    QCOMPARE(data, expected);
+}
+
+QTEST_GUILESS_MAIN(tst_LogFile)
+
+#include "tst_logfile.moc"
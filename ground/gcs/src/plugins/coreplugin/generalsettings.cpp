@@ -49,6 +49,7 @@ GeneralSettings::GeneralSettings() :
     m_autoConnect(true),
     m_autoSelect(true),
     m_useUDPMirror(false),
+    m_telemetryTransactionWindow(8),
     m_useExpertMode(false),
     m_collectUsageData(true),
     m_showUsageDataDisclaimer(true),
@@ -127,6 +128,7 @@ QWidget *GeneralSettings::createPage(QWidget *parent)
     m_page->checkAutoConnect->setChecked(m_autoConnect);
     m_page->checkAutoSelect->setChecked(m_autoSelect);
     m_page->cbUseUDPMirror->setChecked(m_useUDPMirror);
+    m_page->sbTransactionWindow->setValue(m_telemetryTransactionWindow);
     m_page->cbExpertMode->setChecked(m_useExpertMode);
     m_page->cbUsageData->setChecked(m_collectUsageData);
     m_page->colorButton->setColor(StyleHelper::baseColor());
@@ -146,6 +148,7 @@ void GeneralSettings::apply()
 
     m_saveSettingsOnExit = m_page->checkBoxSaveOnExit->isChecked();
     m_useUDPMirror  = m_page->cbUseUDPMirror->isChecked();
+    m_telemetryTransactionWindow = m_page->sbTransactionWindow->value();
     m_useExpertMode = m_page->cbExpertMode->isChecked();
     m_autoConnect   = m_page->checkAutoConnect->isChecked();
     m_autoSelect    = m_page->checkAutoSelect->isChecked();
@@ -165,6 +168,7 @@ void GeneralSettings::readSettings(QSettings *qs)
     m_autoConnect        = qs->value(QLatin1String("AutoConnect"), m_autoConnect).toBool();
     m_autoSelect         = qs->value(QLatin1String("AutoSelect"), m_autoSelect).toBool();
     m_useUDPMirror       = qs->value(QLatin1String("UDPMirror"), m_useUDPMirror).toBool();
+    m_telemetryTransactionWindow = qs->value(QLatin1String("TelemetryTransactionWindow"), m_telemetryTransactionWindow).toInt();
     m_useExpertMode      = qs->value(QLatin1String("ExpertMode"), m_useExpertMode).toBool();
     m_collectUsageData   = qs->value(QLatin1String("CollectUsageData"), m_collectUsageData).toBool();
     m_showUsageDataDisclaimer = qs->value(QLatin1String("ShowUsageDataDisclaimer"), m_showUsageDataDisclaimer).toBool();
@@ -186,6 +190,7 @@ void GeneralSettings::saveSettings(QSettings *qs)
     qs->setValue(QLatin1String("AutoConnect"), m_autoConnect);
     qs->setValue(QLatin1String("AutoSelect"), m_autoSelect);
     qs->setValue(QLatin1String("UDPMirror"), m_useUDPMirror);
+    qs->setValue(QLatin1String("TelemetryTransactionWindow"), m_telemetryTransactionWindow);
     qs->setValue(QLatin1String("ExpertMode"), m_useExpertMode);
     qs->setValue(QLatin1String("CollectUsageData"), m_collectUsageData);
     qs->setValue(QLatin1String("ShowUsageDataDisclaimer"), m_showUsageDataDisclaimer);
@@ -260,6 +265,11 @@ bool GeneralSettings::useUDPMirror() const
     return m_useUDPMirror;
 }
 
+int GeneralSettings::telemetryTransactionWindow() const
+{
+    return m_telemetryTransactionWindow;
+}
+
 bool GeneralSettings::collectUsageData() const
 {
     return m_collectUsageData;
@@ -58,6 +58,7 @@ public:
     bool autoConnect() const;
     bool autoSelect() const;
     bool useUDPMirror() const;
+    int telemetryTransactionWindow() const;
     bool collectUsageData() const;
     bool showUsageDataDisclaimer() const;
     QString lastUsageHash() const;
@@ -84,6 +85,7 @@ private:
     bool m_autoConnect;
     bool m_autoSelect;
     bool m_useUDPMirror;
+    int m_telemetryTransactionWindow;
     bool m_useExpertMode;
     bool m_collectUsageData;
     bool m_showUsageDataDisclaimer;
@@ -35,6 +35,9 @@
 #include <QPushButton>
 #include <loggingplugin.h>
 
+// How often the replay position is shown (ms)
+#define POSITION_UPDATE_INTERVAL 250
+
 LoggingGadgetWidget::LoggingGadgetWidget(QWidget *parent) : QLabel(parent)
 {
     m_logging = new Ui_Logging();
@@ -42,6 +45,9 @@ LoggingGadgetWidget::LoggingGadgetWidget(QWidget *parent) : QLabel(parent)
 
     ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
     scpPlugin = pm->getObject<ScopeGadgetFactory>();
+
+    m_positionTimer.setInterval(POSITION_UPDATE_INTERVAL);
+    connect(&m_positionTimer, SIGNAL(timeout()), this, SLOT(updateReplayPosition()));
 }
 
 LoggingGadgetWidget::~LoggingGadgetWidget()
@@ -58,6 +64,10 @@ void LoggingGadgetWidget::setPlugin(LoggingPlugin *p)
     connect(m_logging->pauseButton, SIGNAL(clicked()), p->getLogfile(), SLOT(pauseReplay()));
     connect(m_logging->pauseButton, SIGNAL(clicked()), scpPlugin, SLOT(stopPlotting()));
     connect(m_logging->playbackSpeed, SIGNAL(valueChanged(double)), p->getLogfile(), SLOT(setReplaySpeed(double)));
+    connect(m_logging->replayFast, SIGNAL(toggled(bool)), this, SLOT(setReplayFast(bool)));
+    connect(m_logging->replayPosition, SIGNAL(sliderReleased()), this, SLOT(seekReplay()));
+    connect(p->getLogfile(), SIGNAL(replayStarted()), this, SLOT(replayStarted()));
+    connect(p->getLogfile(), SIGNAL(replayFinished()), this, SLOT(replayFinished()));
     void pauseReplay();
     void resumeReplay();
 }
@@ -68,6 +78,60 @@ void LoggingGadgetWidget::stateChanged(QString status)
     m_logging->statusLabel->setText(status);
 }
 
+static QString formatReplayTime(quint32 ms)
+{
+    quint32 seconds = ms / 1000;
+
+    return QString("%1:%2").arg(seconds / 60).arg(seconds % 60, 2, 10, QChar('0'));
+}
+
+void LoggingGadgetWidget::replayStarted()
+{
+    LogFile *logFile = loggingPlugin->getLogfile();
+
+    // Positions are in seconds from the start of the log
+    m_logging->replayPosition->setRange(0, (logFile->getLastTimeStamp() - logFile->getFirstTimeStamp()) / 1000);
+    m_logging->replayPosition->setValue(0);
+    m_logging->replayPosition->setEnabled(true);
+    logFile->setReplayAsFastAsPossible(m_logging->replayFast->isChecked());
+    updateReplayPosition();
+    m_positionTimer.start();
+}
+
+void LoggingGadgetWidget::replayFinished()
+{
+    m_positionTimer.stop();
+    m_logging->replayPosition->setEnabled(false);
+}
+
+void LoggingGadgetWidget::updateReplayPosition()
+{
+    LogFile *logFile = loggingPlugin->getLogfile();
+    quint32 first    = logFile->getFirstTimeStamp();
+    quint32 position = logFile->getReplayPosition() - first;
+
+    // Leave the slider alone while the user drags it
+    if (!m_logging->replayPosition->isSliderDown()) {
+        m_logging->replayPosition->setValue(position / 1000);
+    }
+    m_logging->positionLabel->setText(formatReplayTime(position) + " / " +
+                                      formatReplayTime(logFile->getLastTimeStamp() - first));
+}
+
+void LoggingGadgetWidget::seekReplay()
+{
+    LogFile *logFile = loggingPlugin->getLogfile();
+
+    logFile->setReplayPosition(logFile->getFirstTimeStamp() + m_logging->replayPosition->value() * 1000);
+    updateReplayPosition();
+}
+
+void LoggingGadgetWidget::setReplayFast(bool fast)
+{
+    m_logging->playbackSpeed->setEnabled(!fast);
+    loggingPlugin->getLogfile()->setReplayAsFastAsPossible(fast);
+}
+
 /**
  * @}
  * @}
@@ -29,6 +29,7 @@
 #define LoggingGADGETWIDGET_H_
 
 #include <QLabel>
+#include <QTimer>
 #include "extensionsystem/pluginmanager.h"
 #include "scope/scopeplugin.h"
 #include "scope/scopegadgetfactory.h"
@@ -47,6 +48,11 @@ public:
 
 protected slots:
     void stateChanged(QString status);
+    void replayStarted();
+    void replayFinished();
+    void updateReplayPosition();
+    void seekReplay();
+    void setReplayFast(bool fast);
 
 signals:
     void pause();
@@ -56,6 +62,7 @@ private:
     Ui_Logging *m_logging;
     LoggingPlugin *loggingPlugin;
     ScopeGadgetFactory *scpPlugin;
+    QTimer m_positionTimer;
 };
 
 #endif /* LoggingGADGETWIDGET_H_ */
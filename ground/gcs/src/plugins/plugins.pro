@@ -245,3 +245,22 @@ plugin_streamservice.depends = plugin_coreplugin
 plugin_streamservice.depends += plugin_uavobjects
 plugin_streamservice.depends += plugin_uavtalk
 SUBDIRS += plugin_streamservice
+
+# Unit tests, built along with debug builds like the rest of WITH_TESTS (see gcs.pri)
+# and run by make check
+isEmpty(TEST):CONFIG(debug, debug|release) {
+    TEST = 1
+}
+equals(TEST, 1) {
+    test_scope.subdir = scope/test
+    test_scope.depends = plugin_scope
+    SUBDIRS += test_scope
+
+    test_uavobjects.subdir = uavobjects/test
+    test_uavobjects.depends = plugin_uavobjects
+    SUBDIRS += test_uavobjects
+
+    test_uavtalk.subdir = uavtalk/test
+    test_uavtalk.depends = plugin_uavtalk
+    SUBDIRS += test_uavtalk
+}
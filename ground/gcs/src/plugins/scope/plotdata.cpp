@@ -30,15 +30,147 @@
 #include <math.h>
 #include <QDebug>
 
-PlotData::PlotData(UAVObject *object, UAVObjectField *field, int element,
+// Initial capacity of chrono plot buffers, they grow as needed
+#define CHRONO_INITIAL_CAPACITY 256
+
+PlotDataBuffer::PlotDataBuffer(PlotType plotType, int capacity) :
+    m_plotType(plotType), m_capacity(qMax(capacity, 1)), m_samples(capacity), m_buckets(CHRONO_INITIAL_CAPACITY),
+    m_bucketWidth(0), m_count(0), m_boundingRectValid(false)
+{}
+
+size_t PlotDataBuffer::size() const
+{
+    return isDecimated() ? 2 * m_buckets.size() : m_samples.size();
+}
+
+QPointF PlotDataBuffer::sample(size_t i) const
+{
+    QPointF point;
+
+    if (isDecimated()) {
+        // Each bucket is drawn as its minimum and maximum, in x order
+        const Bucket &bucket = m_buckets.at(i / 2);
+        bool minFirst = bucket.min.x() <= bucket.max.x();
+        point = ((i % 2 == 0) == minFirst) ? bucket.min : bucket.max;
+    } else {
+        point = m_samples.at(i);
+    }
+
+    if (m_plotType == SequentialPlot) {
+        point.setX(point.x() - m_samples.first().x());
+    }
+    return point;
+}
+
+QRectF PlotDataBuffer::boundingRect() const
+{
+    if (!m_boundingRectValid) {
+        d_boundingRect      = qwtBoundingRect(*this);
+        m_boundingRectValid = true;
+    }
+    return d_boundingRect;
+}
+
+void PlotDataBuffer::append(double x, double y)
+{
+    if (m_plotType == SequentialPlot) {
+        // Drop the oldest sample once full
+        if (m_samples.size() >= m_capacity) {
+            m_samples.removeFirst();
+        }
+        x = m_count++;
+    }
+    m_samples.append(QPointF(x, y));
+    if (m_bucketWidth > 0) {
+        addToBucket(m_samples.last());
+        removeStaleBuckets();
+    }
+    m_boundingRectValid = false;
+}
+
+void PlotDataBuffer::removeFirst()
+{
+    m_samples.removeFirst();
+    if (m_bucketWidth > 0) {
+        removeStaleBuckets();
+    }
+    m_boundingRectValid = false;
+}
+
+void PlotDataBuffer::clear()
+{
+    m_samples.clear();
+    m_buckets.clear();
+    m_count = 0;
+    m_boundingRectValid = false;
+}
+
+/*!
+   \brief Set the width along x of the buckets samples are reduced to, 0 disables decimation.
+   Changing the width rebuilds the buckets from the stored samples.
+ */
+void PlotDataBuffer::setBucketWidth(double bucketWidth)
+{
+    if (bucketWidth == m_bucketWidth) {
+        return;
+    }
+    m_bucketWidth = bucketWidth;
+    m_buckets.clear();
+    if (m_bucketWidth > 0) {
+        for (int i = 0; i < m_samples.size(); i++) {
+            addToBucket(m_samples.at(i));
+        }
+    }
+    m_boundingRectValid = false;
+}
+
+void PlotDataBuffer::addToBucket(const QPointF &point)
+{
+    qint64 key = (qint64)floor(point.x() / m_bucketWidth);
+
+    if (!m_buckets.isEmpty() && m_buckets.last().key == key) {
+        Bucket &bucket = m_buckets.last();
+        if (point.y() < bucket.min.y()) {
+            bucket.min = point;
+        }
+        if (point.y() > bucket.max.y()) {
+            bucket.max = point;
+        }
+    } else {
+        Bucket bucket = { key, point, point };
+        m_buckets.append(bucket);
+    }
+}
+
+void PlotDataBuffer::removeStaleBuckets()
+{
+    if (m_samples.isEmpty()) {
+        m_buckets.clear();
+        return;
+    }
+    // The first bucket may still hold a few removed samples
+    qint64 firstKey = (qint64)floor(m_samples.first().x() / m_bucketWidth);
+    while (!m_buckets.isEmpty() && m_buckets.first().key < firstKey) {
+        m_buckets.removeFirst();
+    }
+}
+
+PlotData::PlotData(PlotType plotType, UAVObject *object, UAVObjectField *field, int element,
                    int scaleOrderFactor, int meanSamples, QString mathFunction,
                    double plotDataSize, QPen pen, bool antialiased) :
-    m_scalePower(scaleOrderFactor), m_meanSamples(meanSamples),
-    m_meanSum(0.0f), m_mathFunction(mathFunction), m_correctionSum(0.0f),
-    m_correctionCount(0), m_plotDataSize(plotDataSize),
+    m_scalePower(scaleOrderFactor), m_meanSamples(qMax(meanSamples, 1)),
+    m_meanSum(0.0f), m_meanSquareSum(0.0f), m_mathFunction(MathNone), m_correctionSum(0.0f),
+    m_correctionSquareSum(0.0f), m_correctionCount(0), m_plotDataSize(plotDataSize),
+    m_data(NULL), m_yDataHistory(qMax(meanSamples, 1)), m_historyIndex(0), m_historyCount(0),
     m_object(object), m_field(field), m_element(element),
     m_plotCurve(NULL), m_isVisible(true), m_pen(pen), m_isEnumPlot(false)
 {
+    if (mathFunction == "Boxcar average") {
+        m_mathFunction = MathBoxcarAverage;
+    } else if (mathFunction == "Standard deviation") {
+        m_mathFunction = MathStandardDeviation;
+    }
+
     if (m_field->getNumElements() > 1) {
         m_elementName = m_field->getElementNames().at(m_element);
     }
@@ -62,7 +194,8 @@ PlotData::PlotData(UAVObject *object, UAVObjectField *field, int element,
     }
 
     m_plotCurve->setPen(m_pen);
-    m_plotCurve->setSamples(m_xDataEntries, m_yDataEntries);
+    m_data = new PlotDataBuffer(plotType, plotType == SequentialPlot ? (int)m_plotDataSize : CHRONO_INITIAL_CAPACITY);
+    m_plotCurve->setData(m_data);
     m_isEnumPlot = m_field->getType() == UAVObjectField::ENUM;
 }
 
@@ -90,16 +223,28 @@ void PlotData::setVisible(bool visible)
 
 void PlotData::updatePlotData()
 {
-    m_plotCurve->setSamples(m_xDataEntries, m_yDataEntries);
+    // The curve reads the buffer directly, only notify the change
+    m_plotCurve->itemChanged();
+}
+
+/*!
+   \brief Reduce the curve to the minimum and maximum of each bucket of the given width along x.
+ */
+void PlotData::setDecimation(double bucketWidth)
+{
+    m_data->setBucketWidth(bucketWidth);
 }
 
 void PlotData::clear()
 {
     m_meanSum = 0.0f;
-    m_correctionSum   = 0.0f;
-    m_correctionCount = 0;
-    m_xDataEntries.clear();
-    m_yDataEntries.clear();
+    m_meanSquareSum = 0.0f;
+    m_correctionSum = 0.0f;
+    m_correctionSquareSum = 0.0f;
+    m_correctionCount     = 0;
+    m_historyIndex = 0;
+    m_historyCount = 0;
+    m_data->clear();
     while (!m_enumMarkerList.isEmpty()) {
         QwtPlotMarker *marker = m_enumMarkerList.takeFirst();
         marker->detach();
@@ -113,7 +258,7 @@ void PlotData::clear()
 bool PlotData::hasData() const
 {
     if (!m_isEnumPlot) {
-        return !m_xDataEntries.isEmpty();
+        return !m_data->isEmpty();
     } else {
         return !m_enumMarkerList.isEmpty();
     }
@@ -122,7 +267,7 @@ bool PlotData::hasData() const
 QString PlotData::lastDataAsString()
 {
     if (!m_isEnumPlot) {
-        return QString().sprintf("%3.10g", m_yDataEntries.last());
+        return QString().sprintf("%3.10g", m_data->last().y());
     } else {
         return m_enumMarkerList.last()->title().text();
     }
@@ -142,37 +287,42 @@ void PlotData::visibilityChanged(QwtPlotItem *item)
     }
 }
 
-void PlotData::calcMathFunction(double currentValue)
+double PlotData::calcMathFunction(double currentValue)
 {
-    // Put the new value at the back
-    m_yDataHistory.append(currentValue);
+    // Put the new value at the back, replacing the oldest one
+    if (m_historyCount < m_meanSamples) {
+        m_historyCount++;
+    } else {
+        double oldest = m_yDataHistory.at(m_historyIndex);
+        m_meanSum       -= oldest;
+        m_meanSquareSum -= oldest * oldest;
+    }
+    m_yDataHistory[m_historyIndex] = currentValue;
+    m_historyIndex   = (m_historyIndex + 1) % m_meanSamples;
 
     // calculate average value
-    m_meanSum += currentValue;
-    if (m_yDataHistory.size() > m_meanSamples) {
-        m_meanSum -= m_yDataHistory.first();
-        m_yDataHistory.pop_front();
-    }
-    // make sure to correct the sum every meanSamples steps to prevent it
+    m_meanSum       += currentValue;
+    m_meanSquareSum += currentValue * currentValue;
+
+    // make sure to correct the sums every meanSamples steps to prevent them
     // from running away due to floating point rounding errors
     m_correctionSum += currentValue;
+    m_correctionSquareSum += currentValue * currentValue;
     if (++m_correctionCount >= m_meanSamples) {
         m_meanSum = m_correctionSum;
+        m_meanSquareSum = m_correctionSquareSum;
         m_correctionSum = 0.0f;
-        m_correctionCount = 0;
+        m_correctionSquareSum = 0.0f;
+        m_correctionCount     = 0;
     }
 
-    double boxcarAvg = m_meanSum / m_yDataHistory.size();
-    if (m_mathFunction == "Standard deviation") {
+    double boxcarAvg = m_meanSum / m_historyCount;
+    if (m_mathFunction == MathStandardDeviation) {
         // Calculate square of sample standard deviation, with Bessel's correction
-        double stdSum = 0;
-        for (int i = 0; i < m_yDataHistory.size(); i++) {
-            stdSum += pow(m_yDataHistory.at(i) - boxcarAvg, 2) / (m_meanSamples - 1);
-        }
-        m_yDataEntries.append(sqrt(stdSum));
-    } else {
-        m_yDataEntries.append(boxcarAvg);
+        double stdSum = (m_meanSquareSum - m_meanSum * boxcarAvg) / (m_meanSamples - 1);
+        return sqrt(qMax(stdSum, 0.0));
     }
+    return boxcarAvg;
 }
 
 QwtPlotMarker *PlotData::createMarker(QString value)
@@ -207,22 +357,17 @@ bool SequentialPlotData::append(UAVObject *obj)
 
     if (m_object == obj && m_field) {
         if (!m_isEnumPlot) {
-            double currentValue = m_field->getValue(m_element).toDouble() * pow(10, m_scalePower);
+            double currentValue = 0.0;
+            m_field->getDoubles(&currentValue, 1, m_element);
+            currentValue *= pow(10, m_scalePower);
 
             // Perform scope math, if necessary
-            if (m_mathFunction == "Boxcar average" || m_mathFunction == "Standard deviation") {
-                calcMathFunction(currentValue);
-            } else {
-                m_yDataEntries.append(currentValue);
+            if (m_mathFunction != MathNone) {
+                currentValue = calcMathFunction(currentValue);
             }
 
-            if (m_yDataEntries.size() > m_plotDataSize) {
-                // If new data overflows the window, remove old data...
-                m_yDataEntries.pop_front();
-            } else {
-                // ...otherwise, add a new y point at position xData
-                m_xDataEntries.insert(m_xDataEntries.size(), m_xDataEntries.size());
-            }
+            // Once the window is full the oldest value is dropped, x values are positions
+            m_data->append(0, currentValue);
             return true;
         } else {
             // Enum markers
@@ -256,16 +401,16 @@ bool ChronoPlotData::append(UAVObject *obj)
 
         double xValue = NOW.toTime_t() + NOW.time().msec() / 1000.0;
         if (!m_isEnumPlot) {
-            double currentValue = m_field->getValue(m_element).toDouble() * pow(10, m_scalePower);
+            double currentValue = 0.0;
+            m_field->getDoubles(&currentValue, 1, m_element);
+            currentValue *= pow(10, m_scalePower);
 
             // Perform scope math, if necessary
-            if (m_mathFunction == "Boxcar average" || m_mathFunction == "Standard deviation") {
-                calcMathFunction(currentValue);
-            } else {
-                m_yDataEntries.append(currentValue);
+            if (m_mathFunction != MathNone) {
+                currentValue = calcMathFunction(currentValue);
             }
 
-            m_xDataEntries.append(xValue);
+            m_data->append(xValue, currentValue);
         } else {
             // Enum markers
             QString value = m_field->getValue(m_element).toString();
@@ -289,10 +434,9 @@ bool ChronoPlotData::append(UAVObject *obj)
 
 void ChronoPlotData::removeStaleData()
 {
-    while (!m_xDataEntries.isEmpty() &&
-           (m_xDataEntries.last() - m_xDataEntries.first()) > m_plotDataSize) {
-        m_yDataEntries.pop_front();
-        m_xDataEntries.pop_front();
+    while (!m_data->isEmpty() &&
+           (m_data->last().x() - m_data->first().x()) > m_plotDataSize) {
+        m_data->removeFirst();
     }
     while (!m_enumMarkerList.isEmpty() &&
            (m_enumMarkerList.last()->xValue() - m_enumMarkerList.first()->xValue()) > m_plotDataSize) {
@@ -35,6 +35,7 @@
 #include "qwt/src/qwt_plot_curve.h"
 #include "qwt/src/qwt_scale_draw.h"
 #include "qwt/src/qwt_scale_widget.h"
+#include "qwt/src/qwt_series_data.h"
 #include <qwt/src/qwt_plot_marker.h>
 
 #include <QTimer>
@@ -47,6 +48,143 @@
  */
 enum PlotType { SequentialPlot, ChronoPlot };
 
+/*!
+   \brief Math functions applied to the samples before plotting.
+ */
+enum MathFunction { MathNone, MathBoxcarAverage, MathStandardDeviation };
+
+/*!
+   \brief Growable circular buffer, removing from the front and appending are O(1).
+ */
+template <typename T>
+class PlotRingBuffer {
+public:
+    PlotRingBuffer(int capacity) : m_items(qMax(capacity, 1)), m_first(0), m_size(0) {}
+
+    int size() const
+    {
+        return m_size;
+    }
+    int capacity() const
+    {
+        return m_items.size();
+    }
+    bool isEmpty() const
+    {
+        return m_size == 0;
+    }
+    const T &at(int i) const
+    {
+        return m_items.at((m_first + i) % m_items.size());
+    }
+    const T &first() const
+    {
+        return at(0);
+    }
+    const T &last() const
+    {
+        return at(m_size - 1);
+    }
+    T &last()
+    {
+        return m_items[(m_first + m_size - 1) % m_items.size()];
+    }
+
+    void append(const T &item)
+    {
+        if (m_size == m_items.size()) {
+            // Unwrap into a buffer twice as large
+            QVector<T> items(m_items.size() * 2);
+            for (int i = 0; i < m_size; i++) {
+                items[i] = at(i);
+            }
+            m_items = items;
+            m_first = 0;
+        }
+        m_items[(m_first + m_size) % m_items.size()] = item;
+        m_size++;
+    }
+    void removeFirst()
+    {
+        if (m_size > 0) {
+            m_first = (m_first + 1) % m_items.size();
+            m_size--;
+        }
+    }
+    void clear()
+    {
+        m_first = 0;
+        m_size  = 0;
+    }
+
+private:
+    QVector<T> m_items;
+    int m_first;
+    int m_size;
+};
+
+/*!
+   \brief Curve samples, read by the curve without copying.
+
+   A sequential buffer keeps a fixed number of samples and drops the oldest one when full,
+   its x values are the sample positions. A chrono buffer grows as needed and old samples
+   are removed with removeFirst().
+
+   With a bucket width set, samples are also reduced as they arrive to the minimum and
+   maximum of each bucket of that width along x, and the curve is drawn from these
+   two points per bucket when that is fewer than the samples.
+ */
+class PlotDataBuffer : public QwtSeriesData<QPointF> {
+public:
+    PlotDataBuffer(PlotType plotType, int capacity);
+
+    size_t size() const;
+    QPointF sample(size_t i) const;
+    QRectF boundingRect() const;
+
+    // Stored samples, regardless of decimation
+    bool isEmpty() const
+    {
+        return m_samples.isEmpty();
+    }
+    QPointF first() const
+    {
+        return m_samples.first();
+    }
+    QPointF last() const
+    {
+        return m_samples.last();
+    }
+
+    void append(double x, double y);
+    void removeFirst();
+    void clear();
+    void setBucketWidth(double bucketWidth);
+
+private:
+    typedef struct {
+        qint64  key;
+        QPointF min;
+        QPointF max;
+    } Bucket;
+
+    PlotType m_plotType;
+    int m_capacity;
+    PlotRingBuffer<QPointF> m_samples;
+    PlotRingBuffer<Bucket> m_buckets;
+    double m_bucketWidth;
+    // Sequential samples are numbered from the first one appended
+    qint64 m_count;
+    mutable bool m_boundingRectValid;
+
+    bool isDecimated() const
+    {
+        return m_bucketWidth > 0 && m_samples.size() > 2 * m_buckets.size();
+    }
+    void addToBucket(const QPointF &point);
+    void removeStaleBuckets();
+};
+
 /*!
    \brief Base class that keeps the data for each curve in the plot.
  */
@@ -54,7 +192,7 @@ class PlotData : public QObject {
     Q_OBJECT
 
 public:
-    PlotData(UAVObject *object, UAVObjectField *field, int element, int scaleOrderFactor, int meanSamples,
+    PlotData(PlotType plotType, UAVObject *object, UAVObjectField *field, int element, int scaleOrderFactor, int meanSamples,
              QString mathFunction, double plotDataSize, QPen pen, bool antialiased);
     ~PlotData();
 
@@ -93,6 +231,7 @@ public:
     virtual void removeStaleData() = 0;
 
     void updatePlotData();
+    void setDecimation(double bucketWidth);
     void clear();
 
     bool hasData() const;
@@ -108,14 +247,19 @@ protected:
     int m_scalePower;
     int m_meanSamples;
     double m_meanSum;
-    QString m_mathFunction;
+    double m_meanSquareSum;
+    MathFunction m_mathFunction;
     double m_correctionSum;
+    double m_correctionSquareSum;
     int m_correctionCount;
     double m_plotDataSize;
 
-    QVector<double> m_xDataEntries;
-    QVector<double> m_yDataEntries;
+    // Owned by the curve
+    PlotDataBuffer *m_data;
+    // Last m_meanSamples values, m_historyIndex is the oldest once full
     QVector<double> m_yDataHistory;
+    int m_historyIndex;
+    int m_historyCount;
 
     UAVObject *m_object;
     UAVObjectField *m_field;
@@ -127,7 +271,7 @@ protected:
     bool m_isVisible;
     QPen m_pen;
     bool m_isEnumPlot;
-    virtual void calcMathFunction(double currentValue);
+    virtual double calcMathFunction(double currentValue);
     QwtPlotMarker *createMarker(QString value);
 };
 
@@ -141,7 +285,7 @@ public:
     SequentialPlotData(UAVObject *object, UAVObjectField *field, int element,
                        int scaleFactor, int meanSamples, QString mathFunction,
                        double plotDataSize, QPen pen, bool antialiased)
-        : PlotData(object, field, element, scaleFactor, meanSamples,
+        : PlotData(SequentialPlot, object, field, element, scaleFactor, meanSamples,
                    mathFunction, plotDataSize, pen, antialiased) {}
     ~SequentialPlotData() {}
 
@@ -162,7 +306,7 @@ public:
     ChronoPlotData(UAVObject *object, UAVObjectField *field, int element,
                    int scaleFactor, int meanSamples, QString mathFunction,
                    double plotDataSize, QPen pen, bool antialiased)
-        : PlotData(object, field, element, scaleFactor, meanSamples,
+        : PlotData(ChronoPlot, object, field, element, scaleFactor, meanSamples,
                    mathFunction, plotDataSize, pen, antialiased)
     {}
     ~ChronoPlotData() {}
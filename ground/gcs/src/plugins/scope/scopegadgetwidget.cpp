@@ -430,8 +430,12 @@ void ScopeGadgetWidget::replotNewData()
     }
 
     QMutexLocker locker(&m_mutex);
+    // Draw at most the minimum and maximum per pixel column, so long windows
+    // cost no more to redraw than the canvas is wide
+    double bucketWidth = m_plotDataSize / qMax(canvas()->width(), 1);
     foreach(PlotData * plotData, m_curvesData.values()) {
         plotData->removeStaleData();
+        plotData->setDecimation(bucketWidth);
         plotData->updatePlotData();
     }
 
@@ -0,0 +1,16 @@
+QT += testlib widgets
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+TARGET = tst_plotdata
+
+include(../../../../gcs.pri)
+include(../scope_dependencies.pri)
+
+INCLUDEPATH += $$GCS_SOURCE_TREE/src/plugins $$GCS_SOURCE_TREE/src/libs ..
+LIBS += -L$$GCS_PLUGIN_PATH/$$ORG_BIG_NAME
+LIBS *= -l$$qtLibraryName(Qwt)
+
+HEADERS += ../plotdata.h
+SOURCES += ../plotdata.cpp \
+    tst_plotdata.cpp
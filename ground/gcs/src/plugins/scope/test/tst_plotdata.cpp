@@ -0,0 +1,261 @@
+/**
+ ******************************************************************************
+ *
+ * @file       tst_plotdata.cpp
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup ScopePlugin Scope Gadget Plugin
+ * @{
+ * @brief Scope curve buffer tests, ring wrap and min/max decimation
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "plotdata.h"
+
+#include <QtCore/QObject>
+#include <QtTest/QtTest>
+#include <math.h>
+
+// Number of samples fed to the decimation tests
+#define NUM_SAMPLES 1000
+
+// Deterministic noisy signal, with repeated values so ties are covered
+static double sampleValue(int i)
+{
+    return floor(sin(i * 0.37) * 100) + (i * 7919) % 13;
+}
+
+// Plain min/max envelope of consecutive samples sharing floor(x / bucketWidth),
+// each bucket given as its minimum and maximum in x order
+static QVector<QPointF> envelope(const QVector<QPointF> &samples, double bucketWidth)
+{
+    QVector<QPointF> result;
+    int i = 0;
+
+    while (i < samples.size()) {
+        qint64 key = (qint64)floor(samples.at(i).x() / bucketWidth);
+        QPointF min = samples.at(i);
+        QPointF max = samples.at(i);
+        for (i++; i < samples.size() && (qint64)floor(samples.at(i).x() / bucketWidth) == key; i++) {
+            if (samples.at(i).y() < min.y()) {
+                min = samples.at(i);
+            }
+            if (samples.at(i).y() > max.y()) {
+                max = samples.at(i);
+            }
+        }
+        if (min.x() <= max.x()) {
+            result << min << max;
+        } else {
+            result << max << min;
+        }
+    }
+    return result;
+}
+
+static QVector<QPointF> curve(const PlotDataBuffer &buffer)
+{
+    QVector<QPointF> result;
+
+    for (size_t i = 0; i < buffer.size(); i++) {
+        result << buffer.sample(i);
+    }
+    return result;
+}
+
+class tst_PlotData : public QObject {
+    Q_OBJECT
+
+private slots:
+    void ringBufferWrap();
+    void sequentialDropsOldest();
+    void chronoRemoveFirst();
+    void decimation_data();
+    void decimation();
+    void decimationAfterRemoval();
+    void sequentialDecimation();
+    void noDecimationWhenSparse();
+};
+
+void tst_PlotData::ringBufferWrap()
+{
+    PlotRingBuffer<int> ring(4);
+
+    ring.append(1);
+    ring.append(2);
+    ring.append(3);
+    ring.removeFirst();
+    ring.removeFirst();
+    // Wraps around the end of the storage
+    ring.append(4);
+    ring.append(5);
+    ring.append(6);
+    QCOMPARE(ring.capacity(), 4);
+    QCOMPARE(ring.size(), 4);
+    for (int i = 0; i < ring.size(); i++) {
+        QCOMPARE(ring.at(i), 3 + i);
+    }
+
+    // Full while wrapped, grows and keeps the order
+    ring.append(7);
+    QCOMPARE(ring.capacity(), 8);
+    QCOMPARE(ring.size(), 5);
+    for (int i = 0; i < ring.size(); i++) {
+        QCOMPARE(ring.at(i), 3 + i);
+    }
+    QCOMPARE(ring.first(), 3);
+    QCOMPARE(ring.last(), 7);
+
+    ring.clear();
+    QVERIFY(ring.isEmpty());
+    ring.removeFirst();
+    QCOMPARE(ring.size(), 0);
+}
+
+void tst_PlotData::sequentialDropsOldest()
+{
+    PlotDataBuffer buffer(SequentialPlot, 5);
+
+    for (int i = 0; i < 12; i++) {
+        buffer.append(0, i * 10);
+    }
+    QCOMPARE((int)buffer.size(), 5);
+    for (int i = 0; i < 5; i++) {
+        QCOMPARE(buffer.sample(i), QPointF(i, (7 + i) * 10));
+    }
+    QCOMPARE(buffer.boundingRect(), QRectF(0, 70, 4, 40));
+    QCOMPARE(buffer.last().y(), 110.0);
+}
+
+void tst_PlotData::chronoRemoveFirst()
+{
+    PlotDataBuffer buffer(ChronoPlot, 4);
+
+    for (int i = 0; i < 3; i++) {
+        buffer.append(i, sampleValue(i));
+    }
+    buffer.removeFirst();
+    buffer.removeFirst();
+    // Wraps, then grows past the initial capacity
+    for (int i = 3; i < 20; i++) {
+        buffer.append(i, sampleValue(i));
+    }
+    QCOMPARE((int)buffer.size(), 18);
+    for (int i = 0; i < 18; i++) {
+        QCOMPARE(buffer.sample(i), QPointF(2 + i, sampleValue(2 + i)));
+    }
+}
+
+void tst_PlotData::decimation_data()
+{
+    QTest::addColumn<double>("bucketWidth");
+
+    QTest::newRow("3") << 3.0;
+    QTest::newRow("10") << 10.0;
+    QTest::newRow("37.5") << 37.5;
+    QTest::newRow("whole") << 2.0 * NUM_SAMPLES;
+}
+
+void tst_PlotData::decimation()
+{
+    QFETCH(double, bucketWidth);
+
+    PlotDataBuffer incremental(ChronoPlot, 4);
+    PlotDataBuffer rebuilt(ChronoPlot, 4);
+    QVector<QPointF> samples;
+
+    incremental.setBucketWidth(bucketWidth);
+    for (int i = 0; i < NUM_SAMPLES; i++) {
+        samples << QPointF(i, sampleValue(i));
+        incremental.append(i, sampleValue(i));
+        rebuilt.append(i, sampleValue(i));
+    }
+    rebuilt.setBucketWidth(bucketWidth);
+
+    QVector<QPointF> expected = envelope(samples, bucketWidth);
+    QVERIFY(expected.size() < samples.size());
+    QCOMPARE(curve(incremental), expected);
+    QCOMPARE(curve(rebuilt), expected);
+    // The envelope keeps the extremes
+    QCOMPARE(incremental.boundingRect(), QPolygonF(samples).boundingRect());
+
+    // Back to the stored samples
+    incremental.setBucketWidth(0);
+    QCOMPARE(curve(incremental), samples);
+}
+
+void tst_PlotData::decimationAfterRemoval()
+{
+    PlotDataBuffer buffer(ChronoPlot, 4);
+    QVector<QPointF> samples;
+
+    buffer.setBucketWidth(50);
+    for (int i = 0; i < NUM_SAMPLES; i++) {
+        samples << QPointF(i, sampleValue(i));
+        buffer.append(i, sampleValue(i));
+    }
+    // Drop the first two buckets entirely
+    for (int i = 0; i < 100; i++) {
+        buffer.removeFirst();
+        samples.removeFirst();
+    }
+    QCOMPARE(curve(buffer), envelope(samples, 50));
+
+    buffer.clear();
+    QCOMPARE((int)buffer.size(), 0);
+    buffer.append(5, 1);
+    QCOMPARE(curve(buffer), QVector<QPointF>() << QPointF(5, 1));
+}
+
+void tst_PlotData::sequentialDecimation()
+{
+    PlotDataBuffer buffer(SequentialPlot, 200);
+    QVector<QPointF> samples;
+
+    buffer.setBucketWidth(10);
+    for (int i = 0; i < 500; i++) {
+        buffer.append(0, sampleValue(i));
+    }
+    // Positions 300 to 499 are kept, drawn from 0
+    for (int i = 300; i < 500; i++) {
+        samples << QPointF(i, sampleValue(i));
+    }
+    QVector<QPointF> expected = envelope(samples, 10);
+    for (int i = 0; i < expected.size(); i++) {
+        expected[i].rx() -= 300;
+    }
+    QCOMPARE(curve(buffer), expected);
+}
+
+void tst_PlotData::noDecimationWhenSparse()
+{
+    PlotDataBuffer buffer(ChronoPlot, 4);
+    QVector<QPointF> samples;
+
+    // One sample per bucket, the envelope would double the points
+    buffer.setBucketWidth(0.5);
+    for (int i = 0; i < 100; i++) {
+        samples << QPointF(i, sampleValue(i));
+        buffer.append(i, sampleValue(i));
+    }
+    QCOMPARE(curve(buffer), samples);
+}
+
+QTEST_GUILESS_MAIN(tst_PlotData)
+
+#include "tst_plotdata.moc"
@@ -78,6 +78,8 @@ UAVObjectBrowserWidget::UAVObjectBrowserWidget(QWidget *parent) : QWidget(parent
     connect(m_browser->eraseSDButton, SIGNAL(clicked()), this, SLOT(eraseObject()));
     connect(m_browser->tbView, SIGNAL(clicked()), this, SLOT(viewSlot()));
     connect(m_browser->splitter, SIGNAL(splitterMoved(int, int)), this, SLOT(splitterMoved()));
+    connect(m_browser->treeView, SIGNAL(expanded(QModelIndex)), this, SLOT(itemExpanded(QModelIndex)));
+    connect(m_browser->treeView, SIGNAL(collapsed(QModelIndex)), this, SLOT(itemCollapsed(QModelIndex)));
 
     connect(m_viewoptions->cbDescription, SIGNAL(toggled(bool)), this, SLOT(showDescription(bool)));
 
@@ -127,6 +129,8 @@ void UAVObjectBrowserWidget::sendUpdate()
     ObjectTreeItem *objItem = findCurrentObjectTreeItem();
 
     if (objItem != NULL) {
+        // Fields of an object updated while collapsed still hold old values
+        m_model->refreshObjectTreeItem(objItem);
         objItem->apply();
         UAVObject *obj = objItem->object();
         Q_ASSERT(obj);
@@ -297,6 +301,31 @@ void UAVObjectBrowserWidget::splitterMoved()
     emit splitterChanged(m_browser->splitter->saveState());
 }
 
+void UAVObjectBrowserWidget::itemExpanded(const QModelIndex &index)
+{
+    m_model->setExpanded(m_modelProxy->mapToSource(index), true);
+}
+
+void UAVObjectBrowserWidget::itemCollapsed(const QModelIndex &index)
+{
+    m_model->setExpanded(m_modelProxy->mapToSource(index), false);
+}
+
+/**
+ * @brief UAVObjectBrowserWidget::updateExpandedState Passes the expand state of the view to the model,
+ * expandToDepth() and collapseAll() change it without emitting expanded() or collapsed()
+ */
+void UAVObjectBrowserWidget::updateExpandedState(const QModelIndex &parent)
+{
+    for (int row = 0; row < m_modelProxy->rowCount(parent); ++row) {
+        QModelIndex index = m_modelProxy->index(row, 0, parent);
+        if (m_modelProxy->hasChildren(index)) {
+            m_model->setExpanded(m_modelProxy->mapToSource(index), m_browser->treeView->isExpanded(index));
+            updateExpandedState(index);
+        }
+    }
+}
+
 QString UAVObjectBrowserWidget::createObjectDescription(UAVObject *object)
 {
     QString mustache(m_mustacheTemplate);
@@ -413,6 +442,7 @@ void UAVObjectBrowserWidget::searchLineChanged(QString searchText)
     } else {
         m_browser->treeView->collapseAll();
     }
+    updateExpandedState(QModelIndex());
 }
 
 void UAVObjectBrowserWidget::searchTextCleared()
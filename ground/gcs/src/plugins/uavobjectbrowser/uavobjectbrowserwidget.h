@@ -102,6 +102,8 @@ private slots:
     void searchLineChanged(QString searchText);
     void searchTextCleared();
     void splitterMoved();
+    void itemExpanded(const QModelIndex &index);
+    void itemCollapsed(const QModelIndex &index);
     QString createObjectDescription(UAVObject *object);
 
 signals:
@@ -125,6 +127,7 @@ private:
     void updateObjectPersistance(ObjectPersistence::OperationOptions op, UAVObject *obj);
     void enableSendRequest(bool enable);
     void updateDescription();
+    void updateExpandedState(const QModelIndex &parent);
     ObjectTreeItem *findCurrentObjectTreeItem();
     QString loadFileIntoString(QString fileName);
 };
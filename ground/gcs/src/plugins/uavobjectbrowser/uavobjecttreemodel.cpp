@@ -37,6 +37,9 @@
 #include <QtCore/QSignalMapper>
 #include <QtCore/QDebug>
 
+// Updated objects are refreshed at most this often (ms)
+#define REFRESH_INTERVAL 50
+
 UAVObjectTreeModel::UAVObjectTreeModel(QObject *parent, bool categorize, bool showMetadata, bool useScientificNotation) :
     QAbstractItemModel(parent),
     m_categorize(categorize),
@@ -54,6 +57,13 @@ UAVObjectTreeModel::UAVObjectTreeModel(QObject *parent, bool categorize, bool sh
 
     // Create highlight manager, let it run every 300 ms.
     m_highlightManager = new HighLightManager(300);
+
+    // Updates are collected and the visible ones refreshed by this timer.
+    m_refreshTimer = new QTimer(this);
+    m_refreshTimer->setSingleShot(true);
+    m_refreshTimer->setInterval(REFRESH_INTERVAL);
+    connect(m_refreshTimer, SIGNAL(timeout()), this, SLOT(refreshUpdatedObjects()));
+
     connect(objManager, SIGNAL(newObject(UAVObject *)), this, SLOT(newObject(UAVObject *)));
     connect(objManager, SIGNAL(newInstance(UAVObject *)), this, SLOT(newObject(UAVObject *)));
 
@@ -161,6 +171,7 @@ MetaObjectTreeItem *UAVObjectTreeModel::addMetaObject(UAVMetaObject *obj, TreeIt
 
     meta->setHighlightManager(m_highlightManager);
     connect(meta, SIGNAL(updateHighlight(TreeItem *)), this, SLOT(updateHighlight(TreeItem *)));
+    m_objectTreeItems.insert(obj, meta);
     foreach(UAVObjectField * field, obj->getFields()) {
         if (field->getNumElements() > 1) {
             addArrayField(field, meta);
@@ -176,11 +187,10 @@ void UAVObjectTreeModel::addInstance(UAVObject *obj, TreeItem *parent)
 {
     connect(obj, SIGNAL(objectUpdated(UAVObject *)), this, SLOT(highlightUpdatedObject(UAVObject *)));
     connect(obj, SIGNAL(isKnownChanged(UAVObject *, bool)), this, SLOT(isKnownChanged(UAVObject *, bool)));
-    TreeItem *item;
+    ObjectTreeItem *item;
     if (obj->isSingleInstance()) {
-        item = parent;
-        DataObjectTreeItem *objectItem = static_cast<DataObjectTreeItem *>(parent);
-        connect(objectItem, SIGNAL(updateIsKnown(TreeItem *)), this, SLOT(updateIsKnown(TreeItem *)));
+        item = static_cast<DataObjectTreeItem *>(parent);
+        connect(item, SIGNAL(updateIsKnown(TreeItem *)), this, SLOT(updateIsKnown(TreeItem *)));
     } else {
         QString name = tr("Instance") + " " + QString::number(obj->getInstID());
         item = new InstanceTreeItem(obj, name);
@@ -189,6 +199,7 @@ void UAVObjectTreeModel::addInstance(UAVObject *obj, TreeItem *parent)
         connect(item, SIGNAL(updateIsKnown(TreeItem *)), this, SLOT(updateIsKnown(TreeItem *)));
         parent->appendChild(item);
     }
+    m_objectTreeItems.insert(obj, item);
     foreach(UAVObjectField * field, obj->getFields()) {
         if (field->getNumElements() > 1) {
             addArrayField(field, item);
@@ -459,16 +470,109 @@ QVariant UAVObjectTreeModel::headerData(int section, Qt::Orientation orientation
 void UAVObjectTreeModel::highlightUpdatedObject(UAVObject *obj)
 {
     Q_ASSERT(obj);
-    ObjectTreeItem *item = findObjectTreeItem(obj);
+    // Only note the update here, objects can be updated much faster
+    // than it is worth redrawing them.
+    m_updatedObjects.insert(obj);
+    if (!m_refreshTimer->isActive()) {
+        m_refreshTimer->start();
+    }
+}
+
+void UAVObjectTreeModel::refreshUpdatedObjects()
+{
+    // Highlight the rows of objects updated since the last refresh,
+    // their fields are read below once they can be seen.
+    foreach(UAVObject * obj, m_updatedObjects) {
+        ObjectTreeItem *item = m_objectTreeItems.value(obj);
+
+        Q_ASSERT(item);
+        // Instances of a collapsed object show on the object's row
+        ObjectTreeItem *row = visibleObjectTreeItem(item);
+        if (!m_onlyHilightChangedValues && row) {
+            row->setHighlight(true);
+            QModelIndex itemIndex = index(row);
+            Q_ASSERT(itemIndex != QModelIndex());
+            emit dataChanged(itemIndex, itemIndex);
+        }
+        m_staleObjects.insert(obj);
+    }
+    m_updatedObjects.clear();
+
+    // Read the fields of objects that are expanded. When only changed values
+    // are highlighted, reading them is what finds the change, so do it as
+    // soon as the row, or that of the collapsed object above it, can be seen.
+    QSet<UAVObject *>::iterator iter = m_staleObjects.begin();
+    while (iter != m_staleObjects.end()) {
+        ObjectTreeItem *item = m_objectTreeItems.value(*iter);
+        bool visible;
+        if (m_onlyHilightChangedValues) {
+            visible = visibleObjectTreeItem(item) != 0;
+        } else {
+            visible = isRowVisible(item) && m_expandedItems.contains(item);
+        }
+        if (visible) {
+            item->update();
+            iter = m_staleObjects.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+void UAVObjectTreeModel::refreshObjectTreeItem(ObjectTreeItem *item)
+{
     Q_ASSERT(item);
-    if (!m_onlyHilightChangedValues) {
-        item->setHighlight(true);
-    }
-    item->update();
-    if (!m_onlyHilightChangedValues) {
-        QModelIndex itemIndex = index(item);
-        Q_ASSERT(itemIndex != QModelIndex());
-        emit dataChanged(itemIndex, itemIndex);
+    // Objects updated since the last refresh are not in the stale set yet
+    foreach(UAVObject * obj, m_updatedObjects) {
+        ObjectTreeItem *updated = m_objectTreeItems.value(obj);
+        if (updated == item || updated->parent() == item) {
+            updated->update();
+        }
+    }
+    QSet<UAVObject *>::iterator iter = m_staleObjects.begin();
+    while (iter != m_staleObjects.end()) {
+        ObjectTreeItem *stale = m_objectTreeItems.value(*iter);
+        if (stale == item || stale->parent() == item) {
+            stale->update();
+            iter = m_staleObjects.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+bool UAVObjectTreeModel::isRowVisible(TreeItem *item) const
+{
+    for (TreeItem *parent = item->parent(); parent && parent != m_rootItem; parent = parent->parent()) {
+        if (!m_expandedItems.contains(parent)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ObjectTreeItem *UAVObjectTreeModel::visibleObjectTreeItem(ObjectTreeItem *item) const
+{
+    while (item && !isRowVisible(item)) {
+        item = dynamic_cast<ObjectTreeItem *>(item->parent());
+    }
+    return item;
+}
+
+void UAVObjectTreeModel::setExpanded(const QModelIndex &index, bool expanded)
+{
+    if (!index.isValid()) {
+        return;
+    }
+    TreeItem *item = static_cast<TreeItem *>(index.internalPointer());
+    if (expanded) {
+        m_expandedItems.insert(item);
+        // Objects that were updated while hidden are refreshed now
+        if (!m_staleObjects.isEmpty() && !m_refreshTimer->isActive()) {
+            m_refreshTimer->start();
+        }
+    } else {
+        m_expandedItems.remove(item);
     }
 }
 
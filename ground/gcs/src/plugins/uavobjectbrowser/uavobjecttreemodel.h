@@ -32,6 +32,8 @@
 #include <QAbstractItemModel>
 #include <QtCore/QMap>
 #include <QtCore/QList>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
 #include <QColor>
 
 class TopTreeItem;
@@ -87,6 +89,14 @@ public:
 
     QList<QModelIndex> getMetaDataIndexes();
 
+    // Tells the model which items are expanded in the view, only objects
+    // that are visible get refreshed when they are updated.
+    void setExpanded(const QModelIndex &index, bool expanded);
+
+    // Reads back the fields of an object, and of its instances, that were
+    // updated while hidden, so that applying the item does not send old values.
+    void refreshObjectTreeItem(ObjectTreeItem *item);
+
 signals:
 
 public slots:
@@ -96,6 +106,7 @@ private slots:
     void updateHighlight(TreeItem *item);
     void updateIsKnown(TreeItem *item);
     void highlightUpdatedObject(UAVObject *obj);
+    void refreshUpdatedObjects();
     void isKnownChanged(UAVObject *object, bool isKnown);
 
 private:
@@ -111,6 +122,9 @@ private:
 
     QString updateMode(quint8 updateMode);
     ObjectTreeItem *findObjectTreeItem(UAVObject *obj);
+    bool isRowVisible(TreeItem *item) const;
+    // item, or the closest object above it whose row can be seen, 0 if none
+    ObjectTreeItem *visibleObjectTreeItem(ObjectTreeItem *item) const;
     DataObjectTreeItem *findDataObjectTreeItem(UAVDataObject *obj);
     MetaObjectTreeItem *findMetaObjectTreeItem(UAVMetaObject *obj);
 
@@ -128,6 +142,16 @@ private:
 
     // Highlight manager to handle highlighting of tree items.
     HighLightManager *m_highlightManager;
+
+    // Item showing each object, instances map to their own item.
+    QHash<UAVObject *, ObjectTreeItem *> m_objectTreeItems;
+    QSet<TreeItem *> m_expandedItems;
+
+    // Objects updated since the last refresh and objects whose
+    // fields have not been read since they were updated.
+    QSet<UAVObject *> m_updatedObjects;
+    QSet<UAVObject *> m_staleObjects;
+    QTimer *m_refreshTimer;
 };
 
 #endif // UAVOBJECTTREEMODEL_H
@@ -0,0 +1,13 @@
+QT += testlib qml
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+TARGET = tst_uavobjectmanager
+
+include(../../../../gcs.pri)
+include(../uavobjects.pri)
+
+INCLUDEPATH += $$GCS_SOURCE_TREE/src/plugins
+LIBS += -L$$GCS_PLUGIN_PATH/$$ORG_BIG_NAME
+
+SOURCES += tst_uavobjectmanager.cpp
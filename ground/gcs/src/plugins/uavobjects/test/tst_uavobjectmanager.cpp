@@ -0,0 +1,257 @@
+/**
+ ******************************************************************************
+ *
+ * @file       tst_uavobjectmanager.cpp
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVObjectsPlugin UAVObjects Plugin
+ * @{
+ * @brief UAVObjectManager lookup tests and benchmark
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <uavobjectmanager.h>
+#include <uavobjectsinit.h>
+
+#include <QtCore/QObject>
+#include <QtTest/QtTest>
+
+class tst_UAVObjectManager : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void lookupById();
+    void lookupByName();
+    void lookupInstances();
+    void lookupUnknown();
+    void benchmarkLookups();
+    void benchmarkLookupsByName();
+    void packUnpackRoundTrip();
+    void packMatchesFields();
+    void benchmarkPackUnpack();
+    void typedAccessors();
+
+private:
+    UAVObjectManager *objMngr;
+    QList<UAVObject *> allObjects;
+    UAVDataObject *multiObj;
+};
+
+void tst_UAVObjectManager::initTestCase()
+{
+    objMngr = new UAVObjectManager();
+    UAVObjectsInitialize(objMngr);
+
+    // Use the first multi instance object to add instances
+    multiObj = NULL;
+    foreach(QList<UAVDataObject *> list, objMngr->getDataObjects()) {
+        if (!list.first()->isSingleInstance()) {
+            multiObj = list.first();
+            break;
+        }
+    }
+    QVERIFY(multiObj != NULL);
+    for (int i = 0; i < 10; i++) {
+        QVERIFY(objMngr->registerObject(multiObj->clone(0)));
+    }
+
+    foreach(QList<UAVObject *> list, objMngr->getObjects()) {
+        allObjects.append(list);
+    }
+    QVERIFY(allObjects.length() > 0);
+}
+
+void tst_UAVObjectManager::cleanupTestCase()
+{
+    delete objMngr;
+}
+
+void tst_UAVObjectManager::lookupById()
+{
+    foreach(UAVObject * obj, allObjects) {
+        QCOMPARE(objMngr->getObject(obj->getObjID(), obj->getInstID()), obj);
+    }
+}
+
+void tst_UAVObjectManager::lookupByName()
+{
+    foreach(UAVObject * obj, allObjects) {
+        QCOMPARE(objMngr->getObject(obj->getName(), obj->getInstID()), obj);
+    }
+}
+
+void tst_UAVObjectManager::lookupInstances()
+{
+    QList<UAVObject *> instances = objMngr->getObjectInstances(multiObj->getObjID());
+
+    QCOMPARE(instances.length(), 11);
+    QCOMPARE(objMngr->getNumInstances(multiObj->getObjID()), 11);
+    QCOMPARE(objMngr->getNumInstances(multiObj->getName()), 11);
+    QCOMPARE(objMngr->getObjectInstances(multiObj->getName()), instances);
+    for (int i = 0; i < instances.length(); i++) {
+        QCOMPARE(instances.at(i)->getInstID(), (quint32)i);
+    }
+
+    // Instance IDs past the end fill the gap
+    QVERIFY(objMngr->registerObject(multiObj->clone(15)));
+    QCOMPARE(objMngr->getNumInstances(multiObj->getObjID()), 16);
+    QCOMPARE(objMngr->getObject(multiObj->getObjID(), 13)->getInstID(), 13u);
+    QVERIFY(!objMngr->registerObject(multiObj->clone(15)));
+}
+
+void tst_UAVObjectManager::lookupUnknown()
+{
+    QVERIFY(objMngr->getObject(0xFFFFFFF0) == NULL);
+    QVERIFY(objMngr->getObject(QString("NoSuchObject")) == NULL);
+    QVERIFY(objMngr->getObject(multiObj->getObjID(), 1000) == NULL);
+    QCOMPARE(objMngr->getNumInstances(0xFFFFFFF0), -1);
+    QVERIFY(objMngr->getObjectInstances(0xFFFFFFF0).isEmpty());
+}
+
+void tst_UAVObjectManager::benchmarkLookups()
+{
+    // One lookup of every object, QBENCHMARK repeats it as needed
+    int found = 0;
+
+    QBENCHMARK {
+        found = 0;
+        foreach(UAVObject * obj, allObjects) {
+            if (objMngr->getObject(obj->getObjID(), obj->getInstID())) {
+                found++;
+            }
+        }
+    }
+    QCOMPARE(found, allObjects.length());
+}
+
+void tst_UAVObjectManager::benchmarkLookupsByName()
+{
+    int found = 0;
+
+    QBENCHMARK {
+        found = 0;
+        foreach(UAVObject * obj, allObjects) {
+            if (objMngr->getObject(obj->getName(), obj->getInstID())) {
+                found++;
+            }
+        }
+    }
+    QCOMPARE(found, allObjects.length());
+}
+
+void tst_UAVObjectManager::packUnpackRoundTrip()
+{
+    foreach(UAVObject * obj, allObjects) {
+        QByteArray in(obj->getNumBytes(), 0);
+        QByteArray out(obj->getNumBytes(), 0);
+
+        for (int i = 0; i < in.size(); i++) {
+            in[i] = (char)(i * 7 + 3);
+        }
+        QCOMPARE(obj->unpack((const quint8 *)in.constData()), (qint32)in.size());
+        QCOMPARE(obj->pack((quint8 *)out.data()), (qint32)out.size());
+        QCOMPARE(out, in);
+    }
+}
+
+void tst_UAVObjectManager::packMatchesFields()
+{
+    // pack() copies the object data at once, it must give what the fields pack one by one
+    foreach(UAVObject * obj, allObjects) {
+        QByteArray in(obj->getNumBytes(), 0);
+        QByteArray packed(obj->getNumBytes(), 0);
+
+        for (int i = 0; i < in.size(); i++) {
+            in[i] = (char)(i * 13 + 1);
+        }
+        obj->unpack((const quint8 *)in.constData());
+        obj->pack((quint8 *)packed.data());
+
+        quint32 offset = 0;
+        foreach(UAVObjectField * field, obj->getFields()) {
+            QByteArray fieldData(field->getNumBytes(), 0);
+            field->pack((quint8 *)fieldData.data());
+            QCOMPARE(packed.mid(offset, fieldData.size()), fieldData);
+            offset += field->getNumBytes();
+        }
+        QCOMPARE(offset, obj->getNumBytes());
+    }
+}
+
+void tst_UAVObjectManager::benchmarkPackUnpack()
+{
+    // One pack and unpack of every object, QBENCHMARK repeats it as needed
+    QByteArray buffer(1024, 0);
+    quint8 *data = (quint8 *)buffer.data();
+    qint64 bytes = 0;
+
+    QBENCHMARK {
+        bytes = 0;
+        foreach(UAVObject * obj, allObjects) {
+            bytes += obj->pack(data);
+            obj->unpack(data);
+        }
+    }
+    qDebug() << "UAVObject::pack/unpack:" << allObjects.length() << "objects" << bytes << "bytes per iteration";
+    QVERIFY(bytes > 0);
+}
+
+void tst_UAVObjectManager::typedAccessors()
+{
+    foreach(UAVObject * obj, allObjects) {
+        foreach(UAVObjectField * field, obj->getFields()) {
+            if (field->getType() == UAVObjectField::ENUM) {
+                // Enums read and write as their option text, numeric options round trip
+                double value;
+                QCOMPARE(field->getDoubles(&value, 1), (quint32)0);
+                foreach(QString option, field->getOptions()) {
+                    bool isNumber;
+                    double number = option.toDouble(&isNumber);
+                    if (!isNumber) {
+                        continue;
+                    }
+                    field->setDouble(number);
+                    QCOMPARE(field->getValue().toString(), option);
+                    QCOMPARE(field->getDouble(), number);
+                }
+                field->setValue(field->getOptions().first());
+                QCOMPARE(field->getDouble(), field->getOptions().first().toDouble());
+                continue;
+            }
+            if (!field->isNumeric()) {
+                continue;
+            }
+            quint32 count = field->getNumElements();
+            QVector<double> doubles(count + 1);
+
+            // Reads are clamped to the end of the field
+            QCOMPARE(field->getDoubles(doubles.data(), count + 1), count);
+            QCOMPARE(field->getDoubles(doubles.data(), 1, count), (quint32)0);
+            for (quint32 n = 0; n < count; n++) {
+                QCOMPARE(doubles[n], field->getValue(n).toDouble());
+                QCOMPARE(field->getDouble(n), doubles[n]);
+            }
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_UAVObjectManager)
+
+#include "tst_uavobjectmanager.moc"
@@ -1,42 +0,0 @@
-# -------------------------------------------------
-# Project created by QtCreator 2010-03-13T15:17:38
-# -------------------------------------------------
-QT -= gui
-TARGET = uavobjectstest
-CONFIG += console
-CONFIG -= app_bundle
-TEMPLATE = app
-SOURCES += main.cpp \
-    ../uavobjectmanager.cpp \
-    ../uavobjectfield.cpp \
-    ../uavobject.cpp \
-    ../uavmetaobject.cpp \
-    ../uavdataobject.cpp \
-    uavobjectstest.cpp \
-    ../uavobjectfieldenum.cpp \
-    ../uavobjectfieldstring.cpp \
-    ../exampleobject1.cpp \
-    ../uavobjectfielduint32.cpp \
-    ../uavobjectfielduint16.cpp \
-    ../uavobjectfielduint8.cpp \
-    ../uavobjectfieldint32.cpp \
-    ../uavobjectfieldint16.cpp \
-    ../uavobjectfieldint8.cpp \
-    ../uavobjectfieldfloat.cpp
-HEADERS += ../uavobjectmanager.h \
-    ../uavobjectfield.h \
-    ../uavobject.h \
-    ../uavmetaobject.h \
-    ../uavdataobject.h \
-    uavobjectstest.h \
-    ../uavobjectfieldenum.h \
-    ../uavobjectfieldstring.h \
-    ../exampleobject1.h \
-    ../uavobjectfielduint32.h \
-    ../uavobjectfielduint16.h \
-    ../uavobjectfielduint8.h \
-    ../uavobjectfields.h \
-    ../uavobjectfieldint32.h \
-    ../uavobjectfieldint16.h \
-    ../uavobjectfieldint8.h \
-    ../uavobjectfieldfloat.h
@@ -303,12 +303,18 @@ UAVObjectField *UAVObject::getField(const QString & name)
 qint32 UAVObject::pack(quint8 *dataOut)
 {
     QMutexLocker locker(mutex);
-    qint32 offset = 0;
 
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    // The data is a packed structure (DataFields for generated objects) declaring the
+    // fields in the order of the fields list, as sent on the link, see initializeFields()
+    memcpy(dataOut, data, numBytes);
+#else
+    qint32 offset = 0;
     for (int n = 0; n < fields.length(); ++n) {
         fields[n]->pack(&dataOut[offset]);
         offset += fields[n]->getNumBytes();
     }
+#endif
     return numBytes;
 }
 
@@ -319,12 +325,17 @@ qint32 UAVObject::pack(quint8 *dataOut)
 qint32 UAVObject::unpack(const quint8 *dataIn)
 {
     QMutexLocker locker(mutex);
-    qint32 offset = 0;
 
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    // Same layout as on the link, see pack()
+    memcpy(data, dataIn, numBytes);
+#else
+    qint32 offset = 0;
     for (int n = 0; n < fields.length(); ++n) {
         fields[n]->unpack(&dataIn[offset]);
         offset += fields[n]->getNumBytes();
     }
+#endif
     emit objectUnpacked(this); // trigger object updated event
     emit objectUpdated(this);
 
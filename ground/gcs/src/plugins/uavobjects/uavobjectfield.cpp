@@ -1182,9 +1182,111 @@ void UAVObjectField::setValue(const QVariant & value, quint32 index)
     }
 }
 
+/**
+ * Read one element as a double. Enum elements are read as their option text,
+ * so options such as "57600" read as that number and others as 0.
+ */
 double UAVObjectField::getDouble(quint32 index)
 {
-    return getValue(index).toDouble();
+    if (!isNumeric()) {
+        return getValue(index).toDouble();
+    }
+    QMutexLocker locker(obj->getMutex());
+
+    if (index >= numElements) {
+        return 0.0;
+    }
+    return getNumber<double>(index);
+}
+
+/**
+ * Copy up to count consecutive elements starting at index into values,
+ * taking the object lock once and without going through QVariant.
+ * Only numeric fields are supported, use getDouble() for enum fields.
+ * Returns the number of elements copied.
+ */
+quint32 UAVObjectField::getDoubles(double *values, quint32 count, quint32 index)
+{
+    return getNumbers<double>(values, count, index);
+}
+
+template<typename T> quint32 UAVObjectField::getNumbers(T *values, quint32 count, quint32 index)
+{
+    if (!isNumeric()) {
+        return 0;
+    }
+    QMutexLocker locker(obj->getMutex());
+
+    if (index >= numElements) {
+        return 0;
+    }
+    count = qMin(count, numElements - index);
+    for (quint32 n = 0; n < count; ++n) {
+        values[n] = getNumber<T>(index + n);
+    }
+    return count;
+}
+
+/**
+ * Read a single element of a numeric field, the caller must hold the object
+ * lock and have checked index against numElements.
+ */
+template<typename T> T UAVObjectField::getNumber(quint32 index)
+{
+    const quint8 *element = &data[offset + numBytesPerElement * index];
+
+    switch (type) {
+    case INT8:
+    {
+        qint8 tmpint8;
+        memcpy(&tmpint8, element, sizeof(tmpint8));
+        return static_cast<T>(tmpint8);
+    }
+    case INT16:
+    {
+        qint16 tmpint16;
+        memcpy(&tmpint16, element, sizeof(tmpint16));
+        return static_cast<T>(tmpint16);
+    }
+    case INT32:
+    {
+        qint32 tmpint32;
+        memcpy(&tmpint32, element, sizeof(tmpint32));
+        return static_cast<T>(tmpint32);
+    }
+    case UINT8:
+    {
+        quint8 tmpuint8;
+        memcpy(&tmpuint8, element, sizeof(tmpuint8));
+        return static_cast<T>(tmpuint8);
+    }
+    case UINT16:
+    {
+        quint16 tmpuint16;
+        memcpy(&tmpuint16, element, sizeof(tmpuint16));
+        return static_cast<T>(tmpuint16);
+    }
+    case UINT32:
+    {
+        quint32 tmpuint32;
+        memcpy(&tmpuint32, element, sizeof(tmpuint32));
+        return static_cast<T>(tmpuint32);
+    }
+    case FLOAT32:
+    {
+        float tmpfloat;
+        memcpy(&tmpfloat, element, sizeof(tmpfloat));
+        return static_cast<T>(tmpfloat);
+    }
+    case BITFIELD:
+    {
+        quint8 tmpbitfield = data[offset + numBytesPerElement * (index / 8)];
+        return static_cast<T>((tmpbitfield >> (index % 8)) & 1);
+    }
+    default:
+        break;
+    }
+    return static_cast<T>(0);
 }
 
 void UAVObjectField::setDouble(double value, quint32 index)
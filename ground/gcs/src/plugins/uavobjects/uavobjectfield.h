@@ -73,6 +73,7 @@ public:
     void setValue(const QVariant & data, quint32 index = 0);
     double getDouble(quint32 index = 0);
     void setDouble(double value, quint32 index = 0);
+    quint32 getDoubles(double *values, quint32 count, quint32 index = 0);
     quint32 getDataOffset();
     quint32 getNumBytes();
     bool isNumeric();
@@ -109,6 +110,8 @@ protected:
     void clear();
     void constructorInitialize(const QString & name, const QString & description, const QString & units, FieldType type, const QStringList & elementNames, const QStringList & options, const QString &limits);
     void limitsInitialize(const QString &limits);
+    template<typename T> quint32 getNumbers(T *values, quint32 count, quint32 index);
+    template<typename T> T getNumber(quint32 index);
 };
 
 #endif // UAVOBJECTFIELD_H
@@ -33,6 +33,7 @@
 #include "uavdataobject.h"
 #include "uavmetaobject.h"
 #include <QList>
+#include <QHash>
 #include <QMutex>
 #include <QMutexLocker>
 #include <QJsonObject>
@@ -69,9 +70,13 @@ private:
     static const quint32 MAX_INSTANCES = 1000;
 
     QList< QList<UAVObject *> > objects;
+    // Position of each object type in objects, by object ID and by name
+    QHash<quint32, int> idIndex;
+    QHash<QString, int> nameIndex;
     QMutex *mutex;
 
     void addObject(UAVObject *obj);
+    int findObject(const QString *name, quint32 objId);
     UAVObject *getObject(const QString *name, quint32 objId, quint32 instId);
     QList<UAVObject *> getObjectInstances(const QString *name, quint32 objId);
     qint32 getNumInstances(const QString *name, quint32 objId);
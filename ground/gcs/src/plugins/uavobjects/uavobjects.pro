@@ -80,9 +80,11 @@ UAVOBJS = \
     $${UAVOBJ_XML_DIR}/flightplansettings.xml \
     $${UAVOBJ_XML_DIR}/flightplanstatus.xml \
     $${UAVOBJ_XML_DIR}/flightstatus.xml \
+    $${UAVOBJ_XML_DIR}/flighttelemetrybatchstats.xml \
     $${UAVOBJ_XML_DIR}/flighttelemetrystats.xml \
     $${UAVOBJ_XML_DIR}/gcsreceiver.xml \
     $${UAVOBJ_XML_DIR}/gcstelemetrystats.xml \
+    $${UAVOBJ_XML_DIR}/gcstelemetrywindowstats.xml \
     $${UAVOBJ_XML_DIR}/gpsextendedstatus.xml \
     $${UAVOBJ_XML_DIR}/gpspositionsensor.xml \
     $${UAVOBJ_XML_DIR}/gpssatellites.xml \
@@ -28,6 +28,8 @@
 #include "telemetry.h"
 #include "oplinksettings.h"
 #include "objectpersistence.h"
+#include <extensionsystem/pluginmanager.h>
+#include <coreplugin/generalsettings.h>
 #include <QTime>
 #include <QtGlobal>
 #include <stdlib.h>
@@ -72,6 +74,17 @@ Telemetry::Telemetry(UAVTalk *utalk, UAVObjectManager *objMngr) : objMngr(objMng
     // Setup and start the stats timer
     txErrors  = 0;
     txRetries = 0;
+
+    // Setup the transaction window, the timeout adapts to the measured round trip time
+    ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
+    Core::Internal::GeneralSettings *settings = pm->getObject<Core::Internal::GeneralSettings>();
+    transactionWindow    = settings ? qMax(settings->telemetryTransactionWindow(), 1) : DEFAULT_TRANSACTION_WINDOW;
+    transactionsInFlight = 0;
+    txInFlightPeak = 0;
+    rttValid     = false;
+    srttMs       = 0;
+    rttVarMs     = 0;
+    reqTimeoutMs = REQ_TIMEOUT_MS;
 }
 
 Telemetry::~Telemetry()
@@ -247,6 +260,11 @@ void Telemetry::transactionCompleted(UAVObject *obj, bool success)
             // We now know tat the flight side knows of this object.
             obj->setIsKnown(true);
 
+            // Only time transactions that were not retried, the response to a retry is ambiguous
+            if (transInfo->retriesRemaining == MAX_RETRIES && transInfo->sentTime.isValid()) {
+                updateRoundTripTime(transInfo->sentTime.elapsed());
+            }
+
 #ifdef VERBOSE_TELEMETRY
             qDebug() << "Telemetry - transaction successful for object" << obj->toStringBrief();
 #endif
@@ -281,6 +299,9 @@ void Telemetry::transactionTimeout(ObjectTransactionInfo *transInfo)
         ++txRetries;
         --transInfo->retriesRemaining;
 
+        // Back off, the link is probably busier than the round trip estimate suggests
+        transInfo->timeoutMs = qMin(transInfo->timeoutMs * 2, (qint32)MAX_REQ_TIMEOUT_MS);
+
         // Retry the transaction
         processObjectTransaction(transInfo);
     } else {
@@ -324,14 +345,12 @@ void Telemetry::processObjectTransaction(ObjectTransactionInfo *transInfo)
     }
     // Check if a response is needed now or will arrive asynchronously
     if (transInfo->objRequest || transInfo->acked) {
-        if (sent) {
-            // Start timer if a response is expected
-            transInfo->timer->start(REQ_TIMEOUT_MS);
-        } else {
-            // message was not sent, the transaction will not complete and will timeout
-            // there is no need to wait to close the transaction and notify of completion failure
-            // transactionCompleted(transInfo->obj, false);
+        if (sent && !transInfo->sentTime.isValid()) {
+            transInfo->sentTime.start();
         }
+        // Start timer if a response is expected
+        // If the message was not sent it will be retried when the timer expires
+        transInfo->timer->start(transInfo->timeoutMs);
     } else {
         // not transacted, so just close the transaction with no notification of completion
         closeTransaction(transInfo);
@@ -349,6 +368,15 @@ void Telemetry::processObjectUpdates(UAVObject *obj, EventMask event, bool allIn
     objInfo.obj   = obj;
     objInfo.event = event;
     objInfo.allInstances = allInstances;
+
+    // Drop the event if the very same one is still waiting for a transaction slot
+    QQueue<ObjectQueueInfo> & queue = priority ? objPriorityQueue : objQueue;
+    foreach(const ObjectQueueInfo &info, queue) {
+        if (info.obj == obj && info.event == event && info.allInstances == allInstances) {
+            return;
+        }
+    }
+
     if (priority) {
         if (objPriorityQueue.length() < MAX_QUEUE_SIZE) {
             objPriorityQueue.enqueue(objInfo);
@@ -373,20 +401,73 @@ void Telemetry::processObjectUpdates(UAVObject *obj, EventMask event, bool allIn
 
 /**
  * Process events from the object queue
+ * Up to transactionWindow acked updates and requests are in flight at any time,
+ * events for objects that already have a transaction in flight wait in the queue.
  */
 void Telemetry::processObjectQueue()
 {
     // Get object information from queue (first the priority and then the regular queue)
     ObjectQueueInfo objInfo;
 
-    if (!objPriorityQueue.isEmpty()) {
-        objInfo = objPriorityQueue.dequeue();
-    } else if (!objQueue.isEmpty()) {
-        objInfo = objQueue.dequeue();
-    } else {
-        return;
+    while (dequeueObject(objPriorityQueue, objInfo) || dequeueObject(objQueue, objInfo)) {
+        processQueuedObject(objInfo);
+    }
+}
+
+/**
+ * Take the first event from the queue that can be processed now
+ */
+bool Telemetry::dequeueObject(QQueue<ObjectQueueInfo> & queue, ObjectQueueInfo & objInfo)
+{
+    for (int n = 0; n < queue.length(); ++n) {
+        const ObjectQueueInfo & info = queue.at(n);
+        if (needsTransaction(info)) {
+            // Only one transaction per object, wait for the one in flight to complete
+            if (findTransaction(info.obj)) {
+                continue;
+            }
+            if (awaitsResponse(info) && transactionsInFlight >= transactionWindow) {
+                continue;
+            }
+        }
+        objInfo = queue.takeAt(n);
+        return true;
     }
+    return false;
+}
+
+/**
+ * Check if the event starts a transaction (skip if unpack event or throttled periodic update)
+ */
+bool Telemetry::needsTransaction(const ObjectQueueInfo & objInfo)
+{
+    if (objInfo.event == EV_UNPACKED) {
+        return false;
+    }
+    if (objInfo.event == EV_UPDATED_PERIODIC) {
+        UAVObject::Metadata metadata = objInfo.obj->getMetadata();
+        return UAVObject::GetGcsTelemetryUpdateMode(metadata) != UAVObject::UPDATEMODE_THROTTLED;
+    }
+    return true;
+}
+
+/**
+ * Check if the transaction started by the event stays open until the flight side responds
+ */
+bool Telemetry::awaitsResponse(const ObjectQueueInfo & objInfo)
+{
+    if (objInfo.event == EV_UPDATE_REQ) {
+        return true;
+    }
+    UAVObject::Metadata metadata = objInfo.obj->getMetadata();
+    return UAVObject::GetGcsTelemetryAcked(metadata);
+}
 
+/**
+ * Process an event taken from the object queue
+ */
+void Telemetry::processQueuedObject(const ObjectQueueInfo & objInfo)
+{
     // Check if a connection has been established, only process GCSTelemetryStats updates
     // (used to establish the connection)
     GCSTelemetryStats::DataFields gcsStats = gcsStatsObj->getData();
@@ -403,23 +484,18 @@ void Telemetry::processObjectQueue()
     // Setup transaction (skip if unpack event)
     UAVObject::Metadata metadata     = objInfo.obj->getMetadata();
     UAVObject::UpdateMode updateMode = UAVObject::GetGcsTelemetryUpdateMode(metadata);
-    if ((objInfo.event != EV_UNPACKED) && ((objInfo.event != EV_UPDATED_PERIODIC) || (updateMode != UAVObject::UPDATEMODE_THROTTLED))) {
-        // Check if a transaction for that object already exists
+    if (needsTransaction(objInfo)) {
+        // dequeueObject() made sure that no transaction for that object exists
         // It is allowed to have multiple transaction on the same object ID provided that the instance IDs are different
         // If an "all instances" transaction is running, then it is not allowed to start another transaction with same object ID
         // If a single instance transaction is running, then starting an "all instance" transaction is not allowed
         // TODO make the above logic a reality...
-        if (findTransaction(objInfo.obj)) {
-            qWarning().nospace() << "Telemetry - !!! Making request for an object " << objInfo.obj->toStringBrief() << " for which a request is already in progress";
-            // objInfo.obj->emitTransactionCompleted(false);
-            return;
-        }
-        UAVObject::Metadata metadata     = objInfo.obj->getMetadata();
         ObjectTransactionInfo *transInfo = new ObjectTransactionInfo(this);
         transInfo->obj   = objInfo.obj;
         transInfo->allInstances = objInfo.allInstances;
         transInfo->retriesRemaining = MAX_RETRIES;
         transInfo->acked = UAVObject::GetGcsTelemetryAcked(metadata);
+        transInfo->timeoutMs = reqTimeoutMs;
         if (objInfo.event == EV_UPDATED || objInfo.event == EV_UPDATED_MANUAL || objInfo.event == EV_UPDATED_PERIODIC) {
             transInfo->objRequest = false;
         } else if (objInfo.event == EV_UPDATE_REQ) {
@@ -438,14 +514,62 @@ void Telemetry::processObjectQueue()
     } else if (updateMode != UAVObject::UPDATEMODE_THROTTLED) {
         updateObject(objInfo.obj, objInfo.event);
     }
+}
 
-    // The fact we received an unpacked event does not mean that
-    // we do not have additional objects still in the queue,
-    // so we have to reschedule queue processing to make sure they are not
-    // stuck:
-    if (objInfo.event == EV_UNPACKED) {
-        processObjectQueue();
+/**
+ * Update the smoothed round trip time and derive the transaction timeout from it (RFC 6298)
+ */
+void Telemetry::updateRoundTripTime(qint32 rttMs)
+{
+    if (!rttValid) {
+        srttMs   = rttMs;
+        rttVarMs = rttMs / 2;
+        rttValid = true;
+    } else {
+        rttVarMs = (3 * rttVarMs + qAbs(srttMs - rttMs)) / 4;
+        srttMs   = (7 * srttMs + rttMs) / 8;
     }
+    reqTimeoutMs = qBound((qint32)MIN_REQ_TIMEOUT_MS, srttMs + 4 * rttVarMs, (qint32)MAX_REQ_TIMEOUT_MS);
+}
+
+/**
+ * Set the maximum number of acked updates and requests in flight
+ */
+void Telemetry::setTransactionWindow(int window)
+{
+    QMutexLocker locker(mutex);
+
+    transactionWindow = qMax(window, 1);
+
+    // A larger window lets queued events go now
+    processObjectQueue();
+}
+
+int Telemetry::getTransactionWindow()
+{
+    QMutexLocker locker(mutex);
+
+    return transactionWindow;
+}
+
+/**
+ * Negotiate optional protocol features (delta encoded updates) with the autopilot
+ */
+void Telemetry::requestCapabilities()
+{
+    QMutexLocker locker(mutex);
+
+    utalk->sendCapabilityRequest();
+}
+
+/**
+ * Drop the negotiated protocol features, the autopilot is gone
+ */
+void Telemetry::resetCapabilities()
+{
+    QMutexLocker locker(mutex);
+
+    utalk->resetCapabilities();
 }
 
 /**
@@ -519,6 +643,9 @@ Telemetry::TelemetryStats Telemetry::getStats()
     stats.txObjects     = utalkStats.txObjects;
     stats.txErrors      = utalkStats.txErrors + txErrors;
     stats.txRetries     = txRetries;
+    stats.txInFlight    = transactionsInFlight;
+    stats.txInFlightPeak = txInFlightPeak;
+    stats.txRoundTripMs = srttMs;
 
     stats.rxBytes       = utalkStats.rxBytes;
     stats.rxObjectBytes = utalkStats.rxObjectBytes;
@@ -538,6 +665,7 @@ void Telemetry::resetStats()
     utalk->resetStats();
     txErrors  = 0;
     txRetries = 0;
+    txInFlightPeak = transactionsInFlight;
 }
 
 void Telemetry::objectUpdatedAuto(UAVObject *obj)
@@ -630,6 +758,11 @@ void Telemetry::openTransaction(ObjectTransactionInfo *trans)
         transMap.insert(objId, objTransactions);
     }
     objTransactions->insert(instId, trans);
+
+    if (trans->objRequest || trans->acked) {
+        ++transactionsInFlight;
+        txInFlightPeak = qMax(txInFlightPeak, (quint32)transactionsInFlight);
+    }
 }
 
 void Telemetry::closeTransaction(ObjectTransactionInfo *trans)
@@ -643,6 +776,9 @@ void Telemetry::closeTransaction(ObjectTransactionInfo *trans)
         // Keep the map even if it is empty
         // There are at most 100 different object IDs...
     }
+    if (trans->objRequest || trans->acked) {
+        --transactionsInFlight;
+    }
     delete trans;
 }
 
@@ -660,6 +796,7 @@ void Telemetry::closeAllTransactions()
         transMap.remove(objId);
         delete objTransactions;
     }
+    transactionsInFlight = 0;
 }
 
 ObjectTransactionInfo::ObjectTransactionInfo(QObject *parent) : QObject(parent)
@@ -668,8 +805,9 @@ ObjectTransactionInfo::ObjectTransactionInfo(QObject *parent) : QObject(parent)
     allInstances     = false;
     objRequest       = false;
     retriesRemaining = 0;
-    acked = false;
-    telem = 0;
+    acked     = false;
+    timeoutMs = 0;
+    telem     = 0;
     // Setup transaction timer
     timer = new QTimer(this);
     timer->setSingleShot(true);
@@ -34,6 +34,7 @@
 #include <QMutex>
 #include <QMutexLocker>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QQueue>
 #include <QMap>
 
@@ -48,13 +49,15 @@ public:
     bool objRequest;
     qint32 retriesRemaining;
     bool acked;
+    qint32 timeoutMs;
+    QElapsedTimer sentTime;
     QPointer<class Telemetry>telem;
     QTimer *timer;
 private slots:
     void timeout();
 };
 
-class Telemetry : public QObject {
+class UAVTALK_EXPORT Telemetry : public QObject {
     Q_OBJECT
 
 public:
@@ -64,6 +67,9 @@ public:
         quint32 txObjects;
         quint32 txErrors;
         quint32 txRetries;
+        quint32 txInFlight; /** Transactions currently awaiting a response */
+        quint32 txInFlightPeak; /** Highest number of transactions awaiting a response since the last reset */
+        quint32 txRoundTripMs; /** Smoothed transaction round trip time */
 
         quint32 rxBytes;
         quint32 rxObjectBytes;
@@ -78,14 +84,23 @@ public:
     TelemetryStats getStats();
     void resetStats();
     void transactionTimeout(ObjectTransactionInfo *info);
+    void setTransactionWindow(int window);
+    int getTransactionWindow();
+    void requestCapabilities();
+    void resetCapabilities();
 
 private:
     // Constants
-    static const int REQ_TIMEOUT_MS = 250;
-    static const int MAX_RETRIES    = 2;
+    static const int REQ_TIMEOUT_MS     = 250;
+    static const int MIN_REQ_TIMEOUT_MS = 100;
+    static const int MAX_REQ_TIMEOUT_MS = 2000;
+    static const int MAX_RETRIES = 2;
     static const int MAX_UPDATE_PERIOD_MS = 1000;
     static const int MIN_UPDATE_PERIOD_MS = 1;
-    static const int MAX_QUEUE_SIZE = 20;
+    // Events wait in the queue while the window is full, it must hold a settings upload
+    static const int MAX_QUEUE_SIZE     = 100;
+    // Window used when the general settings do not set one
+    static const int DEFAULT_TRANSACTION_WINDOW = 8;
 
     // Types
     /**
@@ -126,6 +141,13 @@ private:
     qint32 timeToNextUpdateMs;
     quint32 txErrors;
     quint32 txRetries;
+    int transactionWindow;
+    int transactionsInFlight;
+    quint32 txInFlightPeak;
+    bool rttValid;
+    qint32 srttMs;
+    qint32 rttVarMs;
+    qint32 reqTimeoutMs;
 
     // Methods
     void registerObject(UAVObject *obj);
@@ -137,6 +159,11 @@ private:
     void processObjectUpdates(UAVObject *obj, EventMask event, bool allInstances, bool priority);
     void processObjectTransaction(ObjectTransactionInfo *transInfo);
     void processObjectQueue();
+    void processQueuedObject(const ObjectQueueInfo & objInfo);
+    bool dequeueObject(QQueue<ObjectQueueInfo> & queue, ObjectQueueInfo & objInfo);
+    bool needsTransaction(const ObjectQueueInfo & objInfo);
+    bool awaitsResponse(const ObjectQueueInfo & objInfo);
+    void updateRoundTripTime(qint32 rttMs);
 
     ObjectTransactionInfo *findTransaction(UAVObject *obj);
     void openTransaction(ObjectTransactionInfo *trans);
@@ -37,10 +37,10 @@ TelemetryMonitor::TelemetryMonitor(UAVObjectManager *objMngr, Telemetry *tel) :
     objMngr(objMngr),
     tel(tel),
     gcsStatsObj(GCSTelemetryStats::GetInstance(objMngr)),
+    gcsWindowStatsObj(GCSTelemetryWindowStats::GetInstance(objMngr)),
     flightStatsObj(FlightTelemetryStats::GetInstance(objMngr)),
     firmwareIAPObj(FirmwareIAPObj::GetInstance(objMngr)),
     statsTimer(new QTimer(this)),
-    objPending(NULL),
     mutex(new QMutex(QMutex::Recursive)),
     connectionTimer(new QTime())
 {
@@ -103,12 +103,16 @@ void TelemetryMonitor::stopRetrievingObjects()
 }
 
 /**
- * Retrieve the next object in the queue
+ * Retrieve the next objects in the queue, keeping the telemetry transaction window busy
  */
 void TelemetryMonitor::retrieveNextObject()
 {
     // If queue is empty return
     if (queue.isEmpty()) {
+        if (!objPending.isEmpty()) {
+            // Wait for the remaining requests to complete
+            return;
+        }
         qDebug() << "TelemetryMonitor::retrieveNextObject - object retrieval completed";
         if (firmwareIAPObj->getBoardType()) {
             emit connected();
@@ -118,16 +122,18 @@ void TelemetryMonitor::retrieveNextObject()
         return;
     }
 
-    // Get next object from the queue
-    UAVObject *obj = queue.dequeue();
-    // qDebug( tr("Retrieving object: %1").arg(obj->getName()) );
+    while (!queue.isEmpty() && objPending.size() < tel->getTransactionWindow()) {
+        // Get next object from the queue
+        UAVObject *obj = queue.dequeue();
+        // qDebug( tr("Retrieving object: %1").arg(obj->getName()) );
 
-    // Connect to object
-    connect(obj, SIGNAL(transactionCompleted(UAVObject *, bool)), this, SLOT(transactionCompleted(UAVObject *, bool)));
+        // Connect to object
+        connect(obj, SIGNAL(transactionCompleted(UAVObject *, bool)), this, SLOT(transactionCompleted(UAVObject *, bool)), Qt::UniqueConnection);
 
-    // Request update
-    obj->requestUpdate();
-    objPending = obj;
+        // Request update
+        objPending.insert(obj);
+        obj->requestUpdate();
+    }
 }
 
 /**
@@ -138,10 +144,9 @@ void TelemetryMonitor::transactionCompleted(UAVObject *obj, bool success)
     Q_UNUSED(success);
     QMutexLocker locker(mutex);
 
-    if (obj == objPending) {
+    if (objPending.remove(obj)) {
         // Disconnect from sending object
         obj->disconnect(this);
-        objPending = NULL;
 
         // Process next object if telemetry is still available
         GCSTelemetryStats::DataFields gcsStats = gcsStatsObj->getData();
@@ -195,6 +200,7 @@ void TelemetryMonitor::processStatsUpdates()
 
     // Get telemetry stats
     GCSTelemetryStats::DataFields gcsStats = gcsStatsObj->getData();
+    GCSTelemetryWindowStats::DataFields gcsWindowStats = gcsWindowStatsObj->getData();
     FlightTelemetryStats::DataFields flightStats = flightStatsObj->getData();
     Telemetry::TelemetryStats telStats     = tel->getStats();
 
@@ -206,6 +212,11 @@ void TelemetryMonitor::processStatsUpdates()
     gcsStats.TxFailures   += telStats.txErrors;
     gcsStats.TxRetries    += telStats.txRetries;
 
+    gcsWindowStats.TxInFlight     = qMin(telStats.txInFlight, (quint32)0xFFFF);
+    gcsWindowStats.TxInFlightPeak = qMin(telStats.txInFlightPeak, (quint32)0xFFFF);
+    gcsWindowStats.TxRoundTrip    = qMin(telStats.txRoundTripMs, (quint32)0xFFFF);
+    gcsWindowStatsObj->setData(gcsWindowStats);
+
     gcsStats.RxDataRate    = (float)telStats.rxBytes / ((float)statsTimer->interval() / 1000.0);
     gcsStats.RxBytes      += telStats.rxBytes;
     gcsStats.RxFailures   += telStats.rxErrors;
@@ -255,11 +266,13 @@ void TelemetryMonitor::processStatsUpdates()
     if (gcsStats.Status == GCSTelemetryStats::STATUS_CONNECTED && gcsStats.Status != oldStatus) {
         statsTimer->setInterval(STATS_UPDATE_PERIOD_MS);
         qDebug() << "TelemetryMonitor::processStatsUpdates - connection with the autopilot established";
+        tel->requestCapabilities();
         startRetrievingObjects();
     }
     if (gcsStats.Status == GCSTelemetryStats::STATUS_DISCONNECTED && gcsStats.Status != oldStatus) {
         statsTimer->setInterval(STATS_CONNECT_PERIOD_MS);
         qDebug() << "TelemetryMonitor::processStatsUpdates - connection with the autopilot lost";
+        tel->resetCapabilities();
         emit disconnected();
     }
 }
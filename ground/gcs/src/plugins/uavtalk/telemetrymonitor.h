@@ -30,12 +30,14 @@
 
 #include <QObject>
 #include <QQueue>
+#include <QSet>
 #include <QTimer>
 #include <QTime>
 #include <QMutex>
 #include <QMutexLocker>
 #include "uavobjectmanager.h"
 #include "gcstelemetrystats.h"
+#include "gcstelemetrywindowstats.h"
 #include "flighttelemetrystats.h"
 #include "firmwareiapobj.h"
 #include "systemstats.h"
@@ -68,10 +70,11 @@ private:
     Telemetry *tel;
     QQueue<UAVObject *> queue;
     GCSTelemetryStats *gcsStatsObj;
+    GCSTelemetryWindowStats *gcsWindowStatsObj;
     FlightTelemetryStats *flightStatsObj;
     FirmwareIAPObj *firmwareIAPObj;
     QTimer *statsTimer;
-    UAVObject *objPending;
+    QSet<UAVObject *> objPending;
     QMutex *mutex;
     QTime *connectionTimer;
 
@@ -0,0 +1,13 @@
+QT += testlib network widgets
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+TARGET = tst_uavtalk
+
+include(../../../../gcs.pri)
+include(../uavtalk.pri)
+
+INCLUDEPATH += $$GCS_SOURCE_TREE/src/plugins
+LIBS += -L$$GCS_PLUGIN_PATH/$$ORG_BIG_NAME
+
+SOURCES += tst_uavtalk.cpp
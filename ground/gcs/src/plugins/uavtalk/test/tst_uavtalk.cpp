@@ -0,0 +1,510 @@
+/**
+ ******************************************************************************
+ *
+ * @file       tst_uavtalk.cpp
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief UAVTalk input parser tests and replay benchmark
+ *
+ * Set UAVTALK_BENCH_LOG to the path of a .opl telemetry log to benchmark the
+ * parser against recorded data, a synthetic stream is used otherwise.
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <extensionsystem/pluginmanager.h>
+#include <uavobjectmanager.h>
+#include <uavobjectsinit.h>
+#include <utils/crc.h>
+#include <uavtalk/uavtalk.h>
+#include <uavtalk/telemetry.h>
+
+#include <QtCore/QObject>
+#include <QtTest/QtTest>
+#include <QBuffer>
+#include <QFile>
+#include <QSignalSpy>
+#include <QElapsedTimer>
+
+// Size of the synthetic stream replayed by benchmarkReplay()
+#define BENCH_STREAM_SIZE (256 * 1024)
+// Long enough for a transaction to time out after all its retries
+#define TRANSACTION_TIMEOUT_MS 10000
+
+using namespace Utils;
+
+// Keeps what UAVTalk writes apart from what it reads, so two instances can be wired together
+class LoopbackDevice : public QIODevice {
+public:
+    LoopbackDevice()
+    {
+        open(QIODevice::ReadWrite);
+    }
+    bool isSequential() const
+    {
+        return true;
+    }
+    qint64 bytesAvailable() const
+    {
+        return in.size() + QIODevice::bytesAvailable();
+    }
+    QByteArray in;
+    QByteArray out;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize)
+    {
+        qint64 size = qMin(maxSize, (qint64)in.size());
+
+        memcpy(data, in.constData(), size);
+        in.remove(0, size);
+        return size;
+    }
+    qint64 writeData(const char *data, qint64 size)
+    {
+        out.append(data, size);
+        return size;
+    }
+};
+
+class tst_UAVTalk : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void parseWholeStream();
+    void parseSplitStream();
+    void parseWithGarbage();
+    void deltaUpdates();
+    void telemetryAck();
+    void telemetryRetry();
+    void telemetryLoss();
+    void telemetryWindowFull();
+    void benchmarkReplay();
+
+private:
+    QByteArray buildFrame(UAVObject *obj);
+    void process(UAVTalk *talk);
+    void pump(UAVTalk *talkA, LoopbackDevice *ioA, UAVTalk *talkB, LoopbackDevice *ioB);
+    QByteArray loadLog(const QString & fileName);
+    QList<UAVObject *> ackedObjects(int count);
+    void setConnected(bool connected);
+
+    // UAVTalk looks up its settings through the plugin manager
+    ExtensionSystem::PluginManager pluginManager;
+    UAVObjectManager *objMngr;
+    QByteArray stream;
+    quint32 packets;
+};
+
+void tst_UAVTalk::initTestCase()
+{
+    objMngr = new UAVObjectManager();
+    UAVObjectsInitialize(objMngr);
+
+    // One object packet per registered object
+    packets = 0;
+    foreach(QList<UAVObject *> list, objMngr->getObjects()) {
+        foreach(UAVObject * obj, list) {
+            if (obj->getNumBytes() < 256) {
+                stream.append(buildFrame(obj));
+                packets++;
+            }
+        }
+    }
+    QVERIFY(packets > 0);
+}
+
+void tst_UAVTalk::cleanupTestCase()
+{
+    delete objMngr;
+}
+
+QByteArray tst_UAVTalk::buildFrame(UAVObject *obj)
+{
+    // header : sync(1), type (1), size(2), object ID(4), instance ID(2)
+    quint16 size = 10 + obj->getNumBytes();
+    QByteArray frame(size + 1, 0);
+    quint8 *data = (quint8 *)frame.data();
+
+    data[0] = 0x3C;
+    data[1] = 0x20;
+    qToLittleEndian<quint16>(size, data + 2);
+    qToLittleEndian<quint32>(obj->getObjID(), data + 4);
+    qToLittleEndian<quint16>(obj->getInstID(), data + 8);
+    obj->pack(data + 10);
+    data[size] = Crc::updateCRC(0, data, size);
+    return frame;
+}
+
+void tst_UAVTalk::process(UAVTalk *talk)
+{
+    QMetaObject::invokeMethod(talk, "processInputStream", Qt::DirectConnection);
+}
+
+void tst_UAVTalk::pump(UAVTalk *talkA, LoopbackDevice *ioA, UAVTalk *talkB, LoopbackDevice *ioB)
+{
+    while (!ioA->out.isEmpty() || !ioB->out.isEmpty()) {
+        ioB->in.append(ioA->out);
+        ioA->out.clear();
+        process(talkB);
+        ioA->in.append(ioB->out);
+        ioB->out.clear();
+        process(talkA);
+    }
+}
+
+// Settings objects the GCS sends acked
+QList<UAVObject *> tst_UAVTalk::ackedObjects(int count)
+{
+    QList<UAVObject *> objs;
+
+    foreach(QList<UAVDataObject *> list, objMngr->getDataObjects()) {
+        UAVDataObject *obj = list.first();
+        if (objs.length() < count && obj->isSettingsObject() && obj->getNumBytes() < 256
+            && UAVObject::GetGcsTelemetryAcked(obj->getMetadata())) {
+            objs.append(obj);
+        }
+    }
+    return objs;
+}
+
+// Telemetry only sends objects once the connection is established
+void tst_UAVTalk::setConnected(bool connected)
+{
+    GCSTelemetryStats *gcsStatsObj = GCSTelemetryStats::GetInstance(objMngr);
+    GCSTelemetryStats::DataFields gcsStats = gcsStatsObj->getData();
+
+    gcsStats.Status = connected ? GCSTelemetryStats::STATUS_CONNECTED : GCSTelemetryStats::STATUS_DISCONNECTED;
+    gcsStatsObj->setData(gcsStats);
+}
+
+QByteArray tst_UAVTalk::loadLog(const QString & fileName)
+{
+    QFile file(fileName);
+    QByteArray data;
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        return data;
+    }
+
+    // Records are: timestamp(4), size(8), data(size)
+    quint32 timeStamp;
+    qint64 dataSize;
+    while (file.read((char *)&timeStamp, sizeof(timeStamp)) == sizeof(timeStamp)
+           && file.read((char *)&dataSize, sizeof(dataSize)) == sizeof(dataSize)) {
+        if (dataSize < 1 || dataSize > (1024 * 1024)) {
+            break;
+        }
+        data.append(file.read(dataSize));
+    }
+    return data;
+}
+
+void tst_UAVTalk::parseWholeStream()
+{
+    QBuffer buffer(&stream);
+
+    buffer.open(QIODevice::ReadOnly);
+    UAVTalk talk(&buffer, objMngr);
+
+    process(&talk);
+    UAVTalk::ComStats stats = talk.getStats();
+    QCOMPARE(stats.rxObjects, packets);
+    QCOMPARE(stats.rxBytes, (quint32)stream.size());
+    QCOMPARE(stats.rxErrors, 0u);
+    QCOMPARE(stats.rxSyncErrors, 0u);
+    QCOMPARE(stats.rxCrcErrors, 0u);
+}
+
+void tst_UAVTalk::parseSplitStream()
+{
+    QByteArray data;
+    QBuffer buffer(&data);
+
+    buffer.open(QIODevice::ReadOnly);
+    UAVTalk talk(&buffer, objMngr);
+
+    // Odd sized reads split frames at every possible position
+    for (int pos = 0; pos < stream.size(); pos += 7) {
+        data.append(stream.mid(pos, 7));
+        process(&talk);
+    }
+    UAVTalk::ComStats stats = talk.getStats();
+    QCOMPARE(stats.rxObjects, packets);
+    QCOMPARE(stats.rxBytes, (quint32)stream.size());
+    QCOMPARE(stats.rxErrors, 0u);
+}
+
+void tst_UAVTalk::parseWithGarbage()
+{
+    QByteArray data = QByteArray(5, 0) + stream + QByteArray(3, 0) + stream;
+    quint16 size    = qFromLittleEndian<quint16>((const uchar *)stream.constData() + 2);
+
+    // Corrupt the checksum of the first frame
+    data[5 + size] = data.at(5 + size) ^ 0xFF;
+
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    UAVTalk talk(&buffer, objMngr);
+
+    process(&talk);
+    UAVTalk::ComStats stats = talk.getStats();
+    QCOMPARE(stats.rxObjects, 2 * packets - 1);
+    QCOMPARE(stats.rxCrcErrors, 1u);
+    QCOMPARE(stats.rxBytes, (quint32)data.size());
+}
+
+void tst_UAVTalk::deltaUpdates()
+{
+    UAVObjectManager remoteMngr;
+
+    UAVObjectsInitialize(&remoteMngr);
+
+    // Pick the largest object that fits in a packet
+    UAVObject *obj = NULL;
+    foreach(QList<UAVObject *> list, objMngr->getObjects()) {
+        UAVObject *o = list.first();
+        if (o->getNumBytes() < 256 && (obj == NULL || o->getNumBytes() > obj->getNumBytes())) {
+            obj = o;
+        }
+    }
+    QVERIFY(obj != NULL && obj->getNumBytes() > 24);
+    UAVObject *remoteObj = remoteMngr.getObject(obj->getObjID());
+    QVERIFY(remoteObj != NULL);
+
+    LoopbackDevice localIo;
+    LoopbackDevice remoteIo;
+    UAVTalk local(&localIo, objMngr);
+    UAVTalk remote(&remoteIo, &remoteMngr);
+    QSignalSpy completed(&local, SIGNAL(transactionCompleted(UAVObject *, bool)));
+
+    QVERIFY(local.sendCapabilityRequest());
+    pump(&local, &localIo, &remote, &remoteIo);
+
+    QByteArray data(obj->getNumBytes(), 0);
+    QByteArray remoteData(obj->getNumBytes(), 0);
+    for (int i = 0; i < data.size(); i++) {
+        data[i] = (char)(i * 3);
+    }
+
+    // The first update is sent whole, it becomes the reference once acked
+    obj->unpack((const quint8 *)data.constData());
+    QVERIFY(local.sendObject(obj, true, false));
+    pump(&local, &localIo, &remote, &remoteIo);
+    remoteObj->pack((quint8 *)remoteData.data());
+    QCOMPARE(remoteData, data);
+    QCOMPARE(local.getStats().txDeltaBytesSaved, 0u);
+
+    // Only the changed chunk goes over the link
+    data[5] = data.at(5) ^ 0x55;
+    obj->unpack((const quint8 *)data.constData());
+    QVERIFY(local.sendObject(obj, true, false));
+    pump(&local, &localIo, &remote, &remoteIo);
+    remoteObj->pack((quint8 *)remoteData.data());
+    QCOMPARE(remoteData, data);
+    QVERIFY(local.getStats().txDeltaBytesSaved > 0);
+    QCOMPARE(remote.getStats().rxDeltaBytesSaved, local.getStats().txDeltaBytesSaved);
+
+    // A remote copy that changed meanwhile is NACKed and the whole object is sent again
+    remoteData[10] = remoteData.at(10) ^ 0x01;
+    remoteObj->unpack((const quint8 *)remoteData.constData());
+    data[20] = data.at(20) ^ 0x01;
+    obj->unpack((const quint8 *)data.constData());
+    QVERIFY(local.sendObject(obj, true, false));
+    pump(&local, &localIo, &remote, &remoteIo);
+    remoteObj->pack((quint8 *)remoteData.data());
+    QCOMPARE(remoteData, data);
+
+    QCOMPARE(completed.count(), 3);
+    foreach(const QList<QVariant> &args, completed) {
+        QVERIFY(args.at(1).toBool());
+    }
+}
+
+void tst_UAVTalk::telemetryAck()
+{
+    UAVObjectManager remoteMngr;
+
+    UAVObjectsInitialize(&remoteMngr);
+    setConnected(true);
+
+    LoopbackDevice localIo;
+    LoopbackDevice remoteIo;
+    UAVTalk local(&localIo, objMngr);
+    UAVTalk remote(&remoteIo, &remoteMngr);
+    Telemetry telemetry(&local, objMngr);
+
+    QList<UAVObject *> objs = ackedObjects(1);
+    QCOMPARE(objs.length(), 1);
+    QSignalSpy completed(objs.first(), SIGNAL(transactionCompleted(UAVObject *, bool)));
+
+    objs.first()->updated();
+    QCOMPARE(telemetry.getStats().txInFlight, 1u);
+
+    // The flight side acks the update, which closes the transaction
+    pump(&local, &localIo, &remote, &remoteIo);
+    QCOMPARE(completed.count(), 1);
+    QVERIFY(completed.first().at(1).toBool());
+
+    Telemetry::TelemetryStats stats = telemetry.getStats();
+    QCOMPARE(stats.txInFlight, 0u);
+    QCOMPARE(stats.txInFlightPeak, 1u);
+    QCOMPARE(stats.txRetries, 0u);
+    QCOMPARE(stats.txErrors, 0u);
+
+    setConnected(false);
+}
+
+void tst_UAVTalk::telemetryRetry()
+{
+    UAVObjectManager remoteMngr;
+
+    UAVObjectsInitialize(&remoteMngr);
+    setConnected(true);
+
+    LoopbackDevice localIo;
+    LoopbackDevice remoteIo;
+    UAVTalk local(&localIo, objMngr);
+    UAVTalk remote(&remoteIo, &remoteMngr);
+    Telemetry telemetry(&local, objMngr);
+
+    QList<UAVObject *> objs = ackedObjects(1);
+    QCOMPARE(objs.length(), 1);
+    QSignalSpy completed(objs.first(), SIGNAL(transactionCompleted(UAVObject *, bool)));
+
+    // The first update is lost, the retry gets through
+    objs.first()->updated();
+    localIo.out.clear();
+    QTRY_COMPARE_WITH_TIMEOUT(telemetry.getStats().txRetries, 1u, TRANSACTION_TIMEOUT_MS);
+    pump(&local, &localIo, &remote, &remoteIo);
+
+    QCOMPARE(completed.count(), 1);
+    QVERIFY(completed.first().at(1).toBool());
+    QCOMPARE(telemetry.getStats().txInFlight, 0u);
+    QCOMPARE(telemetry.getStats().txErrors, 0u);
+
+    setConnected(false);
+}
+
+void tst_UAVTalk::telemetryLoss()
+{
+    setConnected(true);
+
+    LoopbackDevice localIo;
+    UAVTalk local(&localIo, objMngr);
+    Telemetry telemetry(&local, objMngr);
+
+    QList<UAVObject *> objs = ackedObjects(1);
+    QCOMPARE(objs.length(), 1);
+    QSignalSpy completed(objs.first(), SIGNAL(transactionCompleted(UAVObject *, bool)));
+
+    // Nothing gets through, the transaction fails once the retries are used up
+    objs.first()->updated();
+    QElapsedTimer timer;
+    timer.start();
+    while (completed.isEmpty() && timer.elapsed() < TRANSACTION_TIMEOUT_MS) {
+        localIo.out.clear();
+        QTest::qWait(10);
+    }
+    QCOMPARE(completed.count(), 1);
+    QVERIFY(!completed.first().at(1).toBool());
+
+    Telemetry::TelemetryStats stats = telemetry.getStats();
+    QCOMPARE(stats.txInFlight, 0u);
+    QCOMPARE(stats.txRetries, 2u);
+    QVERIFY(stats.txErrors > 0);
+
+    setConnected(false);
+}
+
+void tst_UAVTalk::telemetryWindowFull()
+{
+    UAVObjectManager remoteMngr;
+
+    UAVObjectsInitialize(&remoteMngr);
+    setConnected(true);
+
+    LoopbackDevice localIo;
+    LoopbackDevice remoteIo;
+    UAVTalk local(&localIo, objMngr);
+    UAVTalk remote(&remoteIo, &remoteMngr);
+    Telemetry telemetry(&local, objMngr);
+
+    telemetry.setTransactionWindow(2);
+    QCOMPARE(telemetry.getTransactionWindow(), 2);
+
+    QList<UAVObject *> objs = ackedObjects(4);
+    QCOMPARE(objs.length(), 4);
+    QList<QSignalSpy *> completed;
+    foreach(UAVObject * obj, objs) {
+        completed.append(new QSignalSpy(obj, SIGNAL(transactionCompleted(UAVObject *, bool))));
+        obj->updated();
+    }
+
+    // Two are sent, the other two wait for a slot
+    QCOMPARE(telemetry.getStats().txInFlight, 2u);
+
+    // Each ack lets a waiting one go
+    pump(&local, &localIo, &remote, &remoteIo);
+    foreach(QSignalSpy * spy, completed) {
+        QCOMPARE(spy->count(), 1);
+        QVERIFY(spy->first().at(1).toBool());
+    }
+
+    Telemetry::TelemetryStats stats = telemetry.getStats();
+    QCOMPARE(stats.txInFlight, 0u);
+    QCOMPARE(stats.txInFlightPeak, 2u);
+    QCOMPARE(stats.txRetries, 0u);
+
+    qDeleteAll(completed);
+    setConnected(false);
+}
+
+void tst_UAVTalk::benchmarkReplay()
+{
+    QByteArray data;
+    QString logName = qgetenv("UAVTALK_BENCH_LOG");
+
+    if (!logName.isEmpty()) {
+        data = loadLog(logName);
+        QVERIFY2(!data.isEmpty(), "could not read UAVTALK_BENCH_LOG");
+    } else {
+        // Small enough to run with the tests, QBENCHMARK repeats it as needed
+        while (data.size() < BENCH_STREAM_SIZE) {
+            data.append(stream);
+        }
+    }
+
+    UAVTalk::ComStats stats;
+    QBENCHMARK {
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadOnly);
+        UAVTalk talk(&buffer, objMngr);
+        process(&talk);
+        stats = talk.getStats();
+    }
+    qDebug() << "UAVTalk replay:" << stats.rxObjects << "packets" << stats.rxBytes << "bytes per iteration";
+    QVERIFY(stats.rxObjects > 0);
+}
+
+QTEST_GUILESS_MAIN(tst_UAVTalk)
+
+#include "tst_uavtalk.moc"
@@ -56,9 +56,11 @@ UAVTalk::UAVTalk(QIODevice *iodev, UAVObjectManager *objMngr) : io(iodev), objMn
 
     memset(&stats, 0, sizeof(ComStats));
 
+    peerCaps = 0;
+
     ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
     Core::Internal::GeneralSettings *settings = pm->getObject<Core::Internal::GeneralSettings>();
-    useUDPMirror = settings->useUDPMirror();
+    useUDPMirror = settings && settings->useUDPMirror();
     if (useUDPMirror) {
         qDebug() << "UAVTalk::UAVTalk -*** UDP mirror is enabled ***";
     }
@@ -160,6 +162,31 @@ bool UAVTalk::sendObjectRequest(UAVObject *obj, bool allInstances)
     return objectTransaction(TYPE_OBJ_REQ, obj->getObjID(), instId, obj);
 }
 
+/**
+ * Ask the peer which optional protocol features it supports.
+ * Until it answers only the basic protocol is used, older peers simply NACK the request.
+ * \return Success (true), Failure (false)
+ */
+bool UAVTalk::sendCapabilityRequest()
+{
+    QMutexLocker locker(&mutex);
+
+    resetCapabilities();
+    return transmitSingleObject(TYPE_OBJ_REQ, CAPS_OBJID, CAPS, NULL);
+}
+
+/**
+ * Forget the optional features negotiated with the peer, along with the delta references.
+ * To be called when the link is lost, the next peer negotiates again.
+ */
+void UAVTalk::resetCapabilities()
+{
+    QMutexLocker locker(&mutex);
+
+    peerCaps = 0;
+    deltaRefs.clear();
+}
+
 /**
  * Cancel a pending transaction
  */
@@ -210,36 +237,113 @@ bool UAVTalk::objectTransaction(quint8 type, quint32 objId, quint16 instId, UAVO
  */
 void UAVTalk::processInputStream()
 {
-    quint8 tmp;
-
     if (io && io->isReadable()) {
         while (io->bytesAvailable() > 0) {
-            int ret = io->read((char *)&tmp, 1);
-            if (ret != -1) {
-                processInputByte(tmp);
-            } else {
-                // TODOD
+            qint64 length = io->read((char *)rxChunkBuffer, qMin(io->bytesAvailable(), (qint64)RX_CHUNK_SIZE));
+            if (length <= 0) {
+                break;
             }
-            if (rxState == STATE_COMPLETE) {
-                mutex.lock();
-                if (receiveObject(rxType, rxObjId, rxInstId, rxBuffer, rxLength)) {
-                    stats.rxObjectBytes += rxLength;
-                    stats.rxObjects++;
-                } else {
-                    // TODO...
-                }
-                mutex.unlock();
+            QMutexLocker locker(&mutex);
+            processInputBuffer(rxChunkBuffer, length);
+        }
+    }
+}
 
+/**
+ * Process a buffer of bytes from the telemetry stream.
+ * Complete frames found between packets are decoded in place, partial or invalid
+ * frames go through the byte by byte state machine.
+ * \param[in] data Received bytes
+ * \param[in] length Number of bytes in the buffer
+ */
+void UAVTalk::processInputBuffer(quint8 *data, qint32 length)
+{
+    qint32 pos = 0;
+
+    while (pos < length) {
+        if (rxState == STATE_SYNC || rxState == STATE_COMPLETE || rxState == STATE_ERROR) {
+            // Skip to the next sync byte
+            quint8 *sync = (quint8 *)memchr(data + pos, SYNC_VAL, length - pos);
+            qint32 skipped = sync ? (qint32)(sync - (data + pos)) : length - pos;
+            stats.rxBytes      += skipped;
+            stats.rxSyncErrors += skipped;
+            pos += skipped;
+            if (sync == NULL) {
+                break;
+            }
+
+            qint32 frameLength = processInputFrame(data + pos, length - pos);
+            if (frameLength > 0) {
+                stats.rxBytes += frameLength;
+                receivePacket(data[1 + pos], qFromLittleEndian<quint32>(data + pos + 4), qFromLittleEndian<quint16>(data + pos + 8),
+                              data + pos + HEADER_LENGTH, frameLength - HEADER_LENGTH - CHECKSUM_LENGTH);
                 if (useUDPMirror) {
-                    // it is safe to do this outside of the above critical section as the rxDataArray is
-                    // accessed from this thread only
-                    udpSocketTx->writeDatagram(rxDataArray, QHostAddress::LocalHost, udpSocketRx->localPort());
+                    udpSocketTx->writeDatagram((const char *)data + pos, frameLength, QHostAddress::LocalHost, udpSocketRx->localPort());
                 }
+                pos += frameLength;
+                continue;
+            }
+        }
+
+        processInputByte(data[pos++]);
+        if (rxState == STATE_COMPLETE) {
+            receivePacket(rxType, rxObjId, rxInstId, rxBuffer, rxLength);
+            if (useUDPMirror) {
+                udpSocketTx->writeDatagram(rxDataArray, QHostAddress::LocalHost, udpSocketRx->localPort());
             }
         }
     }
 }
 
+/**
+ * Check for a complete and valid frame at the start of a buffer.
+ * Performs the same checks as the state machine, without reporting errors.
+ * \param[in] data Buffer starting with a sync byte
+ * \param[in] length Number of bytes in the buffer
+ * \return Length of the frame including checksum, 0 if the frame is incomplete or invalid
+ */
+qint32 UAVTalk::processInputFrame(quint8 *data, qint32 length)
+{
+    if (length < HEADER_LENGTH + CHECKSUM_LENGTH) {
+        return 0;
+    }
+
+    quint8 type = data[1];
+    if ((type & TYPE_MASK) != TYPE_VER) {
+        return 0;
+    }
+
+    qint32 size = qFromLittleEndian<quint16>(data + 2);
+    if (size < HEADER_LENGTH || size > HEADER_LENGTH + MAX_PAYLOAD_LENGTH) {
+        return 0;
+    }
+    if (length < size + CHECKSUM_LENGTH) {
+        return 0;
+    }
+
+    quint32 objId = qFromLittleEndian<quint32>(data + 4);
+    UAVObject *obj = objMngr->getObject(objId);
+    if (obj == NULL && type != TYPE_OBJ_REQ && !(type == TYPE_ACK && objId == CAPS_OBJID)) {
+        return 0;
+    }
+
+    qint32 dataLength = 0;
+    if (type == TYPE_OBJ_ACK_DELTA) {
+        dataLength = size - HEADER_LENGTH;
+    } else if (type != TYPE_OBJ_REQ && type != TYPE_ACK && type != TYPE_NACK) {
+        dataLength = obj->getNumBytes();
+    }
+    if (dataLength >= MAX_PAYLOAD_LENGTH || HEADER_LENGTH + dataLength != size) {
+        return 0;
+    }
+
+    if (Crc::updateCRC(0, data, size) != data[size]) {
+        return 0;
+    }
+
+    return size + CHECKSUM_LENGTH;
+}
+
 /**
  * Process an byte from the telemetry stream.
  * \param[in] rxbyte Received byte
@@ -364,7 +468,7 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
         // Search for object, if not found reset state machine
         {
             UAVObject *rxObj = objMngr->getObject(rxObjId);
-            if (rxObj == NULL && rxType != TYPE_OBJ_REQ) {
+            if (rxObj == NULL && rxType != TYPE_OBJ_REQ && !(rxType == TYPE_ACK && rxObjId == CAPS_OBJID)) {
                 qWarning() << "UAVTalk - error : unknown object" << rxObjId;
                 stats.rxErrors++;
                 rxState = STATE_ERROR;
@@ -375,7 +479,7 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
             if (rxType == TYPE_OBJ_REQ || rxType == TYPE_ACK || rxType == TYPE_NACK) {
                 rxLength = 0;
             } else {
-                if (rxObj) {
+                if (rxObj && rxType != TYPE_OBJ_ACK_DELTA) {
                     rxLength = rxObj->getNumBytes();
                 } else {
                     rxLength = packetSize - rxPacketLength;
@@ -458,6 +562,19 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
     return true;
 }
 
+/**
+ * Hand a complete packet to receiveObject() and update the statistics.
+ */
+void UAVTalk::receivePacket(quint8 type, quint32 objId, quint16 instId, quint8 *data, qint32 length)
+{
+    if (receiveObject(type, objId, instId, data, length)) {
+        stats.rxObjectBytes += length;
+        stats.rxObjects++;
+    } else {
+        // TODO...
+    }
+}
+
 /**
  * Receive an object. This function process objects received through the telemetry stream.
  *
@@ -476,8 +593,6 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
  */
 bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *data, qint32 length)
 {
-    Q_UNUSED(length);
-
     UAVObject *obj    = NULL;
     bool error        = false;
     bool allInstances = (instId == ALL_INSTANCES);
@@ -528,7 +643,35 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *
         }
         break;
 
+    case TYPE_OBJ_ACK_DELTA:
+        // All instances, not allowed for OBJ_ACK messages
+        if (!allInstances) {
+            // Apply the changes to the existing instance
+            obj = updateObjectDelta(objId, instId, data, length);
+#ifdef VERBOSE_UAVTALK
+            VERBOSE_FILTER(objId) qDebug() << "UAVTalk - received object delta (acked)" << objId << instId << (obj != NULL ? obj->toStringBrief() : "<null object>");
+#endif
+            if (obj != NULL) {
+                error = !transmitObject(TYPE_ACK, objId, instId, obj);
+            } else {
+                error = true;
+            }
+        } else {
+            error = true;
+        }
+        if (error) {
+            // our copy is not the one the delta was encoded against, the sender will send the whole object
+            transmitObject(TYPE_NACK, objId, instId, NULL);
+        }
+        break;
+
     case TYPE_OBJ_REQ:
+        if (objId == CAPS_OBJID) {
+            // Capability probe, remember what the peer supports and answer with ours
+            peerCaps = instId;
+            error    = !transmitSingleObject(TYPE_ACK, CAPS_OBJID, CAPS, NULL);
+            break;
+        }
         // Check if requested object exists
         if (allInstances) {
             // All instances, so get instance zero
@@ -553,6 +696,12 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *
         break;
 
     case TYPE_ACK:
+        if (objId == CAPS_OBJID) {
+            // Answer to our capability probe
+            peerCaps = instId;
+            qDebug() << "UAVTalk - peer capabilities" << peerCaps;
+            break;
+        }
         // All instances, not allowed for ACK messages
         if (!allInstances) {
             // Get object
@@ -634,6 +783,99 @@ UAVObject *UAVTalk::updateObject(quint32 objId, quint16 instId, quint8 *data)
     }
 }
 
+/**
+ * Apply a delta encoded update to an existing object instance.
+ * The result must match the CRC16 of the copy the sender encoded the delta from.
+ */
+UAVObject *UAVTalk::updateObjectDelta(quint32 objId, quint16 instId, const quint8 *data, qint32 length)
+{
+    UAVObject *obj = objMngr->getObject(objId, instId);
+
+    if (obj == NULL) {
+        return NULL;
+    }
+
+    qint32 numBytes     = obj->getNumBytes();
+    qint32 bitmapLength = ((numBytes + DELTA_CHUNK_SIZE - 1) / DELTA_CHUNK_SIZE + 7) / 8;
+    if (length < 2 + bitmapLength || numBytes > MAX_PAYLOAD_LENGTH) {
+        return NULL;
+    }
+
+    quint8 buffer[MAX_PAYLOAD_LENGTH];
+    obj->pack(buffer);
+
+    const quint8 *bitmap = data + 2;
+    const quint8 *in     = data + 2 + bitmapLength;
+    const quint8 *end    = data + length;
+    for (qint32 chunk = 0, offset = 0; offset < numBytes; ++chunk, offset += DELTA_CHUNK_SIZE) {
+        if (bitmap[chunk / 8] & (1 << (chunk % 8))) {
+            qint32 size = qMin((qint32)DELTA_CHUNK_SIZE, numBytes - offset);
+            if (in + size > end) {
+                return NULL;
+            }
+            memcpy(buffer + offset, in, size);
+            in += size;
+        }
+    }
+    if (in != end || Crc::updateCRC16(0, buffer, numBytes) != qFromLittleEndian<quint16>(data)) {
+        qWarning() << "UAVTalk - delta does not apply to" << obj->toStringBrief();
+        return NULL;
+    }
+
+    obj->unpack(buffer);
+    stats.rxDeltaBytesSaved += numBytes - length;
+    return obj;
+}
+
+/**
+ * Replace packed object data by its delta against the copy the peer last acked.
+ * The packed data always becomes the new reference, pending until the peer acks it.
+ * \return Length of the delta or -1 if the whole object has to be sent
+ */
+qint32 UAVTalk::packDelta(quint32 objId, quint16 instId, quint8 *data, qint32 length)
+{
+    DeltaRef &ref = deltaRefs[((quint64)objId << 16) | instId];
+    bool haveBase = ref.acked && ref.data.size() == length;
+
+    qint32 bitmapLength = ((length + DELTA_CHUNK_SIZE - 1) / DELTA_CHUNK_SIZE + 7) / 8;
+    qint32 deltaLength  = 2 + bitmapLength;
+    QVarLengthArray<quint8, 32> bitmap(bitmapLength);
+
+    if (haveBase) {
+        memset(bitmap.data(), 0, bitmapLength);
+        const quint8 *base = (const quint8 *)ref.data.constData();
+        for (qint32 chunk = 0, offset = 0; offset < length; ++chunk, offset += DELTA_CHUNK_SIZE) {
+            qint32 size = qMin((qint32)DELTA_CHUNK_SIZE, length - offset);
+            if (memcmp(base + offset, data + offset, size) != 0) {
+                bitmap[chunk / 8] |= 1 << (chunk % 8);
+                deltaLength += size;
+            }
+        }
+    }
+
+    ref.data  = QByteArray((const char *)data, length);
+    ref.acked = false;
+    ref.sentDelta = haveBase && deltaLength < length;
+    if (!ref.sentDelta) {
+        return -1;
+    }
+
+    // Changed chunks are taken from the reference, which now holds the new data
+    const quint8 *current = (const quint8 *)ref.data.constData();
+    quint8 *out = data + 2 + bitmapLength;
+    for (qint32 chunk = 0, offset = 0; offset < length; ++chunk, offset += DELTA_CHUNK_SIZE) {
+        if (bitmap[chunk / 8] & (1 << (chunk % 8))) {
+            qint32 size = qMin((qint32)DELTA_CHUNK_SIZE, length - offset);
+            memcpy(out, current + offset, size);
+            out += size;
+        }
+    }
+    qToLittleEndian<quint16>(Crc::updateCRC16(0, current, length), data);
+    memcpy(data + 2, bitmap.constData(), bitmapLength);
+
+    return deltaLength;
+}
+
 /**
  * Check if a transaction is pending and if yes complete it.
  */
@@ -643,6 +885,13 @@ void UAVTalk::updateAck(quint8 type, quint32 objId, quint16 instId, UAVObject *o
     if (!obj) {
         return;
     }
+    if (type == TYPE_ACK) {
+        // The peer now holds the copy last sent, use it as reference for the next delta
+        QHash<quint64, DeltaRef>::iterator ref = deltaRefs.find(((quint64)objId << 16) | instId);
+        if (ref != deltaRefs.end()) {
+            ref->acked = true;
+        }
+    }
     Transaction *trans = findTransaction(objId, instId);
     if (trans && trans->respType == type) {
         if (trans->respInstId == ALL_INSTANCES) {
@@ -671,6 +920,15 @@ void UAVTalk::updateNack(quint32 objId, quint16 instId, UAVObject *obj)
     }
     Transaction *trans = findTransaction(objId, instId);
     if (trans) {
+        // A delta the peer could not apply is answered by sending the whole object, once
+        QHash<quint64, DeltaRef>::iterator ref = deltaRefs.find(((quint64)objId << 16) | instId);
+        if (ref != deltaRefs.end()) {
+            bool sentDelta = ref->sentDelta;
+            deltaRefs.erase(ref);
+            if (sentDelta && trans->respType == TYPE_ACK && transmitSingleObject(TYPE_OBJ_ACK, objId, instId, obj)) {
+                return;
+            }
+        }
         closeTransaction(trans);
         emit transactionCompleted(obj, false);
     }
@@ -781,6 +1039,17 @@ bool UAVTalk::transmitSingleObject(quint8 type, quint32 objId, quint16 instId, U
         }
     }
 
+    // Only send the changes if the peer acked a previous copy of the object
+    qint32 saved = 0;
+    if (type == TYPE_OBJ_ACK && length > 0 && (peerCaps & CAPS_DELTA)) {
+        qint32 deltaLength = packDelta(objId, instId, &txBuffer[HEADER_LENGTH], length);
+        if (deltaLength > 0) {
+            txBuffer[1] = TYPE_OBJ_ACK_DELTA;
+            saved  = length - deltaLength;
+            length = deltaLength;
+        }
+    }
+
     // Store the packet length
     qToLittleEndian<quint16>(HEADER_LENGTH + length, &txBuffer[2]);
 
@@ -809,6 +1078,7 @@ bool UAVTalk::transmitSingleObject(quint8 type, quint32 objId, quint16 instId, U
     ++stats.txObjects;
     stats.txObjectBytes += length;
     stats.txBytes += HEADER_LENGTH + length + CHECKSUM_LENGTH;
+    stats.txDeltaBytesSaved += saved;
 
     // Done
     return true;
@@ -885,6 +1155,11 @@ const char *UAVTalk::typeToString(quint8 type)
 
         break;
 
+    case TYPE_OBJ_ACK_DELTA:
+        return "object delta (acked)";
+
+        break;
+
     case TYPE_OBJ_REQ:
         return "object request";
 
@@ -58,6 +58,9 @@ public:
         quint32 rxErrors;
         quint32 rxSyncErrors;
         quint32 rxCrcErrors;
+
+        quint32 txDeltaBytesSaved;
+        quint32 rxDeltaBytesSaved;
     } ComStats;
 
     UAVTalk(QIODevice *iodev, UAVObjectManager *objMngr);
@@ -68,6 +71,8 @@ public:
 
     bool sendObject(UAVObject *obj, bool acked, bool allInstances);
     bool sendObjectRequest(UAVObject *obj, bool allInstances);
+    bool sendCapabilityRequest();
+    void resetCapabilities();
     void cancelTransaction(UAVObject *obj);
 
 signals:
@@ -85,6 +90,13 @@ private:
         quint16 respInstId;
     } Transaction;
 
+    // Last copy of an object sent acked, delta updates are encoded against it once acked
+    typedef struct {
+        QByteArray data;
+        bool acked;
+        bool sentDelta;
+    } DeltaRef;
+
     // Constants
     static const int TYPE_MASK     = 0xF8;
     static const int TYPE_VER      = 0x20;
@@ -93,6 +105,16 @@ private:
     static const int TYPE_OBJ_ACK  = (TYPE_VER | 0x02);
     static const int TYPE_ACK      = (TYPE_VER | 0x03);
     static const int TYPE_NACK     = (TYPE_VER | 0x04);
+    static const int TYPE_OBJ_ACK_DELTA = (TYPE_VER | 0x05);
+
+    // Optional protocol features are negotiated with an object request for this ID, the instance ID
+    // carries the feature bits of the sender and the ack those of the peer
+    static const quint32 CAPS_OBJID = 0x55415654;
+    static const quint16 CAPS_DELTA = 0x0001;
+    static const quint16 CAPS = CAPS_DELTA;
+
+    // delta payload : CRC16 of the whole object(2), bitmap with one bit per chunk, changed chunks
+    static const int DELTA_CHUNK_SIZE = 4;
 
     // header : sync(1), type (1), size(2), object ID(4), instance ID(2)
     static const int HEADER_LENGTH = 10;
@@ -105,6 +127,8 @@ private:
 
     static const int TX_BUFFER_SIZE     = 2 * 1024;
 
+    static const int RX_CHUNK_SIZE      = 4 * 1024;
+
     // Types
     typedef enum {
         STATE_SYNC, STATE_TYPE, STATE_SIZE, STATE_OBJID, STATE_INSTID, STATE_DATA, STATE_CS, STATE_COMPLETE, STATE_ERROR
@@ -121,8 +145,14 @@ private:
 
     QMap<quint32, QMap<quint32, Transaction *> *> transMap;
 
+    quint16 peerCaps;
+    QHash<quint64, DeltaRef> deltaRefs;
+
     quint8 rxBuffer[MAX_PACKET_LENGTH];
 
+    // Bytes read from the device in one go, complete frames are decoded in place
+    quint8 rxChunkBuffer[RX_CHUNK_SIZE];
+
     quint8 txBuffer[MAX_PACKET_LENGTH];
 
     // Variables used by the receive state machine
@@ -147,9 +177,14 @@ private:
 
     // Methods
     bool objectTransaction(quint8 type, quint32 objId, quint16 instId, UAVObject *obj);
+    void processInputBuffer(quint8 *data, qint32 length);
+    qint32 processInputFrame(quint8 *data, qint32 length);
     bool processInputByte(quint8 rxbyte);
+    void receivePacket(quint8 type, quint32 objId, quint16 instId, quint8 *data, qint32 length);
     bool receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *data, qint32 length);
     UAVObject *updateObject(quint32 objId, quint16 instId, quint8 *data);
+    UAVObject *updateObjectDelta(quint32 objId, quint16 instId, const quint8 *data, qint32 length);
+    qint32 packDelta(quint32 objId, quint16 instId, quint8 *data, qint32 length);
     void updateAck(quint8 type, quint32 objId, quint16 instId, UAVObject *obj);
     void updateNack(quint32 objId, quint16 instId, UAVObject *obj);
     bool transmitObject(quint8 type, quint32 objId, quint16 instId, UAVObject *obj);